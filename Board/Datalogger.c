@@ -30,6 +30,51 @@
 #define DATALOGGER_DATA_SAVE_RATE		30	//these must be less than 60 for now...
 #define DATALOGGER_MIN_TO_SKIP			5
 
+//Return values for Datalogger_ReadDataSet
+#define DATALOGGER_DATASET_OK			0x00	//A valid data set was found
+#define DATALOGGER_DATASET_NONE			0x01	//There is no data set header at this location
+#define DATALOGGER_DATASET_BAD_CRC		0x02	//The data set is damaged (torn write or corrupted flash)
+#define DATALOGGER_DATASET_OTHER_LAYOUT	0x03	//The data set was written with another CHANNEL_LIST. Skip it by its size.
+
+#if DATALOGGER_USE_CRC == 1
+//Lookup table for the CRC-16 (CCITT polynomial x^16 + x^12 + x^5 + 1, initial value 0xFFFF)
+static const uint16_t Datalogger_CRC16Table[256] PROGMEM =
+{
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+	0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+	0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+	0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+	0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+	0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+	0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+	0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+	0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+	0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+	0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+	0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+	0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+	0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+	0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+	0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+	0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+	0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+	0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+	0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+	0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+	0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+#endif
+
 uint8_t DataToSave[DATALOGGER_DATASET_SIZE];		//The running average of the data
 uint8_t DataLoggerStarted = 0;
 		//The current data set to average
@@ -43,40 +88,61 @@ uint8_t NextTimeToSaveData;
 //Variables used to write data
 uint16_t DataSetAddress;	//Points to the address in the page where the next data set goes
 uint16_t DataPageAddress;	//Points to the current page to which we are writing data
+uint32_t DataPageSequence;	//The sequence number of the current page
+uint16_t TailPageAddress;	//Points to the page that holds the oldest data
 uint8_t BufferInUse;		//Points to the current buffer to which we are saving data
 
+//The data set being written to the dataflash buffer
+static uint8_t DataSetRecord[DATALOGGER_RECORD_SIZE];
+static SPIBus_Transaction DataSetWrite;
+
 //I think these are useless
 uint8_t DataSetSizeBytes;	
 //uint8_t DataSetsPerPage;
 
 uint8_t DataloggerInitalized = 0;
 
+static uint32_t Datalogger_GetPageSequence(uint16_t PageNumber);
+static uint32_t Datalogger_GetPageTime(uint16_t PageNumber);
+static uint32_t Datalogger_TimeKey(uint8_t *TimeBytes);
+static uint16_t Datalogger_GetLastPage(void);
+static uint8_t Datalogger_LoadPage(uint8_t Buffer, uint16_t PageNumber, uint32_t *ExpectedSequence);
+static uint8_t Datalogger_ReadDataSet(uint8_t Buffer, uint16_t Address, uint8_t DataSet[], uint8_t *DataSetSize);
+static void Datalogger_PrintDataSet(uint8_t DataSet[]);
+#if DATALOGGER_USE_CRC == 1
+static uint16_t Datalogger_CRC16(uint16_t CRC, uint8_t Data[], uint8_t Length);
+#endif
+static uint16_t Datalogger_NextPage(uint16_t PageNumber);
+
 void Datalogger_Init(uint8_t SetupByte)
 {
 	uint16_t StartingPage;
 	uint16_t StartingLocationInPage;
 	
-	DataSetSizeBytes = DATALOGGER_DATASET_SIZE + 2;
-	#if DATALOGGER_USE_CRC == 1
-	DataSetSizeBytes++;
-	#endif
+	DataSetSizeBytes = DATALOGGER_RECORD_SIZE;
 
 	printf_P(PSTR("Data set size: %u\n"), DataSetSizeBytes);
-	printf_P(PSTR("Sets per page: %u\n"), DATALOGGER_PAGE_SIZE/DataSetSizeBytes);
+	printf_P(PSTR("Sets per page: %u\n"), (DATALOGGER_PAGE_SIZE-DATALOGGER_PAGE_HEADER_SIZE)/DataSetSizeBytes);
 
 	//printf_P(PSTR("h1: 0x%02X\n"), ((DataSetSizeBytes >> 4) | DATALOGGER_HEADER1_PREFIX) );
 	//printf_P(PSTR("h2: 0X%02X\n"), ((uint8_t)(DataSetSizeBytes << 4) | DATALOGGER_HEADER2_SUFFIX));
 
-	//This should eventually search for preexisting data sets, but for now, initalize to zero
+	BufferInUse = 1;
+
+	//Find the newest page. This also finds the sequence number of that page and the oldest page.
+	Datalogger_FindLastDataSet(&StartingPage, &StartingLocationInPage);
+
 	if((SetupByte & DATALOGGER_INIT_APPEND) == DATALOGGER_INIT_APPEND)
 	{
-		Datalogger_FindLastDataSet(&StartingPage, &StartingLocationInPage);
 		if((StartingPage > 0x1FFF) && (StartingLocationInPage > 0x1FFF))
 		{
 			if((SetupByte & DATALOGGER_INIT_RESTART_IF_FULL) == DATALOGGER_INIT_RESTART_IF_FULL)
 			{
+				//Reclaim the oldest page. The next oldest page becomes the tail.
 				DataSetAddress = 0;
-				DataPageAddress = 0;
+				DataPageAddress = TailPageAddress;
+				DataPageSequence++;
+				TailPageAddress = Datalogger_NextPage(TailPageAddress);
 			}
 			else
 			{
@@ -88,16 +154,24 @@ void Datalogger_Init(uint8_t SetupByte)
 		{
 			DataSetAddress = StartingLocationInPage;
 			DataPageAddress = StartingPage;
+			
+			//Reload the partially written page so that the data already in it is not lost when the page is written again
+			if(DataSetAddress > 0)
+			{
+				AT45DB321D_CopyPageToBuffer(BufferInUse, DataPageAddress);
+				AT45DB321D_WaitForReady();
+			}
 		}
 	}
 	else
 	{
+		//Keep counting up from the newest sequence number so the old pages are seen as older than page 0
 		DataSetAddress = 0;
 		DataPageAddress = 0;
+		DataPageSequence++;
+		TailPageAddress = 0;
 	}
 	
-	BufferInUse = 1;
-	
 	printf_P(PSTR("Starting data collection in page 0x%04X at address 0x%04X\n"), DataPageAddress, DataSetAddress);
 	
 	
@@ -110,7 +184,10 @@ void Datalogger_Init(uint8_t SetupByte)
 
 void Datalogger_AddDataSet(uint8_t DataSet[])
 {
-	uint8_t DataSetHeader[2];
+	uint8_t PageHeader[DATALOGGER_PAGE_HEADER_SIZE];
+	#if DATALOGGER_USE_CRC == 1
+	uint16_t CRC;
+	#endif
 
 	if(DataloggerInitalized != 1)
 	{
@@ -118,30 +195,49 @@ void Datalogger_AddDataSet(uint8_t DataSet[])
 	}
 	printf_P(PSTR("Writing to buffer %u\n"), BufferInUse);
 	
-	DataSetHeader[0] = ((DataSetSizeBytes >> 4) | DATALOGGER_HEADER1_PREFIX);
-	DataSetHeader[1] = ((uint8_t)(DataSetSizeBytes << 4) | DATALOGGER_HEADER2_SUFFIX);
-	
-	//Write data set header
-	AT45DB321D_BufferWrite(BufferInUse, DataSetAddress, DataSetHeader, 2);
-	DataSetAddress += 2;
+	//Write the page sequence number at the start of a new page
+	if(DataSetAddress == 0)
+	{
+		PageHeader[0] = ((DataPageSequence >> 16) & 0xFF);
+		PageHeader[1] = ((DataPageSequence >> 8) & 0xFF);
+		PageHeader[2] = (DataPageSequence & 0xFF);
+		AT45DB321D_BufferWrite(BufferInUse, 0, PageHeader, DATALOGGER_PAGE_HEADER_SIZE);
+		DataSetAddress = DATALOGGER_PAGE_HEADER_SIZE;
+		
+		//Save the time of the first data set of every indexed page
+		if((DataPageAddress % DATALOGGER_INDEX_PAGES_PER_ENTRY) == 0)
+		{
+			DS3232M_WriteSRAM(DATALOGGER_INDEX_SRAM_ADDRESS + (DataPageAddress/DATALOGGER_INDEX_PAGES_PER_ENTRY)*DATALOGGER_INDEX_ENTRY_SIZE, DataSet, DATALOGGER_INDEX_ENTRY_SIZE);
+		}
+	}
 	
-	//Write data
-	AT45DB321D_BufferWrite(BufferInUse, DataSetAddress, DataSet, DATALOGGER_DATASET_SIZE);
-	DataSetAddress += DATALOGGER_DATASET_SIZE;
+	//The last data set may still be going out on the SPI bus
+	SPIBus_Wait(&DataSetWrite);
 	
-	//Write CRC
+	//Data set header
+	DataSetRecord[0] = ((DataSetSizeBytes >> 4) | DATALOGGER_HEADER1_PREFIX);
+	DataSetRecord[1] = ((uint8_t)(DataSetSizeBytes << 4) | DATALOGGER_HEADER2_SUFFIX);
 	#if DATALOGGER_USE_CRC == 1
-	AT45DB321D_BufferWrite(BufferInUse, DataSetAddress, DataSetCRC, 1);
-	DataSetAddress += 1;
+	CRC = Datalogger_CRC16(0xFFFF, DataSetRecord, 2);
 	#endif
 	
-	//If the page is full...
-	//fix this to handle CRC later
+	//Data
+	memcpy(&DataSetRecord[2], DataSet, DATALOGGER_DATASET_SIZE);
+	
+	//CRC, MSB first. This covers the data set header and the data as they are in RAM, so it catches a torn or damaged
+	//program of the page but not a fault on the SPI bus while the record is queued below.
 	#if DATALOGGER_USE_CRC == 1
-	if((DataSetAddress + (DATALOGGER_DATASET_SIZE+3)) > DATALOGGER_PAGE_SIZE)
-	#else
-	if((DataSetAddress + (DATALOGGER_DATASET_SIZE+2)) > DATALOGGER_PAGE_SIZE)
+	CRC = Datalogger_CRC16(CRC, &DataSetRecord[2], DATALOGGER_DATASET_SIZE);
+	DataSetRecord[DATALOGGER_RECORD_SIZE-2] = (uint8_t)(CRC >> 8);
+	DataSetRecord[DATALOGGER_RECORD_SIZE-1] = (uint8_t)(CRC & 0xFF);
 	#endif
+	
+	//Queue the data set to be written to the buffer. It is sent at once if the bus is free, and A/D reads go ahead of it if not.
+	AT45DB321D_BufferWriteAsync(BufferInUse, DataSetAddress, DataSetRecord, DATALOGGER_RECORD_SIZE, &DataSetWrite);
+	DataSetAddress += DATALOGGER_RECORD_SIZE;
+	
+	//If the page is full...
+	if((DataSetAddress + DataSetSizeBytes) > DATALOGGER_PAGE_SIZE)
 	{
 		printf_P(PSTR("Writing to page %u\n"), DataPageAddress);
 	
@@ -158,11 +254,12 @@ void Datalogger_AddDataSet(uint8_t DataSet[])
 			BufferInUse = 1;
 		}
 		
-		//Increment page address
-		DataPageAddress++;
-		if(DataPageAddress > 0x1FFF)
+		//Increment page address. Wrapping around overwrites the oldest page.
+		DataPageAddress = Datalogger_NextPage(DataPageAddress);
+		DataPageSequence++;
+		if(DataPageAddress == TailPageAddress)
 		{
-			DataPageAddress = 0;
+			TailPageAddress = Datalogger_NextPage(TailPageAddress);
 		}
 		
 		//Reset address in page to zero
@@ -178,25 +275,49 @@ void Datalogger_AddDataSet(uint8_t DataSet[])
 
 void Datalogger_SaveDataToFlash(void)
 {
+	uint8_t EndMarker[2];
+
 	if(DataloggerInitalized != 1)
 	{
 		return;
 	}
 
+	//Nothing has been written to this page yet
+	if(DataSetAddress == 0)
+	{
+		return;
+	}
+
+	//The rest of the buffer still holds data from an older page. Mark the end of the data so it is not read back as new data.
+	if((DataSetAddress + 2) <= DATALOGGER_PAGE_SIZE)
+	{
+		EndMarker[0] = 0xFF;
+		EndMarker[1] = 0xFF;
+		AT45DB321D_BufferWrite(BufferInUse, DataSetAddress, EndMarker, 2);
+	}
+
 	AT45DB321D_CopyBufferToPage(BufferInUse, DataPageAddress);
 	AT45DB321D_WaitForReady();
 	return;
 }
 
-//The page should always start with a dataset header.
-//The pages should always start at 0 and go up
+//Every page starts with a sequence number, followed by data sets.
+//Pages are written in order and wrap around from the last page to page 0. Going forward from page 0, the sequence number
+//increases by one per page up to the newest page. Going backward from the newest page (wrapping around), the sequence number
+//decreases by one per page down to the oldest page. Both of these are found with a binary search, so only ~26 page headers
+//are read to mount the log instead of scanning the whole device.
 void Datalogger_FindLastDataSet(uint16_t *PageNumber, uint16_t *AddressInPage)
 {
-	uint16_t PageToLook = 0;
-	uint16_t AddressToLook = 0;
+	uint16_t HeadPage;
+	uint16_t Low;
+	uint16_t High;
+	uint16_t Mid;
+	uint16_t AddressToLook;
+	uint32_t FirstSequence;
+	uint32_t Sequence;
 	uint8_t TempBuffer = 0;
 	
-	uint8_t TempVal[2];
+	uint8_t TempVal[DATALOGGER_RECORD_SIZE];
 	uint8_t TempDataSetSize = 0;
 	
 	//Select the buffer that is not in use
@@ -209,85 +330,119 @@ void Datalogger_FindLastDataSet(uint16_t *PageNumber, uint16_t *AddressInPage)
 		TempBuffer = 1;
 	}
 	
-	//printf_P(PSTR("Looking for data in page 0x%04X at address 0x%04X using buffer %u\n"), PageToLook, AddressToLook, TempBuffer);
-	
-	while(PageToLook <= 0x1FFF)
+	FirstSequence = Datalogger_GetPageSequence(0);
+	if(FirstSequence == DATALOGGER_PAGE_SEQ_ERASED)
 	{
-		//printf_P(PSTR("Looking for data in page 0x%04X at address 0x%04X using buffer %u\n"), PageToLook, AddressToLook, TempBuffer);
+		//printf_P(PSTR("The device is empty\n"));
+		DataPageSequence = 0;
+		TailPageAddress = 0;
 		
-		//Retrieve the memory page
-		AT45DB321D_CopyPageToBuffer(TempBuffer, PageToLook);
-		AT45DB321D_WaitForReady();
+		*PageNumber = 0x0000;
+		*AddressInPage = 0x0000;
 		
-		//Look for the data start 
-		while(AddressToLook <= DATALOGGER_PAGE_SIZE)
+		return;
+	}
+	
+	//Find the newest page. This is the last page where the sequence number is (FirstSequence + PageNumber).
+	Low = 0;
+	High = DATALOGGER_NUMBER_OF_PAGES-1;
+	while(Low < High)
+	{
+		Mid = Low + ((High - Low + 1) >> 1);
+		if(Datalogger_GetPageSequence(Mid) == (FirstSequence + Mid))
 		{
-			AT45DB321D_BufferRead(TempBuffer, AddressToLook, TempVal, 2);
-			TempDataSetSize = ((TempVal[0] & 0x0F) << 4) | ((TempVal[1] & 0xF0) >> 4);
-			//printf_P(PSTR("0x%02X 0x%02X"), TempVal[0], TempVal[1]);
-			
-			if( ((TempVal[0] & 0xF0) == DATALOGGER_HEADER1_PREFIX) && ((TempVal[1] & 0x0F) == DATALOGGER_HEADER2_SUFFIX) && (TempDataSetSize > 0) )
-			{
-				//printf_P(PSTR("Header found at 0x%04X of size %u\n"), AddressToLook, TempDataSetSize);
-				AddressToLook += TempDataSetSize;
-			}
-			else
-			{
-				break;
-			}
+			Low = Mid;
 		}
-		
-		//Check if the page is full
-		if((AddressToLook + TempDataSetSize) > DATALOGGER_PAGE_SIZE)
+		else
 		{
-			PageToLook++;
-			AddressToLook = 0;
+			High = Mid - 1;
+		}
+	}
+	HeadPage = Low;
+	DataPageSequence = FirstSequence + HeadPage;
+	
+	//Find the oldest page. This is the furthest page back from the newest page where the sequence number is (DataPageSequence - PagesBack).
+	Low = 0;
+	High = DATALOGGER_NUMBER_OF_PAGES-1;
+	if(DataPageSequence < High)
+	{
+		High = DataPageSequence;
+	}
+	while(Low < High)
+	{
+		Mid = Low + ((High - Low + 1) >> 1);
+		Sequence = Datalogger_GetPageSequence((HeadPage + DATALOGGER_NUMBER_OF_PAGES - Mid) % DATALOGGER_NUMBER_OF_PAGES);
+		if(Sequence == (DataPageSequence - Mid))
+		{
+			Low = Mid;
 		}
 		else
 		{
-			break;
+			High = Mid - 1;
 		}
 	}
+	TailPageAddress = (HeadPage + DATALOGGER_NUMBER_OF_PAGES - Low) % DATALOGGER_NUMBER_OF_PAGES;
+	
+	//printf_P(PSTR("Newest page 0x%04X (sequence %lu), oldest page 0x%04X\n"), HeadPage, DataPageSequence, TailPageAddress);
+	
+	//Look for the end of the data in the newest page
+	AT45DB321D_CopyPageToBuffer(TempBuffer, HeadPage);
+	AT45DB321D_WaitForReady();
 	
-	if(PageToLook == 0x1FFF)
+	AddressToLook = DATALOGGER_PAGE_HEADER_SIZE;
+	while(AddressToLook < DATALOGGER_PAGE_SIZE)
 	{
-		//printf_P(PSTR("The device is full\n"));
-		
-		*PageNumber = 0xFFFF;
-		*AddressInPage = 0xFFFF;
+		if(Datalogger_ReadDataSet(TempBuffer, AddressToLook, TempVal, &TempDataSetSize) == DATALOGGER_DATASET_NONE)
+		{
+			break;
+		}
 		
+		//Data sets with a bad CRC or in another layout are skipped so that the data after them is not overwritten
+		//printf_P(PSTR("Header found at 0x%04X of size %u\n"), AddressToLook, TempDataSetSize);
+		AddressToLook += TempDataSetSize;
+	}
+	
+	//Check if the page is full. The data sets before may be smaller than the ones written now.
+	if((AddressToLook + DATALOGGER_RECORD_SIZE) <= DATALOGGER_PAGE_SIZE)
+	{
+		//printf_P(PSTR("The next dataset should start at address 0x%04X\n"), AddressToLook);
+		*PageNumber = HeadPage;
+		*AddressInPage = AddressToLook;
 		return;
 	}
-	if( (PageToLook == 0x00) && (AddressToLook == 0x00) )
+	
+	//The newest page is full, new data goes in the next page
+	if(Datalogger_NextPage(HeadPage) == TailPageAddress)
 	{
-		//printf_P(PSTR("The device is empty\n"));
+		//printf_P(PSTR("The device is full\n"));
 		
-		*PageNumber = 0x0000;
-		*AddressInPage = 0x0000;
+		*PageNumber = 0xFFFF;
+		*AddressInPage = 0xFFFF;
 		
 		return;
 	}
 	
-	//printf_P(PSTR("Final data header is in page 0x%04X. New data should start at location 0x%04X\n"), PageToLook, AddressToLook);
-	
-	//printf_P(PSTR("Final data header is in page 0x%04X at address 0x%04X and is of size %u.\n"), PageToLook, AddressToLook-TempDataSetSize, TempDataSetSize);
-	//printf_P(PSTR("The next dataset should start at address 0x%04X\n"), AddressToLook);
-	
-	*PageNumber = PageToLook;
-	*AddressInPage = AddressToLook;
+	DataPageSequence++;
+	*PageNumber = Datalogger_NextPage(HeadPage);
+	*AddressInPage = 0x0000;
 	
 	return;
 }
 
 void Datalogger_ReadBackData(uint16_t NumberOfDataSets)
 {
-	uint16_t PageToLook = 0;
-	uint16_t AddressToLook = 0;
+	uint16_t PageToLook;
+	uint16_t AddressToLook;
+	uint16_t LastPage;
+	uint32_t ExpectedSequence;
 	uint8_t TempBuffer = 0;
-	uint8_t i;
 	
-	uint8_t TempVal[2];
+	uint8_t TempVal[DATALOGGER_RECORD_SIZE];
 	uint8_t TempDataSetSize = 0;
+	uint8_t Status;
+	uint16_t OtherLayoutPage = 0xFFFF;
+	
+	LastPage = Datalogger_GetLastPage();
 	
 	//Select the buffer that is not in use
 	if(BufferInUse == 1)
@@ -299,62 +454,367 @@ void Datalogger_ReadBackData(uint16_t NumberOfDataSets)
 		TempBuffer = 1;
 	}
 	
-	//printf_P(PSTR("Looking for data in page 0x%04X at address 0x%04X using buffer %u\n"), PageToLook, AddressToLook, TempBuffer);
+	//Start at the oldest page
+	PageToLook = TailPageAddress;
+	ExpectedSequence = DATALOGGER_PAGE_SEQ_ERASED;
 	
-	while(PageToLook <= 0x1FFF)
+	while(1)
 	{
-		//printf_P(PSTR("Looking for data in page 0x%04X at address 0x%04X using buffer %u\n"), PageToLook, AddressToLook, TempBuffer);
+		//printf_P(PSTR("Looking for data in page 0x%04X using buffer %u\n"), PageToLook, TempBuffer);
 		
 		//Retrieve the memory page
-		AT45DB321D_CopyPageToBuffer(TempBuffer, PageToLook);
-		AT45DB321D_WaitForReady();
+		if(Datalogger_LoadPage(TempBuffer, PageToLook, &ExpectedSequence) != 1)
+		{
+			return;
+		}
 		
 		//Look for the data start 
-		while(AddressToLook <= DATALOGGER_PAGE_SIZE)
+		AddressToLook = DATALOGGER_PAGE_HEADER_SIZE;
+		while(AddressToLook < DATALOGGER_PAGE_SIZE)
 		{
-			AT45DB321D_BufferRead(TempBuffer, AddressToLook, TempVal, 2);
-			TempDataSetSize = ((TempVal[0] & 0x0F) << 4) | ((TempVal[1] & 0xF0) >> 4);
-			//printf_P(PSTR("0x%02X 0x%02X"), TempVal[0], TempVal[1]);
+			//A long dump keeps the main loop away for much longer than its deadline, but it is still going. The
+			//controller keeps taking its samples in between the data sets.
+			Supervisor_CheckIn(SUPERVISOR_TASK_LOOP);
+			TemperatureControllerTask();
+			Status = Datalogger_ReadDataSet(TempBuffer, AddressToLook, TempVal, &TempDataSetSize);
+			if(Status == DATALOGGER_DATASET_NONE)
+			{
+				break;
+			}
 			
-			if( ((TempVal[0] & 0xF0) == DATALOGGER_HEADER1_PREFIX) && ((TempVal[1] & 0x0F) == DATALOGGER_HEADER2_SUFFIX) && (TempDataSetSize > 0) )
+			if(Status == DATALOGGER_DATASET_BAD_CRC)
 			{
-				NumberOfDataSets--;
-				for(i=2; i<TempDataSetSize; i++)
+				printf_P(PSTR("CRC error in page 0x%04X at address 0x%04X\n"), PageToLook, AddressToLook);
+			}
+			else if(Status == DATALOGGER_DATASET_OTHER_LAYOUT)
+			{
+				if(OtherLayoutPage != PageToLook)
 				{
-					AT45DB321D_BufferRead(TempBuffer, AddressToLook+i, TempVal, 1);
-					AT45DB321D_WaitForReady();
-					printf_P(PSTR("0x%02X, "), TempVal[0]);
+					printf_P(PSTR("Page 0x%04X has data sets in another layout, read them with LogDecode\n"), PageToLook);
+					OtherLayoutPage = PageToLook;
 				}
-				printf_P(PSTR("\b\b \b\n"));
+			}
+			else
+			{
+				NumberOfDataSets--;
+				Datalogger_PrintDataSet(TempVal);
 				if(NumberOfDataSets == 0)
 				{
 					return;
 				}
-				AddressToLook += TempDataSetSize;
-			}
-			else
-			{
-				break;
 			}
+			AddressToLook += TempDataSetSize;
 		}
 		
-		//Check if the page is full
-		if((AddressToLook + TempDataSetSize) > DATALOGGER_PAGE_SIZE)
+		if(PageToLook == LastPage)
 		{
-			PageToLook++;
-			AddressToLook = 0;
+			break;
+		}
+		PageToLook = Datalogger_NextPage(PageToLook);
+	}
+
+
+
+	return;
+}
+
+void Datalogger_ReadBackRange(uint8_t FromTime[], uint8_t ToTime[])
+{
+	uint32_t FromKey;
+	uint32_t ToKey;
+	uint16_t PageToLook;
+	uint16_t AddressToLook;
+	uint16_t LastPage;
+	uint16_t UsedPages;
+	uint16_t Offset;
+	uint16_t Low;
+	uint16_t High;
+	uint16_t Mid;
+	uint32_t ExpectedSequence;
+	uint32_t Key;
+	uint32_t LowKey = 0;
+	uint32_t HighKey = 0;
+	uint8_t TempBuffer = 0;
+	uint8_t i;
+	
+	uint8_t TempVal[DATALOGGER_RECORD_SIZE];
+	uint8_t TempDataSetSize = 0;
+	uint8_t Status;
+	uint16_t OtherLayoutPage = 0xFFFF;
+	
+	FromKey = Datalogger_TimeKey(FromTime);
+	ToKey = Datalogger_TimeKey(ToTime);
+	LastPage = Datalogger_GetLastPage();
+	
+	//Pages are searched by their offset from the oldest page
+	UsedPages = (LastPage + DATALOGGER_NUMBER_OF_PAGES - TailPageAddress) % DATALOGGER_NUMBER_OF_PAGES;
+	Low = 0;
+	High = UsedPages;
+	
+	//Use the index to narrow the search down to the pages between two index entries.
+	//The times in the log always increase, so the last entry at or before FromKey and the first entry after it bound the search.
+	for(i=0; i<DATALOGGER_INDEX_ENTRIES; i++)
+	{
+		Offset = ((uint16_t)i*DATALOGGER_INDEX_PAGES_PER_ENTRY + DATALOGGER_NUMBER_OF_PAGES - TailPageAddress) % DATALOGGER_NUMBER_OF_PAGES;
+		if(Offset > UsedPages)
+		{
+			continue;
+		}
+		
+		if(DS3232M_ReadSRAM(DATALOGGER_INDEX_SRAM_ADDRESS + i*DATALOGGER_INDEX_ENTRY_SIZE, TempVal, DATALOGGER_INDEX_ENTRY_SIZE) != 0)
+		{
+			//The index is not available, search all of the pages
+			Low = 0;
+			High = UsedPages;
+			break;
+		}
+		
+		Key = Datalogger_TimeKey(TempVal);
+		if((Key <= FromKey) && (Offset > Low))
+		{
+			Low = Offset;
+			LowKey = Key;
+		}
+		else if((Key > FromKey) && (Offset > 0) && ((Offset-1) < High))
+		{
+			High = Offset-1;
+			HighKey = Key;
+		}
+	}
+	
+	//Check the index entries against the flash in case the RTC lost power
+	if( ((Low > 0) && (Datalogger_GetPageTime((TailPageAddress + Low) % DATALOGGER_NUMBER_OF_PAGES) != LowKey)) ||
+		((High < UsedPages) && (Datalogger_GetPageTime((TailPageAddress + High + 1) % DATALOGGER_NUMBER_OF_PAGES) != HighKey)) )
+	{
+		//printf_P(PSTR("Index is invalid\n"));
+		Low = 0;
+		High = UsedPages;
+	}
+	
+	//Find the last page that starts at or before FromKey
+	while(Low < High)
+	{
+		Mid = Low + ((High - Low + 1) >> 1);
+		if(Datalogger_GetPageTime((TailPageAddress + Mid) % DATALOGGER_NUMBER_OF_PAGES) <= FromKey)
+		{
+			Low = Mid;
 		}
 		else
+		{
+			High = Mid - 1;
+		}
+	}
+	
+	//Select the buffer that is not in use
+	if(BufferInUse == 1)
+	{
+		TempBuffer = 2;
+	}
+	else
+	{
+		TempBuffer = 1;
+	}
+	
+	PageToLook = (TailPageAddress + Low) % DATALOGGER_NUMBER_OF_PAGES;
+	ExpectedSequence = DATALOGGER_PAGE_SEQ_ERASED;
+	
+	while(1)
+	{
+		if(Datalogger_LoadPage(TempBuffer, PageToLook, &ExpectedSequence) != 1)
+		{
+			return;
+		}
+		
+		AddressToLook = DATALOGGER_PAGE_HEADER_SIZE;
+		while(AddressToLook < DATALOGGER_PAGE_SIZE)
+		{
+			Supervisor_CheckIn(SUPERVISOR_TASK_LOOP);
+			TemperatureControllerTask();
+			Status = Datalogger_ReadDataSet(TempBuffer, AddressToLook, TempVal, &TempDataSetSize);
+			if(Status == DATALOGGER_DATASET_NONE)
+			{
+				break;
+			}
+			
+			if(Status == DATALOGGER_DATASET_BAD_CRC)
+			{
+				printf_P(PSTR("CRC error in page 0x%04X at address 0x%04X\n"), PageToLook, AddressToLook);
+			}
+			else if(Status == DATALOGGER_DATASET_OTHER_LAYOUT)
+			{
+				if(OtherLayoutPage != PageToLook)
+				{
+					printf_P(PSTR("Page 0x%04X has data sets in another layout, read them with LogDecode\n"), PageToLook);
+					OtherLayoutPage = PageToLook;
+				}
+			}
+			else
+			{
+				Key = Datalogger_TimeKey(&TempVal[2]);
+				if(Key > ToKey)
+				{
+					return;
+				}
+				if(Key >= FromKey)
+				{
+					Datalogger_PrintDataSet(TempVal);
+				}
+			}
+			AddressToLook += TempDataSetSize;
+		}
+		
+		if(PageToLook == LastPage)
 		{
 			break;
 		}
+		PageToLook = Datalogger_NextPage(PageToLook);
+	}
+	
+	return;
+}
+
+//Read the sequence number from the start of a page
+static uint32_t Datalogger_GetPageSequence(uint16_t PageNumber)
+{
+	uint8_t PageHeader[DATALOGGER_PAGE_HEADER_SIZE];
+	
+	AT45DB321D_PageRead(PageNumber, 0, PageHeader, DATALOGGER_PAGE_HEADER_SIZE);
+	return (((uint32_t)PageHeader[0]<<16) | ((uint32_t)PageHeader[1]<<8) | (uint32_t)PageHeader[2]);
+}
+
+//Read the time of the first data set in a page. Returns 0xFFFFFFFF if there is no data in the page, and 0 if it is in
+//an older layout. Those were all written before the year was added to the time, so they come before every other page.
+static uint32_t Datalogger_GetPageTime(uint16_t PageNumber)
+{
+	uint8_t TempVal[2+DATALOGGER_INDEX_ENTRY_SIZE];
+	
+	AT45DB321D_PageRead(PageNumber, DATALOGGER_PAGE_HEADER_SIZE, TempVal, 2+DATALOGGER_INDEX_ENTRY_SIZE);
+	if( ((TempVal[0] & 0xF0) != DATALOGGER_HEADER1_PREFIX) || ((TempVal[1] & 0x0F) != DATALOGGER_HEADER2_SUFFIX) )
+	{
+		return 0xFFFFFFFF;
+	}
+	if( (((TempVal[0] & 0x0F) << 4) | ((TempVal[1] & 0xF0) >> 4)) != DATALOGGER_RECORD_SIZE )
+	{
+		return 0;
+	}
+	return Datalogger_TimeKey(&TempVal[2]);
+}
+
+//Convert the time of a data set into a number that can be compared. Each field is counted in steps of the next one, as
+//if every month had 31 days, so the keys keep going up over the end of a month or a year.
+static uint32_t Datalogger_TimeKey(uint8_t *TimeBytes)
+{
+	return (((((uint32_t)TimeBytes[0]*12 + TimeBytes[1])*31 + TimeBytes[2])*24 + TimeBytes[3])*60 + TimeBytes[4]);
+}
+
+//Find the newest page with data in it. This also finds the oldest page if the datalogger is not running.
+static uint16_t Datalogger_GetLastPage(void)
+{
+	uint16_t LastPage;
+	uint16_t AddressInPage;
+	
+	if(DataloggerInitalized == 1)
+	{
+		return DataPageAddress;
 	}
+	
+	Datalogger_FindLastDataSet(&LastPage, &AddressInPage);
+	if(LastPage > 0x1FFF)
+	{
+		//The device is full, the newest page is just before the oldest page
+		LastPage = (TailPageAddress + DATALOGGER_NUMBER_OF_PAGES - 1) % DATALOGGER_NUMBER_OF_PAGES;
+	}
+	return LastPage;
+}
 
+//Copy a page into a buffer. Returns 1 if the page is the next page in the log, 0 if the page is erased or out of sequence.
+//Set ExpectedSequence to DATALOGGER_PAGE_SEQ_ERASED for the first page.
+static uint8_t Datalogger_LoadPage(uint8_t Buffer, uint16_t PageNumber, uint32_t *ExpectedSequence)
+{
+	uint32_t Sequence;
+	uint8_t PageHeader[DATALOGGER_PAGE_HEADER_SIZE];
+	
+	AT45DB321D_CopyPageToBuffer(Buffer, PageNumber);
+	AT45DB321D_WaitForReady();
+	
+	AT45DB321D_BufferRead(Buffer, 0, PageHeader, DATALOGGER_PAGE_HEADER_SIZE);
+	Sequence = (((uint32_t)PageHeader[0]<<16) | ((uint32_t)PageHeader[1]<<8) | (uint32_t)PageHeader[2]);
+	
+	if( (Sequence == DATALOGGER_PAGE_SEQ_ERASED) || ((*ExpectedSequence != DATALOGGER_PAGE_SEQ_ERASED) && (Sequence != *ExpectedSequence)) )
+	{
+		return 0;
+	}
+	
+	*ExpectedSequence = Sequence + 1;
+	return 1;
+}
 
+//Read a data set (including the header and CRC) from a buffer and check it.
+//Returns one of the DATALOGGER_DATASET_* values. DataSetSize is set to the size given in the data set header.
+static uint8_t Datalogger_ReadDataSet(uint8_t Buffer, uint16_t Address, uint8_t DataSet[], uint8_t *DataSetSize)
+{
+	AT45DB321D_BufferRead(Buffer, Address, DataSet, DATALOGGER_RECORD_SIZE);
+	*DataSetSize = ((DataSet[0] & 0x0F) << 4) | ((DataSet[1] & 0xF0) >> 4);
+	
+	if( ((DataSet[0] & 0xF0) != DATALOGGER_HEADER1_PREFIX) || ((DataSet[1] & 0x0F) != DATALOGGER_HEADER2_SUFFIX) || (*DataSetSize == 0) )
+	{
+		return DATALOGGER_DATASET_NONE;
+	}
+	
+	//The size is the only mark of the layout. A data set of another size was written before CHANNEL_LIST last changed.
+	if(*DataSetSize != DATALOGGER_RECORD_SIZE)
+	{
+		return (*DataSetSize > 2) ? DATALOGGER_DATASET_OTHER_LAYOUT : DATALOGGER_DATASET_NONE;
+	}
+	
+	#if DATALOGGER_USE_CRC == 1
+	//The CRC of the data set including its CRC bytes is zero if the data set is intact
+	if(Datalogger_CRC16(0xFFFF, DataSet, DATALOGGER_RECORD_SIZE) != 0x0000)
+	{
+		return DATALOGGER_DATASET_BAD_CRC;
+	}
+	#endif
+	
+	return DATALOGGER_DATASET_OK;
+}
 
+//Print the data from a data set read by Datalogger_ReadDataSet
+static void Datalogger_PrintDataSet(uint8_t DataSet[])
+{
+	uint8_t i;
+	
+	for(i=2; i<(DATALOGGER_DATASET_SIZE+2); i++)
+	{
+		printf_P(PSTR("0x%02X, "), DataSet[i]);
+	}
+	printf_P(PSTR("\b\b \b\n"));
 	return;
 }
 
+#if DATALOGGER_USE_CRC == 1
+//Update a CRC-16 with 'Length' bytes of data
+static uint16_t Datalogger_CRC16(uint16_t CRC, uint8_t Data[], uint8_t Length)
+{
+	while(Length > 0)
+	{
+		CRC = (CRC << 8) ^ pgm_read_word(&Datalogger_CRC16Table[(uint8_t)(CRC >> 8) ^ *Data]);
+		Data++;
+		Length--;
+	}
+	return CRC;
+}
+#endif
+
+static uint16_t Datalogger_NextPage(uint16_t PageNumber)
+{
+	PageNumber++;
+	if(PageNumber > (DATALOGGER_NUMBER_OF_PAGES-1))
+	{
+		PageNumber = 0;
+	}
+	return PageNumber;
+}
+
 
 
 //Call this to start the data logging.
@@ -363,16 +823,13 @@ void Datalogger_Start(void)
 	if(DataloggerInitalized == 1)
 	{
 		TimeAndDate CurrentTime;
-		//GetTime(&CurrentTime);
+		DS3232M_GetTime(&CurrentTime);
 
 		//Take an inital set of data
 		//GetDataSet(DataToSave);
 		
-		//Clear the time data. This data is put in when the data is written to flash.
-		DataToSave[0] = 0;
-		DataToSave[1] = 0;
-		DataToSave[2] = 0;
-		DataToSave[3] = 0;
+		//Clear the average. The time data is put in when the data is written to flash.
+		memset(DataToSave, 0, DATALOGGER_DATASET_SIZE);
 		
 		//Find the next time to get data
 		MinToWaitFor = ((CurrentTime.min/DATALOGGER_MIN_TO_SKIP)+1)*DATALOGGER_MIN_TO_SKIP;
@@ -388,7 +845,7 @@ void Datalogger_Start(void)
 			NextTimeToSaveData = 0;
 		}
 		
-		DataSetNumber = 1;
+		DataSetNumber = 0;
 		
 		printf_P(PSTR("Time is %u min, next data set at %u min, Next time to save data is %u\n"), CurrentTime.min, MinToWaitFor, NextTimeToSaveData);
 	}
@@ -423,16 +880,17 @@ void Datalogger_Process(void)
 		if(CurrentTime.min == NextTimeToSaveData)
 		{
 			//Add time data
-			DataToSave[0] = CurrentTime.month;
-			DataToSave[1] = CurrentTime.day;
-			DataToSave[2] = CurrentTime.hour;
-			DataToSave[3] = CurrentTime.min;
+			DataToSave[0] = CurrentTime.year;
+			DataToSave[1] = CurrentTime.month;
+			DataToSave[2] = CurrentTime.day;
+			DataToSave[3] = CurrentTime.hour;
+			DataToSave[4] = CurrentTime.min;
 		
 			//Save the data
 			Datalogger_AddDataSet(DataToSave);
 			
 			printf_P(PSTR("Saving at min %u: "), NextTimeToSaveData);
-			for(i=0;i<18;i++)
+			for(i=0;i<DATALOGGER_DATASET_SIZE;i++)
 			{
 				printf_P(PSTR("0x%02X, "), DataToSave[i]);
 			}
@@ -449,7 +907,7 @@ void Datalogger_Process(void)
 			
 			//Clear the old data
 			DataSetNumber = 0;
-			for(i=0;i<18;i++)
+			for(i=0;i<DATALOGGER_DATASET_SIZE;i++)
 			{
 				DataToSave[i] = 0;
 			}
@@ -462,85 +920,40 @@ void Datalogger_Process(void)
 
 void Datalogger_AddDataSetToAverage(void)
 {
-	uint8_t TempDataSet[DATALOGGER_DATASET_SIZE];
+	uint8_t TempDataSet[CHANNEL_DATA_SIZE];
+	uint32_t Average[CHANNEL_COUNT];
+	uint32_t NewData[CHANNEL_COUNT];
 	uint8_t i;
-	//uint32_t TempAverage;
-	
-	uint16_t TempData;
 	int32_t delta;
 	
 	//Get the new data set
-	//GetDataSet(TempDataSet);
-	
-	//printf_P(PSTR("datasetnumber=%u\n"), DataSetNumber);
-	
-	//for testing...
-	for(i=0;i<18;i++)
-	{
-		DataToSave[i] = i;
-		TempDataSet[i] = (42-2*i);
-	}
-	DataSetNumber = 2;
-	
+	GetData(TempDataSet);
 	
+	Channels_Unpack(&DataToSave[DATALOGGER_TIME_SIZE], Average);
+	Channels_Unpack(TempDataSet, NewData);
 	
-	
-	printf_P(PSTR("OLD%u, "), DataSetNumber);
-	for(i=0;i<18;i++)
+	//Update the running average of each channel
+	for(i=0; i<CHANNEL_COUNT; i++)
 	{
-		printf_P(PSTR("0x%02X, "), DataToSave[i]);
-	}
-	printf_P(PSTR("\b\b \n"));
-	
-	printf_P(PSTR("NEW%u, "), DataSetNumber);
-	for(i=0;i<18;i++)
-	{
-		printf_P(PSTR("0x%02X, "), TempDataSet[i]);
-	}
-	printf_P(PSTR("\b\b \n"));
-	
-	
-	
-	
-	for (i=4; i<18; i+=2)
-	{
-		//printf_P(PSTR("i=%u\n"), i);
-		//printf_P(PSTR("OLD0: 0x%02X\nOLD1: 0x%02X\n"), DataToSave[i], DataToSave[i+1]);
-		//printf_P(PSTR("NEW0: 0x%02X\nNEW1: 0x%02X\n"), TempDataSet[i], TempDataSet[i+1]);
-		TempData = ((DataToSave[i] << 8) | (DataToSave[i+1]));
-		
-		delta = (int32_t)((TempDataSet[i] << 8) | (TempDataSet[i+1]));
-		delta = delta - (int32_t)(TempData);
+		delta = (int32_t)NewData[i] - (int32_t)Average[i];
 		
 		//rounding (half away from zero)
 		if(delta >= 0)
 		{
 			delta = (((delta << 1l)/(DataSetNumber+1l)) + 1l) >> 1l;
-			//delta = ((delta*10)+10)/(10*(DataSetNumber+1));
 		}
 		else
 		{
 			delta = (((delta << 1l)/(DataSetNumber+1l)) - 1l) >> 1l;
-			//delta = ((delta*10)-10)/(10*(DataSetNumber+1));
 		}
 		
-		TempData = (uint16_t)((int32_t)TempData + delta);
-		
-		DataToSave[i] = (uint8_t)((TempData & 0xFF00) >> 8);
-		DataToSave[i+1] = (uint8_t)(TempData & 0xFF);
-		
-		//printf_P(PSTR("AV0: 0x%02X\nAV1: 0x%02X\n"), DataToSave[i], DataToSave[i+1]);
+		Average[i] = (uint32_t)((int32_t)Average[i] + delta);
 	}
 	
-	/*printf_P(PSTR("CUR%u: "), DataSetNumber);
-	for(i=0;i<18;i++)
-	{
-		printf_P(PSTR("0x%02X, "), TempDataSet[i]);
-	}
-	printf_P(PSTR("\n"));*/
+	Channels_Pack(Average, &DataToSave[DATALOGGER_TIME_SIZE]);
 	
 	printf_P(PSTR("AV%u, "), DataSetNumber);
-	for(i=0;i<18;i++)
+	for(i=0;i<DATALOGGER_DATASET_SIZE;i++)
 	{
 		printf_P(PSTR("0x%02X, "), DataToSave[i]);
 	}
@@ -39,6 +39,8 @@ uint8_t EEMEM NV_INTERNAL_TEMP_SAFTEY_LIMIT;		//The maximum allowable temperatur
 uint8_t EEMEM NV_SET_TEMPERATURE;					//The target fermentation temperature (in degrees C)
 uint8_t EEMEM NV_TEMP_REGULATING = 0;				//Set to 1 when the temperature regulation is active
 uint8_t EEMEM NV_CURRENT_ZERO_CAL[3];				//The zero point for the current calibration
+uint16_t EEMEM NV_CONTROLLER_KP = 0xFFFF;			//Controller gains from the last autotune. 0xFFFF if the controller was never tuned.
+uint16_t EEMEM NV_CONTROLLER_KI = 0xFFFF;
 
 
 /**This is a set of data that is saved for the running average */
@@ -50,7 +52,26 @@ uint32_t IntTempAverage;
 uint32_t HeaterVoltageAverage;
 uint32_t HeaterCurrentAverage;
 
+//Background read of the buttons started by INT2
+static TWIBus_Transaction ButtonRead;
+static uint8_t ButtonReadData;
+static volatile uint8_t ButtonReadAgain;
 
+static void ButtonReadDone(TWIBus_Transaction *Transaction);
+static void LoadSafetyLimits(void);
+
+//The heater controller. The duty cycle is set by TemperatureControllerTask and the relay is driven from the RTC interrupt.
+static Controller_Params ControllerParams;
+static Controller_State ControllerState;
+static volatile uint8_t ControllerActive;
+static volatile uint16_t RelayOnTicks;				//RTC ticks with the relay on since the last sample, for the energy meter
+static volatile uint8_t RelayHold;					//1 to hold the relay off over the controller, for the current sensor zero
+static uint8_t SampleNow;							//Take the next sample without waiting for the RTC count
+static uint8_t Acquiring;							//1 while Acquire_Task is run, since the last Acquire_Start
+
+//The controller runs on the combined thermistor temperature
+static Fusion_Params FusionParams = {FUSION_DEFAULT_PROCESS, FUSION_DEFAULT_NOISE, FUSION_DEFAULT_NOISE, FUSION_DEFAULT_DRIFT};
+static Fusion_State FusionState;
 
 
 void HardwareInit( void )
@@ -64,9 +85,8 @@ void HardwareInit( void )
 	//OldButtonState = 0xFF;
 	//ButtonState = 0xFF;
 	
-	/* Disable watchdog if enabled by bootloader/fuses */
-	MCUSR &= ~(1 << WDRF);
-	wdt_disable();
+	/* Disable watchdog if enabled by bootloader/fuses, and save the fault record from the last watchdog reset */
+	Supervisor_Init();
 	
 	//Disable JTAG (this command must be sent twice)
 	MCUCR = 0x80;
@@ -75,10 +95,14 @@ void HardwareInit( void )
 	/* Disable clock division */
 	clock_prescale_set(clock_div_1);
 
+	/* Time the rest of the boot */
+	Boot_Start();
+
 	/* Hardware Initialization */
 	//LEDs_Init();
 	SPI_Init(SPI_SPEED_FCPU_DIV_2 | SPI_ORDER_MSB_FIRST | SPI_SCK_LEAD_FALLING | SPI_SAMPLE_TRAILING | SPI_MODE_MASTER);
 	InitTWI();
+	TWIBus_Init();
 
 	
 	//Setup timer 0 for 1ms interrupts
@@ -131,35 +155,59 @@ void HardwareInit( void )
 	TIMSK3 = 0x02;
 	TCNT3H = 0x00;
 	TCNT3L = 0x00;
+	Boot_Mark(BOOT_STAGE_BUSES);
 	
-	//Initalize peripherals
+	//Initalize peripherals. What the first sample needs comes first.
 	if(AD7794Init() == 0x00)	//TODO: check for SPI Init errors here and set the CPU flag as well...
 	{
 		BH_SetStatus(BH_STATUS_HW, BH_STATUS_HW_AD7794, STATUS_HW_OK);
+		
+		//Put back the last calibration. The first time, calibrate in the background from the main loop.
+		if(AD7794LoadCalibration() != 0)
+		{
+			AD7794CalibrateStart();
+		}
 	}
 	//AD7794Init();
+	Boot_Mark(BOOT_STAGE_AD7794);
+	
+	LoadSafetyLimits();
+	Safety_Arm(0);
+	Stream_Init();
+	Acquire_SetPolicy(ACQUIRE_POLICY_ADAPTIVE);
+	Boot_Mark(BOOT_STAGE_SAFETY);
+	
+	//Enable USB and interrupts. The host enumerates the board while the TWI parts and the dataflash come up, and the
+	//TWI transactions below run on the interrupt from here on.
+	USB_Init();
+	Supervisor_Start();
+	sei();
+	Boot_Mark(BOOT_STAGE_USB_ATTACH);
+	
+	if(DS3232M_Init() == 0x00)	//todo: check for SPI Init errors here and set the CPU flag as well...
+	{
+		BH_SetStatus(BH_STATUS_HW, BH_STATUS_HW_DS3232M, STATUS_HW_OK);
+	}
+	
+	//DS3232M_Init();
+	
+	//The energy total is kept in the DS3232M SRAM
+	Energy_Init();
+	Boot_Mark(BOOT_STAGE_DS3232M);
 	
 	if(MAX7315Init() == 0x00)	//TODO: check for I2C Init errors here and set the CPU flag as well...
 	{
 		BH_SetStatus(BH_STATUS_HW, BH_STATUS_HW_MAX7315, STATUS_HW_OK);
 	}
+	Boot_Mark(BOOT_STAGE_MAX7315);
 	
 	if(AT45DB321D_Init() == 0x00)	//todo: check for SPI Init errors here and set the CPU flag as well...
 	{
 		BH_SetStatus(BH_STATUS_HW, BH_STATUS_HW_AT45DB321D, STATUS_HW_OK);
 	}
 	//AT45DB321D_Init();
-	
-	if(DS3232M_Init() == 0x00)	//todo: check for SPI Init errors here and set the CPU flag as well...
-	{
-		BH_SetStatus(BH_STATUS_HW, BH_STATUS_HW_DS3232M, STATUS_HW_OK);
-	}
-	
-	//DS3232M_Init();
-	
-	//Enable USB and interrupts
-	USB_Init();
-	sei();
+	Boot_Mark(BOOT_STAGE_AT45DB321D);
+	Boot_Mark(BOOT_STAGE_READY);
 	
 	return;
 }
@@ -179,11 +227,11 @@ void LED(uint8_t LEDValue, uint8_t LEDState)
 	{
 		if(LEDState == 1)
 		{
-			MAX7315ModifyReg(MAX7315_REG_BLINK0, 0x00, 0x04);
+			MAX7315SetOutputsAsync(0x00, 0x04);
 		}
 		else
 		{
-			MAX7315ModifyReg(MAX7315_REG_BLINK0, 0x04, 0x04);
+			MAX7315SetOutputsAsync(0x04, 0x04);
 		}
 		BH_SetStatus(BH_STATUS_HIO, BH_STATUS_HIO_LED2, LEDState);
 	}
@@ -191,11 +239,11 @@ void LED(uint8_t LEDValue, uint8_t LEDState)
 	{
 		if(LEDState == 1)
 		{
-			MAX7315ModifyReg(MAX7315_REG_BLINK0, 0x00, 0x01);
+			MAX7315SetOutputsAsync(0x00, 0x01);
 		}
 		else
 		{
-			MAX7315ModifyReg(MAX7315_REG_BLINK0, 0x01, 0x01);
+			MAX7315SetOutputsAsync(0x01, 0x01);
 		}
 		BH_SetStatus(BH_STATUS_HIO, BH_STATUS_HIO_LED3, LEDState);
 	}
@@ -203,12 +251,12 @@ void LED(uint8_t LEDValue, uint8_t LEDState)
 	{
 		if(LEDState == 1)
 		{
-			MAX7315ModifyReg(MAX7315_REG_BLINK0, 0x00, 0x02);
+			MAX7315SetOutputsAsync(0x00, 0x02);
 		}
 		
 		else
 		{
-			MAX7315ModifyReg(MAX7315_REG_BLINK0, 0x02, 0x02);
+			MAX7315SetOutputsAsync(0x02, 0x02);
 		}
 		BH_SetStatus(BH_STATUS_HIO, BH_STATUS_HIO_LED1, LEDState);
 	}
@@ -227,7 +275,31 @@ uint8_t StartTemperatureController(uint8_t Record)
 	HeaterCurrentAverage = 0;
 	NumberOfSamples = 0;
 	
-	
+	ControllerParams.SetPoint = (int32_t)eeprom_read_byte(&NV_SET_TEMPERATURE) * 10000;
+	ControllerParams.Kp = eeprom_read_word(&NV_CONTROLLER_KP);
+	ControllerParams.Ki = eeprom_read_word(&NV_CONTROLLER_KI);
+	if((ControllerParams.Kp == 0xFFFF) || (ControllerParams.Ki == 0xFFFF))
+	{
+		ControllerParams.Kp = CONTROLLER_DEFAULT_KP;
+		ControllerParams.Ki = CONTROLLER_DEFAULT_KI;
+	}
+	ControllerParams.Window = CONTROLLER_DEFAULT_WINDOW;
+	ControllerParams.Deadband = CONTROLLER_DEFAULT_DEADBAND;
+	ControllerParams.RatedPower = CONTROLLER_DEFAULT_POWER;
+	Fusion_Init(&FusionState);
+	LoadSafetyLimits();
+	cli();
+	Controller_Init(&ControllerState);
+	RelayOnTicks = 0;
+	Safety_Arm(1);
+	Supervisor_Resume(SUPERVISOR_TASK_CONTROLLER);
+	ControllerActive = 1;
+	
+	//The first sample is due now, on the next pass of the main loop, instead of up to 5s later. The count starts over
+	//from it.
+	SampleNow = 1;
+	Power_SampleDue();
+	sei();
 	
 	//TODO: Check for restart here
 	//check for overload bits and clear them if possible?
@@ -238,6 +310,7 @@ uint8_t StartTemperatureController(uint8_t Record)
 	BH_SetStatus(BH_STATUS_PROG, BH_STATUS_PROG_CONTROL_ON, 1);
 	
 	Datalogger_Init( (DATALOGGER_INIT_APPEND|DATALOGGER_INIT_RESTART_IF_FULL) );
+	Boot_Mark(BOOT_STAGE_DATALOGGER);
 	
 	//Check the heater temperature?
 	//Start data recording here...
@@ -250,6 +323,12 @@ uint8_t StopTemperatureController(uint8_t Discard)
 {
 	BH_SetStatus(BH_STATUS_PROG, BH_STATUS_PROG_CONTROL_ON, 0);
 	
+	ControllerActive = 0;
+	Relay(0);
+	Safety_Arm(0);
+	Supervisor_Suspend(SUPERVISOR_TASK_CONTROLLER);
+	Energy_Checkpoint();
+	
 	//Write final datapoint?
 	//Write final status to EEMEM to avoid accidental restarts
 	
@@ -264,16 +343,92 @@ uint8_t StopTemperatureController(uint8_t Discard)
 void TemperatureControllerTask( void )
 {
 	uint8_t ProgStatus;
+	uint8_t OldSREG;
+	uint8_t TuneDone;
+	uint8_t RelayState;
+	uint16_t OnTicks;
+	int32_t Temperature;
+	int32_t Internal;
+	uint8_t ControlOn;
+	uint8_t Count;
+	uint8_t Sample;
 	
 	ProgStatus = BH_GetStatus(BH_STATUS_PROG);
+	ControlOn = ((ProgStatus&BH_STATUS_PROG_CONTROL_ON) == BH_STATUS_PROG_CONTROL_ON) ? 1 : 0;
 
-	if(CountsFromRTC == 10 && ((ProgStatus&BH_STATUS_PROG_CONTROL_ON) == BH_STATUS_PROG_CONTROL_ON))
+	//Samples are also taken for a telemetry stream with the controller off
+	Sample = 0;
+	if((ControlOn == 1) || (Stream_Active() == 1))
+	{
+		Count = CountsFromRTC;
+		Sample = ((Count == 10) || (SampleNow == 1)) ? 1 : 0;
+		if(Sample == 1)
+		{
+			Power_SampleStart();
+		}
+		
+		//The conversions are put on the grid of the samples. A started controller samples right away.
+		if((Acquiring == 0) || (SampleNow == 1))
+		{
+			Acquire_Start((SampleNow == 1) ? 0 : (CONTROLLER_SAMPLE_TICKS - Count));
+			Acquiring = 1;
+		}
+		Acquire_Task();
+	}
+	else if(Acquiring == 1)
+	{
+		Acquire_Stop();
+		Acquiring = 0;
+	}
+	
+	if(Sample == 1)
 	{
 		LED(3,1);
+		Supervisor_CheckIn(SUPERVISOR_TASK_CONTROLLER);
 		
-		uint8_t Dataset[16];
+		uint8_t Dataset[CHANNEL_DATA_SIZE];
 		GetData(Dataset);
 		
+		//The relay state during the latest current conversion. If it switched, the current goes with neither state.
+		RelayState = Acquire_GetRelay(CHANNEL_HEATER_CURRENT);
+		Power_SampleDone();
+		Boot_Mark(BOOT_STAGE_SAMPLE);
+		
+		//The internal temperature is stored as 24 bits
+		Internal = (int32_t)Channels_Get(Dataset, INTERNAL_TEMP);
+		if((Internal & 0x00800000) != 0)
+		{
+			Internal -= 0x01000000;
+		}
+		Temperature = Fusion_Update(&FusionState, &FusionParams, ThermistorCountsToTempNum(Channels_Get(Dataset, RED_TEMP)),
+									ThermistorCountsToTempNum(Channels_Get(Dataset, BLACK_TEMP)), Internal);
+		
+		if(ControlOn == 1)
+		{
+			//The RTC interrupt reads the duty cycle
+			OldSREG = SREG;
+			cli();
+			if(RelayState != ACQUIRE_RELAY_SWITCHED)
+			{
+				Controller_Measure(&ControllerState, HeaterVoltageMV(Channels_Get(Dataset, HEATER_VOLTAGE)),
+								   HeaterCurrentMA(Channels_Get(Dataset, HEATER_CURRENT)), (RelayState != 0) ? 1 : 0);
+			}
+			TuneDone = Controller_Update(&ControllerState, &ControllerParams, Temperature);
+			OnTicks = RelayOnTicks;
+			RelayOnTicks = 0;
+			SREG = OldSREG;
+			Boot_Mark(BOOT_STAGE_DECISION);
+		
+			//The heater power is only measured with the relay on, so it holds over the whole on time
+			Energy_Add(ControllerState.HeaterPower, OnTicks);
+		
+			if(TuneDone == 1)
+			{
+				eeprom_update_word(&NV_CONTROLLER_KP, ControllerParams.Kp);
+				eeprom_update_word(&NV_CONTROLLER_KI, ControllerParams.Ki);
+			}
+		}
+		
 		if(NumberOfSamples < 6)
 		{
 			
@@ -291,19 +446,91 @@ void TemperatureControllerTask( void )
 			//clear averages
 		}
 		
-		
-		
+		Stream_Sample(Dataset, Temperature, ((PORTD & (1<<6)) != 0) ? 1 : 0);
 		
 		LED(3,0);
 		
 		//printf_P(PSTR("Taking Measurments\n"));
-		CountsFromRTC = 0;
+		//Only take off the counts up to this sample, so a tick that came while it ran is not lost and the samples stay on
+		//the grid of the conversions. The RTC interrupt wraps the count from 10 to 1.
+		OldSREG = SREG;
+		cli();
+		CountsFromRTC = (CountsFromRTC >= Count) ? (CountsFromRTC - Count) : (CountsFromRTC + 10 - Count);
+		SREG = OldSREG;
+		SampleNow = 0;
+	}
+
+
+	return;
+}
+
+/** Run an autotune test at the set point. The temperature controller is started if it is not running. */
+void StartAutotune( void )
+{
+	if(ControllerActive == 0)
+	{
+		StartTemperatureController(1);
+	}
+	cli();
+	Controller_TuneStart(&ControllerState, CONTROLLER_TUNE_HYSTERESIS);
+	sei();
+	return;
+}
+
+void StopAutotune( void )
+{
+	cli();
+	Controller_TuneStop(&ControllerState);
+	sei();
+	return;
+}
+
+//Set the over temperature limit (deg C) for one of the SAFETY_* sensors
+void SetSafetyLimit(uint8_t Sensor, uint8_t Limit)
+{
+	if(Sensor == SAFETY_RED)
+	{
+		eeprom_update_byte(&NV_RED_TEMP_SAFTEY_LIMIT, Limit);
+	}
+	else if(Sensor == SAFETY_BLACK)
+	{
+		eeprom_update_byte(&NV_BLACK_TEMP_SAFTEY_LIMIT, Limit);
 	}
+	else if(Sensor == SAFETY_INTERNAL)
+	{
+		eeprom_update_byte(&NV_INTERNAL_TEMP_SAFTEY_LIMIT, Limit);
+	}
+	LoadSafetyLimits();
+	return;
+}
 
+static void LoadSafetyLimits(void)
+{
+	Safety_SetLimits(eeprom_read_byte(&NV_RED_TEMP_SAFTEY_LIMIT), eeprom_read_byte(&NV_BLACK_TEMP_SAFTEY_LIMIT),
+					 eeprom_read_byte(&NV_INTERNAL_TEMP_SAFTEY_LIMIT));
+	return;
+}
 
+/** Get the combined thermistor temperature and its variance. */
+void GetFusion(Fusion_State *State)
+{
+	*State = FusionState;
 	return;
 }
 
+/** Get a copy of the controller settings and state. Returns 1 if the controller is running. */
+uint8_t GetController(Controller_Params *Params, Controller_State *State)
+{
+	uint8_t OldSREG;
+	
+	OldSREG = SREG;
+	cli();
+	*Params = ControllerParams;
+	*State = ControllerState;
+	SREG = OldSREG;
+	return ControllerActive;
+}
+
 void HandleButtonPress( void )
 {
 	uint8_t ButtonsPending;
@@ -450,7 +677,8 @@ void Relay(uint8_t RelayState)
 	return;
 }
 
-/** Determine the zero point for the current sensor and save it into EEPROM. The zero point of the current sensor is measured by shutting down the relay and measuring the reading from the sensor. */
+/** Determine the zero point for the current sensor and save it into EEPROM. The zero point of the current sensor is measured by shutting down the relay and measuring the reading from the sensor.
+ *	The relay is held off for the whole measurement, even with the controller running. */
 void CalibrateHeaterCurrent(void)
 {
 	uint32_t CalValue;
@@ -461,8 +689,8 @@ void CalibrateHeaterCurrent(void)
 	
 	//printf_P(PSTR("Old Calibration 0x%06lX\n"), CalValue);
 	//printf_P(PSTR("Old Calibration 0x%02X 0x%02X 0x%02X\n"), CalString[0], CalString[1], CalString[2]);
-	//Turn of the relay
-	//TODO: try to save the current state of the relay first?
+	//Turn off the relay. The RTC interrupt drives it while the controller runs, so it is held off until the end.
+	RelayHold = 1;
 	Relay(0);
 
 	CalValue = GetHeaterCurrent();
@@ -481,236 +709,59 @@ void CalibrateHeaterCurrent(void)
 	//printf_P(PSTR("New Calibration 0x%02X 0x%02X 0x%02X\n"), CalString[0], CalString[1], CalString[2]);
 	
 	eeprom_update_block ((const void*)CalString, (void*)NV_CURRENT_ZERO_CAL, 3);
+	
+	//The controller turns the relay back on at the next RTC tick if it should be on
+	RelayHold = 0;
 
 	return;
 }
 
 //Get a full set of data from the A/D converter
 //This function will be used by the datalogger to get data to save
+//The channels and the packing are set by CHANNEL_LIST in channels.h. TheData must be at least CHANNEL_DATA_SIZE bytes.
 //TODO: Process the thermistor data into deg C in this function instead of other places
 //TODO: Change decimal storage format to two 16-bit numbers, one containing the LHS and sign, the other containing the RHS.
 //TODO: Add calibraion for the current sensor where it shuts off the relay and measures current
+//The AD7794 channels are converted by Acquire_Task on their own schedule. A channel without a conversion yet is read here.
+#define CHANNEL_READ(Name, Bytes, Read, Convert)	if(Acquire_Get(CHANNEL_##Name, &Values[CHANNEL_##Name]) != 0) { Values[CHANNEL_##Name] = (uint32_t)Read(); }
 void GetData(uint8_t *TheData)
 {
-	//uint8_t SendData[3];
-	uint32_t TempData;
-	//uint8_t DataLocation;
-	
-	//DataLocation = 0;
-	
-	//Turn on excitation current to red thermistor
-	//SendData[0] = (AD7794_IO_DIR_IOUT1 | AD7794_IO_10UA);
-	//AD7794WriteReg(AD7794_CR_REG_IO, SendData);
-
-	//Set up channel 2 (red thermistor)
-	//	-Unipolar
-	//	-Gain of 2
-	//	-Internal 1.17V reference
-	//	-Buffered
-	/*SendData[1] = (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_2);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN2);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	SendData[1] = AD7794_MRH_MODE_SINGLE;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-	AD7794WaitReady();*/
-	TempData = GetRedTemp();
-	TheData[0] = ((TempData>>16) & 0xFF);
-	TheData[1] = ((TempData>>8) & 0xFF);
-	TheData[2] = (TempData & 0xFF);
-	//printf_P(PSTR("Red: %lu counts or %d %d %d\n"), TempData, TheData[0], TheData[1], TheData[2]);
-	
-	//Turn on excitation current to black thermistor
-	//SendData[0] = (AD7794_IO_DIR_IOUT2 | AD7794_IO_10UA);
-	//AD7794WriteReg(AD7794_CR_REG_IO, SendData);
-	
-	//Set up channel 3 (black thermistor)
-	//	-Unipolar
-	//	-Gain of 2
-	//	-Internal 1.17V reference
-	//	-Buffered
-	/*SendData[1] = (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_2);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN3);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	SendData[1] = AD7794_MRH_MODE_SINGLE;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-	AD7794WaitReady();*/
-	TempData = GetBlackTemp();
-	TheData[3] = ((TempData>>16) & 0xFF);
-	TheData[4] = ((TempData>>8) & 0xFF);
-	TheData[5] = (TempData & 0xFF);
-	
-	//printf_P(PSTR("Black: %lu counts or %d %d %d\n"), TempData, TheData[3], TheData[4], TheData[5]);
-
-	//Turn off excitation currents
-	//SendData[0] = (AD7794_IO_DIR_NORMAL | AD7794_IO_OFF);
-	//AD7794WriteReg(AD7794_CR_REG_IO, SendData);
-	
-	//Set up channel 6 (heater voltage)
-	//	-Unipolar
-	//	-Gain of 1
-	//	-Internal 1.17V reference
-	//	-Buffered
-	/*SendData[1] = (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_1);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN6);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	SendData[1] = AD7794_MRH_MODE_SINGLE;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-	AD7794WaitReady();*/
-	TempData = GetHeaterVoltage();
-	TheData[6] = ((TempData>>16) & 0xFF);
-	TheData[7] = ((TempData>>8) & 0xFF);
-	TheData[8] = (TempData & 0xFF);
-	
-	//printf_P(PSTR("Heater Voltage: %lu counts or %d %d %d\n"), TempData, TheData[6], TheData[7], TheData[8]);
-	
-	//Get internal temperature
-	TempData = AD7794GetInternalTemp();
-	TheData[9] = ((TempData>>16) & 0xFF);
-	TheData[10] = ((TempData>>8) & 0xFF);
-	TheData[11] = (TempData & 0xFF);
-	
-	//printf_P(PSTR("Internal Temperature: %lu counts or %d %d %d\n"), TempData, TheData[9], TheData[10], TheData[11]);
-	
-	//Set up channel 1 (heater current)
-	//	-Bipolar
-	//	-Gain of 1
-	//	-Internal 1.17V reference
-	//	-Buffered
-	/*SendData[1] = (AD7794_CRH_BIAS_AIN1|AD7794_CRH_BIPOLAR|AD7794_CRH_BOOST|AD7794_CRH_GAIN_1);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN1);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	SendData[1] = AD7794_MRH_MODE_SINGLE;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-	AD7794WaitReady();*/
-	TempData = GetHeaterCurrent();
-	TheData[12] = ((TempData>>16) & 0xFF);
-	TheData[13] = ((TempData>>8) & 0xFF);
-	TheData[14] = (TempData & 0xFF);
-	
-	//printf_P(PSTR("Heater Current: %lu counts or %d %d %d\n"), TempData, TheData[12], TheData[13], TheData[14]);
-
+	uint32_t Values[CHANNEL_COUNT];
+	
+	CHANNEL_LIST(CHANNEL_READ)
+	Power_ADCSleep();
+	Channels_Pack(Values, TheData);
 	return;
 }
 
 /** Get the heater current from channel 1 of the AD7794. Heater current is measured by an ACS711 current sensor on the low side of the DC plug.
-*
-*	Channel 1 setup:
-*		-Bipolar
-*		-AIN1- biased to VCC/2
-*		-Bias boost on
-*		-Gain of 1
-*		-Internal 1.17V reference
-*		-Buffered	
+*	The channel setup is in the channel table in acquire.c.
 */
 uint32_t GetHeaterCurrent(void)
 {
-	uint8_t SendData[3];
-	uint32_t TempData;
-	
-	SendData[1] = (AD7794_CRH_BIAS_AIN1|AD7794_CRH_BIPOLAR|AD7794_CRH_BOOST|AD7794_CRH_GAIN_1);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN1);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	SendData[1] = AD7794_MRH_MODE_SINGLE;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-	AD7794WaitReady();
-	TempData = AD7794GetData();
-	return TempData;
+	return Acquire_Now(CHANNEL_HEATER_CURRENT);
 }
 
 /** Get the heater voltage from channel 6 of the AD7794. Heater current is measured through a voltage divider on the DC input line.
 *	Resistors for the divider are 280K/10K. This gives a maximum measurement range of ~34V.
-*
-*	Channel 6 setup:
-*		-Unipolar
-*		-Gain of 1
-*		-Internal 1.17V reference
-*		-Buffered
 */
 uint32_t GetHeaterVoltage(void)
 {
-	uint8_t SendData[3];
-	uint32_t TempData;
-
-	SendData[1] = (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_1);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN6);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	SendData[1] = AD7794_MRH_MODE_SINGLE;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-	AD7794WaitReady();
-	TempData = AD7794GetData();
-	return TempData;
+	return Acquire_Now(CHANNEL_HEATER_VOLTAGE);
 }
 
-/** Get the thermistor reading from the red plug attached to channel 2. The thermistor is excited by a 10nA current.
-*
-*	Channel 2 setup:
-*		-Unipolar
-*		-Gain of 2
-*		-Internal 1.17V reference
-*		-Buffered
+/** Get the thermistor reading from the red plug attached to channel 2. The thermistor is excited by a 10uA current.
 */
 uint32_t GetRedTemp(void)
 {
-	uint8_t SendData[3];
-	uint32_t TempData;
-
-	//Turn on excitation current to red thermistor
-	SendData[0] = (AD7794_IO_DIR_IOUT1 | AD7794_IO_10UA);
-	AD7794WriteReg(AD7794_CR_REG_IO, SendData);
-
-	SendData[1] = (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_2);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN2);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	SendData[1] = AD7794_MRH_MODE_SINGLE;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-	AD7794WaitReady();
-	TempData = AD7794GetData();
-	
-	//Turn off excitation currents
-	SendData[0] = (AD7794_IO_DIR_NORMAL | AD7794_IO_OFF);
-	AD7794WriteReg(AD7794_CR_REG_IO, SendData);
-	
-	return TempData;
+	return Acquire_Now(CHANNEL_RED_TEMP);
 }
 
-/** Get the thermistor reading from the black plug attached to channel 3. The thermistor is excited by a 10nA current.
-*
-*	Channel 3 setup:
-*		-Unipolar
-*		-Gain of 2
-*		-Internal 1.17V reference
-*		-Buffered
+/** Get the thermistor reading from the black plug attached to channel 3. The thermistor is excited by a 10uA current.
 */
 uint32_t GetBlackTemp(void)
 {
-	uint8_t SendData[3];
-	uint32_t TempData;
-	
-	//Turn on excitation current to black thermistor
-	SendData[0] = (AD7794_IO_DIR_IOUT2 | AD7794_IO_10UA);
-	AD7794WriteReg(AD7794_CR_REG_IO, SendData);
-	
-	SendData[1] = (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_2);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN3);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	SendData[1] = AD7794_MRH_MODE_SINGLE;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-	AD7794WaitReady();
-	TempData = AD7794GetData();
-	
-	//Turn off excitation currents
-	SendData[0] = (AD7794_IO_DIR_NORMAL | AD7794_IO_OFF);
-	AD7794WriteReg(AD7794_CR_REG_IO, SendData);
-	
-	return TempData;
+	return Acquire_Now(CHANNEL_BLACK_TEMP);
 }
 
 
@@ -722,73 +773,32 @@ uint32_t GetBlackTemp(void)
 
 
 
-//Converts the measured heater voltage to the real voltage in volts/10000
-//Uses the measured values of resistors as R1=10K, R2=279.2K
-//TODO: Make these resistances compiler defines?
-//TODO: These functions should probably be combined somewhere
-uint32_t ConvertHeaterVoltage(uint32_t InputCounts)
+/** Get the zero point of the current sensor from EEPROM, or mid scale if it was never calibrated. */
+uint32_t GetHeaterCurrentZero(void)
 {
-	double HeaterVoltage;
-	HeaterVoltage = ((double)InputCounts*1.17F*289.2F)/((double)(0xFFFFFF * 10));
-	return (uint32_t)(HeaterVoltage*10000);
-}
-
-//This measurment is assumed to be taken in bipolar mode
-int32_t ConvertHeaterCurrent(uint32_t InputCounts)
-{
-	int32_t CountsFromZero;
-	double HeaterCurrent;
-	uint32_t CalValue;
 	uint8_t CalString[3];
 	
-	//Get the calibraion data
 	eeprom_read_block((void*)&CalString, (const void*)&NV_CURRENT_ZERO_CAL, 3);
-	if((CalString[2] == 0xFF) && (CalString[2] == 0xFF) && (CalString[2] == 0xFF))
+	if((CalString[0] == 0xFF) && (CalString[1] == 0xFF) && (CalString[2] == 0xFF))
 	{
 		//If no calibraion exsists
 		//TODO: Add a warning here?
-		CalValue = 8388608;
-	}
-	else
-	{
-		CalValue = CalString[2] + CalString[1]*256 + CalString[0]*65536;
-	}
-	//printf_P(PSTR("Cal: 0x%06lX\n"), CalValue);
-	//printf_P(PSTR("Counts: 0x%06lX\n"), InputCounts);
-	
-	if(InputCounts > CalValue)
-	{
-		CountsFromZero = (int32_t)(InputCounts-CalValue);
-		
-	}
-	else
-	{
-		CountsFromZero = -1*((int32_t)(CalValue-InputCounts));
+		return 8388608;
 	}
-	//CountsFromZero = -4000;
-	//printf_P(PSTR("Counts fz: 0x%06lX\n"), CountsFromZero);
-	//printf_P(PSTR("Counts fz: %ld\n"), CountsFromZero);
-	HeaterCurrent = ((double)CountsFromZero*1170.0F)/((double)(0xFFFFFF));
-	HeaterCurrent = HeaterCurrent / (double)(220);
-	return (int32_t)(HeaterCurrent*10000);
+	return CalString[2] + CalString[1]*256 + ((uint32_t)CalString[0])*65536;
 }
 
 //Timer interrupt 0 for basic timing stuff
 ISR(TIMER0_COMPA_vect)
 {
-	uint16_t inByte;
 	ElapsedMS++;
 	
 	//Handle USB stuff
 	//This happens every ~8 ms
 	if( ((ElapsedMS & 0x0007) == 0x0000) )// && (USB_IsInitialized == true) )
 	{
-		//receiv and process a character from the USB CDC interface
-		inByte = CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-		if((inByte > 0) && (inByte < 255))
-		{
-			CommandGetInputChar(inByte);	//NOTE: this limits the device to recieve a single character every 8ms (I think). This should not be a problem for user input.
-		}
+		//Take everything received from the USB CDC interface. The main loop hands it to the command interpreter.
+		Shell_Receive();
 		
 		CDC_Device_USBTask(&VirtualSerial_CDC_Interface);
 		USB_USBTask();
@@ -807,14 +817,14 @@ ISR(TIMER3_COMPA_vect)
 	PORTF ^= (1<<5);
 }
 
-//Triggered on a change of button state
-ISR(INT2_vect)
+//Called from the TWI interrupt when the button read started by INT2 is done
+static void ButtonReadDone(TWIBus_Transaction *Transaction)
 {
 	uint8_t TheButtonState;
 	uint8_t TheOldButtonState;
 	
 	//Get the button state
-	TheButtonState = GetButtonState();
+	TheButtonState = ~((ButtonReadData >> 4) & 0x03);
 	//printf_P(PSTR("bs: 0x%02X\n"), TheButtonState);
 	TheOldButtonState = BH_GetStatus(BH_STATUS_HIO);
 	
@@ -824,6 +834,7 @@ ISR(INT2_vect)
 		//Button 1 down
 		//printf_P(PSTR("b1\n"));
 		BH_SetStatus(BH_STATUS_HIO, BH_STATUS_HIO_B1_PEND, 1);
+		Power_RequestWake();
 	}
 	
 	if ( ((TheButtonState & 0x02) == 0x02) && ((TheOldButtonState & BH_STATUS_HIO_B2_OLD) == 0x00) )
@@ -831,18 +842,71 @@ ISR(INT2_vect)
 		//Button 2 down
 		//printf_P(PSTR("b2\n"));
 		BH_SetStatus(BH_STATUS_HIO, BH_STATUS_HIO_B2_PEND, 1);
+		Power_RequestWake();
 	}
+	
+	//The buttons changed again while this read was running
+	if(ButtonReadAgain == 1)
+	{
+		ButtonReadAgain = 0;
+		MAX7315ReadInputsAsync(&ButtonReadData, &ButtonRead, ButtonReadDone);
+	}
+	return;
+}
 
+//Triggered on a change of button state
+//The button state is read from the MAX7315 in the background so this interrupt does not wait on the TWI bus
+ISR(INT2_vect)
+{
+	if(ButtonRead.Status != TWIBUS_STATUS_DONE)
+	{
+		ButtonReadAgain = 1;
+	}
+	else
+	{
+		MAX7315ReadInputsAsync(&ButtonReadData, &ButtonRead, ButtonReadDone);
+	}
 }
 
 ISR(INT3_vect)
 {
+	uint8_t Heat;
+	uint8_t Late;
+	
 	CountsFromRTC++;
 	//printf_P(PSTR("%d\n"), CountsFromRTC);
 	if(CountsFromRTC > 10)
 	{
 		CountsFromRTC = CountsFromRTC - 10;
 	}
+	
+	Power_RTCTick();
+	Acquire_Tick();
+	Late = Supervisor_Tick();
+	Heat = 0;
+	if(ControllerActive == 1)
+	{
+		Heat = Controller_Tick(&ControllerState, &ControllerParams);
+	}
+	
+	//The safety cutoff and the supervisor have the last word on the relay, even if the main loop is stuck
+	if((Safety_Tick() == 1) || (Late == 1) || (RelayHold == 1))
+	{
+		Relay(0);
+	}
+	else if(ControllerActive == 1)
+	{
+		Relay(Heat);
+	}
+	if((PORTD & (1<<6)) != 0)
+	{
+		RelayOnTicks++;
+	}
+	
+	if(CountsFromRTC == 10)
+	{
+		Power_SampleDue();
+	}
 }
 
 /** @} */
@@ -42,6 +42,12 @@ uint8_t StopTemperatureController(uint8_t Discard);
 
 void TemperatureControllerTask( void );
 
+void StartAutotune( void );
+void StopAutotune( void );
+uint8_t GetController(Controller_Params *Params, Controller_State *State);
+void GetFusion(Fusion_State *State);
+void SetSafetyLimit(uint8_t Sensor, uint8_t Limit);
+
 void DelayMS(uint16_t ms);
 void DelaySEC(uint16_t SEC);
 
@@ -50,6 +56,7 @@ void GetData(uint8_t *TheData);
 
 //Device level calibration functions
 void CalibrateHeaterCurrent(void);
+uint32_t GetHeaterCurrentZero(void);
 
 //Functions to get measurments from the ADC
 uint32_t GetHeaterCurrent(void);
@@ -57,10 +64,6 @@ uint32_t GetHeaterVoltage(void);
 uint32_t GetRedTemp(void);
 uint32_t GetBlackTemp(void);
 
-//Functions to convert meaurements into human readable output
-uint32_t ConvertHeaterVoltage(uint32_t InputCounts);
-int32_t ConvertHeaterCurrent(uint32_t InputCounts);
-
 /*
 void StartTimer(void);
 void StopTimer(uint16_t *FinalMS, uint16_t *FinalSEC);
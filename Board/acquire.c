@@ -0,0 +1,449 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Schedule the AD7794 conversions for each channel at its own rate.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+
+extern volatile uint16_t ElapsedMS;
+
+/** The channel table. All channels use the internal 1.17V reference, buffered. The steady rates of 16.7Hz reject 50Hz
+*	and 60Hz at once. The Steps are a few times the noise at the fast rate.
+*
+*	Heater current (AIN1): ACS711 on the low side of the DC plug. Bipolar, AIN1- biased to VCC/2 with the bias boost on,
+*	gain of 1. Every tick, so the power is measured against the relay state of each tick. 50Hz steady, 470Hz fast. The
+*	relay switching moves it by far more than the Step.
+*
+*	Red and black thermistors (AIN2 and AIN3): excited by 10uA from IOUT1 and IOUT2. Unipolar, gain of 2. On the sample
+*	ticks, 16.7Hz steady and 123Hz fast. A Step of 500 counts is about 0.002 deg C.
+*
+*	Heater voltage (AIN6): through a 280K/10K divider on the DC input, for a range of ~34V. Unipolar, gain of 1. The tick
+*	before the sample ticks, 16.7Hz steady and 123Hz fast. A Step of 500 counts is about 1mV.
+*
+*	Internal temperature: unipolar, gain of 1, every minute at 10Hz. Half way between the sample ticks.
+*
+*	A conversion takes two periods of the update rate. In steady state the most on one tick is 40 + 120 + 120 = 280ms, on
+*	the sample ticks, and every 5 seconds the AD7794 is busy for 10*40 + 120 + 120 + 120 + 200/12 = 777ms. GetData took
+*	1000ms for one conversion of each channel at 10Hz.
+*/
+static const Acquire_Channel Channels[ACQUIRE_CHANNELS] =
+{
+	{ CHANNEL_HEATER_CURRENT, (AD7794_CRH_BIAS_AIN1|AD7794_CRH_BIPOLAR|AD7794_CRH_BOOST|AD7794_CRH_GAIN_1),
+	  (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN1), (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF),
+	  AD7794_MRL_UPDATE_RATE_50_HZ, AD7794_MRL_UPDATE_RATE_470_HZ, 2000, 1, 0, ACQUIRE_NO_SAFETY, NULL },
+	{ CHANNEL_RED_TEMP, (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_2),
+	  (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN2), (AD7794_IO_DIR_IOUT1|AD7794_IO_10UA),
+	  AD7794_MRL_UPDATE_RATE_16_7_HZ_60DB, AD7794_MRL_UPDATE_RATE_123_HZ, 500, CONTROLLER_SAMPLE_TICKS, 0, SAFETY_RED, NULL },
+	{ CHANNEL_BLACK_TEMP, (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_2),
+	  (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN3), (AD7794_IO_DIR_IOUT2|AD7794_IO_10UA),
+	  AD7794_MRL_UPDATE_RATE_16_7_HZ_60DB, AD7794_MRL_UPDATE_RATE_123_HZ, 500, CONTROLLER_SAMPLE_TICKS, 0, SAFETY_BLACK, NULL },
+	{ CHANNEL_HEATER_VOLTAGE, (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_1),
+	  (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN6), (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF),
+	  AD7794_MRL_UPDATE_RATE_16_7_HZ_60DB, AD7794_MRL_UPDATE_RATE_123_HZ, 500, CONTROLLER_SAMPLE_TICKS, CONTROLLER_SAMPLE_TICKS - 1,
+	  ACQUIRE_NO_SAFETY, NULL },
+	{ CHANNEL_INTERNAL_TEMP, (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_1),
+	  (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_TEMP), (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF),
+	  AD7794_MRL_UPDATE_RATE_10_HZ, AD7794_MRL_UPDATE_RATE_10_HZ, 0, 12*CONTROLLER_SAMPLE_TICKS, CONTROLLER_SAMPLE_TICKS/2,
+	  SAFETY_INTERNAL, AD7794InternalTempFromCounts },
+};
+
+static volatile uint32_t Ticks;				//RTC ticks, counted by Acquire_Tick
+static volatile uint16_t TickMS;			//ElapsedMS at the last tick
+static uint32_t StartTick;
+static uint32_t Deadline[ACQUIRE_CHANNELS];
+static uint32_t Counts[ACQUIRE_CHANNELS];
+static uint8_t Have[ACQUIRE_CHANNELS];		//1 once there are counts since Acquire_Start
+static uint8_t Running;						//1 from Acquire_Start to Acquire_Stop
+static uint8_t RelayState[ACQUIRE_CHANNELS];
+static uint32_t Variance[ACQUIRE_CHANNELS];
+static uint8_t Rate[ACQUIRE_CHANNELS];		//For the next conversion
+static uint8_t Policy;
+static Acquire_Stats Stats[ACQUIRE_CHANNELS];
+
+static uint8_t Acquire_Find(uint8_t Channel);
+static uint32_t Acquire_NowMS(uint32_t *Tick);
+static void Acquire_Convert(uint8_t Index);
+static void Acquire_Adapt(uint8_t Index, uint32_t NewCounts, uint8_t NewRelay);
+
+void Acquire_Tick(void)
+{
+	Ticks++;
+	TickMS = ElapsedMS;
+	return;
+}
+
+void Acquire_Start(uint8_t TicksToSample)
+{
+	uint8_t OldSREG;
+	uint8_t i;
+
+	OldSREG = SREG;
+	cli();
+	StartTick = Ticks;
+	SREG = OldSREG;
+
+	for(i=0; i<ACQUIRE_CHANNELS; i++)
+	{
+		Deadline[i] = StartTick + ((Channels[i].Phase + TicksToSample) % Channels[i].Period);
+		Have[i] = 0;
+		Variance[i] = 0;
+		Rate[i] = (Policy == ACQUIRE_POLICY_FAST) ? Channels[i].FastRate : Channels[i].Rate;
+	}
+	memset(Stats, 0, sizeof(Stats));
+	Running = 1;
+	return;
+}
+
+void Acquire_Stop(void)
+{
+	Running = 0;
+	memset(Have, 0, sizeof(Have));
+	return;
+}
+
+void Acquire_Task(void)
+{
+	uint32_t Now;
+	uint32_t Tick;
+	uint32_t NowMS;
+	uint32_t Late;
+	uint8_t Next;
+	uint8_t Converted;
+	uint8_t i;
+
+	Converted = 0;
+	Acquire_NowMS(&Now);
+	while(1)
+	{
+		//The earliest deadline that has passed. Ties go to the shorter period, then to the table order.
+		Next = ACQUIRE_CHANNELS;
+		for(i=0; i<ACQUIRE_CHANNELS; i++)
+		{
+			if((int32_t)(Now - Deadline[i]) < 0)
+			{
+				continue;
+			}
+			if((Next == ACQUIRE_CHANNELS) || ((int32_t)(Deadline[i] - Deadline[Next]) < 0) ||
+			   ((Deadline[i] == Deadline[Next]) && (Channels[i].Period < Channels[Next].Period)))
+			{
+				Next = i;
+			}
+		}
+		if(Next == ACQUIRE_CHANNELS)
+		{
+			break;
+		}
+
+		//Skip the deadlines that are a whole period or more behind, so the grid is kept
+		Late = (Now - Deadline[Next]) / Channels[Next].Period;
+		if(Late > 0)
+		{
+			Stats[Next].Missed += Late;
+			Deadline[Next] += Late * Channels[Next].Period;
+		}
+
+		NowMS = Acquire_NowMS(&Tick);
+		Late = NowMS - (Deadline[Next] - StartTick) * ACQUIRE_TICK_MS;
+		if(Late > Stats[Next].MaxLateMS)
+		{
+			Stats[Next].MaxLateMS = (Late > 0xFFFF) ? 0xFFFF : Late;
+		}
+		if(Stats[Next].Samples == 0)
+		{
+			Stats[Next].FirstMS = NowMS;
+		}
+		Stats[Next].LastMS = NowMS;
+		Stats[Next].Samples++;
+		Stats[Next].BusyMS += AD7794ConversionMS(Rate[Next]);
+		if(Rate[Next] != Channels[Next].Rate)
+		{
+			Stats[Next].FastSamples++;
+		}
+
+		Acquire_Convert(Next);
+		Deadline[Next] += Channels[Next].Period;
+		Converted = 1;
+	}
+
+	if(Converted == 1)
+	{
+		Power_ADCSleep();
+	}
+	return;
+}
+
+uint32_t Acquire_Now(uint8_t Channel)
+{
+	uint8_t Index;
+
+	Index = Acquire_Find(Channel);
+	if(Index >= ACQUIRE_CHANNELS)
+	{
+		return 0;
+	}
+	Acquire_Convert(Index);
+	return Counts[Index];
+}
+
+uint8_t Acquire_Burst(uint8_t Channel, uint8_t Rate, uint8_t Samples, void (*Sample)(uint32_t Counts))
+{
+	const Acquire_Channel *Entry;
+	uint8_t SendData[2];
+	uint32_t NewCounts;
+	uint8_t Index;
+	uint8_t Taken;
+
+	Index = Acquire_Find(Channel);
+	if(Index >= ACQUIRE_CHANNELS)
+	{
+		return 0;
+	}
+	Entry = &Channels[Index];
+	if(Entry->IO != (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF))
+	{
+		SendData[0] = Entry->IO;
+		AD7794WriteReg(AD7794_CR_REG_IO, SendData);
+	}
+	SendData[1] = Entry->ConfigH;
+	SendData[0] = Entry->ConfigL;
+	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
+
+	//The first conversion takes two periods of the rate, the rest one period each. Reading the data starts the next.
+	SendData[1] = AD7794_MRH_MODE_CONTINUOUS;
+	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | Rate);
+	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
+	for(Taken=0; Taken<Samples; Taken++)
+	{
+		if(AD7794WaitReady() == 0xFF)
+		{
+			break;
+		}
+		NewCounts = AD7794GetData();
+		if(Entry->Safety != ACQUIRE_NO_SAFETY)
+		{
+			Safety_Check(Entry->Safety, NewCounts);
+		}
+		Sample(NewCounts);
+	}
+
+	SendData[1] = AD7794_MRH_MODE_IDLE;
+	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | Rate);
+	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
+	if(Entry->IO != (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF))
+	{
+		SendData[0] = (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF);
+		AD7794WriteReg(AD7794_CR_REG_IO, SendData);
+	}
+	return Taken;
+}
+
+uint8_t Acquire_Get(uint8_t Channel, uint32_t *Value)
+{
+	uint8_t Index;
+
+	//Counts kept by Acquire_Now with no schedule running are not refreshed, so they are never given out
+	Index = Acquire_Find(Channel);
+	if((Running == 0) || (Index >= ACQUIRE_CHANNELS) || (Have[Index] == 0))
+	{
+		return 1;
+	}
+	if(Channels[Index].Convert != NULL)
+	{
+		*Value = (uint32_t)Channels[Index].Convert(Counts[Index]);
+	}
+	else
+	{
+		*Value = Counts[Index];
+	}
+	return 0;
+}
+
+uint8_t Acquire_GetRelay(uint8_t Channel)
+{
+	uint8_t Index;
+
+	Index = Acquire_Find(Channel);
+	if(Index >= ACQUIRE_CHANNELS)
+	{
+		return ACQUIRE_RELAY_SWITCHED;
+	}
+	return RelayState[Index];
+}
+
+void Acquire_SetPolicy(uint8_t NewPolicy)
+{
+	uint8_t i;
+
+	if(NewPolicy > ACQUIRE_POLICY_FAST)
+	{
+		return;
+	}
+	//The adaptive policy starts from the steady rates
+	Policy = NewPolicy;
+	for(i=0; i<ACQUIRE_CHANNELS; i++)
+	{
+		Rate[i] = (Policy == ACQUIRE_POLICY_FAST) ? Channels[i].FastRate : Channels[i].Rate;
+	}
+	return;
+}
+
+uint8_t Acquire_GetPolicy(void)
+{
+	return Policy;
+}
+
+uint8_t Acquire_GetChannel(uint8_t Index, Acquire_Channel *Channel, Acquire_Stats *ChannelStats)
+{
+	if(Index >= ACQUIRE_CHANNELS)
+	{
+		return 1;
+	}
+	memcpy(Channel, &Channels[Index], sizeof(Acquire_Channel));
+	memcpy(ChannelStats, &Stats[Index], sizeof(Acquire_Stats));
+	ChannelStats->Variance = Variance[Index];
+	ChannelStats->Rate = Rate[Index];
+	return 0;
+}
+
+static uint8_t Acquire_Find(uint8_t Channel)
+{
+	uint8_t i;
+
+	for(i=0; i<ACQUIRE_CHANNELS; i++)
+	{
+		if(Channels[i].Channel == Channel)
+		{
+			break;
+		}
+	}
+	return i;
+}
+
+//The time in ms from Acquire_Start, and the tick count. The scheduled conversions of a channel must be spaced by its
+//period, so the time is taken from the ticks, plus ElapsedMS since the last one.
+static uint32_t Acquire_NowMS(uint32_t *Tick)
+{
+	uint8_t OldSREG;
+	uint16_t SinceTick;
+
+	OldSREG = SREG;
+	cli();
+	*Tick = Ticks;
+	SinceTick = (uint16_t)(((uint32_t)ElapsedMS + 60000 - TickMS) % 60000);
+	SREG = OldSREG;
+	return (*Tick - StartTick) * ACQUIRE_TICK_MS + SinceTick;
+}
+
+static void Acquire_Convert(uint8_t Index)
+{
+	const Acquire_Channel *Channel;
+	uint8_t SendData[2];
+	uint8_t Relay;
+	uint8_t NewRelay;
+	uint32_t NewCounts;
+
+	Channel = &Channels[Index];
+	Relay = PORTD & (1<<6);
+	if(Channel->IO != (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF))
+	{
+		SendData[0] = Channel->IO;
+		AD7794WriteReg(AD7794_CR_REG_IO, SendData);
+	}
+	SendData[1] = Channel->ConfigH;
+	SendData[0] = Channel->ConfigL;
+	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
+	SendData[1] = AD7794_MRH_MODE_SINGLE;
+	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | Rate[Index]);
+	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
+	AD7794WaitReady();
+	NewCounts = AD7794GetData();
+	if(Channel->Safety != ACQUIRE_NO_SAFETY)
+	{
+		Safety_Check(Channel->Safety, NewCounts);
+	}
+
+	//The current does not go with either relay state if it switched
+	if((PORTD & (1<<6)) != Relay)
+	{
+		NewRelay = ACQUIRE_RELAY_SWITCHED;
+	}
+	else
+	{
+		NewRelay = (Relay != 0) ? 1 : 0;
+	}
+	Acquire_Adapt(Index, NewCounts, NewRelay);
+	Counts[Index] = NewCounts;
+	RelayState[Index] = NewRelay;
+	Have[Index] = 1;
+
+	//Turn off the excitation current
+	if(Channel->IO != (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF))
+	{
+		SendData[0] = (AD7794_IO_DIR_NORMAL|AD7794_IO_OFF);
+		AD7794WriteReg(AD7794_CR_REG_IO, SendData);
+	}
+	return;
+}
+
+//Update the variance of the change between conversions, and pick the rate of the next conversion. A change across a
+//relay switch is the load, not the signal moving, and is left out.
+static void Acquire_Adapt(uint8_t Index, uint32_t NewCounts, uint8_t NewRelay)
+{
+	const Acquire_Channel *Channel;
+	uint32_t Change;
+	uint32_t Clip;
+	uint32_t Limit;
+
+	Channel = &Channels[Index];
+	if((Have[Index] == 1) && (NewRelay == RelayState[Index]) && (NewRelay != ACQUIRE_RELAY_SWITCHED))
+	{
+		Change = (NewCounts > Counts[Index]) ? (NewCounts - Counts[Index]) : (Counts[Index] - NewCounts);
+		Clip = (uint32_t)Channel->Step * ACQUIRE_CLIP_STEPS;
+		if((Clip == 0) || (Clip > ACQUIRE_STEP_MAX))
+		{
+			Clip = ACQUIRE_STEP_MAX;
+		}
+		if(Change > Clip)
+		{
+			Change = Clip;
+		}
+		Variance[Index] = Variance[Index] - (Variance[Index] >> ACQUIRE_VARIANCE_SHIFT) + ((Change * Change) >> ACQUIRE_VARIANCE_SHIFT);
+	}
+
+	if((Policy != ACQUIRE_POLICY_ADAPTIVE) || (Channel->Step == 0))
+	{
+		return;
+	}
+	Limit = (uint32_t)Channel->Step * Channel->Step;
+	if(Variance[Index] > Limit)
+	{
+		Rate[Index] = Channel->FastRate;
+	}
+	else if(Variance[Index] < (Limit / 4))
+	{
+		Rate[Index] = Channel->Rate;
+	}
+	return;
+}
+
+/** @} */
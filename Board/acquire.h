@@ -0,0 +1,147 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Schedule the AD7794 conversions for each channel at its own rate.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Each AD7794 channel has an entry in the channel table in acquire.c with its configuration register, excitation
+*	current, update rate, period and phase. The period and phase are in RTC ticks. A channel is due every period ticks,
+*	and the phase is counted from a sample tick. TemperatureControllerTask calls Acquire_Start when it starts taking
+*	samples, with the ticks to its next sample, so a channel with a period of CONTROLLER_SAMPLE_TICKS and a phase of 0 is
+*	converted on the sample ticks, just before the sample.
+*
+*	Acquire_Task runs the conversions that are due, one at a time on the single AD7794, earliest deadline first. Channels
+*	due on the same tick go in order of their period, shortest first. The deadlines stay on the grid of the period: if
+*	the main loop gets to a channel a whole period or more late, the deadlines it missed are counted and skipped, so a
+*	channel never runs back to back to catch up. The phases spread the slow channels over the ticks, so the conversions
+*	due on one tick take less than a tick.
+*
+*	The counts from the latest conversion of each channel are kept, and GetData uses them instead of starting its own
+*	conversions while the schedule runs. A channel that is not in the table or has not been converted since
+*	Acquire_Start is read by GetData as before, and so is every channel once TemperatureControllerTask stops taking
+*	samples and calls Acquire_Stop. The safety limit of a channel is checked on every conversion, and the relay state
+*	during the conversion is kept so the heater current can be matched to it.
+*
+*	Each channel has a steady rate, slow with high rejection, and a fast rate. The update rate of each conversion is set
+*	by the policy:
+*		-ACQUIRE_POLICY_FIXED: always the steady rate.
+*		-ACQUIRE_POLICY_FAST: always the fast rate.
+*		-ACQUIRE_POLICY_ADAPTIVE: the fast rate while the signal is moving, the steady rate once it settles. Each channel
+*		 keeps the variance of the change between its conversions, as an exponential average over about
+*		 2^ACQUIRE_VARIANCE_SHIFT conversions. The channel goes fast once the variance is over its Step squared and back to
+*		 steady below a quarter of that. Each change is clipped to ACQUIRE_CLIP_STEPS Steps, so a single jump sets the
+*		 channel fast for about a dozen conversions and a channel that keeps moving stays fast. Changes across a relay
+*		 switch come from the load, not the signal, and are left out. The fast rate has more noise, so the Step of a channel must be a few times the
+*		 noise at its fast rate, or the noise alone keeps it fast. A channel with a Step of 0 always uses its steady rate.
+*	The fast rates take less time, so the adaptive policy saves A/D time while the signals move, when the extra noise is
+*	small against the change, and gets the low noise and the 50/60Hz rejection back in steady state. The policy is kept
+*	in RAM. HardwareInit sets ACQUIRE_POLICY_ADAPTIVE.
+*
+*	For each channel the number of conversions, the deadlines missed, the worst lateness (from the deadline to the start
+*	of the conversion, in ms) and the times of the first and last conversion are kept. They are shown with the table by
+*	the 'acq' command.
+*
+*	@{
+*/
+
+#ifndef _ACQUIRE_H_
+#define _ACQUIRE_H_
+
+#include "stdint.h"
+
+#define ACQUIRE_CHANNELS			5		//Entries in the channel table
+#define ACQUIRE_TICK_MS				500		//INT3 triggers on both edges of the 1Hz square wave
+#define ACQUIRE_NO_SAFETY			0xFF
+#define ACQUIRE_RELAY_SWITCHED		0xFF	//The relay switched during the conversion
+#define ACQUIRE_VARIANCE_SHIFT		3		//The variance averages over about 8 conversions
+#define ACQUIRE_CLIP_STEPS			3		//Changes are clipped to this many Steps, so one jump does not stay in the variance
+#define ACQUIRE_STEP_MAX			0xFFFF	//and to this, so the square fits in 32 bits
+
+//Policies for the update rate
+#define ACQUIRE_POLICY_FIXED		0
+#define ACQUIRE_POLICY_ADAPTIVE		1
+#define ACQUIRE_POLICY_FAST			2
+
+typedef struct
+{
+	uint8_t Channel;						//CHANNEL_<Name>
+	uint8_t ConfigH;						//Configuration register
+	uint8_t ConfigL;
+	uint8_t IO;								//IO register during the conversion: the excitation current, if any
+	uint8_t Rate;							//AD7794_MRL_UPDATE_RATE_* in steady state
+	uint8_t FastRate;						//While the signal moves
+	uint16_t Step;							//Counts of change between conversions that count as moving, 0 for never
+	uint16_t Period;						//RTC ticks
+	uint16_t Phase;							//RTC ticks after a sample tick
+	uint8_t Safety;							//SAFETY_<Sensor>, or ACQUIRE_NO_SAFETY
+	int32_t (*Convert)(uint32_t Counts);	//Turns the counts into the value for GetData, or NULL for the counts
+} Acquire_Channel;
+
+typedef struct
+{
+	uint32_t Samples;						//Conversions since Acquire_Start
+	uint16_t Missed;						//Deadlines skipped
+	uint16_t MaxLateMS;						//Longest time from a deadline to the start of its conversion
+	uint32_t FirstMS;						//Start of the first and last conversion, in ms from Acquire_Start
+	uint32_t LastMS;
+	uint32_t FastSamples;					//Conversions at the fast rate
+	uint32_t BusyMS;						//A/D time of the conversions
+	uint32_t Variance;						//Of the change between conversions, in counts squared
+	uint8_t Rate;							//For the next conversion
+} Acquire_Stats;
+
+/** Count an RTC tick. Called from the RTC interrupt. */
+void Acquire_Tick(void);
+
+/** Put the deadlines on the grid of the sample ticks, the next of which is 'TicksToSample' from now (0 for this tick).
+*	Clears the stats and the kept values. */
+void Acquire_Start(uint8_t TicksToSample);
+
+/** Stop using the kept counts, when TemperatureControllerTask stops taking samples. Until the next Acquire_Start,
+*	Acquire_Get gives nothing and GetData converts each channel itself. */
+void Acquire_Stop(void);
+
+/** Run the conversions that are due. Called by TemperatureControllerTask while it takes samples. */
+void Acquire_Task(void);
+
+/** Convert a channel now, outside of the schedule and the stats, and keep the counts. Returns the counts, or 0 if the
+*	channel is not in the table. */
+uint32_t Acquire_Now(uint8_t Channel);
+
+/** Convert a channel 'Samples' times in a row in continuous mode at 'Rate', outside of the schedule and the stats, and
+*	pass each conversion to 'Sample'. The kept counts are not changed. Returns the number of conversions, 0 if the
+*	channel is not in the table. */
+uint8_t Acquire_Burst(uint8_t Channel, uint8_t Rate, uint8_t Samples, void (*Sample)(uint32_t Counts));
+
+/** Get the value from the latest conversion of a channel. Returns 1 if the channel is not in the table or has not been
+*	converted since Acquire_Start, or if no schedule is running. */
+uint8_t Acquire_Get(uint8_t Channel, uint32_t *Value);
+
+/** The relay state (0 or 1) during the latest conversion of a channel, or ACQUIRE_RELAY_SWITCHED. */
+uint8_t Acquire_GetRelay(uint8_t Channel);
+
+/** Set the update rate policy, one of ACQUIRE_POLICY_*. Must be called before the first conversion. */
+void Acquire_SetPolicy(uint8_t Policy);
+uint8_t Acquire_GetPolicy(void);
+
+/** Get the table entry and the stats for entry 'Index'. Returns 1 if there is no such entry. */
+uint8_t Acquire_GetChannel(uint8_t Index, Acquire_Channel *Channel, Acquire_Stats *Stats);
+
+#endif
+/** @} */
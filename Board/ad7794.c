@@ -26,11 +26,44 @@
 #include "main.h"
 
 float EEMEM NV_AD7794_INTERNAL_TEMP_CAL;		//Store the internal temperature calibration in non-volatile memory
+AD7794_Calibration EEMEM NV_AD7794_CALIBRATION = { .Offset = { [0 ... (AD7794_CAL_CHANNELS-1)] = 0xFFFFFFFF },
+												   .FullScale = { [0 ... (AD7794_CAL_CHANNELS-1)] = 0xFFFFFFFF } };
+
+extern volatile uint16_t ElapsedMS;
+
+//The calibrated channels, in the order of AD7794_Calibration. Each one is calibrated with the configuration it is read
+//with, high byte first, since the full scale coefficient depends on the gain.
+static const uint8_t CalConfig[AD7794_CAL_CHANNELS][2] =
+{
+	{ (AD7794_CRH_BIAS_AIN1|AD7794_CRH_BIPOLAR|AD7794_CRH_BOOST|AD7794_CRH_GAIN_1), (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN1) },
+	{ (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_2), (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN2) },
+	{ (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_2), (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN3) },
+	{ (AD7794_CRH_UNIPOLAR|AD7794_CRH_GAIN_1), (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN6) },
+};
+
+//Single conversion time in ms for each update rate. The first entry is not a rate.
+static const uint16_t ConversionMS[16] = { 0, 5, 9, 17, 33, 40, 52, 61, 103, 120, 120, 160, 200, 241, 320, 480 };
+
+static AD7794_Calibration CalResult;
+static uint8_t CalState;
+static uint8_t CalStep;				//The channel is CalStep/2. Even steps are the zero, odd steps the full scale.
+static uint8_t CalStepActive;		//1 while the part is running CalStep
+static uint16_t CalStepStart;		//ElapsedMS when it was started
+
+static void AD7794SelectCalChannel( uint8_t Channel );
+static void AD7794CalStartStep( void );
+static void AD7794CalEndStep( uint8_t Status );
 
 uint8_t AD7794Init( void )
 {
 	uint8_t SendData[3];
 	
+	//The reset stops a calibration that was running
+	if(CalState == AD7794_CAL_RUNNING)
+	{
+		CalState = AD7794_CAL_FAILED;
+	}
+	CalStepActive = 0;
 	AD7794SendReset();
 	
 	//Calibrate channels
@@ -58,29 +91,45 @@ uint8_t AD7794Init( void )
 	return 0xFF;
 }
 
+//Put the ADC in power down mode. The next write to the mode register that starts a conversion powers it back up.
+void AD7794Powerdown( void )
+{
+	uint8_t SendData[2];
+	
+	SendData[1] = AD7794_MRH_MODE_POWERDOWN;
+	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
+	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
+	return;
+}
+
 //sel = 1 to select the chip
+//Transactions on the SPI bus select the chip automatically. This is only needed to talk to the chip without the bus.
 void AD7794Select( uint8_t sel )
 {
 	if(sel == 1)
 	{
-		PORTD &= ~(1<<4);
+		AD7794_CS_PORT &= ~(1<<AD7794_CS_PIN);
 	}
 	else
 	{
-		PORTD |= (1<<4);
+		AD7794_CS_PORT |= (1<<AD7794_CS_PIN);
 	}
 	return;
 }
 
 void AD7794SendReset( void )
 {
-	AD7794Select(1);
-	SPI_SendByte(0xFF);
-	SPI_SendByte(0xFF);
-	SPI_SendByte(0xFF);
-	SPI_SendByte(0xFF);
-	SPI_SendByte(0xFF);
-	AD7794Select(0);
+	SPIBus_Transaction Transaction;
+	
+	//32 ones resets the serial interface
+	SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AD7794);
+	Transaction.Header[0] = 0xFF;
+	Transaction.Header[1] = 0xFF;
+	Transaction.Header[2] = 0xFF;
+	Transaction.Header[3] = 0xFF;
+	Transaction.Header[4] = 0xFF;
+	Transaction.HeaderLength = 5;
+	SPIBus_Transfer(&Transaction);
 	return;
 }
 
@@ -105,33 +154,44 @@ uint8_t AD7794WaitReady( void )
 	return data;
 }
 
+//Returns the size of register 'reg' in bytes
+static uint8_t AD7794RegSize( uint8_t reg )
+{
+	if( (reg == 0) || (reg == 4) || (reg == 5) )
+	{
+		return 1;
+	}
+	else if( (reg == 1) || (reg == 2) )
+	{
+		return 2;
+	}
+	return 3;
+}
+
 //LSB of returned register is in DataToRead[0]
 bool AD7794ReadReg( uint8_t reg, uint8_t *DataToRead )
 {
+	SPIBus_Transaction Transaction;
+	uint8_t RegData[3];
+	uint8_t RegSize;
+	uint8_t i;
+	
 	if( (reg >= 0) && (reg <= 7) )
 	{
-		AD7794Select(1);
-		SPI_SendByte( AD7794_CR_READ | (reg << 3) );
+		RegSize = AD7794RegSize(reg);
 		
-		if( (reg == 0) || (reg == 4) || (reg == 5) )
-		{
-			//8-bit register
-			*DataToRead = SPI_ReceiveByte();
-		}
-		else if( (reg == 1) || (reg == 2) )
-		{
-			//16-bit register
-			DataToRead[1] = SPI_ReceiveByte();
-			DataToRead[0] = SPI_ReceiveByte();
-		}
-		else
+		SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AD7794);
+		Transaction.Header[0] = AD7794_CR_READ | (reg << 3);
+		Transaction.HeaderLength = 1;
+		Transaction.RxData = RegData;
+		Transaction.DataLength = RegSize;
+		SPIBus_Transfer(&Transaction);
+		
+		//The MSB is read first
+		for(i=0; i<RegSize; i++)
 		{
-			//16-bit register
-			DataToRead[2] = SPI_ReceiveByte();
-			DataToRead[1] = SPI_ReceiveByte();
-			DataToRead[0] = SPI_ReceiveByte();
+			DataToRead[i] = RegData[RegSize-1-i];
 		}
-		AD7794Select(0);
 		return true;
 	}
 	
@@ -142,6 +202,17 @@ bool AD7794ReadReg( uint8_t reg, uint8_t *DataToRead )
 //MSB of register is sent first, MSB should be in DataToWrite[0]
 bool AD7794WriteReg( uint8_t reg, uint8_t *DataToWrite)
 {
+	SPIBus_Transaction Transaction;
+	uint8_t RegSize;
+	uint8_t i;
+	
+	//A calibration step running in the background is let finish before the part is used for anything else, so this
+	//waits for one step at most
+	if(CalStepActive == 1)
+	{
+		AD7794CalEndStep(AD7794WaitReady());
+	}
+	
 	if( (reg == 1) || (reg == 2) || (reg == 5) || (reg == 6) || (reg == 7) )
 	{
 		//Mask the mode register
@@ -152,28 +223,16 @@ bool AD7794WriteReg( uint8_t reg, uint8_t *DataToWrite)
 			DataToWrite[0] &= AD7794_CR_REG_MODE_MASK_L;
 		}
 		
-		//Send data
-		AD7794Select(1);
-		SPI_SendByte( AD7794_CR_WRITE | (reg << 3) );
-		if(reg == 5)
-		{
-			//8-bit write
-			SPI_SendByte(DataToWrite[0]);
-		}
-		else if( (reg == 1) || (reg == 2) )
-		{
-			//16-bit write
-			SPI_SendByte(DataToWrite[1]);
-			SPI_SendByte(DataToWrite[0]);
-		}
-		else
+		//Send data, MSB first
+		RegSize = AD7794RegSize(reg);
+		SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AD7794);
+		Transaction.Header[0] = AD7794_CR_WRITE | (reg << 3);
+		for(i=0; i<RegSize; i++)
 		{
-			//24-bit write
-			SPI_SendByte(DataToWrite[2]);
-			SPI_SendByte(DataToWrite[1]);
-			SPI_SendByte(DataToWrite[0]);
+			Transaction.Header[1+i] = DataToWrite[RegSize-1-i];
 		}
-		AD7794Select(0);
+		Transaction.HeaderLength = 1 + RegSize;
+		SPIBus_Transfer(&Transaction);
 		return true;
 	}
 
@@ -197,6 +256,169 @@ uint32_t AD7794GetData( void )
 	return 0;
 }
 
+/**Returns the time for a single conversion at an update rate (AD7794_MRL_UPDATE_RATE_*) in ms, rounded up. With chop on,
+*	a single conversion takes two periods of the update rate.
+*/
+uint16_t AD7794ConversionMS( uint8_t Rate )
+{
+	return ConversionMS[Rate & 0x0F];
+}
+
+/**Start an internal zero and full scale calibration of each channel. AD7794CalibrateTask runs it from the main loop, one
+*	step at a time, while the part is still used for measurements in between. The results are saved to EEPROM when all
+*	of the steps are done.
+*
+*	Returns 1 if a calibration is already running.
+*/
+uint8_t AD7794CalibrateStart( void )
+{
+	if(CalState == AD7794_CAL_RUNNING)
+	{
+		return 1;
+	}
+	CalState = AD7794_CAL_RUNNING;
+	CalStep = 0;
+	CalStepActive = 0;
+	return 0;
+}
+
+/**Called from the main loop. Checks on the step that is running without waiting, and starts the next one when it is done. */
+void AD7794CalibrateTask( void )
+{
+	uint8_t Status;
+	
+	if(CalState != AD7794_CAL_RUNNING)
+	{
+		return;
+	}
+	if(CalStepActive == 1)
+	{
+		AD7794ReadReg(AD7794_CR_REG_STATUS, &Status);
+		if(((Status & 0x80) != 0) && ((((uint32_t)ElapsedMS + 60000 - CalStepStart) % 60000) < AD7794_CAL_TIMEOUT_MS))
+		{
+			return;
+		}
+		AD7794CalEndStep(Status);
+	}
+	if(CalState == AD7794_CAL_RUNNING)
+	{
+		AD7794CalStartStep();
+	}
+	return;
+}
+
+/**Returns the AD7794_CAL_* state. 'Step' is set to the number of steps done, out of AD7794_CAL_STEPS. */
+uint8_t AD7794CalibrateStatus( uint8_t *Step )
+{
+	*Step = CalStep;
+	return CalState;
+}
+
+/**Write the saved calibration to the OFFSET and FS registers of each channel. Call this after AD7794Init, with the part
+*	idle.
+*
+*	Returns 1 if there is no saved calibration.
+*/
+uint8_t AD7794LoadCalibration( void )
+{
+	uint8_t SendData[3];
+	uint8_t i;
+	
+	eeprom_read_block(&CalResult, &NV_AD7794_CALIBRATION, sizeof(AD7794_Calibration));
+	for(i=0; i<AD7794_CAL_CHANNELS; i++)
+	{
+		//The registers are 24 bits, so an erased EEPROM can not be a calibration
+		if((CalResult.Offset[i] > 0xFFFFFF) || (CalResult.FullScale[i] > 0xFFFFFF))
+		{
+			return 1;
+		}
+	}
+	
+	for(i=0; i<AD7794_CAL_CHANNELS; i++)
+	{
+		AD7794SelectCalChannel(i);
+		SendData[2] = (uint8_t)(CalResult.Offset[i] >> 16);
+		SendData[1] = (uint8_t)(CalResult.Offset[i] >> 8);
+		SendData[0] = (uint8_t)CalResult.Offset[i];
+		AD7794WriteReg(AD7794_CR_REG_OFFSET, SendData);
+		SendData[2] = (uint8_t)(CalResult.FullScale[i] >> 16);
+		SendData[1] = (uint8_t)(CalResult.FullScale[i] >> 8);
+		SendData[0] = (uint8_t)CalResult.FullScale[i];
+		AD7794WriteReg(AD7794_CR_REG_FS, SendData);
+	}
+	return 0;
+}
+
+/**The calibration that was loaded at boot or made since. Channels not calibrated yet are 0xFFFFFFFF. */
+void AD7794GetCalibration( AD7794_Calibration *Calibration )
+{
+	memcpy(Calibration, &CalResult, sizeof(AD7794_Calibration));
+	return;
+}
+
+//Select calibrated channel 'Channel' (0 to AD7794_CAL_CHANNELS-1)
+static void AD7794SelectCalChannel( uint8_t Channel )
+{
+	uint8_t SendData[2];
+	
+	SendData[1] = CalConfig[Channel][0];
+	SendData[0] = CalConfig[Channel][1];
+	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
+	return;
+}
+
+static void AD7794CalStartStep( void )
+{
+	uint8_t SendData[2];
+	
+	if(CalStep == 0)
+	{
+		memset(&CalResult, 0xFF, sizeof(AD7794_Calibration));
+	}
+	AD7794SelectCalChannel(CalStep >> 1);
+	SendData[1] = ((CalStep & 0x01) == 0) ? AD7794_MRH_MODE_IZ_CAL : AD7794_MRH_MODE_IFS_CAL;
+	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ);
+	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
+	CalStepStart = ElapsedMS;
+	CalStepActive = 1;
+	return;
+}
+
+//'Status' is the status register read after the step, with the ready bit still set if it timed out. The part goes back
+//to idle by itself after a calibration step.
+static void AD7794CalEndStep( uint8_t Status )
+{
+	uint8_t ReadData[3];
+	uint32_t Value;
+	
+	CalStepActive = 0;
+	if((Status & 0x80) != 0)
+	{
+		CalState = AD7794_CAL_FAILED;
+		return;
+	}
+	
+	//The channel is still selected, nothing else can use the part while a step runs
+	AD7794ReadReg((((CalStep & 0x01) == 0) ? AD7794_CR_REG_OFFSET : AD7794_CR_REG_FS), ReadData);
+	Value = ((uint32_t)ReadData[2] << 16) | ((uint32_t)ReadData[1] << 8) | ((uint32_t)ReadData[0]);
+	if((CalStep & 0x01) == 0)
+	{
+		CalResult.Offset[CalStep >> 1] = Value;
+	}
+	else
+	{
+		CalResult.FullScale[CalStep >> 1] = Value;
+	}
+	
+	CalStep++;
+	if(CalStep >= AD7794_CAL_STEPS)
+	{
+		eeprom_update_block(&CalResult, &NV_AD7794_CALIBRATION, sizeof(AD7794_Calibration));
+		CalState = AD7794_CAL_DONE;
+	}
+	return;
+}
+
 //Functions below this line use floating point math
 #if AD7794_USE_FLOAT == 1
 
@@ -262,14 +484,6 @@ int32_t AD7794GetInternalTemp(void)
 {
 	uint8_t SendData[2];
 	uint32_t ADCData = 0;
-
-	double slope;
-	double intercept;
-	double InternalTemp;
-	//char OutputString[20];
-	
-	slope = 0.0001721912F;		//Deg C/count
-	intercept = eeprom_read_float(&NV_AD7794_INTERNAL_TEMP_CAL);
 	
 	//Set up internal temperature
 	//	-Unipolar
@@ -284,8 +498,24 @@ int32_t AD7794GetInternalTemp(void)
 	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
 	AD7794WaitReady();
 	ADCData = AD7794GetData();
+	Safety_Check(SAFETY_INTERNAL, ADCData);
+	
+	return AD7794InternalTempFromCounts(ADCData);
+}
+
+/**Returns the internal temperature in degrees C*10000 for a reading of the internal temperature sensor in counts.
+*/
+int32_t AD7794InternalTempFromCounts(uint32_t Counts)
+{
+	double slope;
+	double intercept;
+	double InternalTemp;
+	//char OutputString[20];
+	
+	slope = 0.0001721912F;		//Deg C/count
+	intercept = eeprom_read_float(&NV_AD7794_INTERNAL_TEMP_CAL);
 	
-	InternalTemp = slope*(double)ADCData + intercept;
+	InternalTemp = slope*(double)Counts + intercept;
 	
 	//dtostrf(InternalTemp, 9, 4, OutputString);
 	//printf_P(PSTR("Internal temperature is: %s C\n"), OutputString);
@@ -293,6 +523,29 @@ int32_t AD7794GetInternalTemp(void)
 	return ((int32_t)(InternalTemp*10000.0F));
 }
 
+/**Returns the internal temperature sensor reading in counts for a temperature in degrees C*10000.
+*/
+uint32_t AD7794InternalTempToCounts(int32_t Temp)
+{
+	double slope;
+	double intercept;
+	double Counts;
+	
+	slope = 0.0001721912F;		//Deg C/count
+	intercept = eeprom_read_float(&NV_AD7794_INTERNAL_TEMP_CAL);
+	
+	Counts = ((double)Temp/10000.0F - intercept)/slope;
+	if(Counts < 0)
+	{
+		return 0;
+	}
+	if(!(Counts <= (double)0xFFFFFF))		//Also catches a blank calibration
+	{
+		return 0xFFFFFF;
+	}
+	return (uint32_t)Counts;
+}
+
 #endif
 
 /** @} */
\ No newline at end of file
@@ -33,6 +33,10 @@
 //Set to 1 to enable floating point. The proper libraries and includes need to be set.
 #define AD7794_USE_FLOAT			1
 
+//Setup the CS pin
+#define AD7794_CS_PORT				PORTD
+#define AD7794_CS_PIN				4
+
 
 
 
@@ -147,16 +151,43 @@
 #define AD7794_TEMP_CAL_Y			23400
 #define AD7794_TEMP_CAL_Z			58
 
+//Internal offset and full scale calibration of the channels that are used. The OFFSET and FS registers are kept for each
+//channel by the part, so each channel is calibrated with its own zero and full scale step. The results are saved in
+//EEPROM and written back at boot by AD7794LoadCalibration.
+#define AD7794_CAL_CHANNELS			4		//AIN1, AIN2, AIN3 and AIN6
+#define AD7794_CAL_STEPS			(2*AD7794_CAL_CHANNELS)
+#define AD7794_CAL_TIMEOUT_MS		1000	//For one step. A step takes two conversions at the update rate.
+
+#define AD7794_CAL_IDLE				0		//Never run since boot
+#define AD7794_CAL_RUNNING			1
+#define AD7794_CAL_DONE				2
+#define AD7794_CAL_FAILED			3		//A step timed out, nothing was saved
+
+typedef struct
+{
+	uint32_t Offset[AD7794_CAL_CHANNELS];		//Register 6 for each channel, 0xFFFFFFFF if never saved
+	uint32_t FullScale[AD7794_CAL_CHANNELS];	//Register 7
+} AD7794_Calibration;
+
 //Low Level Functions
 uint8_t AD7794Init( void );
 void AD7794Select(uint8_t sel);
 void AD7794SendReset( void );
 uint8_t AD7794WaitReady( void );
+void AD7794Powerdown( void );
 
 bool AD7794ReadReg(uint8_t reg, uint8_t *DataToRead);
 bool AD7794WriteReg(uint8_t reg, uint8_t *DataToWrite);
 
 uint32_t AD7794GetData( void );
+uint16_t AD7794ConversionMS( uint8_t Rate );
+
+//Calibration
+uint8_t AD7794CalibrateStart( void );
+void AD7794CalibrateTask( void );
+uint8_t AD7794CalibrateStatus( uint8_t *Step );
+uint8_t AD7794LoadCalibration( void );
+void AD7794GetCalibration( AD7794_Calibration *Calibration );
 
 
 //These functions use floating point math
@@ -164,6 +195,8 @@ uint32_t AD7794GetData( void );
 #if AD7794_USE_FLOAT == 1
 uint8_t AD7794InternalTempCal(uint32_t CurrentTemp);
 int32_t AD7794GetInternalTemp(void);
+int32_t AD7794InternalTempFromCounts(uint32_t Counts);
+uint32_t AD7794InternalTempToCounts(int32_t Temp);
 #endif
 
 
@@ -58,12 +58,15 @@ void AT45DB321D_Deselect(void)
 
 uint8_t AT45DB321D_ReadStatus(void)
 {
+	SPIBus_Transaction Transaction;
 	uint8_t StatusByte;
 	
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(AT45DB321D_CMD_READ_STATUS);
-	StatusByte = AT45DB321D_SPISEND(0x00);
-	AT45DB321D_Deselect();
+	SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AT45DB321D);
+	Transaction.Header[0] = AT45DB321D_CMD_READ_STATUS;
+	Transaction.HeaderLength = 1;
+	Transaction.RxData = &StatusByte;
+	Transaction.DataLength = 1;
+	SPIBus_Transfer(&Transaction);
 
 	return StatusByte;	
 }
@@ -74,8 +77,7 @@ uint8_t AT45DB321D_ReadStatus(void)
 //
 void AT45DB321D_BufferRead(uint8_t Buffer, uint16_t BufferStartAddress, uint8_t DataReadBuffer[], uint16_t BytesToRead)
 {
-	uint16_t i;
-	//uint8_t DataByte;
+	SPIBus_Transaction Transaction;
 
 	//No funny stuff...
 	//TODO: add check for length and start address
@@ -84,39 +86,43 @@ void AT45DB321D_BufferRead(uint8_t Buffer, uint16_t BufferStartAddress, uint8_t
 		return;
 	}
 	
-	AT45DB321D_Select();
+	SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AT45DB321D);
 	if(Buffer == 1)
 	{
-		AT45DB321D_SPISEND(AT45DB321D_CMD_BUFFER1_READ_HS);
+		Transaction.Header[0] = AT45DB321D_CMD_BUFFER1_READ_HS;
 	}
 	else
 	{
-		AT45DB321D_SPISEND(AT45DB321D_CMD_BUFFER2_READ_HS);
+		Transaction.Header[0] = AT45DB321D_CMD_BUFFER2_READ_HS;
 	}
 	
 	//Send address to read
 	//The address is 3 bytes, but only the 10 LSBs matter
-	AT45DB321D_SPISEND(0x00);
-	AT45DB321D_SPISEND((BufferStartAddress & 0x0300)>>8);
-	AT45DB321D_SPISEND(BufferStartAddress & 0xFF);
+	AT45DB321D_SetAddress(&Transaction.Header[1], 0, BufferStartAddress);
 	
 	//An extra byte needs to be clocked in to initalize the read
-	AT45DB321D_SPISEND(0x00);
+	Transaction.Header[4] = 0x00;
+	Transaction.HeaderLength = 5;
 	
-	for(i = 0; i<BytesToRead; i++)
-	{
-		*DataReadBuffer = AT45DB321D_SPISEND(0x00);
-		//printf_P(PSTR("[%u]: 0x%02X\n"), i, *DataReadBuffer);
-		DataReadBuffer++;
-	}
-	AT45DB321D_Deselect();
+	Transaction.RxData = DataReadBuffer;
+	Transaction.DataLength = BytesToRead;
+	SPIBus_Transfer(&Transaction);
 
 	return;
 }
 
 void AT45DB321D_BufferWrite(uint8_t Buffer, uint16_t BufferStartAddress, uint8_t DataWriteBuffer[], uint16_t BytesToWrite)
 {
-	uint16_t i;
+	SPIBus_Transaction Transaction;
+	
+	AT45DB321D_BufferWriteAsync(Buffer, BufferStartAddress, DataWriteBuffer, BytesToWrite, &Transaction);
+	SPIBus_Wait(&Transaction);
+	return;
+}
+
+void AT45DB321D_BufferWriteAsync(uint8_t Buffer, uint16_t BufferStartAddress, const uint8_t DataWriteBuffer[], uint16_t BytesToWrite, SPIBus_Transaction *Transaction)
+{
+	SPIBus_InitTransaction(Transaction, SPIBUS_DEVICE_AT45DB321D);
 
 	//No funny stuff...
 	//TODO: add check for length and start address
@@ -125,33 +131,48 @@ void AT45DB321D_BufferWrite(uint8_t Buffer, uint16_t BufferStartAddress, uint8_t
 		return;
 	}
 	
-	AT45DB321D_Select();
 	if(Buffer == 1)
 	{
-		AT45DB321D_SPISEND(AT45DB321D_CMD_BUFFER1_WRITE);
+		Transaction->Header[0] = AT45DB321D_CMD_BUFFER1_WRITE;
 	}
 	else
 	{
-		AT45DB321D_SPISEND(AT45DB321D_CMD_BUFFER2_WRITE);
+		Transaction->Header[0] = AT45DB321D_CMD_BUFFER2_WRITE;
 	}
 
-	//Send address to read
+	//Send address to write
 	//The address is 3 bytes, but only the 10 LSBs matter (9 LSBs for 512 mode)
-	AT45DB321D_SPISEND(0x00);
-	AT45DB321D_SPISEND((BufferStartAddress & 0x0300)>>8);
-	AT45DB321D_SPISEND(BufferStartAddress & 0xFF);
+	AT45DB321D_SetAddress(&Transaction->Header[1], 0, BufferStartAddress);
+	Transaction->HeaderLength = 4;
 	
-	for(i = 0; i<BytesToWrite; i++)
-	{
-		//printf_P(PSTR("write: 0x%02X\n"), *DataWriteBuffer);
-		AT45DB321D_SPISEND(*DataWriteBuffer);
-		DataWriteBuffer++;
-	}
-	AT45DB321D_Deselect();
+	Transaction->TxData = DataWriteBuffer;
+	Transaction->DataLength = BytesToWrite;
+	SPIBus_Submit(Transaction);
 
 	return;
 }
 
+void AT45DB321D_PageRead(uint16_t PageAddress, uint16_t PageStartAddress, uint8_t DataReadBuffer[], uint16_t BytesToRead)
+{
+	SPIBus_Transaction Transaction;
+
+	SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AT45DB321D);
+	Transaction.Header[0] = AT45DB321D_CMD_PAGE_READ;
+	AT45DB321D_SetAddress(&Transaction.Header[1], PageAddress, PageStartAddress);
+
+	//Four extra bytes need to be clocked in to initalize the read
+	Transaction.Header[4] = 0x00;
+	Transaction.Header[5] = 0x00;
+	Transaction.Header[6] = 0x00;
+	Transaction.Header[7] = 0x00;
+	Transaction.HeaderLength = 8;
+
+	Transaction.RxData = DataReadBuffer;
+	Transaction.DataLength = BytesToRead;
+	SPIBus_Transfer(&Transaction);
+	return;
+}
+
 void AT45DB321D_CopyPageToBuffer(uint8_t Buffer, uint16_t PageAddress)
 {
 	//No funny stuff...
@@ -161,21 +182,15 @@ void AT45DB321D_CopyPageToBuffer(uint8_t Buffer, uint16_t PageAddress)
 		return;
 	}
 
-	AT45DB321D_Select();
 	if(Buffer == 1)
 	{
-		AT45DB321D_SPISEND(AT45DB321D_CMD_TRANSFER_PAGE_TO_BUFFER1);
+		AT45DB321D_PageCommand(AT45DB321D_CMD_TRANSFER_PAGE_TO_BUFFER1, PageAddress);
 	}
 	else
 	{
-		AT45DB321D_SPISEND(AT45DB321D_CMD_TRANSFER_PAGE_TO_BUFFER2);
+		AT45DB321D_PageCommand(AT45DB321D_CMD_TRANSFER_PAGE_TO_BUFFER2, PageAddress);
 	}
 	
-	//Send page address, this is different for 512 and 528 mode
-	AT45DB321D_SendPageAddress(PageAddress);
-	
-	AT45DB321D_Deselect();
-	
 	//Add code to check for complete?
 	
 	return;
@@ -190,20 +205,14 @@ void AT45DB321D_CopyBufferToPage(uint8_t Buffer, uint16_t PageAddress)
 		return;
 	}
 
-	AT45DB321D_Select();
 	if(Buffer == 1)
 	{
-		AT45DB321D_SPISEND(AT45DB321D_CMD_BUFFER1_TO_PAGE_ERASE);
+		AT45DB321D_PageCommand(AT45DB321D_CMD_BUFFER1_TO_PAGE_ERASE, PageAddress);
 	}
 	else
 	{
-		AT45DB321D_SPISEND(AT45DB321D_CMD_BUFFER2_TO_PAGE_ERASE);
+		AT45DB321D_PageCommand(AT45DB321D_CMD_BUFFER2_TO_PAGE_ERASE, PageAddress);
 	}
-
-	//Send page address, this is different for 512 and 528 mode
-	AT45DB321D_SendPageAddress(PageAddress);
-	
-	AT45DB321D_Deselect();
 	
 	//Add code to check for complete?
 	
@@ -212,10 +221,7 @@ void AT45DB321D_CopyBufferToPage(uint8_t Buffer, uint16_t PageAddress)
 
 void AT45DB321D_ErasePage(uint16_t PageAddress)
 {
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(AT45DB321D_CMD_PAGE_ERASE);
-	AT45DB321D_SendPageAddress(PageAddress);
-	AT45DB321D_Deselect();
+	AT45DB321D_PageCommand(AT45DB321D_CMD_PAGE_ERASE, PageAddress);
 	return;
 }
 
@@ -229,79 +235,96 @@ uint8_t AT45DB321D_WaitForReady(void)
 	return StatusByte;
  }
 
-void AT45DB321D_SendPageAddress(uint16_t PageAddress)
+void AT45DB321D_SetAddress(uint8_t AddressBytes[], uint16_t PageAddress, uint16_t ByteAddress)
 {
-	//Send page address, this is different for 512 and 528 mode
+	//The page and byte address are packed differently for 512 and 528 mode
 	#if AT45DB321D_PAGE_SIZE_BYTES == 512
-	AT45DB321D_SPISEND( (uint8_t)(PageAddress>>7) );
-	AT45DB321D_SPISEND( (uint8_t)(PageAddress<<1) );
-	AT45DB321D_SPISEND(0x00);
+	AddressBytes[0] = (uint8_t)(PageAddress>>7);
+	AddressBytes[1] = (uint8_t)(PageAddress<<1) | ((ByteAddress & 0x0100)>>8);
 	#else
-	AT45DB321D_SPISEND( (uint8_t)(PageAddress>>6) );
-	AT45DB321D_SPISEND( (uint8_t)(PageAddress<<2) );
-	AT45DB321D_SPISEND(0x00);
+	AddressBytes[0] = (uint8_t)(PageAddress>>6);
+	AddressBytes[1] = (uint8_t)(PageAddress<<2) | ((ByteAddress & 0x0300)>>8);
 	#endif
+	AddressBytes[2] = (uint8_t)(ByteAddress & 0xFF);
+	return;
+}
+
+//Send a command followed by a page address
+void AT45DB321D_PageCommand(uint8_t Command, uint16_t PageAddress)
+{
+	SPIBus_Transaction Transaction;
+	
+	SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AT45DB321D);
+	Transaction.Header[0] = Command;
+	AT45DB321D_SetAddress(&Transaction.Header[1], PageAddress, 0);
+	Transaction.HeaderLength = 4;
+	SPIBus_Transfer(&Transaction);
+	return;
+}
+
+//Send a command with no address or data. 'Command' can be up to SPIBUS_MAX_HEADER bytes long.
+void AT45DB321D_SendCommand(const uint8_t Command[], uint8_t Length)
+{
+	SPIBus_Transaction Transaction;
+	
+	SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AT45DB321D);
+	memcpy(Transaction.Header, Command, Length);
+	Transaction.HeaderLength = Length;
+	SPIBus_Transfer(&Transaction);
 	return;
 }
 
 //Untested
 void AT45DB321D_Powerdown(void)
 {
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(AT45DB321D_CMD_POWERDOWN);
-	AT45DB321D_Deselect();
+	uint8_t Command[1] = {AT45DB321D_CMD_POWERDOWN};
+	
+	AT45DB321D_SendCommand(Command, 1);
 	return;
 }
 
 void AT45DB321D_Powerup(void)
 {
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(AT45DB321D_CMD_POWERUP);
-	AT45DB321D_Deselect();
+	uint8_t Command[1] = {AT45DB321D_CMD_POWERUP};
+	
+	AT45DB321D_SendCommand(Command, 1);
 	return;
 }
 
 void AT45DB321D_ChipErase(void)
 {
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(AT45DB321D_CMD_CHIP_ERASE1);
-	AT45DB321D_SPISEND(AT45DB321D_CMD_CHIP_ERASE2);
-	AT45DB321D_SPISEND(AT45DB321D_CMD_CHIP_ERASE3);
-	AT45DB321D_SPISEND(AT45DB321D_CMD_CHIP_ERASE4);
-	AT45DB321D_Deselect();
+	uint8_t Command[4] = {AT45DB321D_CMD_CHIP_ERASE1, AT45DB321D_CMD_CHIP_ERASE2, AT45DB321D_CMD_CHIP_ERASE3, AT45DB321D_CMD_CHIP_ERASE4};
+	
+	AT45DB321D_SendCommand(Command, 4);
 	return;
 }
 
 void AT45DB321D_Protect(void)
 {
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(0x3D);
-	AT45DB321D_SPISEND(0x2A);
-	AT45DB321D_SPISEND(0x7F);
-	AT45DB321D_SPISEND(0xA9);
-	AT45DB321D_Deselect();
+	uint8_t Command[4] = {0x3D, 0x2A, 0x7F, 0xA9};
+	
+	AT45DB321D_SendCommand(Command, 4);
 	return;
 }
 
 void AT45DB321D_Unprotect(void)
 {
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(0x3D);
-	AT45DB321D_SPISEND(0x2A);
-	AT45DB321D_SPISEND(0x7F);
-	AT45DB321D_SPISEND(0x9A);
-	AT45DB321D_Deselect();
+	uint8_t Command[4] = {0x3D, 0x2A, 0x7F, 0x9A};
+	
+	AT45DB321D_SendCommand(Command, 4);
 	return;
 }
 
 void AT45DB321D_ReadID(uint8_t *DataByteRead)
 {
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(AT45DB321D_CMD_READ_DEVICE_ID);
-	DataByteRead[0] = AT45DB321D_SPISEND(0x00);
-	DataByteRead[1] = AT45DB321D_SPISEND(0x00);
-	DataByteRead[2] = AT45DB321D_SPISEND(0x00);
-	AT45DB321D_Deselect();
+	SPIBus_Transaction Transaction;
+	
+	SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AT45DB321D);
+	Transaction.Header[0] = AT45DB321D_CMD_READ_DEVICE_ID;
+	Transaction.HeaderLength = 1;
+	Transaction.RxData = DataByteRead;
+	Transaction.DataLength = 3;
+	SPIBus_Transfer(&Transaction);
 	return;
 }
 
@@ -310,6 +333,7 @@ void AT45DB321D_ReadID(uint8_t *DataByteRead)
 
 
 
+
 //This command should only need to be sent once. It can not be undone.
 //The device needs to be power cycled after this command is sent.
 //The change can be verified by reading the status register.
@@ -317,12 +341,9 @@ void AT45DB321D_ReadID(uint8_t *DataByteRead)
 #if AT45DB321D_PAGE_SIZE_BYTES != 512
 void AT45DB321D_SwitchTo512(void)
 {
-	AT45DB321D_Select();
-	AT45DB321D_SPISEND(0x3D);
-	AT45DB321D_SPISEND(0x2A);
-	AT45DB321D_SPISEND(0x80);
-	AT45DB321D_SPISEND(0xA6);
-	AT45DB321D_Deselect();
+	uint8_t Command[4] = {0x3D, 0x2A, 0x80, 0xA6};
+	
+	AT45DB321D_SendCommand(Command, 4);
 	AT45DB321D_WaitForReady();
 	printf_P(PSTR("Device page size set to 512. Please power cycle the device\n"));
 	return;
@@ -27,18 +27,13 @@
 #define _AT45DB321D_H_
 
 #include "stdint.h"
+#include "spibus.h"
 
 //Setup the CS pin
 #define AT45DB321D_CS_PORT	PORTB
 #define AT45DB321D_CS_PIN	0
 
-#define USE_LUFA_SPI		1
-
-#if USE_LUFA_SPI == 1
-	#define AT45DB321D_SPISEND		SPI_TransferByte
-#else
-	#define AT45DB321D_SPISEND		SPISendByte
-#endif
+//All transfers go through the shared SPI bus (spibus.h)
 
 
 #define AT45DB321D_PAGE_SIZE_BYTES		528
@@ -105,6 +100,15 @@ void AT45DB321D_BufferRead(uint8_t Buffer, uint16_t BufferStartAddress, uint8_t
 /** Writes 'BytesToWrite' bytes from 'DataWriteBuffer' to buffer number 'Buffer' starting at address 'BufferStartAddress' */
 void AT45DB321D_BufferWrite(uint8_t Buffer, uint16_t BufferStartAddress, uint8_t DataWriteBuffer[], uint16_t BytesToWrite);
 
+/** Same as AT45DB321D_BufferWrite, but returns as soon as the write is queued on the SPI bus. 'DataWriteBuffer' and 'Transaction' must
+ *	not be changed until the transaction is done (see SPIBus_Wait). Later dataflash commands are queued behind this one.
+ *	A write that fits in SPIBUS_BURST_MAX with its 4 byte header is sent before this returns if the bus is free.
+ */
+void AT45DB321D_BufferWriteAsync(uint8_t Buffer, uint16_t BufferStartAddress, const uint8_t DataWriteBuffer[], uint16_t BytesToWrite, SPIBus_Transaction *Transaction);
+
+/** Reads 'BytesToRead' bytes directly from main memory page 'PageAddress' starting at 'PageStartAddress'. The buffers are not modified. */
+void AT45DB321D_PageRead(uint16_t PageAddress, uint16_t PageStartAddress, uint8_t DataReadBuffer[], uint16_t BytesToRead);
+
 /** Copies the contents of main memory page 'PageAddress' into buffer number 'Buffer' */
 void AT45DB321D_CopyPageToBuffer(uint8_t Buffer, uint16_t PageAddress);
 
@@ -120,8 +124,14 @@ void AT45DB321D_ErasePage(uint16_t PageAddress);
  */
 uint8_t AT45DB321D_WaitForReady(void);
 
-/** Send the page address to the device */
-void AT45DB321D_SendPageAddress(uint16_t PageAddress);
+/** Put the three address bytes for 'PageAddress' and 'ByteAddress' in 'AddressBytes'. Use page 0 for buffer addresses. */
+void AT45DB321D_SetAddress(uint8_t AddressBytes[], uint16_t PageAddress, uint16_t ByteAddress);
+
+/** Send a command followed by the address of page 'PageAddress' */
+void AT45DB321D_PageCommand(uint8_t Command, uint16_t PageAddress);
+
+/** Send a command with no address or data */
+void AT45DB321D_SendCommand(const uint8_t Command[], uint8_t Length);
 
 /** Powerdown the device. Once powered down, the device will ignore all commands except the power up command */
 void AT45DB321D_Powerdown(void);
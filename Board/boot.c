@@ -0,0 +1,126 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Time each stage of the boot.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+
+static uint32_t Times[BOOT_STAGES];
+static uint8_t Marked;
+static volatile uint8_t Overflows;
+static volatile uint8_t Running;
+
+static uint32_t Boot_Now(void);
+static void Boot_Stop(void);
+
+void Boot_Start(void)
+{
+	uint8_t i;
+
+	for(i=0; i<BOOT_STAGES; i++)
+	{
+		Times[i] = BOOT_NOT_REACHED;
+	}
+	Marked = 0;
+	Overflows = 0;
+
+	//Timer 1 free running at Fcpu/1024, with the overflow interrupt
+	TCCR1A = 0x00;
+	TCCR1B = 0x00;
+	TCNT1 = 0;
+	TIFR1 = (1<<TOV1);
+	TIMSK1 = (1<<TOIE1);
+	TCCR1B = (1<<CS12)|(1<<CS10);
+	Running = 1;
+	return;
+}
+
+void Boot_Mark(uint8_t Stage)
+{
+	uint8_t OldSREG;
+
+	if((Running == 0) || (Stage >= BOOT_STAGES) || (Times[Stage] != BOOT_NOT_REACHED))
+	{
+		return;
+	}
+	Times[Stage] = Boot_Now() * BOOT_TICK_US;
+	Marked++;
+	if(Marked >= BOOT_STAGES)
+	{
+		OldSREG = SREG;
+		cli();
+		Boot_Stop();
+		SREG = OldSREG;
+	}
+	return;
+}
+
+uint8_t Boot_Active(void)
+{
+	return Running;
+}
+
+void Boot_GetTimes(uint32_t Copy[])
+{
+	memcpy(Copy, Times, sizeof(Times));
+	return;
+}
+
+//Timer 1 ticks since Boot_Start. Read again if the overflow interrupt ran in between. Interrupts are only off for the
+//first few ms, far less than an overflow.
+static uint32_t Boot_Now(void)
+{
+	uint8_t OldSREG;
+	uint8_t Count;
+	uint16_t Ticks;
+
+	do
+	{
+		Count = Overflows;
+		OldSREG = SREG;
+		cli();
+		Ticks = TCNT1;
+		SREG = OldSREG;
+	} while(Count != Overflows);
+	return ((uint32_t)Count << 16) | Ticks;
+}
+
+//Called with interrupts off
+static void Boot_Stop(void)
+{
+	TCCR1B = 0x00;
+	TIMSK1 = 0x00;
+	Running = 0;
+	return;
+}
+
+ISR(TIMER1_OVF_vect)
+{
+	Overflows++;
+	if(Overflows >= BOOT_WINDOW_OVERFLOWS)
+	{
+		Boot_Stop();
+	}
+}
+
+/** @} */
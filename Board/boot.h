@@ -0,0 +1,75 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Time each stage of the boot.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Boot_Start is called by HardwareInit as soon as the clock is set up, and starts timer 1 from zero. Each stage calls
+*	Boot_Mark when it is done, and the time of the first mark is kept. Times are in us from Boot_Start, with the 128us
+*	resolution of timer 1 at Fcpu/1024. They are shown by the 'boot' command.
+*
+*	HardwareInit brings up what the first sample needs (the buses, the AD7794 and the safety limits) and attaches USB
+*	before the TWI parts and the dataflash, so the host enumerates the board while the rest comes up. The stages after
+*	that (USB configured, the datalogger, the first sample and the first controller update) are marked as they happen.
+*
+*	Timer 1 does not run in power save, so Power_Sleep only uses idle sleep while the boot is timed. Timing stops, and
+*	timer 1 is turned off, once every stage is marked or after BOOT_WINDOW_OVERFLOWS timer overflows (about 16s).
+*	Stages that are not reached by then are not shown.
+*
+*	@{
+*/
+
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+#include "stdint.h"
+
+//Stages, in the order they are expected
+#define BOOT_STAGE_BUSES			0		//Clocks, timers, GPIO, SPI and TWI
+#define BOOT_STAGE_AD7794			1		//AD7794 reset and its calibration loaded
+#define BOOT_STAGE_SAFETY			2		//Safety limits, stream settings and the A/D rate policy
+#define BOOT_STAGE_USB_ATTACH		3		//USB attached and interrupts on
+#define BOOT_STAGE_DS3232M			4		//RTC and the energy total in its SRAM
+#define BOOT_STAGE_MAX7315			5
+#define BOOT_STAGE_AT45DB321D		6
+#define BOOT_STAGE_READY			7		//End of HardwareInit
+#define BOOT_STAGE_USB_CONFIGURED	8		//Configured by the host
+#define BOOT_STAGE_DATALOGGER		9		//Datalogger found where to append, when the controller started
+#define BOOT_STAGE_SAMPLE			10		//First sample taken by TemperatureControllerTask
+#define BOOT_STAGE_DECISION			11		//First controller update from a sample
+#define BOOT_STAGES					12
+
+#define BOOT_NOT_REACHED			0xFFFFFFFF
+#define BOOT_TICK_US				(1024000000UL/F_CPU)
+#define BOOT_WINDOW_OVERFLOWS		2
+
+/** Start timing the boot. Called by HardwareInit with interrupts off. */
+void Boot_Start(void);
+
+/** Mark a stage as done. Only the first mark of each stage is kept. */
+void Boot_Mark(uint8_t Stage);
+
+/** Returns 1 while the boot is being timed. */
+uint8_t Boot_Active(void);
+
+/** Get the time of each stage in us, or BOOT_NOT_REACHED. */
+void Boot_GetTimes(uint32_t Times[]);
+
+#endif
+/** @} */
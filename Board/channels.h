@@ -0,0 +1,118 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Measurement channel schema.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Every channel returned by GetData and saved by the datalogger is listed once in CHANNEL_LIST. The channel indices, the
+*	byte offsets, the packed size and the pack/unpack code are all generated from this list, so adding a channel is a one
+*	line change here. Values are packed MSB first.
+*
+*	The size of a datalogger record is the only mark of its layout, and a log keeps the records written before a change
+*	to this list. So channels are only ever added at the end, which changes the size, and the old record size is added to
+*	the layout table in Tools/LogDecode so old logs still decode. The firmware skips records of any other size. A new
+*	channel is also a new stream field, which resets the stream deadbands saved in EEPROM (see stream.h).
+*
+*	This file is also used by the host tools, so it must only depend on stdint.h.
+*
+*	@{
+*/
+
+#ifndef _CHANNELS_H_
+#define _CHANNELS_H_
+
+#include "stdint.h"
+
+/** The channel list. Each entry is X(Name, Bytes, ReadFunction, Conversion)
+ *		-Name:			Used to make CHANNEL_<Name> (index) and CHANNEL_<Name>_OFFSET (byte offset in the packed data).
+ *		-Bytes:			Number of bytes stored for this channel (1 to 4).
+ *		-ReadFunction:	Function called by GetData to take the measurement. Must return a 32-bit value.
+ *		-Conversion:	Used by the host tools to convert the value to real units. Not used by the firmware.
+ */
+#define CHANNEL_LIST(X)														\
+	X(RED_TEMP,			3,	GetRedTemp,				THERMISTOR)				\
+	X(BLACK_TEMP,		3,	GetBlackTemp,			THERMISTOR)				\
+	X(HEATER_VOLTAGE,	3,	GetHeaterVoltage,		HEATER_VOLTAGE)			\
+	X(INTERNAL_TEMP,	3,	AD7794GetInternalTemp,	SCALED_10000)			\
+	X(HEATER_CURRENT,	3,	GetHeaterCurrent,		HEATER_CURRENT)			\
+	X(ENERGY,			3,	Energy_Get,				SCALED_100)				\
+	X(HEATER_RMS,		3,	Ripple_Get,				SCALED_10000)
+
+//Channel indices
+#define CHANNEL_INDEX_ENUM(Name, Bytes, Read, Convert)		CHANNEL_##Name,
+enum
+{
+	CHANNEL_LIST(CHANNEL_INDEX_ENUM)
+	CHANNEL_COUNT
+};
+
+//Byte offsets. Each channel takes the next offset after the last byte of the channel before it.
+#define CHANNEL_OFFSET_ENUM(Name, Bytes, Read, Convert)		CHANNEL_##Name##_OFFSET, CHANNEL_##Name##_LAST = CHANNEL_##Name##_OFFSET + (Bytes) - 1,
+enum
+{
+	CHANNEL_LIST(CHANNEL_OFFSET_ENUM)
+	CHANNEL_DATA_SIZE
+};
+
+/** Put a value in the packed data. Offset and Bytes are constants in the generated code, so the loop is unrolled. */
+static inline void Channels_PutValue(uint8_t Data[], uint8_t Offset, uint8_t Bytes, uint32_t Value)
+{
+	while(Bytes > 0)
+	{
+		Bytes--;
+		Data[Offset + Bytes] = (uint8_t)(Value & 0xFF);
+		Value = Value >> 8;
+	}
+	return;
+}
+
+/** Get a value from the packed data. */
+static inline uint32_t Channels_GetValue(const uint8_t Data[], uint8_t Offset, uint8_t Bytes)
+{
+	uint32_t Value = 0;
+	uint8_t i;
+
+	for(i=0; i<Bytes; i++)
+	{
+		Value = (Value << 8) | Data[Offset + i];
+	}
+	return Value;
+}
+
+/** Get one channel from the packed data. */
+#define Channels_Get(Data, Name)	Channels_GetValue((Data), CHANNEL_##Name##_OFFSET, (CHANNEL_##Name##_LAST - CHANNEL_##Name##_OFFSET + 1))
+
+/** Pack CHANNEL_COUNT values into CHANNEL_DATA_SIZE bytes. */
+#define CHANNEL_PACK(Name, Bytes, Read, Convert)		Channels_PutValue(Data, CHANNEL_##Name##_OFFSET, (Bytes), Values[CHANNEL_##Name]);
+static inline void Channels_Pack(const uint32_t Values[], uint8_t Data[])
+{
+	CHANNEL_LIST(CHANNEL_PACK)
+	return;
+}
+
+/** Unpack CHANNEL_DATA_SIZE bytes into CHANNEL_COUNT values. */
+#define CHANNEL_UNPACK(Name, Bytes, Read, Convert)		Values[CHANNEL_##Name] = Channels_GetValue(Data, CHANNEL_##Name##_OFFSET, (Bytes));
+static inline void Channels_Unpack(const uint8_t Data[], uint32_t Values[])
+{
+	CHANNEL_LIST(CHANNEL_UNPACK)
+	return;
+}
+
+#endif
+/** @} */
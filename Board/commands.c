@@ -28,7 +28,7 @@
 
 
 //The number of commands
-const uint8_t NumCommands = 13;
+const uint8_t NumCommands = 26;
 
 //Handler function declerations
 
@@ -90,7 +90,7 @@ const char _F9_HELPTEXT[] PROGMEM 		= "relay <state>";
 static int _F10_Handler (void);
 const char _F10_NAME[] PROGMEM 			= "cal";
 const char _F10_DESCRIPTION[] PROGMEM 	= "Calibrate the ADC";
-const char _F10_HELPTEXT[] PROGMEM 		= "'cal' has no parameters";
+const char _F10_HELPTEXT[] PROGMEM 		= "cal <0 to show, 2 to zero the current>";
 
 //Get temperatures from the ADC
 static int _F11_Handler (void);
@@ -110,6 +110,89 @@ const char _F13_NAME[] PROGMEM 			= "mem";
 const char _F13_DESCRIPTION[] PROGMEM 	= "dataflash functions";
 const char _F13_HELPTEXT[] PROGMEM 		= "mem <1> <2> <3>";
 
+//Datalogger functions
+static int _F14_Handler (void);
+const char _F14_NAME[] PROGMEM 			= "log";
+const char _F14_DESCRIPTION[] PROGMEM 	= "Read back logged data";
+const char _F14_HELPTEXT[] PROGMEM 		= "log <1> <2> <3>";
+
+//Power management
+static int _F15_Handler (void);
+const char _F15_NAME[] PROGMEM 			= "power";
+const char _F15_DESCRIPTION[] PROGMEM 	= "Sleep mode and wake up timing";
+const char _F15_HELPTEXT[] PROGMEM 		= "power <1>";
+
+//Controller autotune
+static int _F16_Handler (void);
+const char _F16_NAME[] PROGMEM 			= "autotune";
+const char _F16_DESCRIPTION[] PROGMEM 	= "Tune the temperature controller";
+const char _F16_HELPTEXT[] PROGMEM 		= "autotune <1>";
+
+//Heater energy
+static int _F17_Handler (void);
+const char _F17_NAME[] PROGMEM 			= "energy";
+const char _F17_DESCRIPTION[] PROGMEM 	= "Heater energy used";
+const char _F17_HELPTEXT[] PROGMEM 		= "energy <0>";
+
+//Over temperature cutoff
+static int _F18_Handler (void);
+const char _F18_NAME[] PROGMEM 			= "safety";
+const char _F18_DESCRIPTION[] PROGMEM 	= "Over temperature limits";
+const char _F18_HELPTEXT[] PROGMEM 		= "safety <sensor> <limit>";
+
+//Watchdog faults
+static int _F19_Handler (void);
+const char _F19_NAME[] PROGMEM 			= "fault";
+const char _F19_DESCRIPTION[] PROGMEM 	= "Last watchdog fault";
+const char _F19_HELPTEXT[] PROGMEM 		= "fault <0>";
+
+//Command macros
+static int _F20_Handler (void);
+const char _F20_NAME[] PROGMEM 			= "macro";
+const char _F20_DESCRIPTION[] PROGMEM 	= "Show or record a macro";
+const char _F20_HELPTEXT[] PROGMEM 		= "macro <number> <1>";
+
+//Run a macro
+static int _F21_Handler (void);
+const char _F21_NAME[] PROGMEM 			= "run";
+const char _F21_DESCRIPTION[] PROGMEM 	= "Run a macro";
+const char _F21_HELPTEXT[] PROGMEM 		= "run <number>";
+
+//Telemetry stream
+static int _F22_Handler (void);
+const char _F22_NAME[] PROGMEM 			= "stream";
+const char _F22_DESCRIPTION[] PROGMEM 	= "Push samples to the host";
+const char _F22_HELPTEXT[] PROGMEM 		= "stream <period> <format>";
+
+//Stream deadbands
+static int _F23_Handler (void);
+const char _F23_NAME[] PROGMEM 			= "deadband";
+const char _F23_DESCRIPTION[] PROGMEM 	= "Show or set the stream deadbands";
+const char _F23_HELPTEXT[] PROGMEM 		= "deadband <field> <counts> <heartbeat>";
+
+//Boot stage timings
+static int _F24_Handler (void);
+const char _F24_NAME[] PROGMEM 			= "boot";
+const char _F24_DESCRIPTION[] PROGMEM 	= "Time of each boot stage";
+const char _F24_HELPTEXT[] PROGMEM 		= "'boot' has no parameters";
+
+//Acquisition schedule
+static int _F25_Handler (void);
+const char _F25_NAME[] PROGMEM 			= "acq";
+const char _F25_DESCRIPTION[] PROGMEM 	= "AD7794 channel schedule and rate policy";
+const char _F25_HELPTEXT[] PROGMEM 		= "acq <policy>";
+
+//Heater current burst
+static int _F26_Handler (void);
+const char _F26_NAME[] PROGMEM 			= "ripple";
+const char _F26_DESCRIPTION[] PROGMEM 	= "Heater current RMS and ripple";
+const char _F26_HELPTEXT[] PROGMEM 		= "'ripple' has no parameters";
+
+static char WaitForKey(void);
+static uint8_t WaitForLine(char *Line, uint8_t Size);
+static void PrintBootStage(const char *Name, uint32_t Time);
+static uint8_t ArgAsLogTime(uint8_t Arg, uint8_t Time[DATALOGGER_TIME_SIZE]);
+
 //Command list
 const CommandListItem AppCommandList[] PROGMEM =
 {
@@ -122,10 +205,23 @@ const CommandListItem AppCommandList[] PROGMEM =
 	{ _F7_NAME, 	0,  0,	_F7_Handler,	_F7_DESCRIPTION,	_F7_HELPTEXT	},		//tempcal
 	{ _F8_NAME,		1,  1,	_F8_Handler,	_F8_DESCRIPTION,	_F8_HELPTEXT	},		//beep
 	{ _F9_NAME,		1,  1,	_F9_Handler,	_F9_DESCRIPTION,	_F9_HELPTEXT	},		//relay
-	{ _F10_NAME,	0,  0,	_F10_Handler,	_F10_DESCRIPTION,	_F10_HELPTEXT	},		//cal
+	{ _F10_NAME,	0,  1,	_F10_Handler,	_F10_DESCRIPTION,	_F10_HELPTEXT	},		//cal
 	{ _F11_NAME,	0,  0,	_F11_Handler,	_F11_DESCRIPTION,	_F11_HELPTEXT	},		//temp
 	{ _F12_NAME,	0,  0,	_F12_Handler,	_F12_DESCRIPTION,	_F12_HELPTEXT	},		//twiscan
-	{ _F13_NAME,	1,  3,	_F13_Handler,	_F13_DESCRIPTION,	_F13_HELPTEXT	},		//twiscan
+	{ _F13_NAME,	1,  3,	_F13_Handler,	_F13_DESCRIPTION,	_F13_HELPTEXT	},		//mem
+	{ _F14_NAME,	1,  3,	_F14_Handler,	_F14_DESCRIPTION,	_F14_HELPTEXT	},		//log
+	{ _F15_NAME,	0,  1,	_F15_Handler,	_F15_DESCRIPTION,	_F15_HELPTEXT	},		//power
+	{ _F16_NAME,	0,  1,	_F16_Handler,	_F16_DESCRIPTION,	_F16_HELPTEXT	},		//autotune
+	{ _F17_NAME,	0,  1,	_F17_Handler,	_F17_DESCRIPTION,	_F17_HELPTEXT	},		//energy
+	{ _F18_NAME,	0,  2,	_F18_Handler,	_F18_DESCRIPTION,	_F18_HELPTEXT	},		//safety
+	{ _F19_NAME,	0,  1,	_F19_Handler,	_F19_DESCRIPTION,	_F19_HELPTEXT	},		//fault
+	{ _F20_NAME,	0,  2,	_F20_Handler,	_F20_DESCRIPTION,	_F20_HELPTEXT	},		//macro
+	{ _F21_NAME,	1,  1,	_F21_Handler,	_F21_DESCRIPTION,	_F21_HELPTEXT	},		//run
+	{ _F22_NAME,	0,  2,	_F22_Handler,	_F22_DESCRIPTION,	_F22_HELPTEXT	},		//stream
+	{ _F23_NAME,	0,  3,	_F23_Handler,	_F23_DESCRIPTION,	_F23_HELPTEXT	},		//deadband
+	{ _F24_NAME,	0,  0,	_F24_Handler,	_F24_DESCRIPTION,	_F24_HELPTEXT	},		//boot
+	{ _F25_NAME,	0,  1,	_F25_Handler,	_F25_DESCRIPTION,	_F25_HELPTEXT	},		//acq
+	{ _F26_NAME,	0,  0,	_F26_Handler,	_F26_DESCRIPTION,	_F26_HELPTEXT	},		//ripple
 };
 
 //Command functions
@@ -170,10 +266,11 @@ static int _F2_Handler (void)
 {
 	printf_P(PSTR("Jumping to bootloader. A manual reset will be required\nPress 'y' to continue..."));
 	
-	if(WaitForAnyKey() == 'y')
+	if(WaitForKey() == 'y')
 	{
 		printf_P(PSTR("Jump\n"));
 		DelayMS(100);
+		wdt_disable();				//The bootloader does not reset the watchdog
 		Jump_To_Bootloader();
 	}
 	
@@ -288,19 +385,20 @@ static int _F7_Handler (void)
 	int32_t RedTemp;
 	int32_t BlackTemp;
 	char selection;
-	uint8_t Dataset[16];
+	uint8_t Dataset[CHANNEL_DATA_SIZE];
 	uint32_t TempData;
+	char Line[12];
 	
 	printf_P(PSTR("Taking measurements...\n"));
 	GetData(Dataset);
 	
 	//Process the temperature data
-	TempData = (((uint32_t)Dataset[0]<<16) | ((uint32_t)Dataset[1]<<8) | (uint32_t)Dataset[2]);
+	TempData = Channels_Get(Dataset, RED_TEMP);
 	RedTemp = ThermistorCountsToTempNum(TempData);
 	
 	//ThermistorCountsToTemp(TempData, RedOutput);
 	
-	TempData = (((uint32_t)Dataset[3]<<16) | ((uint32_t)Dataset[4]<<8) | (uint32_t)Dataset[5]);
+	TempData = Channels_Get(Dataset, BLACK_TEMP);
 	BlackTemp = ThermistorCountsToTempNum(TempData);
 	//ThermistorCountsToTemp(TempData, BlackOutput);
 	
@@ -311,7 +409,7 @@ static int _F7_Handler (void)
 	//printf_P(PSTR("[2] Black: %s C\n"), BlackOutput);
 	printf_P(PSTR("[3] Manual input\n"));
 	
-	selection = WaitForAnyKey()-48;
+	selection = WaitForKey()-48;
 	
 	if(selection == 1)
 	{
@@ -326,9 +424,9 @@ static int _F7_Handler (void)
 	else if(selection == 3)
 	{
 		printf_P(PSTR("Enter the temperature in degrees C*10000\n"));
-		GetNewCommand();
+		WaitForLine(Line, sizeof(Line));
 		
-		TempData = argAsInt(0);
+		TempData = atol(Line);
 		
 		if((TempData < 500000) && (TempData > 0))
 		{
@@ -360,173 +458,131 @@ static int _F8_Handler (void)
 static int _F9_Handler (void)
 {
 	uint8_t RelayState = argAsInt(1);
+	
+	//The controller sets the relay on every RTC tick, so it would undo this right away
+	if((BH_GetStatus(BH_STATUS_PROG) & BH_STATUS_PROG_CONTROL_ON) == BH_STATUS_PROG_CONTROL_ON)
+	{
+		printf_P(PSTR("The controller is driving the relay, stop it first\n"));
+		return 0;
+	}
 	Relay(RelayState);
 	return 0;
 }
 
 //Manual calibration of the ADC
-//TODO: Take some of the often used strings and set them as globals to save code space.
+//	cal: Start an internal calibration of the A/D in the background
+//	cal 0: Show the calibration progress and the OFFSET and FS registers
+//	cal 2: Zero the current sensor, with the relay held off while it reads
 static int _F10_Handler (void)
 {
-	uint8_t SendData[3];
-	uint8_t selection;
-	//uint32_t TempData;
-	
-	printf_P(PSTR("Performing A/D internal calibraion\n"));
-	//Calibrate channel 1
-	SendData[1] = (AD7794_CRH_BIPOLAR|AD7794_CRH_GAIN_1);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN1);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	
-	//Calibrate zero
-	printf_P(PSTR("Calibrating channel 1 zero...."));
-	SendData[1] = AD7794_MRH_MODE_IZ_CAL & AD7794_CR_REG_MODE_MASK_H;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ) & AD7794_CR_REG_MODE_MASK_L;
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-
-	AD7794WaitReady();
-	printf_P(PSTR("Done!\n"));
-	
-	//Calibrate full scale
-	printf_P(PSTR("Calibrating channel 1 FS...."));
-	SendData[1] = AD7794_MRH_MODE_IFS_CAL & AD7794_CR_REG_MODE_MASK_H;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ) & AD7794_CR_REG_MODE_MASK_L;
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-
-	AD7794WaitReady();
-	printf_P(PSTR("Done!\n"));
-	
-	//Calibrate channel 2
-	SendData[1] = (AD7794_CRH_BIPOLAR|AD7794_CRH_GAIN_1);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN2);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	
-	//Calibrate zero
-	printf_P(PSTR("Calibrating channel 2 zero...."));
-	SendData[1] = AD7794_MRH_MODE_IZ_CAL & AD7794_CR_REG_MODE_MASK_H;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ) & AD7794_CR_REG_MODE_MASK_L;
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-
-	AD7794WaitReady();
-	printf_P(PSTR("Done!\n"));
-	
-	//Calibrate full scale
-	printf_P(PSTR("Calibrating channel 2 FS...."));
-	SendData[1] = AD7794_MRH_MODE_IFS_CAL & AD7794_CR_REG_MODE_MASK_H;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ) & AD7794_CR_REG_MODE_MASK_L;
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-
-	AD7794WaitReady();
-	printf_P(PSTR("Done!\n"));
-	
-	//Calibrate channel 3
-	SendData[1] = (AD7794_CRH_BIPOLAR|AD7794_CRH_GAIN_1);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN3);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	
-	//Calibrate zero
-	printf_P(PSTR("Calibrating channel 3 zero...."));
-	SendData[1] = AD7794_MRH_MODE_IZ_CAL & AD7794_CR_REG_MODE_MASK_H;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ) & AD7794_CR_REG_MODE_MASK_L;
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-
-	AD7794WaitReady();
-	printf_P(PSTR("Done!\n"));
-	
-	//Calibrate full scale
-	printf_P(PSTR("Calibrating channel 3 FS...."));
-	SendData[1] = AD7794_MRH_MODE_IFS_CAL & AD7794_CR_REG_MODE_MASK_H;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ) & AD7794_CR_REG_MODE_MASK_L;
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-
-	AD7794WaitReady();
-	printf_P(PSTR("Done!\n"));
-	
-	//Calibrate channel 6
-	SendData[1] = (AD7794_CRH_BIPOLAR|AD7794_CRH_GAIN_1);
-	SendData[0] = (AD7794_CRL_REF_INT|AD7794_CRL_REF_DETECT|AD7794_CRL_BUFFER_ON|AD7794_CRL_CHANNEL_AIN6);
-	AD7794WriteReg(AD7794_CR_REG_CONFIG, SendData);
-	
-	//Calibrate zero
-	printf_P(PSTR("Calibrating channel 6 zero...."));
-	SendData[1] = AD7794_MRH_MODE_IZ_CAL & AD7794_CR_REG_MODE_MASK_H;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ) & AD7794_CR_REG_MODE_MASK_L;
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-
-	AD7794WaitReady();
-	printf_P(PSTR("Done!\n"));
-	
-	//Calibrate full scale
-	printf_P(PSTR("Calibrating channel 6 FS...."));
-	SendData[1] = AD7794_MRH_MODE_IFS_CAL & AD7794_CR_REG_MODE_MASK_H;
-	SendData[0] = (AD7794_MRL_CLK_INT_NOOUT | AD7794_MRL_UPDATE_RATE_10_HZ) & AD7794_CR_REG_MODE_MASK_L;
-	AD7794WriteReg(AD7794_CR_REG_MODE, SendData);
-
-	AD7794WaitReady();
-	printf_P(PSTR("Done!\n"));
-	
-	printf_P(PSTR("Get current sensor zero value? [y/n]\n"));
-	selection = WaitForAnyKey();
-	
-	if((selection == 'Y') || (selection == 'y'))
+	AD7794_Calibration Calibration;
+	uint8_t State;
+	uint8_t Step;
+	uint8_t i;
+	
+	if((NumberOfArguments() == 1) && (argAsInt(1) == 2))
 	{
 		printf_P(PSTR("Taking zero reading from current sensor...."));
-		
 		CalibrateHeaterCurrent();
-		
-		
-		
-		
 		printf_P(PSTR("Done!\n"));
+		return 0;
 	}
 	
+	if(NumberOfArguments() == 1)
+	{
+		State = AD7794CalibrateStatus(&Step);
+		if(State == AD7794_CAL_RUNNING)
+		{
+			printf_P(PSTR("Calibrating, %u of %u steps done\n"), Step, AD7794_CAL_STEPS);
+		}
+		else if(State == AD7794_CAL_FAILED)
+		{
+			printf_P(PSTR("Calibration failed at step %u\n"), Step + 1);
+		}
+		
+		AD7794GetCalibration(&Calibration);
+		printf_P(PSTR("Channel, Offset, Full scale\n"));
+		for(i=0; i<AD7794_CAL_CHANNELS; i++)
+		{
+			if((Calibration.Offset[i] > 0xFFFFFF) || (Calibration.FullScale[i] > 0xFFFFFF))
+			{
+				printf_P(PSTR("%u, none\n"), i);
+			}
+			else
+			{
+				printf_P(PSTR("%u, 0x%06lX, 0x%06lX\n"), i, Calibration.Offset[i], Calibration.FullScale[i]);
+			}
+		}
+		return 0;
+	}
 	
-	
+	//The controller keeps running. Each step only holds up a measurement that comes along while it runs.
+	if(AD7794CalibrateStart() != 0)
+	{
+		printf_P(PSTR("A calibration is already running\n"));
+		return 0;
+	}
+	printf_P(PSTR("Calibrating the A/D in the background, 'cal 0' shows the progress\n"));
 	return 0;
 }
 
 //Get temperatures from the ADC
 static int _F11_Handler (void)
 {
-	uint8_t Dataset[16];
+	uint8_t Dataset[CHANNEL_DATA_SIZE];
 	uint32_t TempData;
 	int32_t signedTempData;
+	Fusion_State Fusion;
 	
 	printf_P(PSTR("Taking measurements...\n"));
 	
 	GetData(Dataset);
 	
-	TempData = (((uint32_t)Dataset[0]<<16) | ((uint32_t)Dataset[1]<<8) | (uint32_t)Dataset[2]);
+	TempData = Channels_Get(Dataset, RED_TEMP);
 	TempData = ThermistorCountsToTempNum(TempData);
 	printf_P(PSTR("Red: %d.%04lu C\n"), (int16_t)(TempData/10000), (uint32_t)(TempData-((TempData/10000)*10000)) );
 	
-	TempData = (((uint32_t)Dataset[3]<<16) | ((uint32_t)Dataset[4]<<8) | (uint32_t)Dataset[5]);
+	TempData = Channels_Get(Dataset, BLACK_TEMP);
 	TempData = ThermistorCountsToTempNum(TempData);
 	printf_P(PSTR("Black: %d.%04lu C\n"), (int16_t)(TempData/10000), (uint32_t)(TempData-((TempData/10000)*10000)) );
 	
-	TempData = (((uint32_t)Dataset[6]<<16) | ((uint32_t)Dataset[7]<<8) | (uint32_t)Dataset[8]);
+	TempData = Channels_Get(Dataset, HEATER_VOLTAGE);
 	TempData = ConvertHeaterVoltage(TempData);
 	printf_P(PSTR("Heater Voltage: %d.%04lu V\n"), (int16_t)(TempData/10000), (uint32_t)(TempData-((TempData/10000)*10000)) );
 	
-	TempData = (((uint32_t)Dataset[9]<<16) | ((uint32_t)Dataset[10]<<8) | (uint32_t)Dataset[11]);
+	TempData = Channels_Get(Dataset, INTERNAL_TEMP);
 	printf_P(PSTR("Internal Temperature: %d.%04lu C\n"), (int16_t)(TempData/10000), (uint32_t)(TempData-((TempData/10000)*10000)) );
 	
-	TempData = (((uint32_t)Dataset[12]<<16) | ((uint32_t)Dataset[13]<<8) | (uint32_t)Dataset[14]);
+	TempData = Channels_Get(Dataset, HEATER_CURRENT);
 	signedTempData = ConvertHeaterCurrent(TempData);
 	//printf_P(PSTR("Heater Current: %ld\n"), signedTempData);
 	//printf_P(PSTR("int1: %ld\n"), (signedTempData-((signedTempData/10000)*10000)));
 	//printf_P(PSTR("int1: %lu\n"), labs((signedTempData-((signedTempData/10000)*10000))));
 	printf_P(PSTR("Heater Current: %d.%04lu A\n"), (int16_t)(signedTempData/10000), labs(signedTempData-((signedTempData/10000)*10000)) );
 	
+	//From a burst with the relay on, so it is not a random point on the ripple
+	TempData = Channels_Get(Dataset, HEATER_RMS);
+	printf_P(PSTR("Heater Current RMS: %lu.%04lu A\n"), TempData/10000, TempData%10000);
+	
+	//The combined temperature is only updated while the controller is running
+	GetFusion(&Fusion);
+	if(Fusion.Variance != 0)
+	{
+		printf_P(PSTR("Wort: %ld.%04lu C (+/-%lu)\n"), Fusion.Estimate/10000, labs(Fusion.Estimate%10000), (uint32_t)sqrt((double)Fusion.Variance));
+	}
+	
 	return 0;
 }
 
 //Scan the TWI bus for devices
 static int _F12_Handler (void)
 {
+	//The scan runs the TWI hardware directly, so let any queued transfers finish first
+	while(TWIBus_Idle() == 0) {}
 	InitTWI();
 	TWIScan();
 	DeinitTWI();
+	TWIBus_Init();
 	return  0;
 }
 
@@ -595,4 +651,545 @@ static int _F13_Handler (void)
 	return  0;
 }
 
+//Datalogger functions
+//	log 1 <n>:				Print the oldest <n> data sets
+//	log 2 <from> <to>:		Print the data sets between two times. Times are YYMMDDhhmm (ex: 2610191430 is Oct. 19 2026 at 14:30)
+static int _F14_Handler (void)
+{
+	uint8_t arg1 = argAsInt(1);
+	uint8_t FromTime[DATALOGGER_TIME_SIZE];
+	uint8_t ToTime[DATALOGGER_TIME_SIZE];
+	
+	switch (arg1)
+	{
+		case 1:
+			Datalogger_ReadBackData((uint16_t)argAsInt(2));
+			break;
+			
+		case 2:
+			if((NumberOfArguments() != 3) || (ArgAsLogTime(2, FromTime) != 0) || (ArgAsLogTime(3, ToTime) != 0))
+			{
+				printf_P(PSTR("log 2 <from> <to>, times are YYMMDDhhmm\n"));
+				break;
+			}
+			Datalogger_ReadBackRange(FromTime, ToTime);
+			break;
+	}
+	
+	return  0;
+}
+
+//Power management
+//	power:		Print the time spent in each state and the wake up latency
+//	power <n>:	0-2: Set the power mode (0: never sleep, 1: idle sleep only, 2: power save when USB is not attached)
+//				3: Clear the measurements
+static int _F15_Handler (void)
+{
+	Power_Stats Stats;
+	uint8_t arg1;
+	
+	if(NumberOfArguments() == 1)
+	{
+		arg1 = argAsInt(1);
+		if(arg1 <= POWER_MODE_AUTO)
+		{
+			Power_SetMode(arg1);
+		}
+		else if(arg1 == 3)
+		{
+			Power_ResetStats();
+		}
+		return 0;
+	}
+	
+	Power_GetStats(&Stats);
+	printf_P(PSTR("Mode: %u\n"), Power_GetMode());
+	printf_P(PSTR("Run:        %lu ms\n"), Stats.TimeMS[POWER_STATE_RUN]);
+	printf_P(PSTR("Idle:       %lu ms, %lu sleeps\n"), Stats.TimeMS[POWER_STATE_IDLE], Stats.Sleeps[POWER_STATE_IDLE]);
+	printf_P(PSTR("Power save: %lu ms, %lu sleeps\n"), Stats.TimeMS[POWER_STATE_SAVE], Stats.Sleeps[POWER_STATE_SAVE]);
+	printf_P(PSTR("Samples: %u\n"), Stats.Samples);
+	printf_P(PSTR("Wake to sample start: %lu us (max %lu us)\n"), Stats.StartLatencyUS, Stats.StartLatencyMaxUS);
+	printf_P(PSTR("Wake to sample done:  %lu us (max %lu us)\n"), Stats.SampleLatencyUS, Stats.SampleLatencyMaxUS);
+	return 0;
+}
+
+//Controller autotune
+//	autotune 1: Start a relay feedback test at the set point
+//	autotune 0: Stop the test
+//	autotune: Show the test status and the gains
+static int _F16_Handler (void)
+{
+	Controller_Params Params;
+	Controller_State State;
+	
+	if(NumberOfArguments() == 1)
+	{
+		if(argAsInt(1) == 1)
+		{
+			StartAutotune();
+		}
+		else
+		{
+			StopAutotune();
+		}
+		return 0;
+	}
+	
+	GetController(&Params, &State);
+	if(State.Tune.Status == CONTROLLER_TUNE_RUNNING)
+	{
+		printf_P(PSTR("Running: %u samples, %u cycles\n"), State.Tune.Samples, State.Tune.Rises);
+	}
+	else if(State.Tune.Status == CONTROLLER_TUNE_DONE)
+	{
+		printf_P(PSTR("Done: amplitude %lu, period %u samples\n"), State.Tune.Amplitude, State.Tune.Period);
+	}
+	else if(State.Tune.Status == CONTROLLER_TUNE_FAILED)
+	{
+		printf_P(PSTR("Failed after %u samples\n"), State.Tune.Samples);
+	}
+	else
+	{
+		printf_P(PSTR("Not running\n"));
+	}
+	printf_P(PSTR("Kp: %u\nKi: %u.%02u\n"), Params.Kp, Params.Ki >> CONTROLLER_KI_SHIFT, ((Params.Ki & ((1 << CONTROLLER_KI_SHIFT) - 1)) * 100) >> CONTROLLER_KI_SHIFT);
+	return 0;
+}
+
+//Heater energy
+//	energy 0: Start a new total, for a new batch
+//	energy: Show the total and the heater power
+static int _F17_Handler (void)
+{
+	Controller_Params Params;
+	Controller_State State;
+	uint32_t Total;
+	
+	if(NumberOfArguments() == 1)
+	{
+		if(argAsInt(1) == 0)
+		{
+			Energy_Reset();
+		}
+		return 0;
+	}
+	
+	Total = Energy_GetMWh();
+	GetController(&Params, &State);
+	printf_P(PSTR("Energy: %lu.%03lu Wh\n"), Total/1000, Total%1000);
+	printf_P(PSTR("Heater: %lu mW\n"), State.HeaterPower);
+	return 0;
+}
+
+//Over temperature cutoff
+//	safety <sensor> <limit>: Set the limit in deg C for a sensor (0: red, 1: black, 2: internal). 0 uses the default.
+//	safety: Show the limits, the thresholds in counts and what has tripped
+static int _F18_Handler (void)
+{
+	uint8_t i;
+	uint8_t Tripped;
+	
+	if(NumberOfArguments() == 2)
+	{
+		if((argAsInt(1) >= 0) && (argAsInt(1) < SAFETY_SENSORS))
+		{
+			SetSafetyLimit((uint8_t)argAsInt(1), (uint8_t)argAsInt(2));
+		}
+		return 0;
+	}
+	
+	Tripped = Safety_GetTripped();
+	for(i=0; i<SAFETY_SENSORS; i++)
+	{
+		printf_P(PSTR("%u: %u C, %lu counts"), i, Safety_GetLimit(i), Safety_GetThreshold(i));
+		if((Tripped & (1<<i)) != 0)
+		{
+			printf_P(PSTR(", tripped"));
+		}
+		printf_P(PSTR("\n"));
+	}
+	printf_P(PSTR("Held off for stale readings: %u\n"), Safety_GetStaleCuts());
+	return 0;
+}
+
+//Watchdog faults
+//	fault 0: Clear the saved fault
+//	fault: Show the reset cause at boot and the last saved fault
+static int _F19_Handler (void)
+{
+	Supervisor_Fault Fault;
+	uint16_t Count;
+	uint8_t Cause;
+	
+	if(NumberOfArguments() == 1)
+	{
+		if(argAsInt(1) == 0)
+		{
+			Supervisor_ClearFaults();
+		}
+		return 0;
+	}
+	
+	Cause = Supervisor_GetResetCause();
+	printf_P(PSTR("Reset cause: 0x%02X"), Cause);
+	if((Cause & (1<<WDRF)) != 0)
+	{
+		printf_P(PSTR(" (watchdog)"));
+	}
+	printf_P(PSTR("\n"));
+	
+	Count = Supervisor_GetFault(&Fault);
+	if(Count == 0)
+	{
+		printf_P(PSTR("No faults\n"));
+		return 0;
+	}
+	printf_P(PSTR("Faults: %u\n"), Count);
+	if(Fault.Task == SUPERVISOR_TASK_UNKNOWN)
+	{
+		printf_P(PSTR("Last: no record, interrupts were off\n"));
+	}
+	else
+	{
+		//The PC is saved in words. Give the byte address, as in a listing.
+		printf_P(PSTR("Last: task %u, PC 0x%04X, at %lu ticks, last check in at %lu ticks\n"), Fault.Task, (uint16_t)(Fault.PC << 1),
+				 Fault.Uptime, Fault.CheckIn);
+	}
+	return 0;
+}
+
+//Command macros
+//	macro: List the macros
+//	macro <n>: Show macro n
+//	macro <n> 0: Delete macro n
+//	macro <n> 1: Record macro n from the rest of the line, or from the next line if there is nothing after the command.
+//	             "macro 2 1;relay 1;mem 6 1" saves "relay 1;mem 6 1".
+static int _F20_Handler (void)
+{
+	char Line[SHELL_MACRO_SIZE];
+	uint8_t Macro;
+	uint8_t First;
+	uint8_t Last;
+	
+	First = 0;
+	Last = SHELL_MACROS - 1;
+	if(NumberOfArguments() >= 1)
+	{
+		if((argAsInt(1) < 0) || (argAsInt(1) >= SHELL_MACROS))
+		{
+			printf_P(PSTR("Macros are 0 to %u\n"), SHELL_MACROS - 1);
+			return 0;
+		}
+		First = argAsInt(1);
+		Last = First;
+	}
+	
+	if(NumberOfArguments() == 2)
+	{
+		if(argAsInt(2) == 0)
+		{
+			Shell_SaveMacro(First, "");
+		}
+		else
+		{
+			printf_P(PSTR("Enter the commands, separated by '%c'\n"), SHELL_SEPARATOR);
+			WaitForLine(Line, sizeof(Line));
+			Shell_SaveMacro(First, Line);
+		}
+	}
+	
+	for(Macro = First; Macro <= Last; Macro++)
+	{
+		Shell_GetMacro(Macro, Line);
+		printf_P(PSTR("%u: %s\n"), Macro, Line);
+	}
+	return 0;
+}
+
+//Run a macro
+static int _F21_Handler (void)
+{
+	if((argAsInt(1) < 0) || (Shell_RunMacro(argAsInt(1)) != 0))
+	{
+		printf_P(PSTR("Macro not defined, or a macro is running\n"));
+	}
+	return 0;
+}
+
+//Telemetry stream
+//	stream: Show the stream settings and counts
+//	stream <period> <format>: Send every <period>th sample (5s each), 0 to stop. Format 0 is CSV, 1 is binary.
+static int _F22_Handler (void)
+{
+	Stream_Stats Stats;
+	int32_t Period;
+	uint8_t Format;
+	
+	if(NumberOfArguments() == 0)
+	{
+		Stream_GetStats(&Stats);
+		if(Stats.Period == 0)
+		{
+			printf_P(PSTR("Stream off\n"));
+		}
+		else
+		{
+			printf_P(PSTR("Every %u samples, "), Stats.Period);
+			if(Stats.Format == STREAM_FORMAT_BINARY)
+			{
+				printf_P(PSTR("binary\n"));
+			}
+			else
+			{
+				printf_P(PSTR("CSV\n"));
+			}
+		}
+		printf_P(PSTR("Sequence: %u\nSent: %u\nDropped: %u\n"), Stats.Sequence, Stats.Sent, Stats.Dropped);
+		return 0;
+	}
+	
+	Period = argAsInt(1);
+	Format = STREAM_FORMAT_CSV;
+	if(NumberOfArguments() == 2)
+	{
+		Format = (argAsInt(2) == 1) ? STREAM_FORMAT_BINARY : STREAM_FORMAT_CSV;
+	}
+	if((Period < 0) || (Period > 255))
+	{
+		printf_P(PSTR("Period is 0 to 255 samples\n"));
+		return 0;
+	}
+	Stream_Start((uint8_t)Period, Format);
+	return 0;
+}
+
+//Stream deadbands
+//	deadband: Show the deadband and heartbeat of each field
+//	deadband <field> <counts> <heartbeat>: Send the field when it moves more than <counts>, or every <heartbeat> frames.
+//	The fields are the channels, then the temperature (in 0.0001 deg C). A heartbeat of 0 is never.
+static int _F23_Handler (void)
+{
+	Stream_Deadbands Deadbands;
+	int32_t Field;
+	int32_t Deadband;
+	int32_t Heartbeat;
+	uint8_t i;
+	
+	if(NumberOfArguments() == 0)
+	{
+		Stream_GetDeadbands(&Deadbands);
+		printf_P(PSTR("Field, Deadband, Heartbeat\n"));
+		for(i=0; i<STREAM_FIELDS; i++)
+		{
+			printf_P(PSTR("%u, %lu, %u"), i, (unsigned long)Deadbands.Deadband[i], Deadbands.Heartbeat[i]);
+			if(i == STREAM_FIELD_TEMPERATURE)
+			{
+				printf_P(PSTR(" (temperature)"));
+			}
+			printf_P(PSTR("\n"));
+		}
+		return 0;
+	}
+	
+	Field = argAsInt(1);
+	Deadband = 0;
+	Heartbeat = STREAM_DEFAULT_HEARTBEAT;
+	if(NumberOfArguments() >= 2)
+	{
+		Deadband = argAsInt(2);
+	}
+	if(NumberOfArguments() == 3)
+	{
+		Heartbeat = argAsInt(3);
+	}
+	if((Field < 0) || (Field >= STREAM_FIELDS) || (Deadband < 0) || (Heartbeat < 0) || (Heartbeat >= STREAM_HEARTBEAT_ERASED))
+	{
+		printf_P(PSTR("Field is 0 to %u, heartbeat is 0 to %u frames\n"), STREAM_FIELDS-1, STREAM_HEARTBEAT_ERASED-1);
+		return 0;
+	}
+	Stream_SetDeadband((uint8_t)Field, (uint32_t)Deadband, (uint8_t)Heartbeat);
+	return 0;
+}
+
+//Boot stage timings, in ms from the start of HardwareInit. Stages not reached while the boot was timed show '-'.
+static int _F24_Handler (void)
+{
+	uint32_t Times[BOOT_STAGES];
+	
+	Boot_GetTimes(Times);
+	PrintBootStage(PSTR("Buses:           "), Times[BOOT_STAGE_BUSES]);
+	PrintBootStage(PSTR("AD7794:          "), Times[BOOT_STAGE_AD7794]);
+	PrintBootStage(PSTR("Safety:          "), Times[BOOT_STAGE_SAFETY]);
+	PrintBootStage(PSTR("USB attached:    "), Times[BOOT_STAGE_USB_ATTACH]);
+	PrintBootStage(PSTR("DS3232M:         "), Times[BOOT_STAGE_DS3232M]);
+	PrintBootStage(PSTR("MAX7315:         "), Times[BOOT_STAGE_MAX7315]);
+	PrintBootStage(PSTR("AT45DB321D:      "), Times[BOOT_STAGE_AT45DB321D]);
+	PrintBootStage(PSTR("Ready:           "), Times[BOOT_STAGE_READY]);
+	PrintBootStage(PSTR("USB configured:  "), Times[BOOT_STAGE_USB_CONFIGURED]);
+	PrintBootStage(PSTR("Datalogger:      "), Times[BOOT_STAGE_DATALOGGER]);
+	PrintBootStage(PSTR("First sample:    "), Times[BOOT_STAGE_SAMPLE]);
+	PrintBootStage(PSTR("First decision:  "), Times[BOOT_STAGE_DECISION]);
+	return 0;
+}
+
+//Acquisition schedule
+//	acq: Each channel in the table with its period, phase and rates, and what was achieved since the schedule started:
+//	the conversions, the mean time between them, the worst lateness, the deadlines missed, the share at the fast rate
+//	and the A/D time. Then the rate and the variance of the change for the next conversion. The A/D busy time is for one
+//	sample period with every channel at its steady rate.
+//	acq <policy>: Set the rate policy. 0 is always the steady rate, 1 is adaptive, 2 is always the fast rate.
+static int _F25_Handler (void)
+{
+	Acquire_Channel Channel;
+	Acquire_Stats Stats;
+	uint32_t Interval;
+	uint32_t BusyMS;
+	uint8_t Policy;
+	uint8_t i;
+	
+	if(NumberOfArguments() == 1)
+	{
+		Policy = argAsInt(1);
+		if(Policy > ACQUIRE_POLICY_FAST)
+		{
+			printf_P(PSTR("Policy is 0 (steady), 1 (adaptive) or 2 (fast)\n"));
+			return 0;
+		}
+		Acquire_SetPolicy(Policy);
+		return 0;
+	}
+	
+	BusyMS = 0;
+	printf_P(PSTR("Policy: %u\n"), Acquire_GetPolicy());
+	printf_P(PSTR("Channel, Period (ms), Phase, Steady rate, Fast rate, Step, Conversions, Interval (ms), Late max (ms), Missed, Fast, A/D (ms), Rate, Variance\n"));
+	for(i=0; Acquire_GetChannel(i, &Channel, &Stats) == 0; i++)
+	{
+		Interval = 0;
+		if(Stats.Samples > 1)
+		{
+			Interval = (Stats.LastMS - Stats.FirstMS) / (Stats.Samples - 1);
+		}
+		printf_P(PSTR("%u, %lu, %u, 0x%02X, 0x%02X, %u, "), Channel.Channel, (unsigned long)Channel.Period * ACQUIRE_TICK_MS,
+				 Channel.Phase, Channel.Rate, Channel.FastRate, Channel.Step);
+		printf_P(PSTR("%lu, %lu, %u, %u, %lu, %lu, 0x%02X, %lu\n"), (unsigned long)Stats.Samples, (unsigned long)Interval,
+				 Stats.MaxLateMS, Stats.Missed, (unsigned long)Stats.FastSamples, (unsigned long)Stats.BusyMS, Stats.Rate,
+				 (unsigned long)Stats.Variance);
+		BusyMS += ((uint32_t)AD7794ConversionMS(Channel.Rate) * CONTROLLER_SAMPLE_TICKS) / Channel.Period;
+	}
+	printf_P(PSTR("ADC busy: %lu ms per %u s\n"), (unsigned long)BusyMS, (CONTROLLER_SAMPLE_TICKS * ACQUIRE_TICK_MS) / 1000);
+	return 0;
+}
+
+//Heater current burst
+//	ripple: Run a burst on the heater current now and show the results, then the results of the latest burst with the
+//	relay on, which are the ones logged. Currents are in A.
+static int _F26_Handler (void)
+{
+	Ripple_Result Result;
+	uint8_t Relay;
+	uint8_t i;
+	
+	Relay = Ripple_Burst(&Result);
+	for(i=0; i<2; i++)
+	{
+		if(i == 0)
+		{
+			if(Relay == ACQUIRE_RELAY_SWITCHED)
+			{
+				printf_P(PSTR("Now (relay switched):\n"));
+			}
+			else
+			{
+				printf_P(PSTR("Now (relay %s):\n"), (Relay != 0) ? "on" : "off");
+			}
+		}
+		else
+		{
+			Ripple_GetLatest(&Result);
+			printf_P(PSTR("Latest with the relay on:\n"));
+		}
+		printf_P(PSTR("Samples: %u\n"), Result.Samples);
+		printf_P(PSTR("Mean: %ld.%04lu\n"), Result.Mean/10000, labs(Result.Mean%10000));
+		printf_P(PSTR("RMS: %lu.%04lu\n"), Result.RMS/10000, Result.RMS%10000);
+		printf_P(PSTR("Ripple: %lu.%04lu\n"), Result.Ripple/10000, Result.Ripple%10000);
+		printf_P(PSTR("Peak: %lu.%04lu\n"), Result.Peak/10000, Result.Peak%10000);
+		printf_P(PSTR("Crest factor: %u.%02u\n"), Result.Crest/100, Result.Crest%100);
+	}
+	return 0;
+}
+
+//Wait for a key without the watchdog on the main loop, the user can take as long as they want. The controller keeps
+//running in Shell_GetKey and checks in on its own.
+static char WaitForKey(void)
+{
+	char Key;
+	
+	Supervisor_Suspend(SUPERVISOR_TASK_LOOP);
+	Key = Shell_GetKey();
+	Supervisor_Resume(SUPERVISOR_TASK_LOOP);
+	return Key;
+}
+
+static uint8_t WaitForLine(char *Line, uint8_t Size)
+{
+	uint8_t Length;
+	
+	Supervisor_Suspend(SUPERVISOR_TASK_LOOP);
+	Length = Shell_GetLine(Line, Size);
+	Supervisor_Resume(SUPERVISOR_TASK_LOOP);
+	return Length;
+}
+
+//Read a YYMMDDhhmm argument into a data set time. Returns 1 if it is not a time. It does not fit in 32 bits for every
+//year, so the date and the time of day are read as two numbers.
+static uint8_t ArgAsLogTime(uint8_t Arg, uint8_t Time[DATALOGGER_TIME_SIZE])
+{
+	char Text[16];
+	uint32_t Date;
+	uint16_t Clock;
+	uint8_t i;
+	
+	argAsChar(Arg, Text);
+	if(strlen(Text) != 10)
+	{
+		return 1;
+	}
+	for(i=0; i<10; i++)
+	{
+		if((Text[i] < '0') || (Text[i] > '9'))
+		{
+			return 1;
+		}
+	}
+	Clock = (uint16_t)strtoul(&Text[6], NULL, 10);
+	Text[6] = 0;
+	Date = strtoul(Text, NULL, 10);
+	
+	Time[0] = Date / 10000;
+	Time[1] = (Date / 100) % 100;
+	Time[2] = Date % 100;
+	Time[3] = Clock / 100;
+	Time[4] = Clock % 100;
+	if((Time[1] < 1) || (Time[1] > 12) || (Time[2] < 1) || (Time[2] > 31) || (Time[3] > 23) || (Time[4] > 59))
+	{
+		return 1;
+	}
+	return 0;
+}
+
+//Name is in program memory
+static void PrintBootStage(const char *Name, uint32_t Time)
+{
+	printf_P(Name);
+	if(Time == BOOT_NOT_REACHED)
+	{
+		printf_P(PSTR("-\n"));
+	}
+	else
+	{
+		printf_P(PSTR("%lu.%lu ms\n"), Time / 1000, (Time % 1000) / 100);
+	}
+	return;
+}
+
 /** @} */
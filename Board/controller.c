@@ -0,0 +1,340 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Heater control law.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "controller.h"
+
+#define CONTROLLER_INTEGRAL_MAX			(((int32_t)CONTROLLER_DUTY_MAX*100) << CONTROLLER_KI_SHIFT)
+#define CONTROLLER_DEMAND_MAX			40000000ul		//mW. Keeps Demand*100 in 32 bits.
+
+//Ultimate gain is 4d/(pi*a). The relay swings the duty cycle by d = CONTROLLER_DUTY_MAX/2 and a is in 0.0001 deg C,
+//so Ku = 6366198/a in 0.1% per deg C. Tyreus-Luyben: Kp = Ku/3.2 and Ti = 2.2*Tu.
+#define CONTROLLER_TUNE_KP_NUMERATOR	1989437ul
+
+static uint8_t Controller_TuneUpdate(Controller_State *State, Controller_Params *Params, int32_t Temperature);
+static uint32_t Controller_Sqrt(uint32_t Value);
+
+void Controller_Init(Controller_State *State)
+{
+	State->Integral = 0;
+	State->Duty = 0;
+	State->Demand = 0;
+	State->HeaterResistance = 0;
+	State->HeaterPower = 0;
+	State->WindowTick = 0;
+	State->OnTicks = 0;
+	State->RelayOn = 0;
+	State->RelayCycles = 0;
+	State->Tune.Status = CONTROLLER_TUNE_OFF;
+	return;
+}
+
+uint8_t Controller_Update(Controller_State *State, Controller_Params *Params, int32_t Temperature)
+{
+	int32_t Error;
+	int32_t Output;
+
+	if(State->Tune.Status == CONTROLLER_TUNE_RUNNING)
+	{
+		return Controller_TuneUpdate(State, Params, Temperature);
+	}
+
+	Error = Params->SetPoint - Temperature;
+	if((Error <= (int32_t)Params->Deadband) && (Error >= -(int32_t)Params->Deadband))
+	{
+		Error = 0;
+	}
+	else if(Error > CONTROLLER_ERROR_LIMIT)
+	{
+		Error = CONTROLLER_ERROR_LIMIT;
+	}
+	else if(Error < -CONTROLLER_ERROR_LIMIT)
+	{
+		Error = -CONTROLLER_ERROR_LIMIT;
+	}
+
+	//Work in 0.01 deg C so that the gain terms come out in 0.001% duty
+	Error = Error/100;
+
+	//The integral is limited to the duty cycle range so that it does not wind up while the heater is saturated
+	State->Integral += (int32_t)Params->Ki * Error;
+	if(State->Integral > CONTROLLER_INTEGRAL_MAX)
+	{
+		State->Integral = CONTROLLER_INTEGRAL_MAX;
+	}
+	else if(State->Integral < 0)
+	{
+		State->Integral = 0;
+	}
+
+	Output = ((int32_t)Params->Kp * Error + (State->Integral >> CONTROLLER_KI_SHIFT)) / 100;
+	if(Output > CONTROLLER_DUTY_MAX)
+	{
+		Output = CONTROLLER_DUTY_MAX;
+	}
+	else if(Output < 0)
+	{
+		Output = 0;
+	}
+
+	//0.1% of the rated power in W is mW
+	State->Demand = (uint32_t)Output * Params->RatedPower;
+	if((State->HeaterPower >= 10) && (Params->RatedPower != 0))
+	{
+		if(State->Demand > CONTROLLER_DEMAND_MAX)
+		{
+			State->Demand = CONTROLLER_DEMAND_MAX;
+		}
+		Output = (int32_t)((State->Demand * 100) / (State->HeaterPower / 10));
+		if(Output > CONTROLLER_DUTY_MAX)
+		{
+			Output = CONTROLLER_DUTY_MAX;
+		}
+	}
+	State->Duty = (uint16_t)Output;
+	return 0;
+}
+
+void Controller_Measure(Controller_State *State, uint16_t Voltage, int16_t Current, uint8_t RelayOn)
+{
+	uint32_t Resistance;
+
+	if((RelayOn == 1) && (Current >= CONTROLLER_MIN_CURRENT))
+	{
+		Resistance = ((uint32_t)Voltage * 1000) / (uint16_t)Current;
+		if(Resistance > 0xFFFF)
+		{
+			Resistance = 0xFFFF;
+		}
+		else if(Resistance == 0)
+		{
+			Resistance = 1;
+		}
+		State->HeaterResistance = (uint16_t)Resistance;
+	}
+
+	if(State->HeaterResistance != 0)
+	{
+		State->HeaterPower = ((uint32_t)Voltage * Voltage) / State->HeaterResistance;
+	}
+	return;
+}
+
+uint8_t Controller_Tick(Controller_State *State, const Controller_Params *Params)
+{
+	uint8_t RelayOn;
+
+	//The autotune test switches the relay as soon as the temperature crosses the hysteresis band
+	if(State->Tune.Status == CONTROLLER_TUNE_RUNNING)
+	{
+		RelayOn = (State->Duty != 0) ? 1 : 0;
+		if((RelayOn == 1) && (State->RelayOn == 0))
+		{
+			State->RelayCycles++;
+		}
+		State->RelayOn = RelayOn;
+		State->WindowTick = 0;
+		return RelayOn;
+	}
+
+	//The duty cycle is only picked up at the start of a window, so the relay switches at most twice per window
+	if(State->WindowTick == 0)
+	{
+		State->OnTicks = (uint16_t)(((uint32_t)State->Duty * Params->Window) / CONTROLLER_DUTY_MAX);
+	}
+
+	RelayOn = 0;
+	if(State->WindowTick < State->OnTicks)
+	{
+		RelayOn = 1;
+	}
+	if((RelayOn == 1) && (State->RelayOn == 0))
+	{
+		State->RelayCycles++;
+	}
+	State->RelayOn = RelayOn;
+
+	State->WindowTick++;
+	if(State->WindowTick >= Params->Window)
+	{
+		State->WindowTick = 0;
+	}
+	return RelayOn;
+}
+
+void Controller_TuneStart(Controller_State *State, uint16_t Hysteresis)
+{
+	State->Tune.Status = CONTROLLER_TUNE_RUNNING;
+	State->Tune.Heating = 0;
+	State->Tune.Rises = 0;
+	State->Tune.Hysteresis = Hysteresis;
+	State->Tune.Samples = 0;
+	State->Tune.SwingSum = 0;
+	State->Tune.PeriodSum = 0;
+	State->Tune.OnSum = 0;
+	State->Tune.Amplitude = 0;
+	State->Tune.Period = 0;
+	State->Duty = 0;
+	return;
+}
+
+void Controller_TuneStop(Controller_State *State)
+{
+	if(State->Tune.Status == CONTROLLER_TUNE_RUNNING)
+	{
+		State->Tune.Status = CONTROLLER_TUNE_OFF;
+		State->Duty = 0;
+	}
+	return;
+}
+
+static uint8_t Controller_TuneUpdate(Controller_State *State, Controller_Params *Params, int32_t Temperature)
+{
+	Controller_Tune *Tune;
+	uint32_t Amplitude;
+	uint32_t Hysteresis;
+	uint32_t Gain;
+	uint8_t Measured;
+
+	Tune = &State->Tune;
+	Tune->Samples++;
+	if(Tune->Samples > CONTROLLER_TUNE_TIMEOUT)
+	{
+		Tune->Status = CONTROLLER_TUNE_FAILED;
+		State->Duty = 0;
+		return 0;
+	}
+
+	if(Tune->Heating == 1)
+	{
+		Tune->OnSamples++;
+		if(Temperature > Params->SetPoint + (int32_t)Tune->Hysteresis)
+		{
+			Tune->Heating = 0;
+		}
+	}
+	else if(Temperature < Params->SetPoint - (int32_t)Tune->Hysteresis)
+	{
+		//A cycle ends each time the relay turns on
+		Tune->Heating = 1;
+		if(Tune->Rises >= 2)
+		{
+			Tune->SwingSum += (uint32_t)(Tune->Max - Tune->Min);
+			Tune->PeriodSum += (uint16_t)(Tune->Samples - Tune->LastRise);
+			Tune->OnSum += Tune->OnSamples;
+		}
+		Tune->Rises++;
+		Tune->LastRise = Tune->Samples;
+		Tune->OnSamples = 0;
+		Tune->Max = Temperature;
+		Tune->Min = Temperature;
+	}
+
+	if(Temperature > Tune->Max)
+	{
+		Tune->Max = Temperature;
+	}
+	if(Temperature < Tune->Min)
+	{
+		Tune->Min = Temperature;
+	}
+	State->Duty = (Tune->Heating == 1) ? CONTROLLER_DUTY_MAX : 0;
+
+	Measured = Tune->Rises - 2;
+	if((Tune->Rises < 2) || (Measured < CONTROLLER_TUNE_CYCLES))
+	{
+		return 0;
+	}
+
+	//The hysteresis makes the swing larger than it would be with an ideal relay: a = sqrt(swing^2 - hysteresis^2)
+	Amplitude = Tune->SwingSum / (2*Measured);
+	Hysteresis = Tune->Hysteresis;
+	if(Amplitude <= Hysteresis)
+	{
+		Tune->Status = CONTROLLER_TUNE_FAILED;
+		State->Duty = 0;
+		return 0;
+	}
+	if(Amplitude < 0xFFFF)
+	{
+		Amplitude = Controller_Sqrt(Amplitude*Amplitude - Hysteresis*Hysteresis);
+	}
+	Tune->Amplitude = Amplitude;
+	Tune->Period = (uint16_t)(Tune->PeriodSum / Measured);
+
+	Gain = (CONTROLLER_TUNE_KP_NUMERATOR + Amplitude/2) / Amplitude;
+	if(Gain > 0xFFFF)
+	{
+		Gain = 0xFFFF;
+	}
+	else if(Gain == 0)
+	{
+		Gain = 1;
+	}
+	Params->Kp = (uint16_t)Gain;
+
+	//Ki = Kp/Ti with Ti = 2.2*Tu samples, in 1/16 steps
+	Gain = ((Gain << CONTROLLER_KI_SHIFT)*10 + 11ul*Tune->Period) / (22ul*Tune->Period);
+	if(Gain > 0xFFFF)
+	{
+		Gain = 0xFFFF;
+	}
+	Params->Ki = (uint16_t)Gain;
+
+	//Start the integral at the average duty cycle of the test so that the change over is smooth
+	State->Integral = ((int32_t)((Tune->OnSum * (uint32_t)CONTROLLER_DUTY_MAX * 10) / Tune->PeriodSum) * 10) << CONTROLLER_KI_SHIFT;
+	State->Duty = (uint16_t)((State->Integral >> CONTROLLER_KI_SHIFT) / 100);
+	Tune->Status = CONTROLLER_TUNE_DONE;
+	return 1;
+}
+
+//Integer square root, rounded down
+static uint32_t Controller_Sqrt(uint32_t Value)
+{
+	uint32_t Root;
+	uint32_t Bit;
+
+	Root = 0;
+	Bit = 1ul << 30;
+	while(Bit > Value)
+	{
+		Bit = Bit >> 2;
+	}
+	while(Bit != 0)
+	{
+		if(Value >= Root + Bit)
+		{
+			Value -= Root + Bit;
+			Root = (Root >> 1) + Bit;
+		}
+		else
+		{
+			Root = Root >> 1;
+		}
+		Bit = Bit >> 2;
+	}
+	return Root;
+}
+
+/** @} */
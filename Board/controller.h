@@ -0,0 +1,146 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Heater control law.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	A PI controller sets the heater duty cycle once per sample. The relay is driven with a slow PWM: it is turned on at
+*	the start of each window and turned off once the on time for the current duty cycle has passed. Inside the deadband
+*	the error is treated as zero, so the duty cycle holds at the integral term and noise on the temperature does not
+*	move the relay.
+*
+*	The PI output is a power demand: CONTROLLER_DUTY_MAX asks for the rated power of the heater. The heater resistance is
+*	measured whenever the relay is on, and with the heater voltage this gives the power the heater takes right now. The
+*	duty cycle is scaled so that the average power matches the demand, so a change in the supply voltage is corrected
+*	on the next sample instead of waiting for it to show up in the temperature. Until the heater has been measured, or
+*	if the rated power is 0, the demand is used as the duty cycle.
+*
+*	Controller_TuneStart runs an Astrom-Hagglund relay feedback test instead: the relay is turned fully on below the set
+*	point and fully off above it, with a small hysteresis, until the temperature settles into a steady oscillation. The
+*	amplitude and period of the oscillation give the ultimate gain and period of the plant. The peaks and the period are
+*	added up as each cycle ends, so the test only keeps a few numbers no matter how long it runs. The first cycle is not
+*	used since it still has the heat up in it. The PI gains are found with the Tyreus-Luyben rules, which overshoot less
+*	than Ziegler-Nichols on slow, lagging plants like a fermenter.
+*
+*	All of the controller state is in Controller_State, and the functions do not touch the hardware, so the same code
+*	runs in the firmware and in the host tools. This file must only depend on stdint.h.
+*
+*	Units:
+*		-Temperatures are in 0.0001 deg C, the same as ThermistorCountsToTempNum.
+*		-The duty cycle is in 0.1% (0 to CONTROLLER_DUTY_MAX).
+*		-Times are in RTC ticks (500ms).
+*
+*	@{
+*/
+
+#ifndef _CONTROLLER_H_
+#define _CONTROLLER_H_
+
+#include "stdint.h"
+
+#define CONTROLLER_DUTY_MAX				1000
+#define CONTROLLER_SAMPLE_TICKS			10			//Controller_Update is called every 10 RTC ticks (5 seconds)
+#define CONTROLLER_ERROR_LIMIT			500000		//Errors are limited to +/-50 deg C so the gains can not overflow
+#define CONTROLLER_KI_SHIFT				4			//Ki is held in 1/16 steps, since a tuned Ki is only a few steps of 0.1%
+
+//Defaults used until the gains are tuned
+#define CONTROLLER_DEFAULT_KP			400			//0.1% per deg C
+#define CONTROLLER_DEFAULT_KI			(4 << CONTROLLER_KI_SHIFT)	//0.1% per deg C per sample
+#define CONTROLLER_DEFAULT_WINDOW		120			//RTC ticks (1 minute)
+#define CONTROLLER_DEFAULT_DEADBAND		500			//0.0001 deg C (+/-0.05 deg C)
+#define CONTROLLER_DEFAULT_POWER		60			//W
+
+#define CONTROLLER_MIN_CURRENT			100			//mA. The heater is not measured below this.
+
+//Autotune
+#define CONTROLLER_TUNE_OFF				0
+#define CONTROLLER_TUNE_RUNNING			1
+#define CONTROLLER_TUNE_DONE			2			//The last test finished and the gains were updated
+#define CONTROLLER_TUNE_FAILED			3			//The last test timed out or did not oscillate
+
+#define CONTROLLER_TUNE_CYCLES			3			//Cycles measured after the first one
+#define CONTROLLER_TUNE_TIMEOUT			8640		//Samples (12 hours)
+#define CONTROLLER_TUNE_HYSTERESIS		500			//0.0001 deg C (+/-0.05 deg C)
+
+typedef struct
+{
+	int32_t SetPoint;			//Target temperature
+	uint16_t Kp;				//Proportional gain (0.1% duty per deg C of error)
+	uint16_t Ki;				//Integral gain (1/16 of 0.1% duty per deg C of error, added every sample)
+	uint16_t Window;			//Relay PWM period in RTC ticks
+	uint16_t Deadband;			//Errors smaller than this are treated as zero
+	uint16_t RatedPower;		//W. 0 turns off the power feed forward.
+} Controller_Params;
+
+typedef struct
+{
+	uint8_t Status;				//CONTROLLER_TUNE_*
+	uint8_t Heating;
+	uint8_t Rises;				//Number of times the relay was turned on by the test
+	uint16_t Hysteresis;
+	int32_t Max;				//Highest and lowest temperature in the current cycle
+	int32_t Min;
+	uint16_t Samples;			//Samples since the start of the test
+	uint16_t LastRise;			//Sample when the current cycle started
+	uint16_t OnSamples;			//Samples with the relay on in the current cycle
+	uint32_t SwingSum;			//Peak to peak swing, added up over the measured cycles
+	uint32_t PeriodSum;			//In samples
+	uint32_t OnSum;
+	uint32_t Amplitude;			//Result: half of the average peak to peak swing
+	uint16_t Period;			//Result: average period in samples
+} Controller_Tune;
+
+typedef struct
+{
+	int32_t Integral;			//Integral term in 1/16 of 0.001% duty
+	uint16_t Duty;				//Duty cycle from the last sample
+	uint32_t Demand;			//Power asked for by the PI controller in mW
+	uint16_t HeaterResistance;	//mOhms. 0 until the heater is measured.
+	uint32_t HeaterPower;		//mW the heater takes when it is on, at the last measured voltage
+	uint16_t WindowTick;		//RTC ticks since the start of the relay window
+	uint16_t OnTicks;			//Relay on time for the current window
+	uint8_t RelayOn;
+	uint32_t RelayCycles;		//Number of times the relay was turned on
+	Controller_Tune Tune;
+} Controller_State;
+
+/** Clear the controller state. The relay starts off. */
+void Controller_Init(Controller_State *State);
+
+/** Set the duty cycle from a new temperature measurement. Call once every CONTROLLER_SAMPLE_TICKS. While an autotune
+ *	test is running this runs the test instead. Returns 1 when a test has just finished and the gains in Params were
+ *	changed, so that the caller can save them. */
+uint8_t Controller_Update(Controller_State *State, Controller_Params *Params, int32_t Temperature);
+
+/** Measure the heater. Call before Controller_Update with the heater voltage and current, and the relay state when they
+ *	were measured. */
+void Controller_Measure(Controller_State *State, uint16_t Voltage, int16_t Current, uint8_t RelayOn);
+
+/** Step the relay window. Call on every RTC tick. Returns 1 if the relay should be on. */
+uint8_t Controller_Tick(Controller_State *State, const Controller_Params *Params);
+
+/** Start an autotune test around Params->SetPoint. The relay switches when the temperature is more than 'Hysteresis'
+ *	from the set point. */
+void Controller_TuneStart(Controller_State *State, uint16_t Hysteresis);
+
+/** Stop a running autotune test. The gains are not changed. */
+void Controller_TuneStop(Controller_State *State);
+
+#endif
+/** @} */
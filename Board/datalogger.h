@@ -27,17 +27,22 @@
 #define _DATALOGGER_H_
 
 #include "stdint.h"
+#include "channels.h"
 
 
 #define DATALOGGER_PAGE_SIZE			528		//This should be the same as the dataflash page size.
-#define DATALOGGER_DATASET_SIZE			18
-#define DATALOGGER_USE_CRC				0
+#define DATALOGGER_NUMBER_OF_PAGES		8192	//The number of pages in the dataflash.
+#define DATALOGGER_PAGE_HEADER_SIZE		3		//Each page starts with a 24-bit sequence number (MSB first).
+#define DATALOGGER_TIME_SIZE			5		//Each data set starts with the year (from 2000), month, day, hour and min it was saved
+#define DATALOGGER_DATASET_SIZE			(DATALOGGER_TIME_SIZE + CHANNEL_DATA_SIZE)	//Followed by the averaged channels from channels.h
+#define DATALOGGER_USE_CRC				1		//Set to 1 to add a CRC-16 to the end of each data set
+#define DATALOGGER_RECORD_SIZE			(DATALOGGER_DATASET_SIZE + 2 + 2*DATALOGGER_USE_CRC)	//Data set header, data and CRC
 
 
 //Initalization options
 #define DATALOGGER_INIT_APPEND				0x01		//Search for previously written data and append.
 #define DATALOGGER_INIT_OVERWRITE			0x02		//Restart data collection at page 0, address 0.
-#define DATALOGGER_INIT_RESTART_IF_FULL		0x04		//If the device is full, restart data collection at page 0, address 0.
+#define DATALOGGER_INIT_RESTART_IF_FULL		0x04		//If the device is full, overwrite the oldest page and continue (circular log).
 #define DATALOGGER_INIT_STOP_IF_FULL		0x08		//If the device is full, do not start collecting data.
 
 
@@ -45,6 +50,19 @@
 
 #define DATALOGGER_HEADER1_PREFIX	0xA0
 #define DATALOGGER_HEADER2_SUFFIX	0x00
+
+//Page sequence numbers
+//The sequence number is incremented for every new page written. Pages are always written in order, wrapping from the last page
+//back to page 0, so the page with the newest data (head) and the oldest data (tail) can be found by a binary search on mount.
+#define DATALOGGER_PAGE_SEQ_ERASED	0xFFFFFFUL	//The sequence number read from an erased page
+
+//Sparse time index
+//The time of the first data set in every DATALOGGER_INDEX_PAGES_PER_ENTRY pages is saved in the DS3232M SRAM. Range queries
+//use this to find the right block of pages, then a binary search on the pages in that block to find the starting page.
+#define DATALOGGER_INDEX_PAGES_PER_ENTRY	256
+#define DATALOGGER_INDEX_ENTRIES			(DATALOGGER_NUMBER_OF_PAGES/DATALOGGER_INDEX_PAGES_PER_ENTRY)
+#define DATALOGGER_INDEX_ENTRY_SIZE			DATALOGGER_TIME_SIZE		//The time as it is in the data set
+#define DATALOGGER_INDEX_SRAM_ADDRESS		0x00	//Location of the index in the DS3232M SRAM
 //TODO: Add exclude sectors
 
 /*typedef struct 
@@ -74,12 +92,23 @@ void Datalogger_AddDataSet(uint8_t DataSet[]);
 /** Save a partial set of data to flash. Call this if the controller needs to be reset. */
 void Datalogger_SaveDataToFlash(void);
 
-/** Locate the last set of data written to flash */
+/** Locate the last set of data written to flash. Returns the location of the next data set, or 0xFFFF in both values if the device is full.
+ *	The oldest page in the log is also found and saved for use by Datalogger_ReadBackData.
+ */
 void Datalogger_FindLastDataSet(uint16_t *PageNumber, uint16_t *AddressInPage);
 
-/** Writes a given number of datasets to the screen using prinf */
+/** Writes a given number of datasets to the screen using prinf, starting at the oldest data set.
+ *	Both readbacks check in the main loop with the supervisor and run the controller for every data set, since a dump can
+ *	take minutes.
+ */
 void Datalogger_ReadBackData(uint16_t NumberOfDataSets);
 
+/** Writes all datasets between 'FromTime' and 'ToTime' (inclusive) to the screen using printf. The times are DATALOGGER_TIME_SIZE
+ *	bytes, as at the start of a data set.
+ *	The sparse time index is used to seek to the first page, so only a few pages are read before the data is found.
+ */
+void Datalogger_ReadBackRange(uint8_t FromTime[], uint8_t ToTime[]);
+
 
 void Datalogger_Start(void);
 void Datalogger_Process(void);
@@ -40,7 +40,7 @@ uint8_t DS3232M_Init( void )
 	//Read the status register
 	//If the OSF bit (bit 7) is 1, the oscillator has stopped since last initalization.
 	SendData[0] = DS3232M_REG_STATUS;
-	stat = TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 1, 1);
+	stat = TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 1, 1);
 	TWI_CHECKSTAT(stat);
 
 	//Set up control register
@@ -48,7 +48,7 @@ uint8_t DS3232M_Init( void )
 	// -Disable pending interrupts
 	SendData[0] = DS3232M_REG_CONTROL;
 	SendData[1] = 0x00;
-	stat = TWIRW(DS3232M_SLA_ADDRESS, SendData, &NULL, 2, 0);
+	stat = TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, NULL, 2, 0);
 	TWI_CHECKSTAT(stat);
 	
 	DS3232M_DisableAlarm(1);
@@ -67,7 +67,7 @@ void DS3232M_GetStatus( void )
 	uint8_t RecieveData[2];
 	uint8_t SendData = DS3232M_REG_CONTROL;
 	
-	TWIRW(DS3232M_SLA_ADDRESS, &SendData, RecieveData, 1, 2);
+	TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, &SendData, RecieveData, 1, 2);
 	printf("Control: 0x%02X\n", RecieveData[0]);
 	printf("Status: 0x%02X\n", RecieveData[1]);
 	
@@ -88,7 +88,7 @@ void DS3232M_SetTime(TimeAndDate *TheTime)
 	SendData[6] = ((TheTime->month % 10) | ((TheTime->month / 10) << 4));	//NOTE: this probably clears the century bit. maybe look at this later.
 	SendData[7] = ((TheTime->year % 10) | ((TheTime->year / 10) << 4));
 
-	if(TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 8, 0) != 0)
+	if(TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 8, 0) != 0)
 	{
 		printf_P(PSTR("I2C Error\n"));
 	}
@@ -105,7 +105,7 @@ void DS3232M_GetTime(TimeAndDate *TheTime)
 	SendData = DS3232M_REG_SEC;
 
 
-	if(TWIRW(DS3232M_SLA_ADDRESS, &SendData, RecieveData, 1, 7) == 0)
+	if(TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, &SendData, RecieveData, 1, 7) == 0)
 	{
 		//Convert registers in BCD into the time struct
 		TheTime->sec = ((RecieveData[0] & 0x0F) + ((RecieveData[0] & 0x70) >> 4)*10 );
@@ -166,7 +166,7 @@ void DS3232M_SetAlarm(uint8_t AlarmNumber, uint8_t AlarmMasks, TimeAndDate *Alar
 			//Alarm on date
 			SendData[4] = (((AlarmMasks & 0x08) << 4) | ((AlarmMasks & 0x10) << 2) | (AlarmTime->day % 10) | ((AlarmTime->day / 10) << 4));
 		}
-		TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 5, 0);
+		TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 5, 0);
 	}
 	else
 	{
@@ -184,7 +184,7 @@ void DS3232M_SetAlarm(uint8_t AlarmNumber, uint8_t AlarmMasks, TimeAndDate *Alar
 			//Alarm on date
 			SendData[3] = (((AlarmMasks & 0x08) << 4) | ((AlarmMasks & 0x10) << 2) | (AlarmTime->day % 10) | ((AlarmTime->day / 10) << 4));
 		}
-		TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 4, 0);
+		TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 4, 0);
 	}
 	return;
 }
@@ -198,11 +198,11 @@ void DS3232M_EnableAlarm(uint8_t AlarmNumber)
 	{
 		//Get the current control register
 		SendData[0] = DS3232M_REG_CONTROL;
-		TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 1, 1);
+		TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 1, 1);
 		
 		//Enable the requested alarm
 		SendData[1] = RecieveData | AlarmNumber;
-		TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 2, 0);
+		TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 2, 0);
 	}
 	return;
 }
@@ -216,19 +216,19 @@ void DS3232M_DisableAlarm(uint8_t AlarmNumber)
 	{
 		//Get the current control register
 		SendData[0] = DS3232M_REG_CONTROL;
-		TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 1, 1);
+		TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 1, 1);
 		
 		//Disable the requested alarm
 		SendData[1] = (RecieveData & (~AlarmNumber));
-		TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 2, 0);
+		TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 2, 0);
 		
 		//Get the current status register
 		SendData[0] = DS3232M_REG_STATUS;
-		TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 1, 1);
+		TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 1, 1);
 		
 		//Clear the interrupt flag for the requested alarm
 		SendData[1] = (RecieveData & (~AlarmNumber));
-		TWIRW(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 2, 0);
+		TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, 2, 0);
 	}
 	return;
 }
@@ -241,7 +241,7 @@ uint8_t DS3232M_GetTemp(int8_t *TempLHS, uint8_t *TempRHS)
 	uint8_t ret;
 
 	SendData = DS3232M_REG_TEMP_HI;
-	ret = TWIRW(DS3232M_SLA_ADDRESS, &SendData, RecieveData, 1, 2);
+	ret = TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, &SendData, RecieveData, 1, 2);
 
 	if(ret == 0)
 	{
@@ -257,4 +257,37 @@ uint8_t DS3232M_GetTemp(int8_t *TempLHS, uint8_t *TempRHS)
 	}
 }
 
+uint8_t DS3232M_ReadSRAM(uint8_t Address, uint8_t *Data, uint8_t Length)
+{
+	uint8_t SendData;
+	
+	if((Length == 0) || (((uint16_t)Address + Length) > DS3232M_SRAM_SIZE))
+	{
+		return 0xFF;
+	}
+	
+	SendData = DS3232M_REG_SRAM + Address;
+	return TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, &SendData, Data, 1, Length);
+}
+
+uint8_t DS3232M_WriteSRAM(uint8_t Address, uint8_t *Data, uint8_t Length)
+{
+	uint8_t RecieveData;
+	uint8_t SendData[DS3232M_SRAM_MAX_WRITE+1];
+	uint8_t i;
+	
+	if((Length == 0) || (Length > DS3232M_SRAM_MAX_WRITE) || (((uint16_t)Address + Length) > DS3232M_SRAM_SIZE))
+	{
+		return 0xFF;
+	}
+	
+	SendData[0] = DS3232M_REG_SRAM + Address;
+	for(i=0; i<Length; i++)
+	{
+		SendData[i+1] = Data[i];
+	}
+	
+	return TWIBus_ReadWrite(DS3232M_SLA_ADDRESS, SendData, &RecieveData, Length+1, 0);
+}
+
 /** @} */
\ No newline at end of file
@@ -56,6 +56,10 @@
 #define DS3232M_REG_TEMP_HI		0x11
 #define DS3232M_REG_TEMP_LO		0x12
 #define DS3232M_REG_TEST		0x03
+#define DS3232M_REG_SRAM		0x14	//Start of the battery backed SRAM
+
+#define DS3232M_SRAM_SIZE		236		//Size of the SRAM in bytes
+#define DS3232M_SRAM_MAX_WRITE	8		//The maximum number of bytes that can be written to the SRAM at once
 
 uint8_t DS3232M_Init( void );
 void DS3232M_GetStatus( void );
@@ -66,6 +70,12 @@ void DS3232M_EnableAlarm(uint8_t AlarmNumber);
 void DS3232M_DisableAlarm(uint8_t AlarmNumber);
 uint8_t DS3232M_GetTemp(int8_t *TempLHS, uint8_t *TempRHS);
 
+/** Read 'Length' bytes from the battery backed SRAM starting at 'Address'. Address 0 is the first byte of the SRAM. Returns the I2C status. */
+uint8_t DS3232M_ReadSRAM(uint8_t Address, uint8_t *Data, uint8_t Length);
+
+/** Write up to DS3232M_SRAM_MAX_WRITE bytes to the battery backed SRAM starting at 'Address'. Returns the I2C status. */
+uint8_t DS3232M_WriteSRAM(uint8_t Address, uint8_t *Data, uint8_t Length);
+
 #endif
 
 /** @} */
\ No newline at end of file
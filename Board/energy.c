@@ -0,0 +1,156 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Heater energy meter.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+
+uint32_t EEMEM NV_ENERGY_MWH = 0xFFFFFFFF;			//Energy total from the last hourly checkpoint. 0xFFFFFFFF if never saved.
+
+static Energy_Counter Total;
+static uint32_t LastSaved;
+static uint16_t SamplesToSRAM;
+static uint16_t SamplesToEEPROM;
+
+static void Energy_SaveSRAM(void);
+static void Energy_SaveEEPROM(void);
+
+void Energy_Init(void)
+{
+	uint8_t Saved[ENERGY_SRAM_SIZE];
+	uint8_t Check;
+	uint8_t i;
+
+	//Start from the EEPROM copy, unless it was never saved
+	LastSaved = eeprom_read_dword(&NV_ENERGY_MWH);
+	Total.MilliWattHours = LastSaved;
+	if(LastSaved == 0xFFFFFFFF)
+	{
+		Total.MilliWattHours = 0;
+	}
+	Total.Remainder = 0;
+
+	//The SRAM copy is newer if it is valid. Layout: total (4 bytes, MSB first), remainder (2 bytes), magic, check.
+	if(DS3232M_ReadSRAM(ENERGY_SRAM_ADDRESS, Saved, ENERGY_SRAM_SIZE) == 0)
+	{
+		Check = 0;
+		for(i=0; i<(ENERGY_SRAM_SIZE-1); i++)
+		{
+			Check += Saved[i];
+		}
+		if((Saved[6] == ENERGY_SRAM_MAGIC) && (Saved[7] == (uint8_t)~Check))
+		{
+			Total.MilliWattHours = ((uint32_t)Saved[0] << 24) | ((uint32_t)Saved[1] << 16) | ((uint32_t)Saved[2] << 8) | Saved[3];
+			Total.Remainder = ((uint16_t)Saved[4] << 8) | Saved[5];
+			if(Total.Remainder >= ENERGY_UNITS_PER_MWH)
+			{
+				Total.Remainder = 0;
+			}
+		}
+	}
+
+	SamplesToSRAM = ENERGY_SRAM_PERIOD;
+	SamplesToEEPROM = ENERGY_EEPROM_PERIOD;
+	return;
+}
+
+void Energy_Add(uint32_t Power, uint16_t OnTicks)
+{
+	Energy_Accumulate(&Total, Power, OnTicks);
+
+	SamplesToSRAM--;
+	if(SamplesToSRAM == 0)
+	{
+		SamplesToSRAM = ENERGY_SRAM_PERIOD;
+		Energy_SaveSRAM();
+	}
+
+	SamplesToEEPROM--;
+	if(SamplesToEEPROM == 0)
+	{
+		SamplesToEEPROM = ENERGY_EEPROM_PERIOD;
+		Energy_SaveEEPROM();
+	}
+	return;
+}
+
+void Energy_Checkpoint(void)
+{
+	Energy_SaveSRAM();
+	Energy_SaveEEPROM();
+	return;
+}
+
+void Energy_Reset(void)
+{
+	Total.MilliWattHours = 0;
+	Total.Remainder = 0;
+	Energy_Checkpoint();
+	return;
+}
+
+uint32_t Energy_GetMWh(void)
+{
+	return Total.MilliWattHours;
+}
+
+uint32_t Energy_Get(void)
+{
+	return Total.MilliWattHours / 10;
+}
+
+static void Energy_SaveSRAM(void)
+{
+	uint8_t Saved[ENERGY_SRAM_SIZE];
+	uint8_t Check;
+	uint8_t i;
+
+	Saved[0] = (uint8_t)(Total.MilliWattHours >> 24);
+	Saved[1] = (uint8_t)(Total.MilliWattHours >> 16);
+	Saved[2] = (uint8_t)(Total.MilliWattHours >> 8);
+	Saved[3] = (uint8_t)Total.MilliWattHours;
+	Saved[4] = (uint8_t)(Total.Remainder >> 8);
+	Saved[5] = (uint8_t)Total.Remainder;
+	Saved[6] = ENERGY_SRAM_MAGIC;
+	Check = 0;
+	for(i=0; i<(ENERGY_SRAM_SIZE-1); i++)
+	{
+		Check += Saved[i];
+	}
+	Saved[7] = ~Check;
+	DS3232M_WriteSRAM(ENERGY_SRAM_ADDRESS, Saved, ENERGY_SRAM_SIZE);
+	return;
+}
+
+//Only write the EEPROM if the total changed
+static void Energy_SaveEEPROM(void)
+{
+	if(Total.MilliWattHours != LastSaved)
+	{
+		eeprom_update_dword(&NV_ENERGY_MWH, Total.MilliWattHours);
+		LastSaved = Total.MilliWattHours;
+	}
+	return;
+}
+
+/** @} */
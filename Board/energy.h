@@ -0,0 +1,87 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Heater energy meter.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Every sample, the heater power (V*I, measured by the controller) times the time the relay was on since the last sample
+*	is added to the total. Power is in mW and time in RTC ticks, so each step adds 0.5mJ units. These are carried in a
+*	remainder until they make a whole mWh, so nothing is lost to rounding and no floating point is used.
+*
+*	The total is checkpointed to the DS3232M SRAM every minute. The SRAM is battery backed and does not wear out. It is
+*	also saved to EEPROM once an hour if it changed, which is about 10 years of continuous use for a 100k cycle EEPROM,
+*	so the total survives a dead RTC battery with at most an hour lost. At boot, the SRAM copy is used if it is valid,
+*	otherwise the EEPROM copy.
+*
+*	The total is logged as the ENERGY channel in 0.01Wh. Like every channel it is averaged over the save period.
+*
+*	Energy_Counter and Energy_Accumulate only depend on stdint.h so that they can be used by the host tools.
+*
+*	@{
+*/
+
+#ifndef _ENERGY_H_
+#define _ENERGY_H_
+
+#include "stdint.h"
+
+#define ENERGY_UNITS_PER_MWH		7200		//1mWh = 3.6J = 7200 * 0.5mJ
+#define ENERGY_SRAM_ADDRESS			0x80		//After the datalogger index in the DS3232M SRAM
+#define ENERGY_SRAM_SIZE			8
+#define ENERGY_SRAM_MAGIC			0xE7
+#define ENERGY_SRAM_PERIOD			12			//Samples (1 minute)
+#define ENERGY_EEPROM_PERIOD		720			//Samples (1 hour)
+
+typedef struct
+{
+	uint32_t MilliWattHours;
+	uint16_t Remainder;			//0.5mJ units, less than ENERGY_UNITS_PER_MWH
+} Energy_Counter;
+
+/** Add 'Power' (mW) for 'Ticks' RTC ticks. */
+static inline void Energy_Accumulate(Energy_Counter *Counter, uint32_t Power, uint16_t Ticks)
+{
+	uint32_t Units;
+
+	//A 4kW heater for 1000 ticks still fits in 32 bits
+	Units = Power * Ticks + Counter->Remainder;
+	Counter->MilliWattHours += Units / ENERGY_UNITS_PER_MWH;
+	Counter->Remainder = (uint16_t)(Units % ENERGY_UNITS_PER_MWH);
+	return;
+}
+
+/** Restore the total from the DS3232M SRAM or EEPROM. Call after DS3232M_Init. */
+void Energy_Init(void);
+
+/** Add the energy for one sample and checkpoint the total when it is time. */
+void Energy_Add(uint32_t Power, uint16_t OnTicks);
+
+/** Save the total to SRAM and EEPROM now. */
+void Energy_Checkpoint(void);
+
+/** Start a new total, for a new batch. */
+void Energy_Reset(void);
+
+uint32_t Energy_GetMWh(void);
+
+/** The total in 0.01Wh, for the channel list. */
+uint32_t Energy_Get(void);
+
+#endif
+/** @} */
@@ -0,0 +1,132 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Combine the two thermistors into one wort temperature.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "fusion.h"
+
+static uint8_t Fusion_Measure(Fusion_State *State, int32_t Reading, uint32_t Noise);
+
+void Fusion_Init(Fusion_State *State)
+{
+	State->Estimate = 0;
+	State->Variance = 0;
+	State->Rejects = 0;
+	State->Used = 0;
+	return;
+}
+
+int32_t Fusion_Update(Fusion_State *State, const Fusion_Params *Params, int32_t Red, int32_t Black, int32_t Internal)
+{
+	int32_t Correction;
+	int64_t Difference;
+	uint64_t Variance;
+
+	//Take out the excitation drift. Work in 0.01 deg C so that this can not overflow.
+	Correction = (((Internal - FUSION_DRIFT_REFERENCE)/100) * Params->Drift)/100;
+	Red += Correction;
+	Black += Correction;
+
+	//Start from the average of the two readings. The starting variance includes any difference between them, so that
+	//neither one is thrown out by the gate on the next sample.
+	if(State->Variance == 0)
+	{
+		Difference = (int64_t)Red - Black;
+		Variance = ((uint64_t)Params->RedNoise + Params->BlackNoise + (uint64_t)(Difference*Difference))/4 + 1;
+		if(Variance > 0xFFFFFFFF)
+		{
+			Variance = 0xFFFFFFFF;
+		}
+		State->Estimate = (int32_t)(((int64_t)Red + Black)/2);
+		State->Variance = (uint32_t)Variance;
+		State->Rejects = 0;
+		State->Used = FUSION_USED_RED|FUSION_USED_BLACK;
+		return State->Estimate;
+	}
+
+	//Predict
+	if(State->Variance > (0xFFFFFFFF - Params->Process))
+	{
+		State->Variance = 0xFFFFFFFF;
+	}
+	else
+	{
+		State->Variance += Params->Process;
+	}
+
+	//Correct with each reading in turn
+	State->Used = 0;
+	if(Fusion_Measure(State, Red, Params->RedNoise) == 1)
+	{
+		State->Used |= FUSION_USED_RED;
+	}
+	if(Fusion_Measure(State, Black, Params->BlackNoise) == 1)
+	{
+		State->Used |= FUSION_USED_BLACK;
+	}
+
+	if(State->Used == 0)
+	{
+		State->Rejects++;
+		if(State->Rejects >= FUSION_MAX_REJECTS)
+		{
+			State->Variance = 0;
+		}
+	}
+	else
+	{
+		State->Rejects = 0;
+	}
+	return State->Estimate;
+}
+
+//One Kalman update. Returns 0 if the reading was thrown out by the gate.
+static uint8_t Fusion_Measure(Fusion_State *State, int32_t Reading, uint32_t Noise)
+{
+	int64_t Innovation;
+	uint64_t Total;
+	uint32_t Gain;
+
+	Innovation = (int64_t)Reading - State->Estimate;
+	Total = (uint64_t)State->Variance + Noise;
+	if((Innovation > INT32_MAX) || (Innovation < -INT32_MAX))
+	{
+		return 0;
+	}
+	if((uint64_t)(Innovation*Innovation) > (uint64_t)(FUSION_GATE*FUSION_GATE)*Total)
+	{
+		return 0;
+	}
+
+	//Gain is in 1/65536
+	Gain = (uint32_t)(((uint64_t)State->Variance << 16) / Total);
+	State->Estimate += (int32_t)((Innovation * Gain) / 65536);
+	State->Variance = (uint32_t)(((uint64_t)State->Variance * (65536 - Gain)) >> 16);
+	if(State->Variance == 0)
+	{
+		State->Variance = 1;
+	}
+	return 1;
+}
+
+/** @} */
@@ -0,0 +1,81 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Combine the two thermistors into one wort temperature.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	A one state Kalman filter. The wort temperature is modeled as a random walk, so each sample the variance of the
+*	estimate grows by the process noise, then each thermistor reading pulls the estimate toward it by the Kalman gain.
+*	The filter keeps the variance of the estimate, which is much smaller than the variance of either thermistor once it
+*	has run for a few samples.
+*
+*	Both thermistors are driven by the same AD7794 excitation current, which drifts with the temperature of the board.
+*	A higher current reads as a higher resistance, which reads as a lower temperature. The AD7794 internal temperature
+*	is used to take this out of both readings before they are used.
+*
+*	A reading more than FUSION_GATE standard deviations from the estimate is not used, so a thermistor that comes off of
+*	the vessel or goes open does not pull the estimate with it. If every reading is thrown out for FUSION_MAX_REJECTS
+*	samples in a row, the filter starts over from the next readings.
+*
+*	Everything is in integer math. Temperatures are in 0.0001 deg C, the same as ThermistorCountsToTempNum, and
+*	variances are in (0.0001 deg C)^2. This file must only depend on stdint.h.
+*
+*	@{
+*/
+
+#ifndef _FUSION_H_
+#define _FUSION_H_
+
+#include "stdint.h"
+
+#define FUSION_GATE					4			//Readings further than this many standard deviations out are not used
+#define FUSION_MAX_REJECTS			12			//Samples (1 minute)
+#define FUSION_DRIFT_REFERENCE		250000		//The board temperature with no excitation drift (25 deg C)
+
+//Defaults
+#define FUSION_DEFAULT_PROCESS		1600		//The wort can move about 0.004 deg C per sample with the heater on
+#define FUSION_DEFAULT_NOISE		2500		//0.005 deg C standard deviation on each thermistor
+#define FUSION_DEFAULT_DRIFT		45			//200ppm/C excitation drift, with the thermistor at 4.4%/C
+
+typedef struct
+{
+	uint32_t Process;			//Variance added to the estimate every sample
+	uint32_t RedNoise;			//Variance of each thermistor reading
+	uint32_t BlackNoise;
+	int16_t Drift;				//Apparent thermistor temperature change in 0.0001 deg C per deg C of board temperature
+} Fusion_Params;
+
+typedef struct
+{
+	int32_t Estimate;			//Wort temperature
+	uint32_t Variance;			//Variance of Estimate. 0 until the first reading.
+	uint8_t Rejects;			//Samples in a row with every reading thrown out
+	uint8_t Used;				//FUSION_USED_* for the last sample
+} Fusion_State;
+
+#define FUSION_USED_RED				0x01
+#define FUSION_USED_BLACK			0x02
+
+void Fusion_Init(Fusion_State *State);
+
+/** Add one sample. Internal is the AD7794 internal temperature. Returns the new estimate. */
+int32_t Fusion_Update(Fusion_State *State, const Fusion_Params *Params, int32_t Red, int32_t Black, int32_t Internal);
+
+#endif
+/** @} */
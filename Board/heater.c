@@ -0,0 +1,86 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Conversion of the heater voltage and current measurements from counts.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+
+//Converts the measured heater voltage to the real voltage in volts/10000
+//Uses the measured values of resistors as R1=10K, R2=279.2K
+//TODO: Make these resistances compiler defines?
+//TODO: These functions should probably be combined somewhere
+uint32_t ConvertHeaterVoltage(uint32_t InputCounts)
+{
+	double HeaterVoltage;
+	HeaterVoltage = ((double)InputCounts*1.17F*289.2F)/((double)(0xFFFFFF * 10));
+	return (uint32_t)(HeaterVoltage*10000);
+}
+
+//This measurment is assumed to be taken in bipolar mode
+int32_t ConvertHeaterCurrent(uint32_t InputCounts)
+{
+	int32_t CountsFromZero;
+	double HeaterCurrent;
+	uint32_t CalValue;
+	
+	CalValue = GetHeaterCurrentZero();
+	//printf_P(PSTR("Cal: 0x%06lX\n"), CalValue);
+	//printf_P(PSTR("Counts: 0x%06lX\n"), InputCounts);
+	
+	if(InputCounts > CalValue)
+	{
+		CountsFromZero = (int32_t)(InputCounts-CalValue);
+		
+	}
+	else
+	{
+		CountsFromZero = -1*((int32_t)(CalValue-InputCounts));
+	}
+	//CountsFromZero = -4000;
+	//printf_P(PSTR("Counts fz: 0x%06lX\n"), CountsFromZero);
+	//printf_P(PSTR("Counts fz: %ld\n"), CountsFromZero);
+	HeaterCurrent = ((double)CountsFromZero*1170.0F)/((double)(0xFFFFFF));
+	HeaterCurrent = HeaterCurrent / (double)(220);
+	return (int32_t)(HeaterCurrent*10000);
+}
+
+/** Integer versions of ConvertHeaterVoltage and ConvertHeaterCurrent for the controller. The low 8 bits of the counts
+*	are dropped so that the scaling fits in 32 bits.
+*
+*	Voltage: 1.17V * 28.92 / 2^24 counts = 33836mV / 2^24
+*	Current: 1170mV / 220mV/A / 2^24 counts = 5318mA / 2^24
+*/
+uint16_t HeaterVoltageMV(uint32_t InputCounts)
+{
+	return (uint16_t)(((InputCounts >> 8) * 33836ul) >> 16);
+}
+
+int16_t HeaterCurrentMA(uint32_t InputCounts)
+{
+	int32_t CountsFromZero;
+	
+	CountsFromZero = (int32_t)InputCounts - (int32_t)GetHeaterCurrentZero();
+	return (int16_t)(((CountsFromZero / 256) * 5318l) / 65536);
+}
+
+/** @} */
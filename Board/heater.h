@@ -0,0 +1,38 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Heater measurement conversion header file.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	These only depend on GetHeaterCurrentZero, so the host tools can link them with their own zero point.
+*
+*	@{
+*/
+
+#ifndef _HEATER_H_
+#define _HEATER_H_
+
+//Functions to convert meaurements into human readable output
+uint32_t ConvertHeaterVoltage(uint32_t InputCounts);
+int32_t ConvertHeaterCurrent(uint32_t InputCounts);
+uint16_t HeaterVoltageMV(uint32_t InputCounts);
+int16_t HeaterCurrentMA(uint32_t InputCounts);
+
+#endif
+/** @} */
@@ -25,6 +25,15 @@
 
 #include "main.h"
 
+static uint8_t MAX7315_OutputShadow = 0xFF;		//The last value written to MAX7315_REG_BLINK0
+
+//Transactions for MAX7315SetOutputsAsync. These are used in order, so a write only has to wait if all of them are still queued.
+static TWIBus_Transaction MAX7315_Writes[MAX7315_ASYNC_WRITES];
+static uint8_t MAX7315_WriteData[MAX7315_ASYNC_WRITES][2];
+static uint8_t MAX7315_NextWrite;
+
+static const uint8_t MAX7315_InputsReg = MAX7315_REG_INPUTS;
+
 //Returns an I2C status code, 0 if everything worked.
 uint8_t MAX7315Init( void )
 {
@@ -58,7 +67,7 @@ uint8_t MAX7315ReadReg(uint8_t RegToRead, uint8_t *RegData)
 	uint8_t stat;
 	if(MAX7315IsReg(RegToRead) == 1)
 	{
-		stat = TWIRW(MAX7315_SLA_7B, &RegToRead, RegData, 1, 1);
+		stat = TWIBus_ReadWrite(MAX7315_SLA_7B, &RegToRead, RegData, 1, 1);
 		
 		if(stat > 0)
 		{
@@ -78,12 +87,16 @@ uint8_t MAX7315WriteReg(uint8_t RegToWrite, uint8_t RegData)
 		WriteReg[0] = RegToWrite;
 		WriteReg[1] = RegData;
 		
-		stat = TWIRW(MAX7315_SLA_7B, WriteReg, &RegData, 2, 0);
+		stat = TWIBus_ReadWrite(MAX7315_SLA_7B, WriteReg, &RegData, 2, 0);
 		
 		if(stat > 0)
 		{
 			return stat;
 		}
+		if(RegToWrite == MAX7315_REG_BLINK0)
+		{
+			MAX7315_OutputShadow = RegData;
+		}
 		return 0;
 	}
 	return 0xFF;
@@ -103,7 +116,7 @@ uint8_t MAX7315ModifyReg(uint8_t RegToWrite, uint8_t BitData, uint8_t BitMask)
 
 	//Read the register
 	WriteReg[0] = RegToWrite;
-	stat = TWIRW(MAX7315_SLA_7B, WriteReg, &ReadReg, 1, 1);
+	stat = TWIBus_ReadWrite(MAX7315_SLA_7B, WriteReg, &ReadReg, 1, 1);
 	if(stat > 0)
 	{
 		return stat;
@@ -111,16 +124,59 @@ uint8_t MAX7315ModifyReg(uint8_t RegToWrite, uint8_t BitData, uint8_t BitMask)
 	
 	//Modify the register data and write back to the device
 	WriteReg[1] = (ReadReg & (~BitMask)) | BitData;
-	stat = TWIRW(MAX7315_SLA_7B, WriteReg, &ReadReg, 2, 0);
+	stat = TWIBus_ReadWrite(MAX7315_SLA_7B, WriteReg, &ReadReg, 2, 0);
 	
 	if(stat > 0)
 	{
 		return stat;
 	}
+	if(RegToWrite == MAX7315_REG_BLINK0)
+	{
+		MAX7315_OutputShadow = WriteReg[1];
+	}
 	
 	return 0;
 }
 
+void MAX7315SetOutputsAsync(uint8_t BitData, uint8_t BitMask)
+{
+	TWIBus_Transaction *Transaction;
+	uint8_t *WriteData;
+	
+	Transaction = &MAX7315_Writes[MAX7315_NextWrite];
+	WriteData = MAX7315_WriteData[MAX7315_NextWrite];
+	MAX7315_NextWrite = (MAX7315_NextWrite + 1) % MAX7315_ASYNC_WRITES;
+	
+	//Wait for the oldest write if it is still queued
+	TWIBus_Wait(Transaction);
+	
+	//Use the saved output state instead of reading the register, so this does not depend on writes that are still queued
+	MAX7315_OutputShadow = (MAX7315_OutputShadow & (~BitMask)) | BitData;
+	WriteData[0] = MAX7315_REG_BLINK0;
+	WriteData[1] = MAX7315_OutputShadow;
+	
+	Transaction->Address = MAX7315_SLA_7B;
+	Transaction->TxData = WriteData;
+	Transaction->TxLength = 2;
+	Transaction->RxData = NULL;
+	Transaction->RxLength = 0;
+	Transaction->Callback = NULL;
+	TWIBus_Submit(Transaction);
+	return;
+}
+
+void MAX7315ReadInputsAsync(uint8_t *RegData, TWIBus_Transaction *Transaction, void (*Callback)(TWIBus_Transaction *Transaction))
+{
+	Transaction->Address = MAX7315_SLA_7B;
+	Transaction->TxData = &MAX7315_InputsReg;
+	Transaction->TxLength = 1;
+	Transaction->RxData = RegData;
+	Transaction->RxLength = 1;
+	Transaction->Callback = Callback;
+	TWIBus_Submit(Transaction);
+	return;
+}
+
 uint8_t MAX7315IsReg(uint8_t reg)
 {
 	if((reg == 0x00) || (reg == 0x01) || (reg == 0x03) || (reg == 0x09) || (reg == 0x0E) || (reg == 0x0F) || (reg == 0x10) || (reg == 0x11) || (reg == 0x12) || (reg == 0x13))
@@ -28,6 +28,8 @@
 #ifndef _MAX7315_H_
 #define _MAX7315_H_
 
+#include "twibus.h"
+
 //The 7-bit i2c slave address (note: this can be different based on the device connections)
 #define MAX7315_SLA_7B				0x20
 
@@ -43,6 +45,9 @@
 #define MAX7315_REG_INT54			0x12
 #define MAX7315_REG_INT76			0x13
 
+//Number of output writes that can be queued by MAX7315SetOutputsAsync
+#define MAX7315_ASYNC_WRITES		4
+
 
 //
 uint8_t MAX7315Init(void);
@@ -51,5 +56,11 @@ uint8_t MAX7315WriteReg(uint8_t RegToWrite, uint8_t RegData);
 uint8_t MAX7315ModifyReg(uint8_t RegToWrite, uint8_t BitData, uint8_t BitMask);
 uint8_t MAX7315IsReg(uint8_t reg);
 
+/** Set the bits in 'BitMask' of the output register (MAX7315_REG_BLINK0) to 'BitData' and return without waiting for the write. */
+void MAX7315SetOutputsAsync(uint8_t BitData, uint8_t BitMask);
+
+/** Queue a read of the inputs register. 'Callback' is called from the TWI interrupt when 'RegData' is valid. 'RegData' and 'Transaction' must stay valid until then. */
+void MAX7315ReadInputsAsync(uint8_t *RegData, TWIBus_Transaction *Transaction, void (*Callback)(TWIBus_Transaction *Transaction));
+
 #endif
 /** @} */
\ No newline at end of file
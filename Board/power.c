@@ -0,0 +1,306 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Sleep between scheduled work and keep track of where the time goes.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+#include <avr/sleep.h>
+#include <util/delay.h>
+
+#define POWER_TIMER_WRAP			(60000ul*POWER_TIMER_TICKS_PER_MS)		//ElapsedMS counts to 60000 then resets
+#define POWER_DATAFLASH_WAKE_US		35										//Deep power down recovery time (tRDPD)
+
+extern volatile uint16_t ElapsedMS;
+
+static uint8_t PowerMode = POWER_MODE_AUTO;
+static volatile uint8_t WakeRequested;
+static volatile uint16_t RTCTicks;
+static volatile uint32_t LastTickTime;			//Timer 0 time of the last RTC tick
+
+//Time accounting
+static uint32_t LastTransition;
+static uint32_t TimeMS[POWER_NUMBER_OF_STATES];
+static uint8_t TimeRemainder[POWER_NUMBER_OF_STATES];		//Timer ticks left over after the last full ms
+static uint32_t Sleeps[POWER_NUMBER_OF_STATES];
+
+//Latency measurement
+static volatile uint8_t SampleIsDue;
+static volatile uint32_t SampleDueTime;
+static uint16_t Samples;
+static uint32_t StartLatency;
+static uint32_t StartLatencyMax;
+static uint32_t SampleLatency;
+static uint32_t SampleLatencyMax;
+
+static uint32_t Power_Now(void);
+static uint32_t Power_Elapsed(uint32_t From, uint32_t To);
+static void Power_AddTime(uint8_t State, uint32_t Ticks);
+
+void Power_SetMode(uint8_t Mode)
+{
+	if(Mode <= POWER_MODE_AUTO)
+	{
+		PowerMode = Mode;
+	}
+	return;
+}
+
+uint8_t Power_GetMode(void)
+{
+	return PowerMode;
+}
+
+void Power_Sleep(void)
+{
+	uint8_t SleepState;
+	uint16_t RTCTicksAtSleep;
+	uint32_t SleepStart;
+	uint32_t WakeTime;
+	uint32_t TickPhaseMS;
+	uint32_t SaveMS;
+
+	if(PowerMode == POWER_MODE_OFF)
+	{
+		return;
+	}
+
+	//Interrupts stay off from here until the sleep instruction so that a wake request can not be missed
+	cli();
+	if(WakeRequested == 1)
+	{
+		WakeRequested = 0;
+		sei();
+		return;
+	}
+
+	//Power save stops the TWI and SPI clocks, so it can only be used with both buses idle. It also stops timer 1, which
+	//times the boot. The dataflash ignores the deep power down command while it is busy.
+	SleepState = POWER_STATE_IDLE;
+	if((PowerMode == POWER_MODE_AUTO) && (USB_DeviceState == DEVICE_STATE_Unattached) && (TWIBus_Idle() == 1) && (SPIBus_Idle() == 1) &&
+	   (Boot_Active() == 0))
+	{
+		if((AT45DB321D_ReadStatus() & AT45DB321D_STATUS_READY_MASK) == AT45DB321D_STATUS_READY_MASK)
+		{
+			AT45DB321D_Powerdown();
+			SleepState = POWER_STATE_SAVE;
+		}
+	}
+
+	SleepStart = Power_Now();
+	Power_AddTime(POWER_STATE_RUN, Power_Elapsed(LastTransition, SleepStart));
+	RTCTicksAtSleep = RTCTicks;
+	TickPhaseMS = Power_Elapsed(LastTickTime, SleepStart) / POWER_TIMER_TICKS_PER_MS;
+	Sleeps[SleepState]++;
+
+	if(SleepState == POWER_STATE_SAVE)
+	{
+		set_sleep_mode(SLEEP_MODE_PWR_SAVE);
+	}
+	else
+	{
+		set_sleep_mode(SLEEP_MODE_IDLE);
+	}
+	sleep_enable();
+	sei();				//The instruction after sei always runs before any interrupt
+	sleep_cpu();
+	sleep_disable();
+
+	WakeTime = Power_Now();
+	Power_AddTime(SleepState, Power_Elapsed(SleepStart, WakeTime));
+	if(SleepState == POWER_STATE_SAVE)
+	{
+		//Timer 0 did not run while asleep. The first RTC tick came TickPhaseMS short of a whole tick.
+		SaveMS = (uint32_t)(uint16_t)(RTCTicks - RTCTicksAtSleep) * POWER_RTC_TICK_MS;
+		if(SaveMS > TickPhaseMS)
+		{
+			TimeMS[POWER_STATE_SAVE] += SaveMS - TickPhaseMS;
+		}
+
+		AT45DB321D_Powerup();
+		_delay_us(POWER_DATAFLASH_WAKE_US);
+	}
+	LastTransition = Power_Now();
+	Power_AddTime(SleepState, Power_Elapsed(WakeTime, LastTransition));
+	return;
+}
+
+void Power_RequestWake(void)
+{
+	WakeRequested = 1;
+	return;
+}
+
+void Power_RTCTick(void)
+{
+	RTCTicks++;
+	LastTickTime = Power_Now();
+	return;
+}
+
+void Power_SampleDue(void)
+{
+	SampleDueTime = Power_Now();
+	SampleIsDue = 1;
+	WakeRequested = 1;
+	return;
+}
+
+void Power_SampleStart(void)
+{
+	if(SampleIsDue == 1)
+	{
+		StartLatency = Power_Elapsed(SampleDueTime, Power_Now());
+		if(StartLatency > StartLatencyMax)
+		{
+			StartLatencyMax = StartLatency;
+		}
+	}
+	return;
+}
+
+void Power_SampleDone(void)
+{
+	if(SampleIsDue == 1)
+	{
+		SampleLatency = Power_Elapsed(SampleDueTime, Power_Now());
+		if(SampleLatency > SampleLatencyMax)
+		{
+			SampleLatencyMax = SampleLatency;
+		}
+		Samples++;
+		SampleIsDue = 0;
+	}
+	return;
+}
+
+void Power_ADCSleep(void)
+{
+	if(PowerMode != POWER_MODE_OFF)
+	{
+		AD7794Powerdown();
+	}
+	return;
+}
+
+void Power_GetStats(Power_Stats *Stats)
+{
+	uint8_t i;
+	uint32_t Now;
+
+	//Count the time since the last wake up
+	Now = Power_Now();
+	Power_AddTime(POWER_STATE_RUN, Power_Elapsed(LastTransition, Now));
+	LastTransition = Now;
+
+	for(i=0; i<POWER_NUMBER_OF_STATES; i++)
+	{
+		Stats->TimeMS[i] = TimeMS[i];
+		Stats->Sleeps[i] = Sleeps[i];
+	}
+	Stats->Samples = Samples;
+	Stats->StartLatencyUS = StartLatency * POWER_US_PER_TIMER_TICK;
+	Stats->StartLatencyMaxUS = StartLatencyMax * POWER_US_PER_TIMER_TICK;
+	Stats->SampleLatencyUS = SampleLatency * POWER_US_PER_TIMER_TICK;
+	Stats->SampleLatencyMaxUS = SampleLatencyMax * POWER_US_PER_TIMER_TICK;
+	return;
+}
+
+void Power_ResetStats(void)
+{
+	uint8_t i;
+
+	for(i=0; i<POWER_NUMBER_OF_STATES; i++)
+	{
+		TimeMS[i] = 0;
+		TimeRemainder[i] = 0;
+		Sleeps[i] = 0;
+	}
+	Samples = 0;
+	StartLatency = 0;
+	StartLatencyMax = 0;
+	SampleLatency = 0;
+	SampleLatencyMax = 0;
+	LastTransition = Power_Now();
+	return;
+}
+
+//Returns the time in timer 0 ticks. Wraps at POWER_TIMER_WRAP.
+static uint32_t Power_Now(void)
+{
+	uint8_t OldSREG;
+	uint16_t MS;
+	uint8_t Count;
+	uint32_t Ticks;
+
+	OldSREG = SREG;
+	cli();
+	MS = ElapsedMS;
+	Count = TCNT0;
+
+	//The timer reset, but the interrupt has not run yet
+	if((TIFR0 & (1<<OCF0A)) != 0)
+	{
+		Count = TCNT0;
+		MS++;
+	}
+	SREG = OldSREG;
+
+	Ticks = ((uint32_t)MS * POWER_TIMER_TICKS_PER_MS) + Count;
+	if(Ticks >= POWER_TIMER_WRAP)
+	{
+		Ticks -= POWER_TIMER_WRAP;
+	}
+	return Ticks;
+}
+
+static uint32_t Power_Elapsed(uint32_t From, uint32_t To)
+{
+	if(To >= From)
+	{
+		return To - From;
+	}
+	return (To + POWER_TIMER_WRAP) - From;
+}
+
+static void Power_AddTime(uint8_t State, uint32_t Ticks)
+{
+	Ticks += TimeRemainder[State];
+	if(Ticks < (2*POWER_TIMER_TICKS_PER_MS))
+	{
+		//Most sleeps end on the next timer 0 interrupt, so skip the division
+		if(Ticks >= POWER_TIMER_TICKS_PER_MS)
+		{
+			TimeMS[State]++;
+			Ticks -= POWER_TIMER_TICKS_PER_MS;
+		}
+	}
+	else
+	{
+		TimeMS[State] += Ticks / POWER_TIMER_TICKS_PER_MS;
+		Ticks = Ticks % POWER_TIMER_TICKS_PER_MS;
+	}
+	TimeRemainder[State] = (uint8_t)Ticks;
+	return;
+}
+
+/** @} */
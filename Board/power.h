@@ -0,0 +1,99 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Sleep between scheduled work and keep track of where the time goes.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Power_Sleep is called at the end of the main loop. Any interrupt wakes the processor and the main loop runs again.
+*
+*	Timer 0 runs the USB stack, so the processor only uses idle sleep while USB is attached. With no USB host, power save
+*	sleep is used instead. Timer 0 and the TWI and SPI clocks stop in power save, so the processor only wakes on the RTC
+*	(INT3), the buttons (INT2) or a USB VBUS change, and the dataflash is put in deep power down until the processor wakes.
+*	The AD7794 is put in power down after each set of measurements in both modes.
+*
+*	Time awake and in idle sleep is measured with timer 0 (8us resolution). Timer 0 does not run in power save, so that
+*	time is counted in RTC ticks, less the part of the first tick that timer 0 saw go by before the sleep. A power save
+*	ended by the buttons or USB is only counted up to the last RTC tick in it. 'replay -d' checks the counts against a
+*	model of the board. The wake up latency is measured from the RTC interrupt that starts a scheduled sample, so it does
+*	not include the oscillator start up time set by the fuses.
+*
+*	@{
+*/
+
+#ifndef _POWER_H_
+#define _POWER_H_
+
+#include "stdint.h"
+
+//Power modes
+#define POWER_MODE_OFF				0		//Never sleep
+#define POWER_MODE_IDLE				1		//Idle sleep only
+#define POWER_MODE_AUTO				2		//Idle sleep while USB is attached, power save sleep otherwise
+
+//States for the time accounting
+#define POWER_STATE_RUN				0
+#define POWER_STATE_IDLE			1
+#define POWER_STATE_SAVE			2
+#define POWER_NUMBER_OF_STATES		3
+
+#define POWER_TIMER_TICKS_PER_MS	125		//Timer 0 counts per ms. This must match OCR0A + 1 in HardwareInit.
+#define POWER_US_PER_TIMER_TICK		(1000/POWER_TIMER_TICKS_PER_MS)
+#define POWER_RTC_TICK_MS			500		//INT3 triggers on both edges of the 1Hz square wave from the RTC
+
+typedef struct
+{
+	uint32_t TimeMS[POWER_NUMBER_OF_STATES];	//Time spent in each state
+	uint32_t Sleeps[POWER_NUMBER_OF_STATES];	//Number of times each sleep state was entered. Not used for POWER_STATE_RUN.
+	uint16_t Samples;							//Number of scheduled samples measured
+	uint32_t StartLatencyUS;					//Time from the RTC interrupt to the start of the last sample
+	uint32_t StartLatencyMaxUS;
+	uint32_t SampleLatencyUS;					//Time from the RTC interrupt to the end of the last sample
+	uint32_t SampleLatencyMaxUS;
+} Power_Stats;
+
+/** Set the power mode to one of POWER_MODE_*. */
+void Power_SetMode(uint8_t Mode);
+uint8_t Power_GetMode(void);
+
+/** Sleep until the next interrupt. Returns right away if the mode is POWER_MODE_OFF or if Power_RequestWake was called
+ *	since the last call to this function. */
+void Power_Sleep(void);
+
+/** Make the next call to Power_Sleep return without sleeping. Call this from interrupts that leave work for the main loop. */
+void Power_RequestWake(void);
+
+/** Called from the RTC interrupt on every tick. */
+void Power_RTCTick(void);
+
+/** Called from the RTC interrupt when a scheduled sample is due. Starts the latency measurement. */
+void Power_SampleDue(void);
+
+/** Called by the main loop just before and just after the scheduled sample is taken. */
+void Power_SampleStart(void);
+void Power_SampleDone(void);
+
+/** Put the AD7794 in power down after a set of measurements, unless the mode is POWER_MODE_OFF. */
+void Power_ADCSleep(void);
+
+/** Get the time in each state and the latency measurements. */
+void Power_GetStats(Power_Stats *Stats);
+void Power_ResetStats(void);
+
+#endif
+/** @} */
@@ -0,0 +1,83 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Heater current RMS, mean, peak and crest factor from a burst of fast conversions.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+
+static Ripple_Sums Sums;
+static uint32_t Zero;				//Of the current sensor, for the burst running
+static Ripple_Result Latest;		//Of the latest burst with the relay on
+
+static void Ripple_Sample(uint32_t Counts);
+
+uint8_t Ripple_Burst(Ripple_Result *Result)
+{
+	uint8_t Relay;
+
+	Relay = PORTD & (1<<6);
+	Zero = GetHeaterCurrentZero();
+	Ripple_Init(&Sums);
+	Acquire_Burst(CHANNEL_HEATER_CURRENT, RIPPLE_RATE, RIPPLE_SAMPLES, Ripple_Sample);
+	Ripple_Finish(&Sums, Result);
+
+	if((PORTD & (1<<6)) != Relay)
+	{
+		return ACQUIRE_RELAY_SWITCHED;
+	}
+	if(Relay == 0)
+	{
+		return 0;
+	}
+	if(Result->Samples == RIPPLE_SAMPLES)
+	{
+		Latest = *Result;
+	}
+	return 1;
+}
+
+uint32_t Ripple_Get(void)
+{
+	Ripple_Result Result;
+
+	if((PORTD & (1<<6)) != 0)
+	{
+		Ripple_Burst(&Result);
+	}
+	return Latest.RMS;
+}
+
+void Ripple_GetLatest(Ripple_Result *Result)
+{
+	*Result = Latest;
+	return;
+}
+
+//Called by Acquire_Burst for each conversion
+static void Ripple_Sample(uint32_t Counts)
+{
+	Ripple_Add(&Sums, (int32_t)Counts - (int32_t)Zero);
+	return;
+}
+
+/** @} */
@@ -0,0 +1,208 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Heater current RMS, mean, peak and crest factor from a burst of fast conversions.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	A single conversion of the heater current is a random point on any ripple of the supply. A burst converts AIN1
+*	RIPPLE_SAMPLES times in a row, in continuous mode at RIPPLE_RATE, which is 470 samples per second for about 135ms. Each
+*	conversion is taken from the zero of the current sensor and added to running sums: the count, the sum, the sum of
+*	squares and the largest magnitude. Nothing else is kept, so the memory does not grow with the burst. At the end of the
+*	burst the sums give:
+*		-Mean:		the DC current.
+*		-RMS:		the heating current, sqrt of the mean square.
+*		-Ripple:	the RMS of the current less its mean, sqrt(N*sum(x^2) - sum(x)^2)/N.
+*		-Peak:		the largest magnitude.
+*		-Crest:		Peak/RMS, in 0.01. A DC current has a crest factor of 1.00, a sine 1.41.
+*	The sums are in counts and use integer arithmetic only, with a 64 bit sum of squares and an integer square root. The
+*	results are scaled to 0.1mA at the end, the same units as ConvertHeaterCurrent. The AD7794 filter at 470Hz takes off
+*	some of the ripple over about 100Hz, so the ripple is the ripple as the AD7794 sees it.
+*
+*	GetData runs a burst for the HEATER_RMS channel when the relay is on. The results of the latest burst with the relay
+*	on all the way through are kept and logged, so the channel holds the heater current while the relay is off. The
+*	'ripple' command runs a burst at any time and shows all of the results.
+*
+*	A burst blocks. Every sample taken with the relay on spends about 135ms in it (64 periods of 470Hz, the first one
+*	twice), with the main loop and the A/D schedule held up meanwhile. The RTC interrupt, the safety cutoff and USB keep
+*	running. 'replay -n' gives the burst time on its own.
+*
+*	Ripple_Init, Ripple_Add and Ripple_Finish only depend on stdint.h so that they can be used by the host tools.
+*
+*	@{
+*/
+
+#ifndef _RIPPLE_H_
+#define _RIPPLE_H_
+
+#include "stdint.h"
+
+#define RIPPLE_SAMPLES			64		//Conversions in a burst. 127 at most, so the sum of 24 bit counts fits in 32 bits.
+#define RIPPLE_RATE				AD7794_MRL_UPDATE_RATE_470_HZ
+#define RIPPLE_SCALE			53182	//0.1mA for 2^24 counts: 1170mV / 220mV/A = 5.3182A
+#define RIPPLE_SCALE_SHIFT		24
+
+typedef struct
+{
+	uint16_t Samples;
+	int32_t Sum;					//Counts from the zero
+	uint64_t SumSquares;
+	uint32_t Peak;					//Largest magnitude, in counts
+} Ripple_Sums;
+
+typedef struct
+{
+	uint16_t Samples;
+	int32_t Mean;					//0.1mA
+	uint32_t RMS;					//0.1mA
+	uint32_t Ripple;				//0.1mA
+	uint32_t Peak;					//0.1mA
+	uint16_t Crest;					//0.01
+} Ripple_Result;
+
+/** Clear the sums for a new burst. */
+static inline void Ripple_Init(Ripple_Sums *Sums)
+{
+	Sums->Samples = 0;
+	Sums->Sum = 0;
+	Sums->SumSquares = 0;
+	Sums->Peak = 0;
+	return;
+}
+
+/** Add a conversion, in counts from the zero of the sensor. */
+static inline void Ripple_Add(Ripple_Sums *Sums, int32_t Counts)
+{
+	uint32_t Magnitude;
+
+	Magnitude = (Counts < 0) ? (uint32_t)(-Counts) : (uint32_t)Counts;
+	Sums->Samples++;
+	Sums->Sum += Counts;
+	Sums->SumSquares += (uint64_t)Magnitude * Magnitude;
+	if(Magnitude > Sums->Peak)
+	{
+		Sums->Peak = Magnitude;
+	}
+	return;
+}
+
+/** Integer square root, rounded to the nearest. */
+static inline uint32_t Ripple_Sqrt(uint64_t Value)
+{
+	uint64_t Bit;
+	uint64_t Root;
+
+	Root = 0;
+	Bit = (uint64_t)1 << 62;
+	while(Bit > Value)
+	{
+		Bit >>= 2;
+	}
+	while(Bit != 0)
+	{
+		if(Value >= (Root + Bit))
+		{
+			Value -= Root + Bit;
+			Root = (Root >> 1) + Bit;
+		}
+		else
+		{
+			Root >>= 1;
+		}
+		Bit >>= 2;
+	}
+
+	//Value is what is left of the square, so it is over Root + 0.5 squared if it is over Root
+	if(Value > Root)
+	{
+		Root++;
+	}
+	return (uint32_t)Root;
+}
+
+/** Counts to 0.1mA, rounded to the nearest. */
+static inline int32_t Ripple_Scale(int32_t Counts)
+{
+	int64_t Scaled;
+
+	Scaled = (int64_t)Counts * RIPPLE_SCALE;
+	if(Scaled < 0)
+	{
+		return -(int32_t)((-Scaled + ((int64_t)1 << (RIPPLE_SCALE_SHIFT - 1))) >> RIPPLE_SCALE_SHIFT);
+	}
+	return (int32_t)((Scaled + ((int64_t)1 << (RIPPLE_SCALE_SHIFT - 1))) >> RIPPLE_SCALE_SHIFT);
+}
+
+/** Work out the results from the sums. All zero if there are no samples. */
+static inline void Ripple_Finish(const Ripple_Sums *Sums, Ripple_Result *Result)
+{
+	uint32_t Samples;
+	int32_t Mean;
+	uint32_t RMS;
+	uint32_t Ripple;
+	uint64_t Spread;
+
+	Result->Samples = Sums->Samples;
+	Result->Mean = 0;
+	Result->RMS = 0;
+	Result->Ripple = 0;
+	Result->Peak = 0;
+	Result->Crest = 0;
+	if(Sums->Samples == 0)
+	{
+		return;
+	}
+	Samples = Sums->Samples;
+
+	//Signed division, rounded to the nearest
+	if(Sums->Sum < 0)
+	{
+		Mean = -(int32_t)(((uint32_t)(-Sums->Sum) + Samples/2) / Samples);
+	}
+	else
+	{
+		Mean = (int32_t)(((uint32_t)Sums->Sum + Samples/2) / Samples);
+	}
+	RMS = Ripple_Sqrt((Sums->SumSquares + Samples/2) / Samples);
+
+	//N*sum(x^2) - sum(x)^2 is N^2 times the variance, and is never negative
+	Spread = Samples * Sums->SumSquares - (uint64_t)((int64_t)Sums->Sum * Sums->Sum);
+	Ripple = (Ripple_Sqrt(Spread) + Samples/2) / Samples;
+
+	Result->Mean = Ripple_Scale(Mean);
+	Result->RMS = (uint32_t)Ripple_Scale((int32_t)RMS);
+	Result->Ripple = (uint32_t)Ripple_Scale((int32_t)Ripple);
+	Result->Peak = (uint32_t)Ripple_Scale((int32_t)Sums->Peak);
+	if(RMS != 0)
+	{
+		Result->Crest = (uint16_t)((Sums->Peak * 100 + RMS/2) / RMS);
+	}
+	return;
+}
+
+/** Run a burst now and get the results. Returns the relay state during the burst: 0, 1 or ACQUIRE_RELAY_SWITCHED. */
+uint8_t Ripple_Burst(Ripple_Result *Result);
+
+/** For GetData: runs a burst if the relay is on, and returns the RMS of the latest burst with the relay on in 0.1mA. */
+uint32_t Ripple_Get(void);
+
+/** Get the results of the latest burst with the relay on all the way through. */
+void Ripple_GetLatest(Ripple_Result *Result);
+
+#endif
+/** @} */
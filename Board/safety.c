@@ -0,0 +1,158 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Over temperature cutoff for the heater relay.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+
+static const uint8_t StatusBits[SAFETY_SENSORS] = {BH_STATUS_PROG_RED_HEATER_OVERTEMP, BH_STATUS_PROG_BLACK_HEATER_OVERTEMP,
+                                                   BH_STATUS_PROG_INT_HEATER_OVERTEMP};
+
+static uint8_t Limits[SAFETY_SENSORS];
+static uint32_t Thresholds[SAFETY_SENSORS];
+static volatile uint8_t Tripped;
+static volatile uint8_t Armed;
+static volatile uint8_t Age;				//RTC ticks since the last good thermistor reading
+static volatile uint8_t Stale;
+static volatile uint16_t StaleCuts;
+
+//The limits and thresholds are only used by the main loop
+void Safety_SetLimits(uint8_t Red, uint8_t Black, uint8_t Internal)
+{
+	uint8_t i;
+
+	Limits[SAFETY_RED] = Red;
+	Limits[SAFETY_BLACK] = Black;
+	Limits[SAFETY_INTERNAL] = Internal;
+	for(i=0; i<SAFETY_SENSORS; i++)
+	{
+		if((Limits[i] == 0) || (Limits[i] == 0xFF))
+		{
+			Limits[i] = (i == SAFETY_INTERNAL) ? SAFETY_DEFAULT_INTERNAL : SAFETY_DEFAULT_THERMISTOR;
+		}
+	}
+
+	Thresholds[SAFETY_RED] = ThermistorTempToCounts((int32_t)Limits[SAFETY_RED] * 10000);
+	Thresholds[SAFETY_BLACK] = ThermistorTempToCounts((int32_t)Limits[SAFETY_BLACK] * 10000);
+	Thresholds[SAFETY_INTERNAL] = AD7794InternalTempToCounts((int32_t)Limits[SAFETY_INTERNAL] * 10000);
+	return;
+}
+
+void Safety_Arm(uint8_t NewArmed)
+{
+	uint8_t i;
+
+	for(i=0; i<SAFETY_SENSORS; i++)
+	{
+		BH_SetStatus(BH_STATUS_PROG, StatusBits[i], 0);
+	}
+	Age = 0;
+	Stale = 0;
+	Tripped = 0;
+	Armed = NewArmed;
+	return;
+}
+
+void Safety_Check(uint8_t Sensor, uint32_t Counts)
+{
+	uint8_t Over;
+
+	//The thermistors read fewer counts as they get hotter
+	if(Sensor == SAFETY_INTERNAL)
+	{
+		Over = (Counts >= Thresholds[Sensor]) ? 1 : 0;
+	}
+	else
+	{
+		Over = (Counts <= Thresholds[Sensor]) ? 1 : 0;
+	}
+
+	if(Over == 1)
+	{
+		Relay(0);
+		Tripped |= (1<<Sensor);
+		BH_SetStatus(BH_STATUS_PROG, StatusBits[Sensor], 1);
+	}
+	else if((Sensor != SAFETY_INTERNAL) && (Counts < SAFETY_OPEN_COUNTS))
+	{
+		Age = 0;
+	}
+	return;
+}
+
+uint8_t Safety_Tick(void)
+{
+	if(Tripped != 0)
+	{
+		return 1;
+	}
+	if(Armed == 0)
+	{
+		return 0;
+	}
+
+	if(Age < 0xFF)
+	{
+		Age++;
+	}
+	if(Age > SAFETY_MAX_AGE)
+	{
+		if(Stale == 0)
+		{
+			Stale = 1;
+			StaleCuts++;
+		}
+		return 1;
+	}
+	Stale = 0;
+	return 0;
+}
+
+uint8_t Safety_GetTripped(void)
+{
+	return Tripped;
+}
+
+uint8_t Safety_GetLimit(uint8_t Sensor)
+{
+	return Limits[Sensor];
+}
+
+uint32_t Safety_GetThreshold(uint8_t Sensor)
+{
+	return Thresholds[Sensor];
+}
+
+uint16_t Safety_GetStaleCuts(void)
+{
+	uint16_t Cuts;
+	uint8_t OldSREG;
+
+	OldSREG = SREG;
+	cli();
+	Cuts = StaleCuts;
+	SREG = OldSREG;
+	return Cuts;
+}
+
+/** @} */
@@ -0,0 +1,80 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Over temperature cutoff for the heater relay.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	The limits in degrees C are turned into A/D counts once, when they are set, so each reading is checked with a single
+*	integer compare as soon as the conversion is read back (in Acquire_Convert and AD7794GetInternalTemp). The
+*	thermistors read fewer counts as they get hotter and the internal sensor reads more. A reading over the limit turns
+*	the relay off right away, sets the matching BH_STATUS_PROG_*_OVERTEMP bit and holds the relay off until the
+*	controller is started again.
+*
+*	The readings are taken by the main loop, which can be held up by a blocking command or a flash scan. While the
+*	controller is running, the RTC interrupt counts the ticks since the last good thermistor reading and holds the relay
+*	off once there has not been one for SAFETY_MAX_AGE ticks. A thermistor reading at full scale (open) is not a good
+*	reading. This does not latch, so the heater starts again with the next good reading.
+*
+*	The relay is off at most:
+*		-The period of the sensor in the channel table in acquire.c, plus one conversion, after a sensor goes over its limit
+*		 while the main loop runs.
+*		-SAFETY_MAX_AGE + 1 ticks after the main loop stops, whatever the temperature does.
+*
+*	@{
+*/
+
+#ifndef _SAFETY_H_
+#define _SAFETY_H_
+
+#include "stdint.h"
+
+//Sensors
+#define SAFETY_RED					0
+#define SAFETY_BLACK				1
+#define SAFETY_INTERNAL				2
+#define SAFETY_SENSORS				3
+
+#define SAFETY_MAX_AGE				20			//RTC ticks (10s), two samples
+#define SAFETY_OPEN_COUNTS			0xFFF000	//Thermistor readings at or above this are open
+#define SAFETY_DEFAULT_THERMISTOR	50			//deg C, used if the EEPROM limit is not set
+#define SAFETY_DEFAULT_INTERNAL		70
+
+/** Set the limits in deg C. 0 and 0xFF use the defaults. Floating point is only used here. */
+void Safety_SetLimits(uint8_t Red, uint8_t Black, uint8_t Internal);
+
+/** Clear the over temperature latch and start (1) or stop (0) holding the relay off when the readings stop. */
+void Safety_Arm(uint8_t Armed);
+
+/** Check one reading in raw counts. Called as soon as the conversion is read. */
+void Safety_Check(uint8_t Sensor, uint32_t Counts);
+
+/** Called from the RTC interrupt. Returns 1 if the relay must be off. */
+uint8_t Safety_Tick(void);
+
+/** The SAFETY_* sensors over their limit since the last Safety_Arm, one bit each. */
+uint8_t Safety_GetTripped(void);
+
+uint8_t Safety_GetLimit(uint8_t Sensor);
+uint32_t Safety_GetThreshold(uint8_t Sensor);
+
+/** Times the relay was held off because the readings stopped. */
+uint16_t Safety_GetStaleCuts(void);
+
+#endif
+/** @} */
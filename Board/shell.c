@@ -0,0 +1,262 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Command input: batching and macros in front of the command interpreter.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	beer_heater_main
+*
+*	@{
+*/
+
+#include "main.h"
+
+char EEMEM NV_MACROS[SHELL_MACROS][SHELL_MACRO_SIZE];		//Zero terminated. 0xFF if never saved.
+
+static volatile uint8_t Buffer[SHELL_BUFFER_SIZE];
+static volatile uint8_t Head;			//Written by the interrupt
+static volatile uint8_t Tail;			//Read by the main loop
+static uint8_t RunningMacro;			//Macro number + 1, 0 if none
+static uint8_t MacroPosition;
+
+static char Shell_Next(void);
+static void Shell_Wait(void);
+
+void Shell_Receive(void)
+{
+	int16_t Byte;
+
+	//Anything that does not fit is left in the endpoint until the next poll
+	while((uint8_t)(Head - Tail) < SHELL_BUFFER_SIZE)
+	{
+		Byte = CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
+		if(Byte < 0)
+		{
+			break;
+		}
+		if((Byte > 0) && (Byte < 255))
+		{
+			Buffer[Head & (SHELL_BUFFER_SIZE-1)] = (uint8_t)Byte;
+			Head++;
+		}
+	}
+	return;
+}
+
+void Shell_Task(void)
+{
+	char c;
+
+	for(;;)
+	{
+		c = Shell_Next();
+		if(c == 0)
+		{
+			return;
+		}
+		if(c == SHELL_SEPARATOR)
+		{
+			c = '\r';
+		}
+		CommandGetInputChar(c);
+		if((c == '\r') || (c == '\n'))
+		{
+			break;
+		}
+	}
+
+	//There is another command waiting, so do not sleep before the next pass
+	if((RunningMacro != 0) || (Head != Tail))
+	{
+		Power_RequestWake();
+	}
+	return;
+}
+
+char Shell_GetKey(void)
+{
+	char c;
+
+	for(;;)
+	{
+		c = Shell_Next();
+		if(c == 0)
+		{
+			Shell_Wait();
+			continue;
+		}
+		if((c != '\r') && (c != '\n') && (c != SHELL_SEPARATOR))
+		{
+			break;
+		}
+	}
+	return c;
+}
+
+uint8_t Shell_GetLine(char *Line, uint8_t Size)
+{
+	uint8_t Length;
+	char c;
+
+	Length = 0;
+	for(;;)
+	{
+		c = Shell_Next();
+		if(c == 0)
+		{
+			Shell_Wait();
+			continue;
+		}
+		if((c == '\r') || (c == '\n'))
+		{
+			//Skip what is left of the line end from the command that asked
+			if(Length == 0)
+			{
+				continue;
+			}
+			break;
+		}
+		if((c == '\b') || (c == 0x7F))
+		{
+			if(Length > 0)
+			{
+				Length--;
+				printf_P(PSTR("\b \b"));
+			}
+			continue;
+		}
+		if(Length < (Size - 1))
+		{
+			Line[Length] = c;
+			Length++;
+			printf_P(PSTR("%c"), c);
+		}
+	}
+	Line[Length] = 0;
+	printf_P(PSTR("\n"));
+	return Length;
+}
+
+uint8_t Shell_RunMacro(uint8_t Macro)
+{
+	uint8_t First;
+
+	if((Macro >= SHELL_MACROS) || (RunningMacro != 0))
+	{
+		return 1;
+	}
+	First = eeprom_read_byte((uint8_t *)&NV_MACROS[Macro][0]);
+	if((First == 0) || (First == 0xFF))
+	{
+		return 1;
+	}
+	RunningMacro = Macro + 1;
+	MacroPosition = 0;
+	Power_RequestWake();
+	return 0;
+}
+
+void Shell_SaveMacro(uint8_t Macro, const char *Line)
+{
+	uint8_t Length;
+
+	if(Macro >= SHELL_MACROS)
+	{
+		return;
+	}
+
+	//A separator at the end would run an empty command
+	Length = strlen(Line);
+	if(Length > (SHELL_MACRO_SIZE - 1))
+	{
+		Length = SHELL_MACRO_SIZE - 1;
+	}
+	while((Length > 0) && ((Line[Length-1] == SHELL_SEPARATOR) || (Line[Length-1] == ' ')))
+	{
+		Length--;
+	}
+	eeprom_update_block(Line, &NV_MACROS[Macro][0], Length);
+	eeprom_update_byte((uint8_t *)&NV_MACROS[Macro][Length], 0);
+	return;
+}
+
+uint8_t Shell_GetMacro(uint8_t Macro, char *Line)
+{
+	uint8_t Length;
+	uint8_t c;
+
+	Length = 0;
+	if(Macro < SHELL_MACROS)
+	{
+		while(Length < (SHELL_MACRO_SIZE - 1))
+		{
+			c = eeprom_read_byte((uint8_t *)&NV_MACROS[Macro][Length]);
+			if((c == 0) || (c == 0xFF))
+			{
+				break;
+			}
+			Line[Length] = c;
+			Length++;
+		}
+	}
+	Line[Length] = 0;
+	return Length;
+}
+
+//The next input character, from the running macro before the buffer. Returns 0 if there is none.
+static char Shell_Next(void)
+{
+	char c;
+
+	if(RunningMacro != 0)
+	{
+		c = 0;
+		if(MacroPosition < (SHELL_MACRO_SIZE - 1))
+		{
+			c = eeprom_read_byte((uint8_t *)&NV_MACROS[RunningMacro-1][MacroPosition]);
+		}
+		if((c == 0) || (c == (char)0xFF))
+		{
+			//The end of the macro ends its last command
+			RunningMacro = 0;
+			return '\r';
+		}
+		MacroPosition++;
+		return c;
+	}
+
+	if(Head == Tail)
+	{
+		return 0;
+	}
+	c = Buffer[Tail & (SHELL_BUFFER_SIZE-1)];
+	Tail++;
+	return c;
+}
+
+//Run the main loop tasks that can not wait for the user, so the controller keeps its samples and its check in, then
+//sleep until the next interrupt as the main loop does
+static void Shell_Wait(void)
+{
+	Stream_Flush();
+	TemperatureControllerTask();
+	AD7794CalibrateTask();
+	Power_Sleep();
+	return;
+}
+
+/** @} */
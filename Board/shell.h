@@ -0,0 +1,71 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Command input: batching and macros in front of the command interpreter.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	beer_heater_main
+*
+*	Timer 0 moves every byte waiting in the USB CDC endpoint into a buffer, so a whole USB packet is taken in one poll
+*	instead of one byte every 8ms. The main loop hands the buffer to the command interpreter one command at a time, just
+*	before RunCommand. A ';' ends a command the same as the enter key, so "relay 1;mem 6 1;temp" runs three commands
+*	back to back, one per pass through the main loop, without waiting for the host.
+*
+*	A macro is a line of commands saved in EEPROM. It is run by the "run" command and its commands are handed to the
+*	interpreter ahead of anything still in the buffer. A macro can not run another macro.
+*
+*	Commands that ask the user for a key or a line must use Shell_GetKey and Shell_GetLine. They take the answer from the
+*	running macro or the buffer, so "tempcal;1" answers the question asked by tempcal.
+*
+*	@{
+*/
+
+#ifndef _SHELL_H_
+#define _SHELL_H_
+
+#include "stdint.h"
+
+#define SHELL_BUFFER_SIZE			128			//Must be a power of 2
+#define SHELL_SEPARATOR				';'
+#define SHELL_MACROS				4
+#define SHELL_MACRO_SIZE			64			//Including the terminating zero
+
+/** Move the received bytes to the buffer. Called from the timer 0 interrupt. */
+void Shell_Receive(void);
+
+/** Hand the next command to the interpreter. Call right before RunCommand. */
+void Shell_Task(void);
+
+/** Wait for a key. Line ends and separators are skipped. The controller, the stream and the A/D calibration keep
+ *  running while it waits. */
+char Shell_GetKey(void);
+
+/** Wait for a line, up to the enter key. Separators are kept. Returns the length. The same tasks run as for
+ *  Shell_GetKey. */
+uint8_t Shell_GetLine(char *Line, uint8_t Size);
+
+/** Start running a macro. Returns 1 if it is not defined or a macro is already running. */
+uint8_t Shell_RunMacro(uint8_t Macro);
+
+/** Save a macro. An empty line deletes it. */
+void Shell_SaveMacro(uint8_t Macro, const char *Line);
+
+/** Read a macro into Line (SHELL_MACRO_SIZE bytes). Returns the length, 0 if it is not defined. */
+uint8_t Shell_GetMacro(uint8_t Macro, char *Line);
+
+#endif
+/** @} */
@@ -0,0 +1,317 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Queued transactions for the shared SPI bus.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+
+typedef struct
+{
+	volatile uint8_t *CSPort;
+	uint8_t CSMask;
+	uint8_t Priority;
+} SPIBus_Device;
+
+//Chip select and priority for each device. Indexed by SPIBUS_DEVICE_*.
+static const SPIBus_Device SPIBus_Devices[SPIBUS_NUMBER_OF_DEVICES] =
+{
+	{&AD7794_CS_PORT,		(1<<AD7794_CS_PIN),		SPIBUS_PRIORITY_HIGH},		//SPIBUS_DEVICE_AD7794
+	{&AT45DB321D_CS_PORT,	(1<<AT45DB321D_CS_PIN),	SPIBUS_PRIORITY_LOW},		//SPIBUS_DEVICE_AT45DB321D
+};
+
+static SPIBus_Transaction *QueueHead[SPIBUS_NUMBER_OF_PRIORITIES];
+static SPIBus_Transaction *QueueTail[SPIBUS_NUMBER_OF_PRIORITIES];
+static SPIBus_Transaction * volatile ActiveTransaction;
+static uint16_t ActiveByte;		//The byte of the active transaction that is being sent
+
+static uint8_t SPIBus_GetByte(SPIBus_Transaction *Transaction, uint16_t ByteNumber);
+static uint8_t SPIBus_Free(void);
+static void SPIBus_RunOwned(SPIBus_Transaction *Transaction, uint8_t OldSREG);
+static void SPIBus_RunDirect(SPIBus_Transaction *Transaction);
+static void SPIBus_StartNext(void);
+static void SPIBus_HandleByte(void);
+
+void SPIBus_InitTransaction(SPIBus_Transaction *Transaction, uint8_t Device)
+{
+	Transaction->Device = Device;
+	Transaction->HeaderLength = 0;
+	Transaction->TxData = NULL;
+	Transaction->RxData = NULL;
+	Transaction->DataLength = 0;
+	Transaction->Callback = NULL;
+	Transaction->Status = SPIBUS_STATUS_DONE;
+	Transaction->Next = NULL;
+	return;
+}
+
+void SPIBus_Submit(SPIBus_Transaction *Transaction)
+{
+	uint8_t OldSREG;
+	uint8_t Priority;
+
+	if((Transaction->HeaderLength + Transaction->DataLength) == 0)
+	{
+		Transaction->Status = SPIBUS_STATUS_DONE;
+		return;
+	}
+
+	//A short transaction on a free bus is sent now. At Fcpu/2 a byte goes out in less time than the interrupt for it takes.
+	OldSREG = SREG;
+	cli();
+	if(((Transaction->HeaderLength + Transaction->DataLength) <= SPIBUS_BURST_MAX) && (SPIBus_Free() != 0))
+	{
+		SPIBus_RunOwned(Transaction, OldSREG);
+		return;
+	}
+
+	Priority = SPIBus_Devices[Transaction->Device].Priority;
+	Transaction->Next = NULL;
+	Transaction->Status = SPIBUS_STATUS_QUEUED;
+	if(QueueHead[Priority] == NULL)
+	{
+		QueueHead[Priority] = Transaction;
+	}
+	else
+	{
+		QueueTail[Priority]->Next = Transaction;
+	}
+	QueueTail[Priority] = Transaction;
+
+	if(ActiveTransaction == NULL)
+	{
+		SPIBus_StartNext();
+	}
+	SREG = OldSREG;
+	return;
+}
+
+void SPIBus_Wait(SPIBus_Transaction *Transaction)
+{
+	while(Transaction->Status != SPIBUS_STATUS_DONE)
+	{
+		//Interrupts are off during HardwareInit, so the bus needs to be run from here
+		if(((SREG & (1<<SREG_I)) == 0) && ((SPSR & (1<<SPIF)) != 0))
+		{
+			SPIBus_HandleByte();
+		}
+	}
+	return;
+}
+
+void SPIBus_Transfer(SPIBus_Transaction *Transaction)
+{
+	uint8_t OldSREG;
+
+	OldSREG = SREG;
+	cli();
+	if(SPIBus_Free() == 0)
+	{
+		SREG = OldSREG;
+		SPIBus_Submit(Transaction);
+		SPIBus_Wait(Transaction);
+		return;
+	}
+
+	//The bus is free, so take it and run the transaction from here at full speed
+	SPIBus_RunOwned(Transaction, OldSREG);
+	return;
+}
+
+uint8_t SPIBus_Idle(void)
+{
+	if(ActiveTransaction == NULL)
+	{
+		return 1;
+	}
+	return 0;
+}
+
+//Returns the byte to send for byte number 'ByteNumber' of a transaction
+static uint8_t SPIBus_GetByte(SPIBus_Transaction *Transaction, uint16_t ByteNumber)
+{
+	if(ByteNumber < Transaction->HeaderLength)
+	{
+		return Transaction->Header[ByteNumber];
+	}
+	if(Transaction->TxData != NULL)
+	{
+		return Transaction->TxData[ByteNumber - Transaction->HeaderLength];
+	}
+	return 0x00;
+}
+
+//Returns 1 if no transaction is active or queued. Must be called with interrupts disabled.
+static uint8_t SPIBus_Free(void)
+{
+	uint8_t i;
+
+	if(ActiveTransaction != NULL)
+	{
+		return 0;
+	}
+	for(i=0; i<SPIBUS_NUMBER_OF_PRIORITIES; i++)
+	{
+		if(QueueHead[i] != NULL)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//Take the free bus and run a whole transaction with the burst functions, then start anything queued meanwhile. Must be
+//called with interrupts disabled, and puts SREG back to 'OldSREG' while the transaction runs and on return.
+static void SPIBus_RunOwned(SPIBus_Transaction *Transaction, uint8_t OldSREG)
+{
+	Transaction->Status = SPIBUS_STATUS_ACTIVE;
+	ActiveTransaction = Transaction;
+	SREG = OldSREG;
+
+	SPIBus_RunDirect(Transaction);
+
+	cli();
+	ActiveTransaction = NULL;
+	Transaction->Status = SPIBUS_STATUS_DONE;
+	if(Transaction->Callback != NULL)
+	{
+		Transaction->Callback(Transaction);
+	}
+	if(ActiveTransaction == NULL)
+	{
+		SPIBus_StartNext();
+	}
+	SREG = OldSREG;
+	return;
+}
+
+//Run a whole transaction with the burst functions. The caller must own the bus.
+static void SPIBus_RunDirect(SPIBus_Transaction *Transaction)
+{
+	uint16_t i;
+	uint8_t DataByte;
+	const SPIBus_Device *Device = &SPIBus_Devices[Transaction->Device];
+
+	*Device->CSPort &= ~Device->CSMask;
+	SPIBus_BurstWrite(Transaction->Header, Transaction->HeaderLength);
+
+	if((Transaction->TxData != NULL) && (Transaction->RxData != NULL))
+	{
+		SPIBus_BurstXfer(Transaction->TxData, Transaction->RxData, Transaction->DataLength);
+	}
+	else if(Transaction->TxData != NULL)
+	{
+		SPIBus_BurstWrite(Transaction->TxData, Transaction->DataLength);
+	}
+	else if(Transaction->RxData != NULL)
+	{
+		SPIBus_BurstRead(Transaction->RxData, Transaction->DataLength);
+	}
+	else
+	{
+		//Clock out zeros and throw away the data
+		for(i=0; i<Transaction->DataLength; i++)
+		{
+			SPIBus_BurstRead(&DataByte, 1);
+		}
+	}
+
+	*Device->CSPort |= Device->CSMask;
+	return;
+}
+
+//Start the first transaction in the highest priority queue. Must be called with interrupts disabled and no active transaction.
+static void SPIBus_StartNext(void)
+{
+	uint8_t i;
+	SPIBus_Transaction *Transaction;
+
+	for(i=0; i<SPIBUS_NUMBER_OF_PRIORITIES; i++)
+	{
+		if(QueueHead[i] != NULL)
+		{
+			Transaction = QueueHead[i];
+			QueueHead[i] = Transaction->Next;
+
+			Transaction->Status = SPIBUS_STATUS_ACTIVE;
+			ActiveTransaction = Transaction;
+			ActiveByte = 0;
+
+			*SPIBus_Devices[Transaction->Device].CSPort &= ~SPIBus_Devices[Transaction->Device].CSMask;
+			SPCR |= (1<<SPIE);
+			SPDR = SPIBus_GetByte(Transaction, 0);
+			return;
+		}
+	}
+
+	//Nothing left to send
+	SPCR &= ~(1<<SPIE);
+	return;
+}
+
+//Called when a byte has been sent
+static void SPIBus_HandleByte(void)
+{
+	uint8_t DataByte;
+	SPIBus_Transaction *Transaction = ActiveTransaction;
+
+	DataByte = SPDR;
+	if(Transaction == NULL)
+	{
+		return;
+	}
+
+	if((ActiveByte >= Transaction->HeaderLength) && (Transaction->RxData != NULL))
+	{
+		Transaction->RxData[ActiveByte - Transaction->HeaderLength] = DataByte;
+	}
+	ActiveByte++;
+
+	if(ActiveByte < (Transaction->HeaderLength + Transaction->DataLength))
+	{
+		SPDR = SPIBus_GetByte(Transaction, ActiveByte);
+		return;
+	}
+
+	//Transaction is done
+	*SPIBus_Devices[Transaction->Device].CSPort |= SPIBus_Devices[Transaction->Device].CSMask;
+	ActiveTransaction = NULL;
+	Transaction->Status = SPIBUS_STATUS_DONE;
+	if(Transaction->Callback != NULL)
+	{
+		Transaction->Callback(Transaction);
+	}
+
+	//The callback may have started a new transaction
+	if(ActiveTransaction == NULL)
+	{
+		SPIBus_StartNext();
+	}
+	return;
+}
+
+ISR(SPI_STC_vect)
+{
+	SPIBus_HandleByte();
+}
+
+/** @} */
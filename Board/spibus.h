@@ -0,0 +1,166 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Queued transactions for the shared SPI bus.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	The AD7794 and the AT45DB321D share the SPI bus. Drivers do not talk to the bus directly, they fill in a transaction and
+*	submit it here. Transactions are queued by the priority of the device and run from the SPI interrupt. Chip select is
+*	held for the whole transaction, so a transaction is never split, but a higher priority transaction will go ahead of
+*	any lower priority transactions that have not started yet.
+*
+*	A transaction is a header (command, address and dummy bytes) followed by an optional data phase. Bytes read during the
+*	header are discarded.
+*
+*	SPIBus_Transfer runs the transaction directly with the burst functions below if the bus is free, and only falls back
+*	to the queue if another transaction is running or waiting. The burst functions load the next byte while the current
+*	byte is shifting, so the bus runs back to back at the SPI clock rate. SPIBus_Submit does the same for a transaction of
+*	up to SPIBUS_BURST_MAX bytes, since at Fcpu/2 the interrupt for each byte costs several times the byte itself.
+*
+*	Interrupt handlers must not call SPIBus_Transfer or SPIBus_Wait, or any driver function that does (most of ad7794.c
+*	and at45db321d.c). If the interrupt comes while the main loop runs a transaction directly, the new transaction waits
+*	for one that can only finish once the handler returns, and the processor spins until the watchdog resets it. From an
+*	interrupt, only SPIBus_Submit with a callback may be used. This cannot be checked at run time, since SPIBus_Wait also
+*	runs with interrupts off during HardwareInit.
+*
+*	@{
+*/
+
+#ifndef _SPIBUS_H_
+#define _SPIBUS_H_
+
+#include "stdint.h"
+#include <avr/io.h>
+
+//Devices on the bus
+#define SPIBUS_DEVICE_AD7794			0
+#define SPIBUS_DEVICE_AT45DB321D		1
+#define SPIBUS_NUMBER_OF_DEVICES		2
+
+//Priorities. Lower numbers run first.
+#define SPIBUS_PRIORITY_HIGH			0		//A/D reads
+#define SPIBUS_PRIORITY_LOW				1		//Bulk flash transfers
+#define SPIBUS_NUMBER_OF_PRIORITIES		2
+
+#define SPIBUS_MAX_HEADER				8		//Longest header is the dataflash page read (opcode, 3 address bytes, 4 dummy bytes)
+#define SPIBUS_BURST_MAX				64		//Longest transaction SPIBus_Submit sends at once on a free bus, in bytes
+
+//Transaction status. A transaction that has never been submitted (all zeros) reads as done.
+#define SPIBUS_STATUS_DONE				0x00
+#define SPIBUS_STATUS_QUEUED			0x01
+#define SPIBUS_STATUS_ACTIVE			0x02
+
+typedef struct SPIBus_Transaction
+{
+	uint8_t Device;								//SPIBUS_DEVICE_*
+	uint8_t Header[SPIBUS_MAX_HEADER];			//Bytes sent before the data
+	uint8_t HeaderLength;
+	const uint8_t *TxData;						//Data to send after the header. If NULL, 0x00 is sent.
+	uint8_t *RxData;							//Data read after the header. If NULL, the data is discarded.
+	uint16_t DataLength;
+	void (*Callback)(struct SPIBus_Transaction *Transaction);	//Called from the SPI interrupt when the transaction is done. Can be NULL.
+	volatile uint8_t Status;					//SPIBUS_STATUS_*
+	struct SPIBus_Transaction *Next;			//Used by the queue
+} SPIBus_Transaction;
+
+/** Set up a transaction for 'Device' with no header, no data and no callback. */
+void SPIBus_InitTransaction(SPIBus_Transaction *Transaction, uint8_t Device);
+
+/** Add a transaction to the queue and return. The transaction must not be changed until its status is SPIBUS_STATUS_DONE.
+ *	If the bus is free and the transaction is SPIBUS_BURST_MAX bytes or less, it is sent before this returns, and the
+ *	callback is called from here. This is the only way to start a transaction from an interrupt handler. */
+void SPIBus_Submit(SPIBus_Transaction *Transaction);
+
+/** Wait for a submitted transaction to finish. If interrupts are disabled, the bus is run by polling. Never call this
+ *	from an interrupt handler. */
+void SPIBus_Wait(SPIBus_Transaction *Transaction);
+
+/** Submit a transaction and wait for it to finish. Never call this from an interrupt handler. */
+void SPIBus_Transfer(SPIBus_Transaction *Transaction);
+
+/** Returns 1 if there are no active or queued transactions. */
+uint8_t SPIBus_Idle(void);
+
+//Burst transfers. These talk to the SPI hardware directly and must only be used by the owner of the bus (chip select
+//already set and SPI interrupts off). Each one returns with SPIF cleared.
+
+/** Send 'Length' bytes. The data read back is discarded. */
+static inline void SPIBus_BurstWrite(const uint8_t *Data, uint16_t Length)
+{
+	uint8_t NextByte;
+
+	if(Length == 0)
+	{
+		return;
+	}
+	SPDR = *Data++;
+	while(--Length)
+	{
+		NextByte = *Data++;					//Fetch the next byte while this one shifts out
+		while((SPSR & (1<<SPIF)) == 0) {}
+		SPDR = NextByte;
+	}
+	while((SPSR & (1<<SPIF)) == 0) {}
+	NextByte = SPDR;						//Clear SPIF
+	return;
+}
+
+/** Read 'Length' bytes. 0x00 is sent for each byte. */
+static inline void SPIBus_BurstRead(uint8_t *Data, uint16_t Length)
+{
+	if(Length == 0)
+	{
+		return;
+	}
+	SPDR = 0x00;
+	while(--Length)
+	{
+		while((SPSR & (1<<SPIF)) == 0) {}
+		SPDR = 0x00;						//Start the next byte, then save the one just received
+		*Data++ = SPDR;
+	}
+	while((SPSR & (1<<SPIF)) == 0) {}
+	*Data = SPDR;
+	return;
+}
+
+/** Send 'Length' bytes from 'TxData' and save the bytes read to 'RxData'. */
+static inline void SPIBus_BurstXfer(const uint8_t *TxData, uint8_t *RxData, uint16_t Length)
+{
+	uint8_t NextByte;
+
+	if(Length == 0)
+	{
+		return;
+	}
+	SPDR = *TxData++;
+	while(--Length)
+	{
+		NextByte = *TxData++;
+		while((SPSR & (1<<SPIF)) == 0) {}
+		SPDR = NextByte;
+		*RxData++ = SPDR;
+	}
+	while((SPSR & (1<<SPIF)) == 0) {}
+	*RxData = SPDR;
+	return;
+}
+
+#endif
+/** @} */
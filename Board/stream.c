@@ -0,0 +1,229 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Push samples to the USB host as they are taken.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+
+Stream_Deadbands EEMEM NV_STREAM_DEADBANDS = { .Layout = STREAM_DEADBANDS_LAYOUT, .Heartbeat = { [0 ... (STREAM_FIELDS-1)] = STREAM_DEFAULT_HEARTBEAT } };
+
+static Stream_Deadbands Deadbands;
+static Stream_FilterState Filter;
+static uint8_t Frame[STREAM_FRAME_SIZE];
+static uint8_t FrameLength;					//Bytes in Frame, 0 once it has gone out
+static uint8_t Period;
+static uint8_t Format;
+static uint8_t SamplesToFrame;
+static uint16_t Sequence;
+static uint16_t Sent;
+static uint16_t Dropped;
+
+static uint8_t Stream_BuildCSV(const uint32_t Values[], uint8_t Mask, uint8_t Relay);
+static uint8_t Stream_BuildBinary(const uint32_t Values[], uint8_t Mask, uint8_t Relay);
+
+void Stream_Init(void)
+{
+	uint8_t i;
+
+	eeprom_read_block(&Deadbands, &NV_STREAM_DEADBANDS, sizeof(Stream_Deadbands));
+	for(i=0; i<STREAM_FIELDS; i++)
+	{
+		//Saved with another set of fields, or never saved
+		if((Deadbands.Layout != STREAM_DEADBANDS_LAYOUT) || (Deadbands.Heartbeat[i] == STREAM_HEARTBEAT_ERASED))
+		{
+			Deadbands.Deadband[i] = STREAM_DEFAULT_DEADBAND;
+			Deadbands.Heartbeat[i] = STREAM_DEFAULT_HEARTBEAT;
+		}
+	}
+	Deadbands.Layout = STREAM_DEADBANDS_LAYOUT;
+	return;
+}
+
+void Stream_Start(uint8_t NewPeriod, uint8_t NewFormat)
+{
+	FrameLength = 0;
+	Period = NewPeriod;
+	Format = NewFormat;
+	SamplesToFrame = 1;
+	memset(&Filter, 0, sizeof(Filter));
+	Sequence = 0;
+	Sent = 0;
+	Dropped = 0;
+	return;
+}
+
+uint8_t Stream_Active(void)
+{
+	return (Period != 0) ? 1 : 0;
+}
+
+void Stream_Sample(const uint8_t Dataset[], int32_t Temperature, uint8_t Relay)
+{
+	uint32_t Values[STREAM_FIELDS];
+	uint8_t Length;
+	uint8_t Mask;
+
+	if(Period == 0)
+	{
+		return;
+	}
+	SamplesToFrame--;
+	if(SamplesToFrame > 0)
+	{
+		return;
+	}
+	SamplesToFrame = Period;
+
+	//The last frame is still waiting for the main loop to send it
+	if((FrameLength != 0) || (USB_DeviceState != DEVICE_STATE_Configured))
+	{
+		Dropped++;
+	}
+	else
+	{
+		//Only a frame that is sent moves the deadbands
+		Channels_Unpack(Dataset, Values);
+		Values[STREAM_FIELD_TEMPERATURE] = (uint32_t)Temperature;
+		Mask = Stream_Filter(&Deadbands, &Filter, Values);
+		if(Format == STREAM_FORMAT_BINARY)
+		{
+			Length = Stream_BuildBinary(Values, Mask, Relay);
+		}
+		else
+		{
+			Length = Stream_BuildCSV(Values, Mask, Relay);
+		}
+		FrameLength = Length;
+		Sent++;
+	}
+	Sequence++;
+	return;
+}
+
+void Stream_Flush(void)
+{
+	if(FrameLength == 0)
+	{
+		return;
+	}
+	if(USB_DeviceState != DEVICE_STATE_Configured)
+	{
+		FrameLength = 0;
+		return;
+	}
+
+	//The whole frame is written at once from the main loop, so nothing printed by the main loop can land inside it. Like
+	//printf, this waits for the host to take a full bank, up to the LUFA stream timeout.
+	if(CDC_Device_SendData(&VirtualSerial_CDC_Interface, (const char *)Frame, FrameLength) != ENDPOINT_RWSTREAM_NoError)
+	{
+		Sent--;
+		Dropped++;
+	}
+	FrameLength = 0;
+	return;
+}
+
+void Stream_GetStats(Stream_Stats *Stats)
+{
+	Stats->Period = Period;
+	Stats->Format = Format;
+	Stats->Sequence = Sequence;
+	Stats->Sent = Sent;
+	Stats->Dropped = Dropped;
+	return;
+}
+
+void Stream_SetDeadband(uint8_t Field, uint32_t Deadband, uint8_t Heartbeat)
+{
+	if((Field >= STREAM_FIELDS) || (Heartbeat == STREAM_HEARTBEAT_ERASED))
+	{
+		return;
+	}
+	Deadbands.Deadband[Field] = Deadband;
+	Deadbands.Heartbeat[Field] = Heartbeat;
+	eeprom_update_block(&Deadbands, &NV_STREAM_DEADBANDS, sizeof(Stream_Deadbands));
+	return;
+}
+
+void Stream_GetDeadbands(Stream_Deadbands *Copy)
+{
+	memcpy(Copy, &Deadbands, sizeof(Stream_Deadbands));
+	return;
+}
+
+static uint8_t Stream_BuildCSV(const uint32_t Values[], uint8_t Mask, uint8_t Relay)
+{
+	uint8_t Length;
+	uint8_t i;
+
+	Length = sprintf_P((char *)Frame, PSTR("@%u,"), Sequence);
+	if((Mask & (1<<STREAM_FIELD_TEMPERATURE)) != 0)
+	{
+		Length += sprintf_P((char *)&Frame[Length], PSTR("%ld"), (long)(int32_t)Values[STREAM_FIELD_TEMPERATURE]);
+	}
+	Length += sprintf_P((char *)&Frame[Length], PSTR(",%u"), Relay);
+	for(i=0; i<CHANNEL_COUNT; i++)
+	{
+		Frame[Length] = ',';
+		Length++;
+		if((Mask & (1<<i)) != 0)
+		{
+			Length += sprintf_P((char *)&Frame[Length], PSTR("%lu"), (unsigned long)Values[i]);
+		}
+	}
+	Frame[Length] = '\r';
+	Frame[Length+1] = '\n';
+	return Length + 2;
+}
+
+#define STREAM_PUT_CHANNEL(Name, Bytes, Read, Convert)		if((Mask & (1<<CHANNEL_##Name)) != 0) { Channels_PutValue(Frame, Length, (Bytes), Values[CHANNEL_##Name]); Length += (Bytes); }
+static uint8_t Stream_BuildBinary(const uint32_t Values[], uint8_t Mask, uint8_t Relay)
+{
+	uint8_t Length;
+	uint8_t Check;
+	uint8_t i;
+
+	Frame[0] = STREAM_SYNC_1;
+	Frame[1] = STREAM_SYNC_2;
+	Frame[2] = Stream_BinarySize(Mask) - 3;
+	Channels_PutValue(Frame, 3, 2, Sequence);
+	Frame[5] = Relay;
+	Frame[6] = Mask;
+	Length = STREAM_BINARY_HEADER;
+	if((Mask & (1<<STREAM_FIELD_TEMPERATURE)) != 0)
+	{
+		Channels_PutValue(Frame, Length, 4, Values[STREAM_FIELD_TEMPERATURE]);
+		Length += 4;
+	}
+	CHANNEL_LIST(STREAM_PUT_CHANNEL)
+
+	Check = 0;
+	for(i=2; i<Length; i++)
+	{
+		Check += Frame[i];
+	}
+	Frame[Length] = ~Check;
+	return Length + 1;
+}
+
+/** @} */
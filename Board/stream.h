@@ -0,0 +1,182 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Push samples to the USB host as they are taken.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	While a stream is on, every Period'th data set taken by TemperatureControllerTask is sent to the host as one frame.
+*	Samples are taken every 5 seconds, whether or not the controller is on, so that is the fastest rate. No extra
+*	conversions are started for the stream.
+*
+*	A frame is built in a buffer and written to the CDC IN endpoint in one piece by Stream_Flush, which the main loop calls
+*	after each command. Everything else that is printed comes from the main loop too, so it goes out before or after a
+*	frame, never inside one. The frame waits for the host like printf does. If the host does not take it within the LUFA
+*	stream timeout, or the last frame has not been written when the next one is due, the frame is dropped. Every frame
+*	that is due gets the next sequence number, sent or not, so the host can count the drops.
+*
+*	Each field (the channels, and the fused temperature as field STREAM_FIELD_TEMPERATURE) is only sent when it has
+*	moved more than its deadband since it was last sent, or when it has not been sent for its heartbeat number of frames.
+*	This is done on the raw counts from GetData with integer math, in Stream_Filter. The deadbands are kept in EEPROM.
+*	With the defaults (deadband 0, heartbeat 1) every field is sent in every frame.
+*
+*	The deadbands in EEPROM start with STREAM_DEADBANDS_LAYOUT, which holds STREAM_FIELDS. A channel added to
+*	CHANNEL_LIST changes the size and layout of Stream_Deadbands, so deadbands saved by older firmware do not match it and
+*	are all put back to the defaults at boot. They have to be set again with 'deadband'. Stream_Deadbands is the last
+*	EEMEM variable in the link order of the makefile, so nothing else in EEPROM moves when it grows.
+*
+*	Formats:
+*		-CSV: "@<sequence>,<temperature>,<relay>,<channel 0>,...,<channel n>\r\n". The temperature is the fused
+*		 temperature in 0.0001 deg C. The channels are the raw values, in CHANNEL_LIST order. A field that is not sent is
+*		 left empty.
+*		-Binary: STREAM_SYNC_1, STREAM_SYNC_2, length, sequence (2 bytes), relay, field mask, temperature (4 bytes), then
+*		 each channel with the bytes given in CHANNEL_LIST, then the check. The temperature and channels are only there if
+*		 their bit is set in the mask. Values are MSB first. The length counts the bytes from the sequence to the check.
+*		 The check is the inverted sum of the length through the last channel.
+*
+*	Output from a command goes out between frames, so the host has to find the start of each frame again after it.
+*
+*	This file is also used by the host tools, so it must only depend on stdint.h and channels.h.
+*
+*	@{
+*/
+
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+#include "stdint.h"
+#include "channels.h"
+
+#define STREAM_FORMAT_CSV			0
+#define STREAM_FORMAT_BINARY		1
+
+#define STREAM_SYNC_1				0xA5
+#define STREAM_SYNC_2				0x5A
+#define STREAM_BINARY_HEADER		7										//Sync to mask
+#define STREAM_BINARY_SIZE			(STREAM_BINARY_HEADER + 4 + CHANNEL_DATA_SIZE + 1)	//Longest binary frame
+#define STREAM_FRAME_SIZE			(24 + 11*CHANNEL_COUNT)					//Longest CSV frame
+
+//Fields for the deadbands. The channels come first.
+#define STREAM_FIELD_TEMPERATURE	CHANNEL_COUNT
+#define STREAM_FIELDS				(CHANNEL_COUNT + 1)						//Must fit in the 8 bit mask
+
+//The mask in a frame is one byte. A channel past bit 7 would drop out of every frame, so the build fails instead.
+//CHANNEL_COUNT is an enum, which #if can not see.
+typedef char Stream_MaskFits[(STREAM_FIELDS <= 8) ? 1 : -1];
+
+#define STREAM_DEFAULT_DEADBAND		0
+#define STREAM_DEFAULT_HEARTBEAT	1
+#define STREAM_HEARTBEAT_ERASED		0xFF
+#define STREAM_DEADBANDS_LAYOUT		(0x5300 | STREAM_FIELDS)				//Tags the deadbands in EEPROM
+
+#define STREAM_SAMPLE_PERIOD_S		5
+
+typedef struct
+{
+	uint16_t Layout;					//STREAM_DEADBANDS_LAYOUT in EEPROM. Not used by Stream_Filter.
+	uint32_t Deadband[STREAM_FIELDS];	//Counts, or 0.0001 deg C for the temperature. A change of more than this is sent.
+	uint8_t Heartbeat[STREAM_FIELDS];	//Frames before an unchanged field is sent anyway. 0 for never.
+} Stream_Deadbands;
+
+typedef struct
+{
+	uint32_t Last[STREAM_FIELDS];		//The value last sent
+	uint8_t Age[STREAM_FIELDS];			//Frames since it was sent
+	uint8_t Started;					//0 until the first frame, which sends everything
+} Stream_FilterState;
+
+typedef struct
+{
+	uint8_t Period;				//Samples per frame, 0 if the stream is off
+	uint8_t Format;
+	uint16_t Sequence;			//The next sequence number
+	uint16_t Sent;
+	uint16_t Dropped;
+} Stream_Stats;
+
+/** Pick the fields to send. Values holds the channels then the temperature. Returns the mask, bit i for field i. */
+static inline uint8_t Stream_Filter(const Stream_Deadbands *Deadbands, Stream_FilterState *State, const uint32_t Values[])
+{
+	uint32_t Change;
+	uint8_t Mask;
+	uint8_t i;
+
+	Mask = 0;
+	for(i=0; i<STREAM_FIELDS; i++)
+	{
+		//The difference is taken as signed, so this works for the temperature too
+		Change = Values[i] - State->Last[i];
+		if((int32_t)Change < 0)
+		{
+			Change = -Change;
+		}
+		if(State->Age[i] < 0xFF)
+		{
+			State->Age[i]++;
+		}
+		if((State->Started == 0) || (Change > Deadbands->Deadband[i]) ||
+		   ((Deadbands->Heartbeat[i] != 0) && (State->Age[i] >= Deadbands->Heartbeat[i])))
+		{
+			Mask |= (1<<i);
+			State->Last[i] = Values[i];
+			State->Age[i] = 0;
+		}
+	}
+	State->Started = 1;
+	return Mask;
+}
+
+/** The size of a binary frame with the fields in 'Mask'. */
+#define STREAM_FIELD_BYTES(Name, Bytes, Read, Convert)		if((Mask & (1<<CHANNEL_##Name)) != 0) { Size += (Bytes); }
+static inline uint8_t Stream_BinarySize(uint8_t Mask)
+{
+	uint8_t Size;
+
+	Size = STREAM_BINARY_HEADER + 1;
+	if((Mask & (1<<STREAM_FIELD_TEMPERATURE)) != 0)
+	{
+		Size += 4;
+	}
+	CHANNEL_LIST(STREAM_FIELD_BYTES)
+	return Size;
+}
+
+/** Send every 'Period'th sample in 'Format'. A period of 0 stops the stream. */
+void Stream_Start(uint8_t Period, uint8_t Format);
+
+/** Returns 1 if a stream is on. */
+uint8_t Stream_Active(void);
+
+/** Called by TemperatureControllerTask with each data set. */
+void Stream_Sample(const uint8_t Dataset[], int32_t Temperature, uint8_t Relay);
+
+/** Send the frame that is waiting, if there is one. Called from the main loop, never from an interrupt. */
+void Stream_Flush(void);
+
+void Stream_GetStats(Stream_Stats *Stats);
+
+/** Load the deadbands from EEPROM. */
+void Stream_Init(void);
+
+/** Set the deadband and heartbeat for one field and save them. */
+void Stream_SetDeadband(uint8_t Field, uint32_t Deadband, uint8_t Heartbeat);
+
+void Stream_GetDeadbands(Stream_Deadbands *Deadbands);
+
+#endif
+/** @} */
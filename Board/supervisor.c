@@ -0,0 +1,294 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Watchdog supervisor for the main loop and the temperature controller.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+#include <stddef.h>
+
+Supervisor_Fault EEMEM NV_FAULT;
+uint16_t EEMEM NV_FAULT_COUNT = 0;
+
+//Survives the watchdog reset
+static Supervisor_Fault LastFault __attribute__((section(".noinit")));
+
+static const uint8_t Deadlines[SUPERVISOR_TASKS] = {SUPERVISOR_DEADLINE_LOOP, SUPERVISOR_DEADLINE_CONTROLLER};
+
+static uint8_t ResetCause;
+static volatile uint8_t Running;
+static volatile uint8_t Armed;
+static volatile uint8_t Active;					//One bit for each task
+static volatile uint8_t Ages[SUPERVISOR_TASKS];	//RTC ticks since the last check in
+static volatile uint8_t FaultTask;				//The first task to miss its deadline, SUPERVISOR_TASKS if none
+static volatile uint32_t Uptime;
+
+static uint8_t Supervisor_Sum(const Supervisor_Fault *Fault);
+static void Supervisor_WatchdogFault(uint16_t PC) __attribute__((used, noinline));
+
+void Supervisor_Init(void)
+{
+	uint16_t Count;
+
+	//The watchdog stays on after a watchdog reset until WDRF is cleared
+	ResetCause = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+
+	//.noinit RAM is random after power up, so the record is only looked at after a watchdog reset
+	if((ResetCause & (1<<WDRF)) != 0)
+	{
+		if((LastFault.Magic != SUPERVISOR_FAULT_MAGIC) || (LastFault.Check != Supervisor_Sum(&LastFault)))
+		{
+			LastFault.Task = SUPERVISOR_TASK_UNKNOWN;
+			LastFault.PC = 0;
+			LastFault.Uptime = 0;
+			LastFault.CheckIn = 0;
+			LastFault.Magic = SUPERVISOR_FAULT_MAGIC;
+			LastFault.Check = Supervisor_Sum(&LastFault);
+		}
+		eeprom_update_block(&LastFault, &NV_FAULT, sizeof(Supervisor_Fault));
+		Count = eeprom_read_word(&NV_FAULT_COUNT);
+		if(Count == 0xFFFF)
+		{
+			Count = 0;
+		}
+		eeprom_update_word(&NV_FAULT_COUNT, Count + 1);
+	}
+	LastFault.Magic = 0;
+
+	Active = 0;
+	FaultTask = SUPERVISOR_TASKS;
+	Uptime = 0;
+	Armed = 0;
+	Running = 0;
+	return;
+}
+
+void Supervisor_Start(void)
+{
+	Supervisor_Resume(SUPERVISOR_TASK_LOOP);
+	Running = 1;
+	return;
+}
+
+void Supervisor_CheckIn(uint8_t Task)
+{
+	Ages[Task] = 0;
+	return;
+}
+
+void Supervisor_Suspend(uint8_t Task)
+{
+	Active &= ~(1<<Task);
+	return;
+}
+
+void Supervisor_Resume(uint8_t Task)
+{
+	Ages[Task] = 0;
+	Active |= (1<<Task);
+	return;
+}
+
+uint8_t Supervisor_Tick(void)
+{
+	uint8_t Overdue;
+	uint8_t i;
+
+	Uptime++;
+	if(Running == 0)
+	{
+		return 0;
+	}
+	if(Armed == 0)
+	{
+		wdt_enable(SUPERVISOR_WDT_TIMEOUT);
+		WDTCSR |= (1<<WDIE);
+		Armed = 1;
+	}
+
+	Overdue = SUPERVISOR_TASKS;
+	for(i=0; i<SUPERVISOR_TASKS; i++)
+	{
+		if((Active & (1<<i)) != 0)
+		{
+			if(Ages[i] < 0xFF)
+			{
+				Ages[i]++;
+			}
+			if((Ages[i] > Deadlines[i]) && (Overdue == SUPERVISOR_TASKS))
+			{
+				Overdue = i;
+			}
+		}
+	}
+
+	//Once a task is late, the watchdog is left to run out even if the task comes back
+	if(FaultTask == SUPERVISOR_TASKS)
+	{
+		if(Overdue == SUPERVISOR_TASKS)
+		{
+			wdt_reset();
+		}
+		else
+		{
+			FaultTask = Overdue;
+		}
+	}
+	if(FaultTask != SUPERVISOR_TASKS)
+	{
+		return 1;
+	}
+	return 0;
+}
+
+uint8_t Supervisor_GetResetCause(void)
+{
+	return ResetCause;
+}
+
+uint16_t Supervisor_GetFault(Supervisor_Fault *Fault)
+{
+	uint16_t Count;
+
+	Count = eeprom_read_word(&NV_FAULT_COUNT);
+	if(Count == 0xFFFF)
+	{
+		Count = 0;
+	}
+	eeprom_read_block(Fault, &NV_FAULT, sizeof(Supervisor_Fault));
+	if((Fault->Magic != SUPERVISOR_FAULT_MAGIC) || (Fault->Check != Supervisor_Sum(Fault)))
+	{
+		return 0;
+	}
+	return Count;
+}
+
+void Supervisor_ClearFaults(void)
+{
+	eeprom_update_word(&NV_FAULT_COUNT, 0);
+	eeprom_update_byte(&NV_FAULT.Magic, 0);
+	return;
+}
+
+static uint8_t Supervisor_Sum(const Supervisor_Fault *Fault)
+{
+	const uint8_t *Bytes;
+	uint8_t Sum;
+	uint8_t i;
+
+	Bytes = (const uint8_t *)Fault;
+	Sum = 0;
+	for(i=0; i<offsetof(Supervisor_Fault, Check); i++)
+	{
+		Sum += Bytes[i];
+	}
+	return ~Sum;
+}
+
+//The watchdog ran out. The next time out resets the processor.
+//__builtin_return_address(0) does not give the interrupted code in an interrupt handler, and the return address sits
+//under however many registers the compiler pushes first. So the handler saves the registers a C call can change itself,
+//picks the return address up from above them and passes it on.
+#if defined(__AVR__)
+ISR(WDT_vect, ISR_NAKED)
+{
+	__asm__ __volatile__
+	(
+		"push r0"					"\n\t"
+		"in r0, __SREG__"			"\n\t"
+		"push r0"					"\n\t"
+		"push r1"					"\n\t"
+		"clr r1"					"\n\t"
+		"push r18"					"\n\t"
+		"push r19"					"\n\t"
+		"push r20"					"\n\t"
+		"push r21"					"\n\t"
+		"push r22"					"\n\t"
+		"push r23"					"\n\t"
+		"push r24"					"\n\t"
+		"push r25"					"\n\t"
+		"push r26"					"\n\t"
+		"push r27"					"\n\t"
+		"push r30"					"\n\t"
+		"push r31"					"\n\t"
+		//15 bytes pushed, so the return address is at SP+16 (high byte) and SP+17 (low byte)
+		"in r30, __SP_L__"			"\n\t"
+		"in r31, __SP_H__"			"\n\t"
+		"ldd r25, Z+16"				"\n\t"
+		"ldd r24, Z+17"				"\n\t"
+		"call Supervisor_WatchdogFault"	"\n\t"
+		"pop r31"					"\n\t"
+		"pop r30"					"\n\t"
+		"pop r27"					"\n\t"
+		"pop r26"					"\n\t"
+		"pop r25"					"\n\t"
+		"pop r24"					"\n\t"
+		"pop r23"					"\n\t"
+		"pop r22"					"\n\t"
+		"pop r21"					"\n\t"
+		"pop r20"					"\n\t"
+		"pop r19"					"\n\t"
+		"pop r18"					"\n\t"
+		"pop r1"					"\n\t"
+		"pop r0"					"\n\t"
+		"out __SREG__, r0"			"\n\t"
+		"pop r0"					"\n\t"
+		"reti"						"\n\t"
+	);
+}
+#else
+//The host tools call the vector as a function, and have no return address to give
+ISR(WDT_vect)
+{
+	Supervisor_WatchdogFault(0);
+	return;
+}
+#endif
+
+//Save the fault record. 'PC' is the word address the watchdog interrupt returns to.
+static void Supervisor_WatchdogFault(uint16_t PC)
+{
+	uint8_t Task;
+
+	Relay(0);
+	Task = FaultTask;
+	if(Task == SUPERVISOR_TASKS)
+	{
+		Task = SUPERVISOR_TASK_RTC;
+	}
+
+	LastFault.Task = Task;
+	LastFault.PC = PC;
+	LastFault.Uptime = Uptime;
+	LastFault.CheckIn = Uptime;
+	if(Task < SUPERVISOR_TASKS)
+	{
+		LastFault.CheckIn = Uptime - Ages[Task];
+	}
+	LastFault.Magic = SUPERVISOR_FAULT_MAGIC;
+	LastFault.Check = Supervisor_Sum(&LastFault);
+	return;
+}
+
+/** @} */
@@ -0,0 +1,100 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Watchdog supervisor for the main loop and the temperature controller.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Each supervised task checks in with Supervisor_CheckIn. The RTC interrupt counts the ticks since each task last
+*	checked in, and only resets the watchdog while every active task is within its deadline. The RTC is used because it
+*	is the only thing that wakes the processor from power save sleep. The watchdog is not armed until the first RTC
+*	tick, so a board with a dead RTC runs without it instead of resetting over and over.
+*
+*	Once a task misses its deadline, the relay is held off and the watchdog is left to run out. The watchdog runs in
+*	interrupt and reset mode. When it runs out, the watchdog interrupt turns the relay off again and saves a fault
+*	record in .noinit RAM, which is not cleared by the reset: the task that missed its deadline, where the processor
+*	was (the return address of the interrupt) and the uptime of the fault and of the last check in. The next time out
+*	resets the processor. If interrupts were off the whole time (a bus stuck inside a driver called with interrupts
+*	off), only the reset happens and there is no record.
+*
+*	At boot, Supervisor_Init moves the record (or a SUPERVISOR_TASK_UNKNOWN record for a watchdog reset with no record)
+*	to EEPROM, so the last fault and the number of faults survive a power cycle. They are shown by the 'fault' command.
+*
+*	A task that waits on the user on purpose (a command that asks a question) is suspended while it waits.
+*
+*	Worst case from a task getting stuck to the relay turning off is its deadline plus one tick, and two watchdog
+*	periods more to the reset. With interrupts off, the relay is left as it was until the reset.
+*
+*	@{
+*/
+
+#ifndef _SUPERVISOR_H_
+#define _SUPERVISOR_H_
+
+#include "stdint.h"
+
+//Tasks
+#define SUPERVISOR_TASK_LOOP			0			//The main loop. Wakes on every RTC tick.
+#define SUPERVISOR_TASK_CONTROLLER		1			//TemperatureControllerTask, while the controller is running
+#define SUPERVISOR_TASKS				2
+#define SUPERVISOR_TASK_RTC				0xFE		//Every task was on time, but the RTC stopped resetting the watchdog
+#define SUPERVISOR_TASK_UNKNOWN			0xFF		//Watchdog reset with no record
+
+//Deadlines in RTC ticks
+#define SUPERVISOR_DEADLINE_LOOP		8			//4s
+#define SUPERVISOR_DEADLINE_CONTROLLER	30			//15s, three samples
+
+#define SUPERVISOR_WDT_TIMEOUT			WDTO_1S
+#define SUPERVISOR_FAULT_MAGIC			0xA5
+
+typedef struct
+{
+	uint8_t Magic;
+	uint8_t Task;				//SUPERVISOR_TASK_*
+	uint16_t PC;				//Return address of the watchdog interrupt, in words (twice this in a listing)
+	uint32_t Uptime;			//RTC ticks from boot to the fault
+	uint32_t CheckIn;			//RTC ticks from boot to the last check in of Task
+	uint8_t Check;				//~sum of the bytes before it
+} Supervisor_Fault;
+
+/** Call first thing at boot. Turns the watchdog off and saves the fault record from the last reset. */
+void Supervisor_Init(void);
+
+/** Start supervising the main loop. The watchdog is armed on the next RTC tick. */
+void Supervisor_Start(void);
+
+void Supervisor_CheckIn(uint8_t Task);
+
+/** Stop (Suspend) or start (Resume) supervising one task. Resume counts as a check in. */
+void Supervisor_Suspend(uint8_t Task);
+void Supervisor_Resume(uint8_t Task);
+
+/** Called from the RTC interrupt. Returns 1 once a task has missed its deadline. The relay must be held off from then
+ *	until the reset. */
+uint8_t Supervisor_Tick(void);
+
+/** MCUSR at boot */
+uint8_t Supervisor_GetResetCause(void);
+
+/** The last fault saved in EEPROM. Returns the number of faults, 0 if there has never been one. */
+uint16_t Supervisor_GetFault(Supervisor_Fault *Fault);
+
+void Supervisor_ClearFaults(void);
+
+#endif
+/** @} */
@@ -96,6 +96,38 @@ int32_t ThermistorCountsToTempNum (uint32_t Counts)
 	return ((int32_t)(Temp*10000.0F));
 }
 
+//The largest reading in counts that is at or above Temp (in deg C*10000). The conversion only goes one way, so this
+//searches for it. The thermistor reads fewer counts as it gets hotter.
+uint32_t ThermistorTempToCounts (int32_t Temp)
+{
+	uint32_t Low;
+	uint32_t High;
+	uint32_t Middle;
+	
+	//The curve fit is not monotonic below a few counts, so start the search at about 500 deg C
+	Low = 1000;
+	High = 0xFFFFFF;
+	if(ThermistorCountsToTempNum(Low) < Temp)
+	{
+		return 0;
+	}
+	
+	//ThermistorCountsToTempNum(Low) is always at or above Temp
+	while(Low < High)
+	{
+		Middle = Low + (High - Low + 1)/2;
+		if(ThermistorCountsToTempNum(Middle) >= Temp)
+		{
+			Low = Middle;
+		}
+		else
+		{
+			High = Middle - 1;
+		}
+	}
+	return Low;
+}
+
 
 
 
@@ -29,6 +29,8 @@ void ThermistorCountsToTemp (uint32_t Counts, char *outputval);
 
 int32_t ThermistorCountsToTempNum (uint32_t Counts);
 
+uint32_t ThermistorTempToCounts (int32_t Temp);
+
 
 
 
@@ -0,0 +1,272 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Interrupt driven transactions for the TWI bus.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+#include "../config.h"			//For TWI_SCL_FREQ_HZ
+
+//TWI status codes (master mode)
+#define TWIBUS_TW_START					0x08
+#define TWIBUS_TW_REP_START				0x10
+#define TWIBUS_TW_MT_SLA_ACK			0x18
+#define TWIBUS_TW_MT_DATA_ACK			0x28
+#define TWIBUS_TW_MR_SLA_ACK			0x40
+#define TWIBUS_TW_MR_DATA_ACK			0x50
+#define TWIBUS_TW_MR_DATA_NACK			0x58
+
+//Bit rate with a prescaler of 1
+#define TWIBUS_TWBR						(((F_CPU/TWI_SCL_FREQ_HZ)-16)/2)
+#if (TWIBUS_TWBR < 1) || (TWIBUS_TWBR > 255)
+	#error: TWI_SCL_FREQ_HZ can not be set with a prescaler of 1.
+#endif
+
+//Values written to TWCR
+#define TWIBUS_TWCR_START				((1<<TWINT)|(1<<TWSTA)|(1<<TWEN)|(1<<TWIE))
+#define TWIBUS_TWCR_NEXT				((1<<TWINT)|(1<<TWEN)|(1<<TWIE))
+#define TWIBUS_TWCR_NEXT_ACK			((1<<TWINT)|(1<<TWEN)|(1<<TWIE)|(1<<TWEA))
+#define TWIBUS_TWCR_STOP				((1<<TWINT)|(1<<TWEN)|(1<<TWSTO))
+#define TWIBUS_TWCR_STOP_START			((1<<TWINT)|(1<<TWEN)|(1<<TWIE)|(1<<TWSTO)|(1<<TWSTA))
+
+static TWIBus_Transaction *QueueHead;
+static TWIBus_Transaction *QueueTail;
+static TWIBus_Transaction * volatile ActiveTransaction;
+static uint8_t ActiveByte;		//The byte of the active transaction being sent or received
+
+static void TWIBus_SaveByte(TWIBus_Transaction *Transaction);
+static void TWIBus_Finish(uint8_t Result);
+static void TWIBus_HandleState(void);
+
+void TWIBus_Init(void)
+{
+	TWSR = 0x00;
+	TWBR = TWIBUS_TWBR;
+	return;
+}
+
+void TWIBus_Submit(TWIBus_Transaction *Transaction)
+{
+	uint8_t OldSREG;
+
+	Transaction->Next = NULL;
+	Transaction->Result = TWIBUS_RESULT_OK;
+	Transaction->Status = TWIBUS_STATUS_QUEUED;
+
+	OldSREG = SREG;
+	cli();
+	if(QueueHead == NULL)
+	{
+		QueueHead = Transaction;
+	}
+	else
+	{
+		QueueTail->Next = Transaction;
+	}
+	QueueTail = Transaction;
+
+	if(ActiveTransaction == NULL)
+	{
+		//Wait for the stop condition from the last transaction to finish
+		while((TWCR & (1<<TWSTO)) != 0) {}
+
+		ActiveTransaction = QueueHead;
+		QueueHead = ActiveTransaction->Next;
+		ActiveTransaction->Status = TWIBUS_STATUS_ACTIVE;
+		ActiveByte = 0;
+		TWCR = TWIBUS_TWCR_START;
+	}
+	SREG = OldSREG;
+	return;
+}
+
+uint8_t TWIBus_Wait(TWIBus_Transaction *Transaction)
+{
+	while(Transaction->Status != TWIBUS_STATUS_DONE)
+	{
+		//Interrupts are off during HardwareInit and inside other interrupts, so the bus needs to be run from here
+		if(((SREG & (1<<SREG_I)) == 0) && ((TWCR & (1<<TWINT)) != 0))
+		{
+			TWIBus_HandleState();
+		}
+	}
+	return Transaction->Result;
+}
+
+uint8_t TWIBus_ReadWrite(uint8_t Address, const uint8_t *SendData, uint8_t *ReceiveData, uint8_t BytesToSend, uint8_t BytesToReceive)
+{
+	TWIBus_Transaction Transaction;
+
+	Transaction.Address = Address;
+	Transaction.TxData = SendData;
+	Transaction.TxLength = BytesToSend;
+	Transaction.RxData = ReceiveData;
+	Transaction.RxLength = BytesToReceive;
+	Transaction.Callback = NULL;
+	TWIBus_Submit(&Transaction);
+	return TWIBus_Wait(&Transaction);
+}
+
+uint8_t TWIBus_Idle(void)
+{
+	if(ActiveTransaction == NULL)
+	{
+		return 1;
+	}
+	return 0;
+}
+
+//Save a received byte. If there is no place to put the data, it is discarded.
+static void TWIBus_SaveByte(TWIBus_Transaction *Transaction)
+{
+	uint8_t DataByte;
+
+	DataByte = TWDR;
+	if(Transaction->RxData != NULL)
+	{
+		Transaction->RxData[ActiveByte] = DataByte;
+	}
+	return;
+}
+
+//End the active transaction, then send a stop, or a stop and a start if there is another transaction queued
+static void TWIBus_Finish(uint8_t Result)
+{
+	TWIBus_Transaction *Transaction = ActiveTransaction;
+
+	ActiveTransaction = NULL;
+	Transaction->Result = Result;
+	Transaction->Status = TWIBUS_STATUS_DONE;
+	if(Transaction->Callback != NULL)
+	{
+		Transaction->Callback(Transaction);
+	}
+
+	//The callback may have queued another transaction
+	if(QueueHead != NULL)
+	{
+		ActiveTransaction = QueueHead;
+		QueueHead = ActiveTransaction->Next;
+		ActiveTransaction->Status = TWIBUS_STATUS_ACTIVE;
+		ActiveByte = 0;
+		TWCR = TWIBUS_TWCR_STOP_START;
+	}
+	else
+	{
+		TWCR = TWIBUS_TWCR_STOP;
+	}
+	return;
+}
+
+//Called when TWINT is set
+static void TWIBus_HandleState(void)
+{
+	uint8_t TWIStatus;
+	TWIBus_Transaction *Transaction = ActiveTransaction;
+
+	TWIStatus = TWSR & 0xF8;
+	if(Transaction == NULL)
+	{
+		TWCR = TWIBUS_TWCR_STOP;
+		return;
+	}
+
+	switch(TWIStatus)
+	{
+		case TWIBUS_TW_START:
+		case TWIBUS_TW_REP_START:
+			//Send the address. Write first if there is data to send.
+			if(ActiveByte < Transaction->TxLength)
+			{
+				TWDR = (Transaction->Address << 1);
+			}
+			else
+			{
+				TWDR = (Transaction->Address << 1) | 0x01;
+			}
+			TWCR = TWIBUS_TWCR_NEXT;
+			break;
+
+		case TWIBUS_TW_MT_SLA_ACK:
+		case TWIBUS_TW_MT_DATA_ACK:
+			if(ActiveByte < Transaction->TxLength)
+			{
+				TWDR = Transaction->TxData[ActiveByte];
+				ActiveByte++;
+				TWCR = TWIBUS_TWCR_NEXT;
+			}
+			else if(Transaction->RxLength > 0)
+			{
+				//Repeated start to read
+				TWCR = TWIBUS_TWCR_START;
+			}
+			else
+			{
+				TWIBus_Finish(TWIBUS_RESULT_OK);
+			}
+			break;
+
+		case TWIBUS_TW_MR_SLA_ACK:
+			//ACK every byte but the last
+			ActiveByte = 0;
+			if(Transaction->RxLength > 1)
+			{
+				TWCR = TWIBUS_TWCR_NEXT_ACK;
+			}
+			else
+			{
+				TWCR = TWIBUS_TWCR_NEXT;
+			}
+			break;
+
+		case TWIBUS_TW_MR_DATA_ACK:
+			TWIBus_SaveByte(Transaction);
+			ActiveByte++;
+			if(ActiveByte < (Transaction->RxLength - 1))
+			{
+				TWCR = TWIBUS_TWCR_NEXT_ACK;
+			}
+			else
+			{
+				TWCR = TWIBUS_TWCR_NEXT;
+			}
+			break;
+
+		case TWIBUS_TW_MR_DATA_NACK:
+			TWIBus_SaveByte(Transaction);
+			TWIBus_Finish(TWIBUS_RESULT_OK);
+			break;
+
+		default:
+			//Slave did not ACK, arbitration lost or bus error
+			TWIBus_Finish(TWIStatus);
+			break;
+	}
+	return;
+}
+
+ISR(TWI_vect)
+{
+	TWIBus_HandleState();
+}
+
+/** @} */
@@ -0,0 +1,76 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Interrupt driven transactions for the TWI bus.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	The DS3232M and MAX7315 share the TWI bus. Drivers fill in a transaction and submit it here. Transactions are run in
+*	order from the TWI interrupt. A transaction writes 'TxLength' bytes, then reads 'RxLength' bytes after a repeated
+*	start, the same as TWIRW in the common TWI module.
+*
+*	The bus speed is set by TWI_SCL_FREQ_HZ in config.h.
+*
+*	@{
+*/
+
+#ifndef _TWIBUS_H_
+#define _TWIBUS_H_
+
+#include "stdint.h"
+
+//Transaction status. A transaction that has never been submitted (all zeros) reads as done.
+#define TWIBUS_STATUS_DONE				0x00
+#define TWIBUS_STATUS_QUEUED			0x01
+#define TWIBUS_STATUS_ACTIVE			0x02
+
+//Transaction result. Anything other than TWIBUS_RESULT_OK is the TWI status code (TWSR) where the transaction failed.
+#define TWIBUS_RESULT_OK				0x00
+
+typedef struct TWIBus_Transaction
+{
+	uint8_t Address;							//7-bit slave address
+	const uint8_t *TxData;
+	uint8_t TxLength;
+	uint8_t *RxData;							//If NULL, the data read is discarded
+	uint8_t RxLength;
+	void (*Callback)(struct TWIBus_Transaction *Transaction);	//Called from the TWI interrupt when the transaction is done. Can be NULL.
+	volatile uint8_t Status;					//TWIBUS_STATUS_*
+	volatile uint8_t Result;					//TWIBUS_RESULT_OK or the TWI status code
+	struct TWIBus_Transaction *Next;			//Used by the queue
+} TWIBus_Transaction;
+
+/** Set the bus speed. Call this after InitTWI. */
+void TWIBus_Init(void);
+
+/** Add a transaction to the queue and return. The transaction and its data must not be changed until its status is TWIBUS_STATUS_DONE. */
+void TWIBus_Submit(TWIBus_Transaction *Transaction);
+
+/** Wait for a submitted transaction to finish and return its result. If interrupts are disabled, the bus is run by polling. */
+uint8_t TWIBus_Wait(TWIBus_Transaction *Transaction);
+
+/** Write 'BytesToSend' bytes, then read 'BytesToReceive' bytes from the slave at 'Address' and wait for the transfer to finish.
+ *	This is a drop in replacement for TWIRW. Returns 0 if the transfer worked.
+ */
+uint8_t TWIBus_ReadWrite(uint8_t Address, const uint8_t *SendData, uint8_t *ReceiveData, uint8_t BytesToSend, uint8_t BytesToReceive);
+
+/** Returns 1 if there are no active or queued transactions. */
+uint8_t TWIBus_Idle(void);
+
+#endif
+/** @} */
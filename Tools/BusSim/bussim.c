@@ -0,0 +1,1138 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Host tool to run the SPI and TWI bus code against register level models of the buses.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	The replay tool replaces spibus.c and twibus.c with a command level board model, so it never runs them. This tool
+*	builds spibus.c and twibus.c for the host, with the drivers that use them (ad7794.c, at45db321d.c, ds3232m.c and
+*	max7315.c), and runs them against models of the SPI and TWI hardware of the ATmega32u4. SREG and the SPI and TWI
+*	registers are read and written through BusSim_Register (see hal/avr/io.h). Each access moves a CPU cycle count on
+*	by BUSSIM_ACCESS_CYCLES and runs the hardware up to then: a byte written to SPDR shifts for BUSSIM_SPI_BYTE_CYCLES
+*	(Fcpu/2, as HardwareInit sets the bus), and a TWI start, byte or stop takes its bit times at the rate set by TWBR.
+*	A pending SPI or TWI interrupt is taken at the next access once it is enabled and the I bit is set, and costs
+*	BUSSIM_ISR_CYCLES on top of the accesses in the handler. The firmware code between the accesses takes no time, so
+*	CPU times are lower bounds. The cycle costs are estimates for avr-gcc code, not measured on the part.
+*
+*	The AD7794 and AT45DB321D models answer status reads with ready, and every other byte with a value made up from the
+*	device, the byte number and the first byte sent. The DS3232M and MAX7315 models are register files with a register
+*	pointer, set by the first byte written. Each SPI transfer, from chip select low to high, is kept with the bytes sent
+*	and received. Chip select is looked at on each register access, so two transfers to the same device with no access
+*	in between show as one.
+*
+*	With -s, the SPI burst transfers in spibus.h are checked. BUSSIM_SPI_RANDOM random transactions (either device, 0 to
+*	SPIBUS_MAX_HEADER header bytes, 0 to BUSSIM_SPI_MAX_DATA data bytes, with and without data to send and to receive)
+*	are run by SPIBus_Transfer, which bursts them when the bus is free, then by SPIBus_Submit and SPIBus_Wait with
+*	interrupts on, which sends a byte per interrupt for those over SPIBUS_BURST_MAX bytes. The bytes sent and received must be the same both ways and the ones
+*	the transaction gives, with no write collision and no chip select change during a byte. Then a dataflash buffer
+*	write, buffer read and a transfer both ways of BUSSIM_SPI_TIMED_BYTES are timed both ways. For each, the cycles per
+*	byte and the rate against Fcpu/2 are given, with the SPDR writes, SPIF polls and interrupts per byte. A burst must
+*	load SPDR once per byte, take no interrupts and run at BUSSIM_SPI_MIN_SHARE of Fcpu/2 or more.
+*
+*	With -o, both devices share the SPI bus. A dataflash buffer write of BUSSIM_SPI_TIMED_BYTES and BUSSIM_OVERLAP_WRITES
+*	data set records are queued with AT45DB321D_BufferWriteAsync, then the A/D data register is read with AD7794GetData
+*	while they go out. The writes are queued with interrupts off, so that the records are still queued behind the buffer
+*	write when the A/D read is asked for (on a free bus a record is short enough to be sent at once). The A/D read must
+*	go out right after the buffer write, ahead of the records, and give the bytes the model sent. Its wait is given
+*	against the time for all of the writes. Then one record write on a free bus is timed with AT45DB321D_BufferWrite and
+*	with AT45DB321D_BufferWriteAsync: the time the main loop is held up in the call, the time until the write is done,
+*	the CPU time taken by the interrupts meanwhile and what is left to the main loop. The async write must take no more
+*	CPU time than the blocking one. At Fcpu/2 a byte is sent in less time than the interrupt takes, so a transaction
+*	sent a byte per interrupt leaves the main loop only an instruction between them.
+*
+*	With -t, the TWI bus is run at TWI_SCL_FREQ_HZ from config.h and at BUSSIM_TWI_FAST_HZ, with TWBR set for each as
+*	TWIBus_Init sets it. DS3232M_SetTime, DS3232M_GetTime, MAX7315WriteReg and DS3232M_ReadSRAM of DS3232M_SRAM_SIZE
+*	bytes are called as the main loop calls them, then MAX7315SetOutputsAsync and MAX7315ReadInputsAsync are called
+*	and the main loop does other work until they are done. For each, the time on the bus, the time the main loop was
+*	held up in the call and the CPU time in the TWI interrupt are given, with the rate of the SRAM read. The data must
+*	come back right from the models, and an async LED write must hold the main loop up for less than
+*	BUSSIM_TWI_ASYNC_SHARE of the time of the same write with MAX7315WriteReg.
+*
+*	With no option, all three are run. The exit code is 0 if every check passed.
+*
+*	Build (Linux/OS X), from this directory:
+*		gcc -std=gnu99 -O2 -DF_CPU=8000000UL -Ihal -I../Replay/hal -I../../Board -I../.. -o bussim bussim.c
+*			../../Board/spibus.c ../../Board/twibus.c ../../Board/ad7794.c ../../Board/at45db321d.c
+*			../../Board/ds3232m.c ../../Board/max7315.c -lm
+*
+*	Usage:
+*		bussim [-s] [-o] [-t]
+*
+*	@{
+*/
+
+#include "main.h"
+#include "config.h"				//For TWI_SCL_FREQ_HZ
+#include <unistd.h>
+
+#define BUSSIM_ACCESS_CYCLES		2				//An in or out, or a poll of a flag
+#define BUSSIM_ISR_CYCLES			80				//Entry, saving and restoring the call used registers, and reti
+#define BUSSIM_SPI_BYTE_CYCLES		16				//Fcpu/2
+#define BUSSIM_TRANSFERS_KEPT		16
+#define BUSSIM_MAX_TRANSFER			(SPIBUS_MAX_HEADER + BUSSIM_SPI_MAX_DATA)
+#define BUSSIM_SPI_RANDOM			2000
+#define BUSSIM_SPI_MAX_DATA			600
+#define BUSSIM_SPI_TIMED_BYTES		528				//A dataflash page
+#define BUSSIM_SPI_MIN_SHARE		0.75
+#define BUSSIM_OVERLAP_WRITES		4
+#define BUSSIM_TWI_FAST_HZ			400000
+#define BUSSIM_TWI_ASYNC_SHARE		0.25
+#define BUSSIM_TWI_REGISTERS		256
+#define BUSSIM_WAIT_LIMIT			100000000ULL	//Cycles to wait for a transaction before giving up
+#define BUSSIM_NO_DEVICE			0xFF
+
+//TWI status codes (master mode)
+#define BUSSIM_TW_START				0x08
+#define BUSSIM_TW_REP_START			0x10
+#define BUSSIM_TW_MT_SLA_ACK		0x18
+#define BUSSIM_TW_MT_SLA_NACK		0x20
+#define BUSSIM_TW_MT_DATA_ACK		0x28
+#define BUSSIM_TW_MR_SLA_ACK		0x40
+#define BUSSIM_TW_MR_SLA_NACK		0x48
+#define BUSSIM_TW_MR_DATA_ACK		0x50
+#define BUSSIM_TW_MR_DATA_NACK		0x58
+
+typedef struct
+{
+	uint64_t Cycles;						//The CPU clock
+	uint64_t ISRCycles;						//Spent in the SPI and TWI interrupts
+	uint32_t SPIBytes;
+	uint32_t SPIWrites;						//Writes to SPDR
+	uint32_t SPIPolls;						//Reads of SPSR
+	uint32_t SPIInterrupts;
+	uint32_t Collisions;					//SPDR written during a byte
+	uint32_t ChipSelectErrors;				//Both devices selected, or chip select changed during a byte
+	uint32_t TWIBytes;						//Address and data bytes
+	uint32_t TWIInterrupts;
+	uint32_t TWIErrors;						//TWDR written during a byte, or a TWI action that makes no sense in the state
+	uint64_t TWIBusCycles;
+} BusSim_Stats;
+
+typedef struct
+{
+	uint8_t Device;							//SPIBUS_DEVICE_*
+	uint16_t Length;
+	uint8_t Sent[BUSSIM_MAX_TRANSFER];
+	uint8_t Received[BUSSIM_MAX_TRANSFER];
+} BusSim_Transfer;
+
+typedef struct
+{
+	uint8_t Address;
+	uint8_t Registers[BUSSIM_TWI_REGISTERS];
+	uint8_t Pointer;
+} BusSim_TWIDevice;
+
+//Registers that are plain variables
+volatile uint8_t MCUSR, MCUCR, WDTCSR;
+volatile uint8_t DDRB, DDRC, DDRD, DDRF, PORTB, PORTC, PORTD, PORTF;
+volatile uint8_t EICRA, EIFR, EIMSK;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1;
+volatile uint8_t TCCR3A, TCCR3B, TCNT3H, TCNT3L, OCR3AH, OCR3AL, TIMSK3;
+
+//Used by the parts of ad7794.c that are not run here
+volatile uint16_t ElapsedMS;
+
+static BusSim_Stats Stats;
+
+//The register model
+static volatile uint16_t Slots[BUSSIM_REGISTERS];
+static uint16_t Given[BUSSIM_REGISTERS];
+static uint8_t Registers[BUSSIM_REGISTERS];
+static uint64_t AccessCycles;				//Time of the last access, and of a write made to its slot
+static uint8_t InInterrupt;
+static uint8_t SPIFSeen;					//SPSR was read with SPIF or WCOL set, so the next SPDR access clears them
+
+//SPI
+static uint8_t Shifting;
+static uint64_t ShiftEnd;
+static uint8_t ShiftIn;
+static uint8_t Selected = BUSSIM_NO_DEVICE;
+static BusSim_Transfer Transfers[BUSSIM_TRANSFERS_KEPT];
+static uint32_t TransferCount;
+
+//TWI
+static uint8_t TWIBusy;
+static uint64_t TWIEnd;
+static uint8_t TWIStatus;					//Status at the end of the action, 0 for a stop on its own
+static uint8_t TWIReceived;					//Byte read by the action, if it reads
+static uint8_t TWIReading;
+static uint8_t TWIPhase;					//The last status
+static uint8_t TWIOwned;					//A start was sent and no stop since
+static uint8_t TWIFirstByte;				//The next byte written sets the register pointer
+static BusSim_TWIDevice *TWISelected;
+static BusSim_TWIDevice TWIDevices[2] = {{.Address = DS3232M_SLA_ADDRESS}, {.Address = MAX7315_SLA_7B}};
+
+static uint32_t Random = 1;
+
+static void BusSim_Write(uint8_t Register, uint8_t Value);
+
+//The interrupt handlers in spibus.c and twibus.c
+void SPI_STC_vect(void);
+void TWI_vect(void);
+
+//ad7794.c checks the internal temperature against its limit. There is no heater here.
+void Safety_Check(uint8_t Sensor, uint32_t Counts)
+{
+	(void)Sensor;
+	(void)Counts;
+	return;
+}
+
+//ad7794.c prints the internal temperature with this. It is not called here.
+char *dtostrf(double Value, signed char Width, unsigned char Precision, char *Output)
+{
+	sprintf(Output, "%*.*f", Width, Precision, Value);
+	return Output;
+}
+
+static uint32_t NextRandom(void)
+{
+	Random = Random * 1103515245UL + 12345UL;
+	return Random >> 8;
+}
+
+static double CyclesToUS(uint64_t Cycles)
+{
+	return (double)Cycles * 1000000.0 / (double)F_CPU;
+}
+
+//The byte the device sends for byte 'Index' of a transfer
+static uint8_t BusSim_MISO(const BusSim_Transfer *Transfer, uint16_t Index)
+{
+	if(Index == 0)
+	{
+		return 0xFF;
+	}
+	if((Transfer->Device == SPIBUS_DEVICE_AT45DB321D) && (Transfer->Sent[0] == AT45DB321D_CMD_READ_STATUS))
+	{
+		return 0xAC;									//Ready, 32Mbit, 528 byte pages
+	}
+	if((Transfer->Device == SPIBUS_DEVICE_AD7794) && (Transfer->Sent[0] == (AD7794_CR_READ | (AD7794_CR_REG_STATUS << 3))))
+	{
+		return 0x08;									//Ready, AD7794
+	}
+	return (uint8_t)((Index * 131U) + (Transfer->Sent[0] * 29U) + (Transfer->Device * 71U) + (Index >> 8));
+}
+
+static BusSim_Transfer *BusSim_LastTransfer(uint32_t Back)
+{
+	return &Transfers[(TransferCount - 1 - Back) % BUSSIM_TRANSFERS_KEPT];
+}
+
+//Look at the chip select lines and start a new transfer when a device is selected
+static void BusSim_ChipSelect(void)
+{
+	uint8_t Device = BUSSIM_NO_DEVICE;
+	BusSim_Transfer *Transfer;
+
+	if((PORTD & (1<<AD7794_CS_PIN)) == 0)
+	{
+		Device = SPIBUS_DEVICE_AD7794;
+	}
+	if((PORTB & (1<<AT45DB321D_CS_PIN)) == 0)
+	{
+		if(Device != BUSSIM_NO_DEVICE)
+		{
+			Stats.ChipSelectErrors++;
+		}
+		Device = SPIBUS_DEVICE_AT45DB321D;
+	}
+	if(Device == Selected)
+	{
+		return;
+	}
+	if(Shifting == 1)
+	{
+		Stats.ChipSelectErrors++;
+	}
+	Selected = Device;
+	if(Device != BUSSIM_NO_DEVICE)
+	{
+		Transfer = &Transfers[TransferCount % BUSSIM_TRANSFERS_KEPT];
+		Transfer->Device = Device;
+		Transfer->Length = 0;
+		TransferCount++;
+	}
+	return;
+}
+
+//SCL period in CPU cycles, from TWBR and the prescaler
+static uint32_t BusSim_SCLCycles(void)
+{
+	return 16 + (2 * (uint32_t)Registers[BUSSIM_REG_TWBR] * (1U << (2 * (Registers[BUSSIM_REG_TWSR] & 0x03))));
+}
+
+static BusSim_TWIDevice *BusSim_FindTWIDevice(uint8_t Address)
+{
+	uint8_t i;
+
+	for(i = 0; i < (sizeof(TWIDevices) / sizeof(TWIDevices[0])); i++)
+	{
+		if(TWIDevices[i].Address == Address)
+		{
+			return &TWIDevices[i];
+		}
+	}
+	return NULL;
+}
+
+//Start a TWI action that ends 'Bits' SCL periods after the access that started it
+static void BusSim_TWIStart(uint32_t Bits, uint8_t Status)
+{
+	uint64_t Length = (uint64_t)Bits * BusSim_SCLCycles();
+
+	TWIBusy = 1;
+	TWIEnd = AccessCycles + Length;
+	TWIStatus = Status;
+	Stats.TWIBusCycles += Length;
+	return;
+}
+
+//A write to TWCR
+static void BusSim_TWIControl(uint8_t Value)
+{
+	uint8_t Data;
+
+	//TWINT is cleared by writing a one to it, and nothing happens until it is. TWSTO is cleared by the hardware when the
+	//stop is sent.
+	Registers[BUSSIM_REG_TWCR] = (Value & ~((1<<TWINT)|(1<<TWSTO))) | (Registers[BUSSIM_REG_TWCR] & ((1<<TWINT)|(1<<TWSTO)));
+	if(((Value & (1<<TWINT)) == 0) || ((Value & (1<<TWEN)) == 0))
+	{
+		return;
+	}
+	Registers[BUSSIM_REG_TWCR] &= ~(1<<TWINT);
+	if(TWIBusy == 1)
+	{
+		Stats.TWIErrors++;
+		return;
+	}
+	TWIReading = 0;
+
+	if((Value & (1<<TWSTO)) != 0)
+	{
+		Registers[BUSSIM_REG_TWCR] |= (1<<TWSTO);
+		TWIOwned = 0;
+		if((Value & (1<<TWSTA)) != 0)
+		{
+			TWIOwned = 1;
+			BusSim_TWIStart(2, BUSSIM_TW_START);
+		}
+		else
+		{
+			BusSim_TWIStart(1, 0);
+		}
+	}
+	else if((Value & (1<<TWSTA)) != 0)
+	{
+		BusSim_TWIStart(1, (TWIOwned == 1) ? BUSSIM_TW_REP_START : BUSSIM_TW_START);
+		TWIOwned = 1;
+	}
+	else if((TWIPhase == BUSSIM_TW_START) || (TWIPhase == BUSSIM_TW_REP_START))
+	{
+		//Address byte and its ACK
+		Data = Registers[BUSSIM_REG_TWDR];
+		TWISelected = BusSim_FindTWIDevice(Data >> 1);
+		TWIFirstByte = 1;
+		Stats.TWIBytes++;
+		if((Data & 0x01) != 0)
+		{
+			BusSim_TWIStart(9, (TWISelected != NULL) ? BUSSIM_TW_MR_SLA_ACK : BUSSIM_TW_MR_SLA_NACK);
+		}
+		else
+		{
+			BusSim_TWIStart(9, (TWISelected != NULL) ? BUSSIM_TW_MT_SLA_ACK : BUSSIM_TW_MT_SLA_NACK);
+		}
+	}
+	else if(((TWIPhase == BUSSIM_TW_MT_SLA_ACK) || (TWIPhase == BUSSIM_TW_MT_DATA_ACK)) && (TWISelected != NULL))
+	{
+		Data = Registers[BUSSIM_REG_TWDR];
+		if(TWIFirstByte == 1)
+		{
+			TWISelected->Pointer = Data;
+			TWIFirstByte = 0;
+		}
+		else
+		{
+			TWISelected->Registers[TWISelected->Pointer++] = Data;
+		}
+		Stats.TWIBytes++;
+		BusSim_TWIStart(9, BUSSIM_TW_MT_DATA_ACK);
+	}
+	else if(((TWIPhase == BUSSIM_TW_MR_SLA_ACK) || (TWIPhase == BUSSIM_TW_MR_DATA_ACK)) && (TWISelected != NULL))
+	{
+		TWIReceived = TWISelected->Registers[TWISelected->Pointer++];
+		TWIReading = 1;
+		Stats.TWIBytes++;
+		BusSim_TWIStart(9, ((Value & (1<<TWEA)) != 0) ? BUSSIM_TW_MR_DATA_ACK : BUSSIM_TW_MR_DATA_NACK);
+	}
+	else
+	{
+		Stats.TWIErrors++;
+	}
+	return;
+}
+
+//A byte written to SPDR
+static void BusSim_SPIStart(uint8_t Value)
+{
+	BusSim_Transfer *Transfer;
+
+	Stats.SPIWrites++;
+	if(Shifting == 1)
+	{
+		Registers[BUSSIM_REG_SPSR] |= (1<<WCOL);
+		Stats.Collisions++;
+		return;
+	}
+	Shifting = 1;
+	ShiftEnd = AccessCycles + BUSSIM_SPI_BYTE_CYCLES;
+	ShiftIn = 0xFF;
+	Stats.SPIBytes++;
+	if(Selected == BUSSIM_NO_DEVICE)
+	{
+		Stats.ChipSelectErrors++;
+		return;
+	}
+	Transfer = BusSim_LastTransfer(0);
+	if(Transfer->Length < BUSSIM_MAX_TRANSFER)
+	{
+		Transfer->Sent[Transfer->Length] = Value;
+		ShiftIn = BusSim_MISO(Transfer, Transfer->Length);
+		Transfer->Received[Transfer->Length] = ShiftIn;
+		Transfer->Length++;
+	}
+	return;
+}
+
+static void BusSim_Write(uint8_t Register, uint8_t Value)
+{
+	switch(Register)
+	{
+		case BUSSIM_REG_SPSR:
+			Registers[Register] = (Registers[Register] & ~(1<<SPI2X)) | (Value & (1<<SPI2X));
+			break;
+		case BUSSIM_REG_SPDR:
+			BusSim_SPIStart(Value);
+			break;
+		case BUSSIM_REG_TWSR:
+			Registers[Register] = (Registers[Register] & 0xF8) | (Value & 0x03);
+			break;
+		case BUSSIM_REG_TWDR:
+			if((Registers[BUSSIM_REG_TWCR] & (1<<TWINT)) == 0)
+			{
+				Registers[BUSSIM_REG_TWCR] |= (1<<TWWC);
+				Stats.TWIErrors++;
+			}
+			else
+			{
+				Registers[Register] = Value;
+			}
+			break;
+		case BUSSIM_REG_TWCR:
+			BusSim_TWIControl(Value);
+			break;
+		default:
+			Registers[Register] = Value;
+			break;
+	}
+	return;
+}
+
+//Pass on any write made to a slot since the last access
+static void BusSim_Commit(void)
+{
+	uint8_t i;
+
+	for(i = 0; i < BUSSIM_REGISTERS; i++)
+	{
+		if(Slots[i] != Given[i])
+		{
+			Given[i] = Slots[i];
+			BusSim_Write(i, (uint8_t)Slots[i]);
+		}
+	}
+	return;
+}
+
+//Finish the bus actions that are done by now
+static void BusSim_Update(void)
+{
+	if((Shifting == 1) && (Stats.Cycles >= ShiftEnd))
+	{
+		Shifting = 0;
+		Registers[BUSSIM_REG_SPDR] = ShiftIn;
+		Registers[BUSSIM_REG_SPSR] |= (1<<SPIF);
+	}
+	if((TWIBusy == 1) && (Stats.Cycles >= TWIEnd))
+	{
+		TWIBusy = 0;
+		Registers[BUSSIM_REG_TWCR] &= ~(1<<TWSTO);
+		if(TWIStatus != 0)
+		{
+			Registers[BUSSIM_REG_TWSR] = (Registers[BUSSIM_REG_TWSR] & 0x03) | TWIStatus;
+			Registers[BUSSIM_REG_TWCR] |= (1<<TWINT);
+			TWIPhase = TWIStatus;
+			if(TWIReading == 1)
+			{
+				Registers[BUSSIM_REG_TWDR] = TWIReceived;
+			}
+		}
+		else
+		{
+			TWIPhase = 0;
+		}
+	}
+	return;
+}
+
+//Take a pending interrupt, if the I bit is set. The AVR runs an instruction of the main loop after a reti before it
+//takes the next one, so one is taken per access at most.
+static void BusSim_Interrupts(void)
+{
+	void (*Vector)(void);
+	uint64_t Start;
+
+	if((InInterrupt == 0) && ((Registers[BUSSIM_REG_SREG] & (1<<SREG_I)) != 0))
+	{
+		if(((Registers[BUSSIM_REG_SPCR] & (1<<SPIE)) != 0) && ((Registers[BUSSIM_REG_SPSR] & (1<<SPIF)) != 0))
+		{
+			Registers[BUSSIM_REG_SPSR] &= ~(1<<SPIF);		//Cleared by taking the interrupt
+			SPIFSeen = 0;
+			Vector = SPI_STC_vect;
+			Stats.SPIInterrupts++;
+		}
+		else if(((Registers[BUSSIM_REG_TWCR] & (1<<TWIE)) != 0) && ((Registers[BUSSIM_REG_TWCR] & (1<<TWINT)) != 0))
+		{
+			Vector = TWI_vect;
+			Stats.TWIInterrupts++;
+		}
+		else
+		{
+			return;
+		}
+
+		Start = Stats.Cycles;
+		InInterrupt = 1;
+		Registers[BUSSIM_REG_SREG] &= ~(1<<SREG_I);
+		Stats.Cycles += BUSSIM_ISR_CYCLES / 2;
+		BusSim_Update();
+		Vector();
+		BusSim_Commit();
+		Stats.Cycles += BUSSIM_ISR_CYCLES - (BUSSIM_ISR_CYCLES / 2);
+		BusSim_Update();
+		Registers[BUSSIM_REG_SREG] |= (1<<SREG_I);
+		InInterrupt = 0;
+		Stats.ISRCycles += Stats.Cycles - Start;
+	}
+	return;
+}
+
+volatile uint16_t *BusSim_Register(uint8_t Register)
+{
+	BusSim_Commit();
+	Stats.Cycles += BUSSIM_ACCESS_CYCLES;
+	BusSim_Update();
+	BusSim_ChipSelect();
+	BusSim_Interrupts();
+
+	if(Register == BUSSIM_REG_SPSR)
+	{
+		Stats.SPIPolls++;
+		SPIFSeen = ((Registers[BUSSIM_REG_SPSR] & ((1<<SPIF)|(1<<WCOL))) != 0) ? 1 : 0;
+	}
+	else if((Register == BUSSIM_REG_SPDR) && (SPIFSeen == 1))
+	{
+		Registers[BUSSIM_REG_SPSR] &= ~((1<<SPIF)|(1<<WCOL));
+		SPIFSeen = 0;
+	}
+
+	AccessCycles = Stats.Cycles;
+	Slots[Register] = 0x100 | Registers[Register];
+	Given[Register] = Slots[Register];
+	return &Slots[Register];
+}
+
+//The main loop doing other work for a while, with the interrupts running
+static void BusSim_Idle(void)
+{
+	BusSim_Commit();
+	Stats.Cycles += BUSSIM_ACCESS_CYCLES;
+	BusSim_Update();
+	BusSim_ChipSelect();
+	BusSim_Interrupts();
+	return;
+}
+
+//Run the main loop until a transaction status is done. Returns 0 if it never is.
+static int BusSim_IdleUntil(volatile uint8_t *Status, uint8_t Done)
+{
+	uint64_t Limit = Stats.Cycles + BUSSIM_WAIT_LIMIT;
+
+	while(*Status != Done)
+	{
+		if(Stats.Cycles > Limit)
+		{
+			return 0;
+		}
+		BusSim_Idle();
+	}
+	return 1;
+}
+
+//Run the main loop until the TWI bus is free. Returns 0 if it never is.
+static int BusSim_IdleUntilTWIFree(void)
+{
+	uint64_t Limit = Stats.Cycles + BUSSIM_WAIT_LIMIT;
+
+	while(TWIBus_Idle() == 0)
+	{
+		if(Stats.Cycles > Limit)
+		{
+			return 0;
+		}
+		BusSim_Idle();
+	}
+	return 1;
+}
+
+//Power on state of the buses
+static void BusSim_Reset(void)
+{
+	//Let the bus finish what it is doing
+	if(TWIBusy == 1)
+	{
+		Stats.Cycles = TWIEnd;
+		BusSim_Update();
+	}
+	TWIPhase = 0;
+	TWIOwned = 0;
+	PORTB = (1<<AT45DB321D_CS_PIN);
+	PORTD = (1<<AD7794_CS_PIN);
+	DDRB = (1<<AT45DB321D_CS_PIN);
+	DDRD = (1<<AD7794_CS_PIN);
+	memset(Registers, 0, sizeof(Registers));
+	Registers[BUSSIM_REG_SPCR] = (1<<SPE);			//SPI_Init in HardwareInit, master at Fcpu/2
+	Registers[BUSSIM_REG_SPSR] = (1<<SPI2X);
+	Registers[BUSSIM_REG_TWCR] = (1<<TWEN);			//InitTWI
+	TWIBus_Init();
+	return;
+}
+
+//Checks that a transfer sent and received what the transaction gives, from byte 'Offset' of the transfer on. Returns 1
+//if it did.
+static int BusSim_CheckTransfer(const BusSim_Transfer *Transfer, uint16_t Offset, const SPIBus_Transaction *Transaction)
+{
+	uint16_t Length = Transaction->HeaderLength + Transaction->DataLength;
+	uint16_t i;
+	uint8_t Sent;
+
+	if((Transfer->Device != Transaction->Device) || (Transfer->Length < (Offset + Length)))
+	{
+		return 0;
+	}
+	for(i = 0; i < Length; i++)
+	{
+		if(i < Transaction->HeaderLength)
+		{
+			Sent = Transaction->Header[i];
+		}
+		else if(Transaction->TxData != NULL)
+		{
+			Sent = Transaction->TxData[i - Transaction->HeaderLength];
+		}
+		else
+		{
+			Sent = 0x00;
+		}
+		if(Transfer->Sent[Offset + i] != Sent)
+		{
+			return 0;
+		}
+		if((i >= Transaction->HeaderLength) && (Transaction->RxData != NULL) &&
+		   (Transaction->RxData[i - Transaction->HeaderLength] != Transfer->Received[Offset + i]))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+typedef struct
+{
+	uint64_t Cycles;
+	uint32_t Bytes;
+	uint32_t Writes;
+	uint32_t Polls;
+	uint32_t Interrupts;
+} BusSim_Timing;
+
+//Time one transaction, by a burst (Interrupts = 0) or a byte per interrupt (Interrupts = 1)
+static int BusSim_TimeTransaction(SPIBus_Transaction *Transaction, uint8_t Interrupts, BusSim_Timing *Timing)
+{
+	BusSim_Stats Start = Stats;
+	int Done = 1;
+
+	if(Interrupts == 1)
+	{
+		sei();
+		SPIBus_Submit(Transaction);
+		Done = BusSim_IdleUntil(&Transaction->Status, SPIBUS_STATUS_DONE);
+		cli();
+	}
+	else
+	{
+		SPIBus_Transfer(Transaction);
+	}
+	Timing->Cycles = Stats.Cycles - Start.Cycles;
+	Timing->Bytes = Stats.SPIBytes - Start.SPIBytes;
+	Timing->Writes = Stats.SPIWrites - Start.SPIWrites;
+	Timing->Polls = Stats.SPIPolls - Start.SPIPolls;
+	Timing->Interrupts = Stats.SPIInterrupts - Start.SPIInterrupts;
+	return Done;
+}
+
+//Random transactions both ways, then the burst timing
+static int BurstTest(FILE *Report)
+{
+	static const char * const Shapes[3] = {"Buffer write", "Buffer read", "Both ways"};
+	static const char * const Paths[2] = {"burst", "interrupt"};
+	static uint8_t TxData[BUSSIM_SPI_MAX_DATA];
+	static uint8_t RxData[2][BUSSIM_SPI_MAX_DATA];
+	static BusSim_Transfer Done[2];
+	SPIBus_Transaction Transaction;
+	BusSim_Timing Timing;
+	double Share;
+	int Mismatches = 0;
+	int Failed = 0;
+	int Shape;
+	int Path;
+	int Trial;
+	int i;
+
+	BusSim_Reset();
+	for(Trial = 0; Trial < BUSSIM_SPI_RANDOM; Trial++)
+	{
+		for(i = 0; i < BUSSIM_SPI_MAX_DATA; i++)
+		{
+			TxData[i] = (uint8_t)NextRandom();
+		}
+		SPIBus_InitTransaction(&Transaction, (uint8_t)(NextRandom() % SPIBUS_NUMBER_OF_DEVICES));
+		Transaction.HeaderLength = (uint8_t)(NextRandom() % (SPIBUS_MAX_HEADER + 1));
+		for(i = 0; i < SPIBUS_MAX_HEADER; i++)
+		{
+			Transaction.Header[i] = (uint8_t)NextRandom();
+		}
+		Transaction.DataLength = (uint16_t)(NextRandom() % (BUSSIM_SPI_MAX_DATA + 1));
+		if((Transaction.HeaderLength + Transaction.DataLength) == 0)
+		{
+			Transaction.DataLength = 1;
+		}
+		Shape = (int)(NextRandom() % 4);
+		Transaction.TxData = ((Shape & 1) != 0) ? TxData : NULL;
+
+		for(Path = 0; Path < 2; Path++)
+		{
+			memset(RxData[Path], 0x55, sizeof(RxData[Path]));
+			Transaction.RxData = ((Shape & 2) != 0) ? RxData[Path] : NULL;
+			if((BusSim_TimeTransaction(&Transaction, (uint8_t)Path, &Timing) == 0) ||
+			   (BusSim_LastTransfer(0)->Length != (Transaction.HeaderLength + Transaction.DataLength)) ||
+			   (BusSim_CheckTransfer(BusSim_LastTransfer(0), 0, &Transaction) == 0))
+			{
+				Mismatches++;
+			}
+			Done[Path] = *BusSim_LastTransfer(0);
+		}
+		if((memcmp(Done[0].Sent, Done[1].Sent, Done[0].Length) != 0) || (memcmp(Done[0].Received, Done[1].Received, Done[0].Length) != 0) ||
+		   (memcmp(RxData[0], RxData[1], Transaction.DataLength) != 0))
+		{
+			Mismatches++;
+		}
+	}
+	fprintf(Report, "Random transactions:   %d, each as a burst and a byte per interrupt\n", BUSSIM_SPI_RANDOM);
+	fprintf(Report, "Transfers not as given or not the same both ways: %d\n", Mismatches);
+	fprintf(Report, "Write collisions:      %lu\n", (unsigned long)Stats.Collisions);
+	fprintf(Report, "Chip select errors:    %lu\n", (unsigned long)Stats.ChipSelectErrors);
+	if((Mismatches != 0) || (Stats.Collisions != 0) || (Stats.ChipSelectErrors != 0))
+	{
+		Failed++;
+	}
+
+	fprintf(Report, "\n%d data bytes after a 4 byte header, on the dataflash:\n", BUSSIM_SPI_TIMED_BYTES);
+	fprintf(Report, "                         Cycles/byte  Mbit/s  Of Fcpu/2  SPDR writes/byte  SPIF polls/byte  Interrupts/byte\n");
+	for(Shape = 0; Shape < 3; Shape++)
+	{
+		for(Path = 0; Path < 2; Path++)
+		{
+			SPIBus_InitTransaction(&Transaction, SPIBUS_DEVICE_AT45DB321D);
+			Transaction.Header[0] = (Shape == 1) ? AT45DB321D_CMD_BUFFER1_READ_LS : AT45DB321D_CMD_BUFFER1_WRITE;
+			Transaction.HeaderLength = 4;
+			Transaction.TxData = (Shape != 1) ? TxData : NULL;
+			Transaction.RxData = (Shape != 0) ? RxData[0] : NULL;
+			Transaction.DataLength = BUSSIM_SPI_TIMED_BYTES;
+			if(BusSim_TimeTransaction(&Transaction, (uint8_t)Path, &Timing) == 0)
+			{
+				Failed++;
+			}
+			Share = (double)(BUSSIM_SPI_BYTE_CYCLES * Timing.Bytes) / (double)Timing.Cycles;
+			fprintf(Report, "%-12s %-10s  %11.1f  %6.2f  %8.0f%%  %16.2f  %15.2f  %15.2f\n", Shapes[Shape], Paths[Path],
+			        (double)Timing.Cycles / Timing.Bytes, (8.0 * Timing.Bytes) / CyclesToUS(Timing.Cycles), 100.0 * Share,
+			        (double)Timing.Writes / Timing.Bytes, (double)Timing.Polls / Timing.Bytes, (double)Timing.Interrupts / Timing.Bytes);
+			if((Path == 0) && ((Timing.Writes != Timing.Bytes) || (Timing.Interrupts != 0) || (Share < BUSSIM_SPI_MIN_SHARE)))
+			{
+				Failed++;
+			}
+		}
+	}
+	fprintf(Report, "%s\n\n", (Failed == 0) ? "Bursts send the same bytes as the interrupt path, near Fcpu/2" : "Burst check FAILED");
+	fflush(Report);
+	return Failed;
+}
+
+//A/D reads on a bus busy with dataflash writes
+static int OverlapTest(FILE *Report)
+{
+	static uint8_t Records[BUSSIM_OVERLAP_WRITES][DATALOGGER_RECORD_SIZE];
+	static uint8_t Page[BUSSIM_SPI_TIMED_BYTES];
+	SPIBus_Transaction Writes[BUSSIM_OVERLAP_WRITES];
+	SPIBus_Transaction PageWrite;
+	BusSim_Transfer *Transfer;
+	BusSim_Stats Start;
+	uint64_t Asked;
+	uint64_t ADCWait;
+	uint64_t AllWrites;
+	uint64_t Held;
+	uint64_t Blocking;
+	uint32_t FirstTransfer;
+	uint32_t Expected;
+	uint32_t Value;
+	int Failed = 0;
+	int i;
+
+	BusSim_Reset();
+	for(i = 0; i < (BUSSIM_OVERLAP_WRITES * DATALOGGER_RECORD_SIZE); i++)
+	{
+		Records[i / DATALOGGER_RECORD_SIZE][i % DATALOGGER_RECORD_SIZE] = (uint8_t)NextRandom();
+	}
+	for(i = 0; i < BUSSIM_SPI_TIMED_BYTES; i++)
+	{
+		Page[i] = (uint8_t)NextRandom();
+	}
+
+	//Queue the writes, then read the A/D. The records are short enough to be sent at once on a free bus, so a write of a
+	//whole buffer goes first to keep the bus busy.
+	Start = Stats;
+	FirstTransfer = TransferCount;
+	AT45DB321D_BufferWriteAsync(2, 0, Page, BUSSIM_SPI_TIMED_BYTES, &PageWrite);
+	for(i = 0; i < BUSSIM_OVERLAP_WRITES; i++)
+	{
+		AT45DB321D_BufferWriteAsync(1, (uint16_t)(i * DATALOGGER_RECORD_SIZE), Records[i], DATALOGGER_RECORD_SIZE, &Writes[i]);
+	}
+	sei();
+	Asked = Stats.Cycles;
+	Value = AD7794GetData();
+	ADCWait = Stats.Cycles - Asked;
+	if(BusSim_IdleUntil(&PageWrite.Status, SPIBUS_STATUS_DONE) == 0)
+	{
+		Failed++;
+	}
+	for(i = 0; i < BUSSIM_OVERLAP_WRITES; i++)
+	{
+		if(BusSim_IdleUntil(&Writes[i].Status, SPIBUS_STATUS_DONE) == 0)
+		{
+			Failed++;
+		}
+	}
+	AllWrites = Stats.Cycles - Start.Cycles;
+	cli();
+	BusSim_Idle();
+
+	//The buffer write, then the A/D read, then the record writes. Chip select is only looked at on a register access,
+	//so the writes started one after the other by the interrupt show as one transfer.
+	if((TransferCount - FirstTransfer) != 3)
+	{
+		Failed++;
+	}
+	else
+	{
+		Transfer = BusSim_LastTransfer(1);
+		Expected = ((uint32_t)Transfer->Received[1] << 16) | ((uint32_t)Transfer->Received[2] << 8) | Transfer->Received[3];
+		if((Transfer->Device != SPIBUS_DEVICE_AD7794) || (Transfer->Length != 4) || (Value != Expected))
+		{
+			Failed++;
+		}
+		if((BusSim_LastTransfer(2)->Length != (4 + BUSSIM_SPI_TIMED_BYTES)) || (BusSim_CheckTransfer(BusSim_LastTransfer(2), 0, &PageWrite) == 0) ||
+		   (BusSim_LastTransfer(0)->Length != (BUSSIM_OVERLAP_WRITES * (4 + DATALOGGER_RECORD_SIZE))))
+		{
+			Failed++;
+		}
+		for(i = 0; i < BUSSIM_OVERLAP_WRITES; i++)
+		{
+			if(BusSim_CheckTransfer(BusSim_LastTransfer(0), (uint16_t)(i * (4 + DATALOGGER_RECORD_SIZE)), &Writes[i]) == 0)
+			{
+				Failed++;
+			}
+		}
+	}
+	fprintf(Report, "A buffer write of %d bytes and %d record writes of %d bytes queued, then an A/D read\n", BUSSIM_SPI_TIMED_BYTES,
+	        BUSSIM_OVERLAP_WRITES, DATALOGGER_RECORD_SIZE);
+	fprintf(Report, "A/D read waited:       %.1f us, out after the running write and ahead of %d queued\n", CyclesToUS(ADCWait),
+	        BUSSIM_OVERLAP_WRITES);
+	fprintf(Report, "All writes done in:    %.1f us\n", CyclesToUS(AllWrites));
+
+	//One record, blocking and queued
+	Start = Stats;
+	AT45DB321D_BufferWrite(1, 0, Records[0], DATALOGGER_RECORD_SIZE);
+	Held = Stats.Cycles - Start.Cycles;
+	Blocking = Held;
+	fprintf(Report, "\nOne record write       Held up (us)  Done in (us)  Interrupts (us)  Left to the main loop (us)\n");
+	fprintf(Report, "AT45DB321D_BufferWrite %12.1f  %12.1f  %15.1f  %26.1f\n", CyclesToUS(Held), CyclesToUS(Held), 0.0, 0.0);
+
+	sei();
+	Start = Stats;
+	AT45DB321D_BufferWriteAsync(1, 0, Records[0], DATALOGGER_RECORD_SIZE, &Writes[0]);
+	Held = Stats.Cycles - Start.Cycles;
+	if(BusSim_IdleUntil(&Writes[0].Status, SPIBUS_STATUS_DONE) == 0)
+	{
+		Failed++;
+	}
+	cli();
+	fprintf(Report, "  ...Async             %12.1f  %12.1f  %15.1f  %26.1f\n", CyclesToUS(Held), CyclesToUS(Stats.Cycles - Start.Cycles),
+	        CyclesToUS(Stats.ISRCycles - Start.ISRCycles), CyclesToUS((Stats.Cycles - Start.Cycles) - Held - (Stats.ISRCycles - Start.ISRCycles)));
+	if((Held + (Stats.ISRCycles - Start.ISRCycles)) > Blocking)
+	{
+		Failed++;
+	}
+	if((Stats.Collisions != 0) || (Stats.ChipSelectErrors != 0))
+	{
+		Failed++;
+	}
+	fprintf(Report, "%s\n\n", (Failed == 0) ? "A/D read goes ahead of the queued dataflash writes" : "Overlap check FAILED");
+	fflush(Report);
+	return Failed;
+}
+
+typedef struct
+{
+	uint64_t Held;
+	uint64_t Bus;
+	uint64_t Interrupts;
+} BusSim_TWITiming;
+
+static void BusSim_TWIMark(const BusSim_Stats *Start, uint64_t Held, BusSim_TWITiming *Timing)
+{
+	Timing->Held = Held;
+	Timing->Bus = Stats.TWIBusCycles - Start->TWIBusCycles;
+	Timing->Interrupts = Stats.ISRCycles - Start->ISRCycles;
+	return;
+}
+
+static void BusSim_TWIPrint(FILE *Report, const char *Name, const BusSim_TWITiming *Timing)
+{
+	fprintf(Report, "%-26s %12.1f  %12.1f  %15.1f\n", Name, CyclesToUS(Timing->Bus), CyclesToUS(Timing->Held), CyclesToUS(Timing->Interrupts));
+	return;
+}
+
+static volatile uint8_t InputsDone;
+
+static void BusSim_InputsRead(TWIBus_Transaction *Transaction)
+{
+	(void)Transaction;
+	InputsDone = 1;
+	return;
+}
+
+//The RTC and LED traffic at one speed
+static int TWITest(FILE *Report, uint32_t Speed)
+{
+	static uint8_t SRAM[DS3232M_SRAM_SIZE];
+	TimeAndDate Set = {56, 34, 12, 3, 28, 2, 13};
+	TimeAndDate Got;
+	TWIBus_Transaction Transaction;
+	BusSim_TWITiming Timing;
+	BusSim_TWITiming Sync;
+	BusSim_Stats Start;
+	uint8_t Inputs;
+	int Failed = 0;
+	int i;
+
+	BusSim_Reset();
+	TWBR = ((F_CPU / Speed) - 16) / 2;
+	for(i = 0; i < DS3232M_SRAM_SIZE; i++)
+	{
+		TWIDevices[0].Registers[DS3232M_REG_SRAM + i] = (uint8_t)NextRandom();
+	}
+	TWIDevices[1].Registers[MAX7315_REG_INPUTS] = 0xA5;
+	sei();
+
+	fprintf(Report, "TWI at %lu kHz             Bus (us)  Held up (us)  Interrupts (us)\n", (unsigned long)(Speed / 1000));
+	Start = Stats;
+	DS3232M_SetTime(&Set);
+	BusSim_TWIMark(&Start, Stats.Cycles - Start.Cycles, &Timing);
+	BusSim_TWIPrint(Report, "DS3232M_SetTime", &Timing);
+
+	memset(&Got, 0, sizeof(Got));
+	Start = Stats;
+	DS3232M_GetTime(&Got);
+	BusSim_TWIMark(&Start, Stats.Cycles - Start.Cycles, &Timing);
+	BusSim_TWIPrint(Report, "DS3232M_GetTime", &Timing);
+	if(memcmp(&Got, &Set, sizeof(Got)) != 0)
+	{
+		Failed++;
+	}
+
+	Start = Stats;
+	MAX7315WriteReg(MAX7315_REG_BLINK0, 0x3C);
+	BusSim_TWIMark(&Start, Stats.Cycles - Start.Cycles, &Sync);
+	BusSim_TWIPrint(Report, "MAX7315WriteReg", &Sync);
+	if(TWIDevices[1].Registers[MAX7315_REG_BLINK0] != 0x3C)
+	{
+		Failed++;
+	}
+
+	memset(SRAM, 0, sizeof(SRAM));
+	Start = Stats;
+	DS3232M_ReadSRAM(0, SRAM, DS3232M_SRAM_SIZE);
+	BusSim_TWIMark(&Start, Stats.Cycles - Start.Cycles, &Timing);
+	BusSim_TWIPrint(Report, "DS3232M_ReadSRAM", &Timing);
+	if(memcmp(SRAM, &TWIDevices[0].Registers[DS3232M_REG_SRAM], DS3232M_SRAM_SIZE) != 0)
+	{
+		Failed++;
+	}
+	fprintf(Report, "  ...%d bytes at %.1f kB/s\n", DS3232M_SRAM_SIZE, DS3232M_SRAM_SIZE * 1000.0 / CyclesToUS(Timing.Bus));
+
+	Start = Stats;
+	MAX7315SetOutputsAsync(0x0F, 0xFF);
+	Timing.Held = Stats.Cycles - Start.Cycles;
+	if(BusSim_IdleUntilTWIFree() == 0)
+	{
+		Failed++;
+	}
+	BusSim_TWIMark(&Start, Timing.Held, &Timing);
+	BusSim_TWIPrint(Report, "MAX7315SetOutputsAsync", &Timing);
+	if((TWIDevices[1].Registers[MAX7315_REG_BLINK0] != 0x0F) || (Timing.Held >= (BUSSIM_TWI_ASYNC_SHARE * Sync.Held)))
+	{
+		Failed++;
+	}
+
+	InputsDone = 0;
+	Inputs = 0;
+	Start = Stats;
+	MAX7315ReadInputsAsync(&Inputs, &Transaction, BusSim_InputsRead);
+	Timing.Held = Stats.Cycles - Start.Cycles;
+	if(BusSim_IdleUntil(&InputsDone, 1) == 0)
+	{
+		Failed++;
+	}
+	BusSim_TWIMark(&Start, Timing.Held, &Timing);
+	BusSim_TWIPrint(Report, "MAX7315ReadInputsAsync", &Timing);
+	if((Inputs != 0xA5) || (Transaction.Result != TWIBUS_RESULT_OK))
+	{
+		Failed++;
+	}
+	if(BusSim_IdleUntilTWIFree() == 0)
+	{
+		Failed++;
+	}
+	cli();
+	BusSim_Idle();
+	if(Stats.TWIErrors != 0)
+	{
+		Failed++;
+	}
+	fprintf(Report, "TWI errors:                %lu\n", (unsigned long)Stats.TWIErrors);
+	fprintf(Report, "%s\n\n", (Failed == 0) ? "Data right, async calls return before the bus is done" : "TWI check FAILED");
+	fflush(Report);
+	return Failed;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr, "Usage: bussim [-s] [-o] [-t]\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int Burst = 0;
+	int Overlap = 0;
+	int TWI = 0;
+	int Failed = 0;
+	int Option;
+	FILE *Report = stdout;
+	FILE *Quiet;
+
+	while((Option = getopt(argc, argv, "soth")) != -1)
+	{
+		switch(Option)
+		{
+			case 's':
+				Burst = 1;
+				break;
+			case 'o':
+				Overlap = 1;
+				break;
+			case 't':
+				TWI = 1;
+				break;
+			default:
+				Usage();
+				return 1;
+		}
+	}
+	if(optind != argc)
+	{
+		Usage();
+		return 1;
+	}
+	if((Burst + Overlap + TWI) == 0)
+	{
+		Burst = 1;
+		Overlap = 1;
+		TWI = 1;
+	}
+
+	//The drivers print to stdout. Throw that away.
+	Quiet = fopen("/dev/null", "w");
+	if(Quiet != NULL)
+	{
+		Report = fdopen(dup(fileno(stdout)), "w");
+		stdout = Quiet;
+	}
+
+	if(Burst == 1)
+	{
+		Failed += BurstTest(Report);
+	}
+	if(Overlap == 1)
+	{
+		Failed += OverlapTest(Report);
+	}
+	if(TWI == 1)
+	{
+		Failed += TWITest(Report, TWI_SCL_FREQ_HZ);
+		Failed += TWITest(Report, BUSSIM_TWI_FAST_HZ);
+	}
+	fprintf(Report, "%s\n", (Failed == 0) ? "All bus checks passed" : "Bus checks FAILED");
+	fflush(Report);
+	return (Failed == 0) ? 0 : 1;
+}
+
+/** @} */
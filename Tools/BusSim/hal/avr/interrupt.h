@@ -0,0 +1,11 @@
+//Host replacement for <avr/interrupt.h> used by the bus simulator.
+//Each ISR becomes a normal function with the vector name, which bussim.c calls when the interrupt is taken. cli() and
+//sei() change the I bit of SREG, which the model checks before taking an interrupt.
+#ifndef _BUSSIM_AVR_INTERRUPT_H_
+#define _BUSSIM_AVR_INTERRUPT_H_
+
+#define ISR(Vector, ...)	void Vector(void); void Vector(void)
+#define sei()				(SREG |= (1<<SREG_I))
+#define cli()				(SREG &= ~(1<<SREG_I))
+
+#endif
@@ -0,0 +1,65 @@
+//Host replacement for <avr/io.h> used by the bus simulator.
+//SREG and the SPI and TWI registers go through BusSim_Register in bussim.c, which runs the bus model up to each access.
+//It returns a slot that holds the register with bit 8 set. A write leaves a value without bit 8 (or changes the value,
+//for a read-modify-write) and is passed to the model at the next access. The other registers are plain variables.
+#ifndef _BUSSIM_AVR_IO_H_
+#define _BUSSIM_AVR_IO_H_
+
+#include <stdint.h>
+
+#define BUSSIM_REG_SREG		0
+#define BUSSIM_REG_SPCR		1
+#define BUSSIM_REG_SPSR		2
+#define BUSSIM_REG_SPDR		3
+#define BUSSIM_REG_TWBR		4
+#define BUSSIM_REG_TWSR		5
+#define BUSSIM_REG_TWDR		6
+#define BUSSIM_REG_TWCR		7
+#define BUSSIM_REGISTERS	8
+
+volatile uint16_t *BusSim_Register(uint8_t Register);
+
+#define SREG		(*BusSim_Register(BUSSIM_REG_SREG))
+#define SPCR		(*BusSim_Register(BUSSIM_REG_SPCR))
+#define SPSR		(*BusSim_Register(BUSSIM_REG_SPSR))
+#define SPDR		(*BusSim_Register(BUSSIM_REG_SPDR))
+#define TWBR		(*BusSim_Register(BUSSIM_REG_TWBR))
+#define TWSR		(*BusSim_Register(BUSSIM_REG_TWSR))
+#define TWDR		(*BusSim_Register(BUSSIM_REG_TWDR))
+#define TWCR		(*BusSim_Register(BUSSIM_REG_TWCR))
+
+extern volatile uint8_t MCUSR, MCUCR, WDTCSR;
+extern volatile uint8_t DDRB, DDRC, DDRD, DDRF, PORTB, PORTC, PORTD, PORTF;
+extern volatile uint8_t EICRA, EIFR, EIMSK;
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1;
+extern volatile uint8_t TCCR3A, TCCR3B, TCNT3H, TCNT3L, OCR3AH, OCR3AL, TIMSK3;
+
+#define SREG_I		7
+#define PORF		0
+#define EXTRF		1
+#define BORF		2
+#define WDRF		3
+#define WDE			3
+#define WDIE		6
+#define OCF0A		1
+#define TOV1		0
+#define TOIE1		0
+#define CS10		0
+#define CS11		1
+#define CS12		2
+#define SPIE		7
+#define SPE			6
+#define SPIF		7
+#define WCOL		6
+#define SPI2X		0
+#define TWINT		7
+#define TWEA		6
+#define TWSTA		5
+#define TWSTO		4
+#define TWWC		3
+#define TWEN		2
+#define TWIE		0
+
+#endif
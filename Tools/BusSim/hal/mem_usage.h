@@ -0,0 +1,9 @@
+//Host replacement for mem_usage.h from AVR-Common used by the bus simulator. config.h includes it for twibus.c.
+#ifndef _BUSSIM_MEM_USAGE_H_
+#define _BUSSIM_MEM_USAGE_H_
+
+#include <stdint.h>
+
+uint16_t StackCount(void);
+
+#endif
@@ -0,0 +1,810 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Host tool to decode AT45DB321D dataflash dumps from the datalogger.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	Datalogger
+*
+*	Decodes one or more raw dataflash images (8192 pages of 528 bytes each, concatenated) into CSV or a columnar
+*	binary file. The file is memory mapped and the pages are split into blocks that are decoded on a pool of threads.
+*	Blocks are written out in page order, so the output is the same for any number of threads.
+*
+*	The page and record layout comes from Board/datalogger.h and follows the same rules as Board/Datalogger.c. The channels
+*	in each record come from CHANNEL_LIST in Board/channels.h and are unpacked with the same code as the firmware.
+*
+*	With -f raw, each record is written as a CSV line of its time and the value of each channel as it was packed, in
+*	decimal and with no conversion, with nothing for the channels not in its layout. This is the data set as the firmware
+*	saved it, and is what 'replay -p' writes for the data sets it logs, so that the two can be compared byte for byte:
+*		replay -p values.csv -o flash.bin
+*		logdecode -f raw -o decoded.csv flash.bin
+*		cmp values.csv decoded.csv
+*
+*	Records written before a channel was added to CHANNEL_LIST are smaller, and are told apart by the size in their
+*	header. LogDecode_Layouts lists the older sizes with the number of channels in them. Channels were only ever added at
+*	the end, so an older record holds the first channels of the current list at the same offsets. The channels it does
+*	not have are NAN. The firmware skips these records. The year was added at the start of the time in the same way, and
+*	a record from before it has no year, which is left empty (LOGDECODE_NO_YEAR in the columnar file). Records from
+*	before the CRC-16 end in a CRC-8.
+*
+*	The thermistor and heater conversions are the ones in Board/thermistor.c and Board/heater.c, which are built as C
+*	against the replay stubs. The current sensor zero point comes from -z in place of the EEPROM.
+*
+*	Build (Linux/OS X), from this directory:
+*		gcc -std=gnu99 -O2 -DF_CPU=8000000UL -I../Replay/hal -I../../Board -I../.. -c ../../Board/thermistor.c
+*			../../Board/heater.c
+*		g++ -std=c++17 -O2 -pthread -o logdecode logdecode.cpp thermistor.o heater.o -lm
+*
+*	With -b, the decoder is benchmarked instead. A synthetic dump of about the given number of GB is made from copies of
+*	one full image, in the current layout with valid CRCs, and written to a temporary file in $TMPDIR (or /tmp). It is
+*	then decoded in the -f format with 1, 2, 4 and so on threads up to -j, with the output thrown away. The time, rate and
+*	speed up over one thread are given for each. Every run must decode every record. The speed up with more threads has
+*	only been run on a one core machine, where it was below 1, so how it scales on more cores is not known.
+*
+*	Usage:
+*		logdecode [-f csv|col|raw] [-o output] [-j threads] [-z current_zero_counts] dump.bin
+*		logdecode -b gigabytes [-f csv|col|raw] [-j threads]
+*
+*	@{
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../Board/datalogger.h"
+
+//The channel conversions are the firmware's own, built as C from the same sources the replay uses
+extern "C"
+{
+	#include "../../Board/thermistor.h"
+	#include "../../Board/heater.h"
+}
+
+//Pages decoded by a thread at a time
+#define LOGDECODE_PAGES_PER_BLOCK		1024
+
+//The number of decoded blocks that may be waiting to be written. This bounds the memory used for large dumps.
+#define LOGDECODE_BLOCKS_IN_FLIGHT		4
+
+//Output formats
+#define LOGDECODE_NO_YEAR				0xFF
+
+#define LOGDECODE_FORMAT_CSV			0
+#define LOGDECODE_FORMAT_COLUMNAR		1
+#define LOGDECODE_FORMAT_RAW			2
+
+static const char * const LogDecode_FormatNames[] = {"CSV", "columnar", "raw"};
+
+/** A decoded record */
+struct LogRecord
+{
+	uint32_t Image;			//Which image in the dump the record came from
+	uint16_t Page;			//Page number in the image
+	uint32_t Sequence;		//Page sequence number
+	uint8_t Year;			//From 2000, LOGDECODE_NO_YEAR if the layout has none
+	uint8_t Month;
+	uint8_t Day;
+	uint8_t Hour;
+	uint8_t Min;
+	uint8_t Channels;		//In the layout of the record
+	float Value[CHANNEL_COUNT];	//In the units given by the conversion for each channel
+	uint32_t Raw[CHANNEL_COUNT];	//As packed, 0 if the channel is not in the layout
+};
+
+/** The results from one block of pages */
+struct LogBlock
+{
+	std::vector<LogRecord> Records;
+	uint32_t BadCRC = 0;
+	uint32_t OtherLayout = 0;
+	bool Done = false;
+};
+
+/** Totals over a dump */
+struct LogTotals
+{
+	uint64_t Records = 0;
+	uint64_t BadCRC = 0;
+	uint64_t OtherLayout = 0;
+};
+
+/** An older record layout: the first Channels channels of CHANNEL_LIST */
+struct LogLayout
+{
+	unsigned Size;			//Record size, from the data set header
+	int Channels;
+	unsigned TimeSize;		//Bytes of time before the channels
+	unsigned CRCSize;		//1 for a CRC-8, 2 for a CRC-16
+};
+
+static const LogLayout LogDecode_Layouts[] =
+{
+	{DATALOGGER_RECORD_SIZE, CHANNEL_COUNT, DATALOGGER_TIME_SIZE, 2},
+	{29, 7, 5, 1},			//Before the CRC-16
+	{28, 7, 4, 1},			//Before the year
+	{25, 6, 4, 1},			//Before HEATER_RMS
+	{22, 5, 4, 1},			//Before ENERGY
+};
+
+static uint8_t CRC8Table[256];
+static uint16_t CRC16Table[256];
+static uint32_t CurrentZeroCounts = 8388608;
+
+//ConvertHeaterCurrent reads the zero point of the current sensor from EEPROM in the firmware. Here it is set with -z.
+extern "C" uint32_t GetHeaterCurrentZero(void)
+{
+	return CurrentZeroCounts;
+}
+
+//thermistor.c prints with this. It is not called here.
+extern "C" char *dtostrf(double Value, signed char Width, unsigned char Precision, char *Output)
+{
+	sprintf(Output, "%*.*f", Width, Precision, Value);
+	return Output;
+}
+
+//Build the same CRC-16 table as Datalogger.c (CCITT polynomial x^16 + x^12 + x^5 + 1), and the CRC-8 table it used
+//before (polynomial x^8 + x^2 + x + 1)
+static void BuildCRCTables(void)
+{
+	for(int i = 0; i < 256; i++)
+	{
+		uint8_t CRC = (uint8_t)i;
+		uint16_t CRC16 = (uint16_t)(i << 8);
+		for(int j = 0; j < 8; j++)
+		{
+			CRC = (CRC & 0x80) ? (uint8_t)((CRC << 1) ^ 0x07) : (uint8_t)(CRC << 1);
+			CRC16 = (CRC16 & 0x8000) ? (uint16_t)((CRC16 << 1) ^ 0x1021) : (uint16_t)(CRC16 << 1);
+		}
+		CRC8Table[i] = CRC;
+		CRC16Table[i] = CRC16;
+	}
+}
+
+static uint8_t CRC8(const uint8_t *Data, unsigned Length)
+{
+	uint8_t CRC = 0x00;
+	while(Length--)
+	{
+		CRC = CRC8Table[CRC ^ *Data++];
+	}
+	return CRC;
+}
+
+static uint16_t CRC16(const uint8_t *Data, unsigned Length)
+{
+	uint16_t CRC = 0xFFFF;
+	while(Length--)
+	{
+		CRC = (uint16_t)((CRC << 8) ^ CRC16Table[(CRC >> 8) ^ *Data++]);
+	}
+	return CRC;
+}
+
+//Channel conversions. These are named by the Conversion column in CHANNEL_LIST.
+
+//ThermistorCountsToTempNum gives 0.0001 deg C. A reading of 0 is not a temperature.
+static double LogConvert_THERMISTOR(uint32_t Counts)
+{
+	if(Counts == 0)
+	{
+		return NAN;
+	}
+	return (double)ThermistorCountsToTempNum(Counts)/10000.0;
+}
+
+//ConvertHeaterVoltage gives V/10000
+static double LogConvert_HEATER_VOLTAGE(uint32_t Counts)
+{
+	return (double)ConvertHeaterVoltage(Counts)/10000.0;
+}
+
+//ConvertHeaterCurrent gives A/10000, from the zero point below
+static double LogConvert_HEATER_CURRENT(uint32_t Counts)
+{
+	return (double)ConvertHeaterCurrent(Counts)/10000.0;
+}
+
+//Signed 24-bit value scaled by 10000 (AD7794GetInternalTemp)
+static double LogConvert_SCALED_10000(uint32_t Value)
+{
+	return (double)(((int32_t)(Value << 8)) >> 8)/10000.0;
+}
+
+//Unsigned value scaled by 100 (Energy_Get, in Wh)
+static double LogConvert_SCALED_100(uint32_t Value)
+{
+	return (double)Value/100.0;
+}
+
+//No conversion, for new channels that do not have one yet
+[[maybe_unused]] static double LogConvert_RAW(uint32_t Value)
+{
+	return (double)Value;
+}
+
+#define LOGDECODE_RAW(Name, Bytes, Read, Convert)			Out.Raw[CHANNEL_##Name] = (CHANNEL_##Name < Channels) ? Channels_GetValue(&Data[TimeSize], CHANNEL_##Name##_OFFSET, (Bytes)) : 0;
+#define LOGDECODE_CONVERT(Name, Bytes, Read, Convert)		Out.Value[CHANNEL_##Name] = (CHANNEL_##Name < Channels) ? (float)LogConvert_##Convert(Out.Raw[CHANNEL_##Name]) : NAN;
+#define LOGDECODE_CSV_NAME(Name, Bytes, Read, Convert)		",%s"
+#define LOGDECODE_CSV_NAME_ARG(Name, Bytes, Read, Convert)	, #Name
+
+//Decode the records in one page. Follows the same rules as Datalogger_ReadDataSet.
+static void DecodePage(const uint8_t *Page, uint32_t Image, uint16_t PageNumber, LogBlock &Block)
+{
+	uint32_t Sequence = ((uint32_t)Page[0] << 16) | ((uint32_t)Page[1] << 8) | Page[2];
+	unsigned Address = DATALOGGER_PAGE_HEADER_SIZE;
+	
+	if(Sequence == DATALOGGER_PAGE_SEQ_ERASED)
+	{
+		return;
+	}
+	
+	while((Address + 2) <= DATALOGGER_PAGE_SIZE)
+	{
+		const uint8_t *Record = &Page[Address];
+		unsigned Size = ((Record[0] & 0x0F) << 4) | ((Record[1] & 0xF0) >> 4);
+		int Channels = -1;
+		unsigned TimeSize = 0;
+		unsigned CRCSize = 0;
+		
+		if(((Record[0] & 0xF0) != DATALOGGER_HEADER1_PREFIX) || ((Record[1] & 0x0F) != DATALOGGER_HEADER2_SUFFIX) || (Size <= 2) ||
+		   ((Address + Size) > DATALOGGER_PAGE_SIZE))
+		{
+			break;
+		}
+		Address += Size;
+		
+		//A size that is in no layout is skipped, as the firmware does
+		for(const LogLayout &Layout : LogDecode_Layouts)
+		{
+			if(Layout.Size == Size)
+			{
+				Channels = Layout.Channels;
+				TimeSize = Layout.TimeSize;
+				CRCSize = Layout.CRCSize;
+			}
+		}
+		if(Channels < 0)
+		{
+			Block.OtherLayout++;
+			continue;
+		}
+		
+#if DATALOGGER_USE_CRC == 1
+		//The CRC of a record including its CRC is zero if the record is intact
+		if(((CRCSize == 2) ? CRC16(Record, Size) : CRC8(Record, Size)) != 0)
+		{
+			Block.BadCRC++;
+			continue;
+		}
+#endif
+		
+		const uint8_t *Data = &Record[2];
+		LogRecord Out;
+		Out.Image = Image;
+		Out.Page = PageNumber;
+		Out.Sequence = Sequence;
+		//The year was added at the start of the time
+		const uint8_t *Time = &Data[TimeSize - 4];
+		Out.Year = (TimeSize > 4) ? Data[0] : LOGDECODE_NO_YEAR;
+		Out.Month = Time[0];
+		Out.Day = Time[1];
+		Out.Hour = Time[2];
+		Out.Min = Time[3];
+		Out.Channels = (uint8_t)Channels;
+		CHANNEL_LIST(LOGDECODE_RAW)
+		CHANNEL_LIST(LOGDECODE_CONVERT)
+		Block.Records.push_back(Out);
+	}
+}
+
+//The year, or nothing for a record from before it was saved
+static int WriteYear(char *Line, size_t Size, uint8_t Year)
+{
+	if(Year == LOGDECODE_NO_YEAR)
+	{
+		return 0;
+	}
+	return snprintf(Line, Size, "%u", Year);
+}
+
+static void WriteCSVHeader(FILE *Output)
+{
+	fprintf(Output, "image,page,sequence,year,month,day,hour,min" CHANNEL_LIST(LOGDECODE_CSV_NAME) "\n" CHANNEL_LIST(LOGDECODE_CSV_NAME_ARG));
+}
+
+static void WriteCSV(FILE *Output, const LogBlock &Block)
+{
+	char Line[64 + (16 * CHANNEL_COUNT)];
+	
+	for(const LogRecord &R : Block.Records)
+	{
+		int Length = snprintf(Line, sizeof(Line), "%u,%u,%u,", R.Image, R.Page, R.Sequence);
+		Length += WriteYear(&Line[Length], sizeof(Line) - (size_t)Length, R.Year);
+		Length += snprintf(&Line[Length], sizeof(Line) - (size_t)Length, ",%u,%u,%u,%u", R.Month, R.Day, R.Hour, R.Min);
+		for(int i = 0; i < CHANNEL_COUNT; i++)
+		{
+			Length += snprintf(&Line[Length], sizeof(Line) - (size_t)Length, ",%.4f", R.Value[i]);
+		}
+		Line[Length++] = '\n';
+		fwrite(Line, 1, (size_t)Length, Output);
+	}
+}
+
+static void WriteRawHeader(FILE *Output)
+{
+	fprintf(Output, "year,month,day,hour,min" CHANNEL_LIST(LOGDECODE_CSV_NAME) "\n" CHANNEL_LIST(LOGDECODE_CSV_NAME_ARG));
+}
+
+//The time and the packed values, with nothing for a channel that is not in the layout
+static void WriteRaw(FILE *Output, const LogBlock &Block)
+{
+	char Line[32 + (12 * CHANNEL_COUNT)];
+	
+	for(const LogRecord &R : Block.Records)
+	{
+		int Length = WriteYear(Line, sizeof(Line), R.Year);
+		Length += snprintf(&Line[Length], sizeof(Line) - (size_t)Length, ",%u,%u,%u,%u", R.Month, R.Day, R.Hour, R.Min);
+		for(int i = 0; i < CHANNEL_COUNT; i++)
+		{
+			if(i >= R.Channels)
+			{
+				Line[Length++] = ',';
+			}
+			else
+			{
+				Length += snprintf(&Line[Length], sizeof(Line) - (size_t)Length, ",%lu", (unsigned long)R.Raw[i]);
+			}
+		}
+		Line[Length++] = '\n';
+		fwrite(Line, 1, (size_t)Length, Output);
+	}
+}
+
+//Columnar file: an 8 byte magic string, then one row group per block.
+//Each row group is the number of rows (uint32) followed by each column stored contiguously in the order of LogRecord,
+//with one float column for each channel in CHANNEL_LIST.
+//All values are little endian.
+template <typename T, typename F>
+static void WriteColumn(FILE *Output, const std::vector<LogRecord> &Records, F Field)
+{
+	std::vector<T> Column;
+	Column.reserve(Records.size());
+	for(const LogRecord &R : Records)
+	{
+		Column.push_back(Field(R));
+	}
+	fwrite(Column.data(), sizeof(T), Column.size(), Output);
+}
+
+static void WriteColumnarHeader(FILE *Output)
+{
+	fwrite("BHLOG\x02\x00\x00", 1, 8, Output);
+}
+
+static void WriteColumnar(FILE *Output, const LogBlock &Block)
+{
+	const std::vector<LogRecord> &R = Block.Records;
+	uint32_t Rows = (uint32_t)R.size();
+	
+	if(Rows == 0)
+	{
+		return;
+	}
+	fwrite(&Rows, sizeof(Rows), 1, Output);
+	WriteColumn<uint32_t>(Output, R, [](const LogRecord &X) { return X.Image; });
+	WriteColumn<uint16_t>(Output, R, [](const LogRecord &X) { return X.Page; });
+	WriteColumn<uint32_t>(Output, R, [](const LogRecord &X) { return X.Sequence; });
+	WriteColumn<uint8_t>(Output, R, [](const LogRecord &X) { return X.Year; });
+	WriteColumn<uint8_t>(Output, R, [](const LogRecord &X) { return X.Month; });
+	WriteColumn<uint8_t>(Output, R, [](const LogRecord &X) { return X.Day; });
+	WriteColumn<uint8_t>(Output, R, [](const LogRecord &X) { return X.Hour; });
+	WriteColumn<uint8_t>(Output, R, [](const LogRecord &X) { return X.Min; });
+	for(int i = 0; i < CHANNEL_COUNT; i++)
+	{
+		WriteColumn<float>(Output, R, [i](const LogRecord &X) { return X.Value[i]; });
+	}
+}
+
+//Decode 'TotalPages' pages of a dump on 'Threads' threads and write them to 'Output'
+static LogTotals DecodeDump(const uint8_t *Dump, size_t TotalPages, unsigned Threads, int Format, FILE *Output)
+{
+	size_t TotalBlocks = (TotalPages + LOGDECODE_PAGES_PER_BLOCK - 1) / LOGDECODE_PAGES_PER_BLOCK;
+	std::vector<LogBlock> Slots(LOGDECODE_BLOCKS_IN_FLIGHT);
+	std::atomic<size_t> NextBlock(0);
+	size_t BlocksWritten = 0;
+	std::mutex Lock;
+	std::condition_variable BlockDone;
+	std::condition_variable SlotFree;
+	
+	//Each worker takes the next block, waits for a free output slot, then decodes the block into it
+	auto Worker = [&]()
+	{
+		for(;;)
+		{
+			size_t Block = NextBlock.fetch_add(1);
+			if(Block >= TotalBlocks)
+			{
+				return;
+			}
+			
+			{
+				std::unique_lock<std::mutex> Guard(Lock);
+				SlotFree.wait(Guard, [&]() { return Block < (BlocksWritten + LOGDECODE_BLOCKS_IN_FLIGHT); });
+			}
+			
+			LogBlock Result;
+			size_t FirstPage = Block * LOGDECODE_PAGES_PER_BLOCK;
+			size_t LastPage = FirstPage + LOGDECODE_PAGES_PER_BLOCK;
+			if(LastPage > TotalPages)
+			{
+				LastPage = TotalPages;
+			}
+			Result.Records.reserve((LastPage - FirstPage) * (DATALOGGER_PAGE_SIZE / DATALOGGER_RECORD_SIZE));
+			for(size_t Page = FirstPage; Page < LastPage; Page++)
+			{
+				DecodePage(&Dump[Page * DATALOGGER_PAGE_SIZE], (uint32_t)(Page / DATALOGGER_NUMBER_OF_PAGES), (uint16_t)(Page % DATALOGGER_NUMBER_OF_PAGES), Result);
+			}
+			Result.Done = true;
+			
+			{
+				std::lock_guard<std::mutex> Guard(Lock);
+				Slots[Block % LOGDECODE_BLOCKS_IN_FLIGHT] = std::move(Result);
+			}
+			BlockDone.notify_all();
+		}
+	};
+	
+	std::vector<std::thread> Pool;
+	for(unsigned i = 0; i < Threads; i++)
+	{
+		Pool.emplace_back(Worker);
+	}
+	
+	if(Format == LOGDECODE_FORMAT_CSV)
+	{
+		WriteCSVHeader(Output);
+	}
+	else if(Format == LOGDECODE_FORMAT_RAW)
+	{
+		WriteRawHeader(Output);
+	}
+	else
+	{
+		WriteColumnarHeader(Output);
+	}
+	
+	//Write the blocks out in order as they finish
+	LogTotals Totals;
+	while(BlocksWritten < TotalBlocks)
+	{
+		LogBlock Block;
+		{
+			std::unique_lock<std::mutex> Guard(Lock);
+			LogBlock &Slot = Slots[BlocksWritten % LOGDECODE_BLOCKS_IN_FLIGHT];
+			BlockDone.wait(Guard, [&]() { return Slot.Done; });
+			Block = std::move(Slot);
+			Slot = LogBlock();
+		}
+		
+		if(Format == LOGDECODE_FORMAT_CSV)
+		{
+			WriteCSV(Output, Block);
+		}
+		else if(Format == LOGDECODE_FORMAT_RAW)
+		{
+			WriteRaw(Output, Block);
+		}
+		else
+		{
+			WriteColumnar(Output, Block);
+		}
+		Totals.Records += Block.Records.size();
+		Totals.BadCRC += Block.BadCRC;
+		Totals.OtherLayout += Block.OtherLayout;
+		
+		{
+			std::lock_guard<std::mutex> Guard(Lock);
+			BlocksWritten++;
+		}
+		SlotFree.notify_all();
+	}
+	
+	for(std::thread &T : Pool)
+	{
+		T.join();
+	}
+	return Totals;
+}
+
+//One full image for -b, every page full of records in the current layout
+static void MakeBenchImage(std::vector<uint8_t> &Image)
+{
+	uint32_t Values[CHANNEL_COUNT];
+	uint32_t Index = 0;
+	
+	Image.assign((size_t)DATALOGGER_NUMBER_OF_PAGES * DATALOGGER_PAGE_SIZE, 0xFF);
+	for(unsigned Page = 0; Page < DATALOGGER_NUMBER_OF_PAGES; Page++)
+	{
+		uint8_t *Data = &Image[(size_t)Page * DATALOGGER_PAGE_SIZE];
+		Data[0] = (uint8_t)(Page >> 16);
+		Data[1] = (uint8_t)(Page >> 8);
+		Data[2] = (uint8_t)Page;
+		for(unsigned Address = DATALOGGER_PAGE_HEADER_SIZE; (Address + DATALOGGER_RECORD_SIZE) <= DATALOGGER_PAGE_SIZE; Address += DATALOGGER_RECORD_SIZE)
+		{
+			uint8_t *Record = &Data[Address];
+			Record[0] = (DATALOGGER_RECORD_SIZE >> 4) | DATALOGGER_HEADER1_PREFIX;
+			Record[1] = (uint8_t)(DATALOGGER_RECORD_SIZE << 4) | DATALOGGER_HEADER2_SUFFIX;
+			Record[2] = (uint8_t)(13 + Index / (48 * 28 * 12));
+			Record[3] = (uint8_t)(1 + (Index / (48 * 28)) % 12);
+			Record[4] = (uint8_t)(1 + (Index / 48) % 28);
+			Record[5] = (uint8_t)((Index / 2) % 24);
+			Record[6] = (uint8_t)((Index % 2) * 30);
+			for(int i = 0; i < CHANNEL_COUNT; i++)
+			{
+				Values[i] = 0x700000 + ((Index * (uint32_t)(i + 1) * 2654435761u) >> 12);
+			}
+			Channels_Pack(Values, &Record[2 + DATALOGGER_TIME_SIZE]);
+			uint16_t CRC = CRC16(Record, DATALOGGER_RECORD_SIZE - 2);
+			Record[DATALOGGER_RECORD_SIZE - 2] = (uint8_t)(CRC >> 8);
+			Record[DATALOGGER_RECORD_SIZE - 1] = (uint8_t)CRC;
+			Index++;
+		}
+	}
+}
+
+//Decode a synthetic dump of about 'Gigabytes' with 1, 2, 4... threads up to 'MostThreads'
+static int Bench(double Gigabytes, unsigned MostThreads, int Format)
+{
+	std::vector<uint8_t> Image;
+	MakeBenchImage(Image);
+	size_t Images = (size_t)((Gigabytes * 1e9) / (double)Image.size());
+	if(Images == 0)
+	{
+		Images = 1;
+	}
+	size_t TotalPages = Images * DATALOGGER_NUMBER_OF_PAGES;
+	size_t Size = Images * Image.size();
+	uint64_t Expected = (uint64_t)TotalPages * ((DATALOGGER_PAGE_SIZE - DATALOGGER_PAGE_HEADER_SIZE) / DATALOGGER_RECORD_SIZE);
+	
+	const char *Directory = getenv("TMPDIR");
+	std::string Name = std::string((Directory != NULL) ? Directory : "/tmp") + "/logdecode-XXXXXX";
+	int File = mkstemp(&Name[0]);
+	if(File < 0)
+	{
+		fprintf(stderr, "Cannot make a file in %s: %s\n", (Directory != NULL) ? Directory : "/tmp", strerror(errno));
+		return 1;
+	}
+	unlink(Name.c_str());
+	for(size_t i = 0; i < Images; i++)
+	{
+		if(write(File, Image.data(), Image.size()) != (ssize_t)Image.size())
+		{
+			fprintf(stderr, "Cannot write the dump: %s\n", strerror(errno));
+			close(File);
+			return 1;
+		}
+	}
+	const uint8_t *Dump = (const uint8_t *)mmap(NULL, Size, PROT_READ, MAP_PRIVATE, File, 0);
+	close(File);
+	if(Dump == MAP_FAILED)
+	{
+		fprintf(stderr, "Cannot map the dump: %s\n", strerror(errno));
+		return 1;
+	}
+	
+	//Fault the pages in so that the first run is not slower for it
+	volatile uint8_t Touch = 0;
+	for(size_t i = 0; i < Size; i += 4096)
+	{
+		Touch ^= Dump[i];
+	}
+	
+	FILE *Output = fopen("/dev/null", "wb");
+	if(Output == NULL)
+	{
+		fprintf(stderr, "Cannot open /dev/null: %s\n", strerror(errno));
+		munmap((void *)Dump, Size);
+		return 1;
+	}
+	
+	printf("%zu images, %.2f GB, %llu records, %s output\n", Images, (double)Size / 1e9, (unsigned long long)Expected,
+	       LogDecode_FormatNames[Format]);
+	printf("Threads   Seconds      MB/s   Speed up\n");
+	double OneThread = 0;
+	bool AllRecords = true;
+	for(unsigned Threads = 1; ; Threads *= 2)
+	{
+		if(Threads > MostThreads)
+		{
+			Threads = MostThreads;
+		}
+		auto Start = std::chrono::steady_clock::now();
+		LogTotals Totals = DecodeDump(Dump, TotalPages, Threads, Format, Output);
+		fflush(Output);
+		double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		if(Threads == 1)
+		{
+			OneThread = Seconds;
+		}
+		printf("%7u  %8.2f  %8.0f  %9.2f\n", Threads, Seconds, (double)Size / 1e6 / Seconds, OneThread / Seconds);
+		fflush(stdout);
+		if((Totals.Records != Expected) || (Totals.BadCRC != 0) || (Totals.OtherLayout != 0))
+		{
+			AllRecords = false;
+		}
+		if(Threads == MostThreads)
+		{
+			break;
+		}
+	}
+	fclose(Output);
+	munmap((void *)Dump, Size);
+	
+	printf("%s\n", AllRecords ? "Every run decoded every record" : "A run did NOT decode every record");
+	return AllRecords ? 0 : 1;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr, "Usage: logdecode [-f csv|col|raw] [-o output] [-j threads] [-z current_zero_counts] dump.bin\n"
+	                "       logdecode -b gigabytes [-f csv|col|raw] [-j threads]\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int Format = LOGDECODE_FORMAT_CSV;
+	const char *OutputName = NULL;
+	const char *InputName = NULL;
+	unsigned Threads = std::thread::hardware_concurrency();
+	double BenchGigabytes = 0;
+	int Option;
+	
+	while((Option = getopt(argc, argv, "f:o:j:z:b:h")) != -1)
+	{
+		switch(Option)
+		{
+			case 'f':
+				if(strcmp(optarg, "csv") == 0)
+				{
+					Format = LOGDECODE_FORMAT_CSV;
+				}
+				else if(strcmp(optarg, "col") == 0)
+				{
+					Format = LOGDECODE_FORMAT_COLUMNAR;
+				}
+				else if(strcmp(optarg, "raw") == 0)
+				{
+					Format = LOGDECODE_FORMAT_RAW;
+				}
+				else
+				{
+					Usage();
+					return 1;
+				}
+				break;
+			case 'o':
+				OutputName = optarg;
+				break;
+			case 'j':
+				Threads = (unsigned)atoi(optarg);
+				break;
+			case 'z':
+				CurrentZeroCounts = (uint32_t)strtoul(optarg, NULL, 0);
+				break;
+			case 'b':
+				BenchGigabytes = atof(optarg);
+				break;
+			default:
+				Usage();
+				return 1;
+		}
+	}
+	if(Threads == 0)
+	{
+		Threads = 1;
+	}
+	if(BenchGigabytes > 0)
+	{
+		BuildCRCTables();
+		return Bench(BenchGigabytes, Threads, Format);
+	}
+	if(optind != (argc - 1))
+	{
+		Usage();
+		return 1;
+	}
+	InputName = argv[optind];
+	
+	int File = open(InputName, O_RDONLY);
+	if(File < 0)
+	{
+		fprintf(stderr, "Cannot open %s: %s\n", InputName, strerror(errno));
+		return 1;
+	}
+	struct stat FileInfo;
+	if(fstat(File, &FileInfo) != 0)
+	{
+		fprintf(stderr, "Cannot read %s: %s\n", InputName, strerror(errno));
+		close(File);
+		return 1;
+	}
+	
+	size_t TotalPages = (size_t)FileInfo.st_size / DATALOGGER_PAGE_SIZE;
+	if(((size_t)FileInfo.st_size % DATALOGGER_PAGE_SIZE) != 0)
+	{
+		fprintf(stderr, "Warning: %s is not a whole number of %u byte pages\n", InputName, DATALOGGER_PAGE_SIZE);
+	}
+	if(TotalPages == 0)
+	{
+		fprintf(stderr, "%s is empty\n", InputName);
+		close(File);
+		return 1;
+	}
+	
+	const uint8_t *Dump = (const uint8_t *)mmap(NULL, (size_t)FileInfo.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+	close(File);
+	if(Dump == MAP_FAILED)
+	{
+		fprintf(stderr, "Cannot map %s: %s\n", InputName, strerror(errno));
+		return 1;
+	}
+	madvise((void *)Dump, (size_t)FileInfo.st_size, MADV_SEQUENTIAL);
+	
+	FILE *Output = stdout;
+	if(OutputName != NULL)
+	{
+		Output = fopen(OutputName, "wb");
+		if(Output == NULL)
+		{
+			fprintf(stderr, "Cannot open %s: %s\n", OutputName, strerror(errno));
+			return 1;
+		}
+	}
+	
+	BuildCRCTables();
+	
+	LogTotals Totals = DecodeDump(Dump, TotalPages, Threads, Format, Output);
+	
+	if(Output != stdout)
+	{
+		fclose(Output);
+	}
+	munmap((void *)Dump, (size_t)FileInfo.st_size);
+	
+	fprintf(stderr, "%zu pages, %llu records, %llu CRC errors, %llu records in an unknown layout\n", TotalPages,
+	        (unsigned long long)Totals.Records, (unsigned long long)Totals.BadCRC, (unsigned long long)Totals.OtherLayout);
+	return 0;
+}
+
+/** @} */
@@ -0,0 +1,1082 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Board model for the replay tool.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	@{
+*/
+
+#include "main.h"
+#include "board.h"
+#include <avr/sleep.h>
+
+//Registers used by the firmware
+volatile uint8_t SREG, MCUSR, MCUCR, WDTCSR;
+volatile uint8_t DDRB, DDRC, DDRD, DDRF, PORTB, PORTC, PORTD, PORTF;
+volatile uint8_t EICRA, EIFR, EIMSK;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1;
+volatile uint8_t TCCR3A, TCCR3B, TCNT3H, TCNT3L, OCR3AH, OCR3AL, TIMSK3;
+volatile uint8_t SPCR, SPSR, SPDR;
+volatile uint8_t TWBR, TWSR, TWDR, TWCR;
+
+//USB is never attached
+volatile uint8_t USB_DeviceState = DEVICE_STATE_Unattached;
+USB_ClassInfo_CDC_Device_t VirtualSerial_CDC_Interface;
+
+uint32_t Board_ADCInput[BOARD_ADC_INPUTS];
+int32_t Board_ADCError[BOARD_ADC_INPUTS];
+uint8_t Board_Flash[BOARD_FLASH_PAGES][BOARD_FLASH_PAGE_SIZE];
+uint32_t Board_FlashErases[BOARD_FLASH_PAGES];
+Board_Stats Board_Counters;
+uint8_t Board_Stuck;
+void (*Board_WatchdogReset)(void);
+uint32_t Board_NowMS;
+uint32_t Board_HangMS;
+uint32_t Board_RelayOffMS;
+uint8_t Board_ADCTiming;
+uint8_t Board_ADCNoise;
+uint8_t Board_SleepTiming;
+const char *Board_Keys;
+uint32_t Board_KeysMS;
+uint8_t Board_SleepMode;
+void (*Board_ADCConversion)(uint8_t Input, uint32_t Counts, uint32_t Read, uint8_t Rate);
+uint32_t (*Board_ADCSource)(uint8_t Input, uint32_t NowMS);
+
+//Firmware state driven by the board
+extern volatile uint16_t ElapsedMS;
+void INT3_vect(void);
+void WDT_vect(void);
+void TIMER1_OVF_vect(void);
+
+//TWI status codes returned for a failed transaction
+#define BOARD_TW_MT_SLA_NACK			0x20
+
+//Time on the buses
+#define BOARD_SPI_BYTE_US				4								//8 bits at Fcpu/2, then the interrupt that starts the next byte
+#define BOARD_TWI_SCL_HZ				100000							//TWI_SCL_FREQ_HZ in config.h
+#define BOARD_TWI_BYTE_US				(9000000UL/BOARD_TWI_SCL_HZ)	//8 bits and the acknowledge
+#define BOARD_TIMER1_TICK_US			128								//Fcpu/1024
+
+//AD7794 state
+static uint8_t ADCMode[2];						//MSB first
+static uint8_t ADCConfig[2];
+static uint8_t ADCIO;
+static uint32_t ADCData;
+static uint8_t ADCReady;
+static uint32_t ADCOffset[BOARD_ADC_INPUTS];	//For each channel
+static uint32_t ADCFullScale[BOARD_ADC_INPUTS];
+static uint32_t ADCBusyUntil;					//Board_NowMS when the calibration or conversion running is done
+static uint8_t ADCConverting;					//1 if it is a conversion
+static uint32_t ADCWaitMS;						//Polls in a row on the calibration running
+static uint32_t ADCLastPollMS;
+
+//Single conversion time in ms for each update rate, two periods of the rate with chop on
+static const uint16_t ADCConversionMS[16] = {0, 5, 9, 17, 33, 40, 52, 61, 103, 120, 120, 160, 200, 241, 320, 480};
+
+//RMS noise in counts for each update rate
+static const double ADCNoiseCounts[16] = {0, 187, 98, 62, 42, 36, 32, 29, 20, 19, 19, 16, 14, 12, 10, 9};
+static uint32_t ADCRandom = 1;
+
+//Watchdog state. The time outs are the typical ones from the datasheet.
+static const uint16_t WDTTimeouts[10] = {16, 32, 64, 125, 250, 500, 1000, 2000, 4000, 8000};
+static uint8_t WDTEnabled;
+static uint32_t WDTTimeout;
+static uint32_t WDTCount;
+static uint32_t RTCPhase;						//ms since the last RTC tick
+static uint8_t TimersStopped;					//1 in power save, which stops timer 0 and timer 1
+
+//Timer 1 state
+static uint32_t Timer1US;						//Time not yet counted by TCNT1
+static uint8_t Timer1Running;
+static uint16_t Timer1Last;						//TCNT1 as the model last left it
+
+//AT45DB321D state
+static uint8_t FlashBuffer[2][BOARD_FLASH_PAGE_SIZE];
+static uint8_t FlashPoweredDown;
+
+//DS3232M state
+static uint8_t RTCRegisters[256];
+static uint8_t RTCPointer;
+static time_t RTCTime;
+
+//MAX7315 state
+static uint8_t IORegisters[256];
+static uint8_t IOPointer;
+static uint8_t IOInputs;
+
+static void Board_Timer1(uint32_t US);
+static void Board_BusTime(uint32_t US);
+static void Board_HangStep(uint8_t Interrupts);
+static void Board_Hang(uint8_t Interrupts);
+static void Board_AD7794(SPIBus_Transaction *Transaction);
+static void Board_AT45DB321D(SPIBus_Transaction *Transaction);
+static uint8_t Board_DS3232M(TWIBus_Transaction *Transaction);
+static uint8_t Board_MAX7315(TWIBus_Transaction *Transaction);
+static void Board_GetBytes(SPIBus_Transaction *Transaction, uint16_t Offset, uint8_t Data[], uint16_t Length);
+static void Board_PutBytes(SPIBus_Transaction *Transaction, const uint8_t Data[], uint16_t Length);
+static uint8_t Board_ToBCD(uint8_t Value);
+static uint8_t Board_FromBCD(uint8_t Value);
+static int32_t Board_Noise(uint8_t Rate);
+static void Board_ADCConvert(uint8_t Channel, uint16_t TimeMS);
+
+void Board_Reset(time_t Time)
+{
+	memset(Board_Flash, 0xFF, sizeof(Board_Flash));
+	memset(Board_FlashErases, 0, sizeof(Board_FlashErases));
+	memset(FlashBuffer, 0xFF, sizeof(FlashBuffer));
+	FlashPoweredDown = 0;
+
+	memset(RTCRegisters, 0x00, sizeof(RTCRegisters));
+	RTCPointer = 0;
+	RTCTime = Time;
+
+	memset(IORegisters, 0x00, sizeof(IORegisters));
+	IOPointer = 0;
+	IOInputs = 0xFF;
+
+	memset(&Board_Counters, 0, sizeof(Board_Counters));
+	ADCRandom = 1;
+	Board_Stuck = BOARD_STUCK_NONE;
+	Board_NowMS = 0;
+	Board_HangMS = 0;
+	Board_RelayOffMS = 0;
+	WDTEnabled = 0;
+	RTCPhase = 0;
+	TimersStopped = 0;
+	TCCR1B = 0;
+	TCNT1 = 0;
+	TIFR1 = 0;
+	Timer1US = 0;
+	Timer1Running = 0;
+	return;
+}
+
+time_t Board_GetTime(void)
+{
+	return RTCTime;
+}
+
+void Board_SetTime(time_t Time)
+{
+	RTCTime = Time;
+	return;
+}
+
+void Board_Sleep(void)
+{
+	uint32_t Step;
+
+	if(Board_SleepTiming == 0)
+	{
+		return;
+	}
+
+	//Idle sleep ends on the next timer 0 interrupt. Power save stops timer 0, so it ends on the next RTC tick.
+	if(Board_SleepMode == SLEEP_MODE_IDLE)
+	{
+		Board_Counters.SleepIdleMS++;
+		Board_Elapse(1, 1);
+	}
+	else
+	{
+		Step = BOARD_RTC_TICK_MS - RTCPhase;
+		Board_Counters.SleepSaveMS += Step;
+		TimersStopped = 1;
+		Board_Elapse(Step, 1);
+		TimersStopped = 0;
+	}
+	return;
+}
+
+void Board_SetInputs(uint8_t Inputs)
+{
+	IOInputs = Inputs;
+	return;
+}
+
+void Board_Elapse(uint32_t MS, uint8_t Interrupts)
+{
+	uint32_t Step;
+
+	while(MS > 0)
+	{
+		//Step to the next RTC tick or watchdog time out, whichever comes first
+		Step = MS;
+		if(Step > (BOARD_RTC_TICK_MS - RTCPhase))
+		{
+			Step = BOARD_RTC_TICK_MS - RTCPhase;
+		}
+		if((WDTEnabled == 1) && (Step > (WDTTimeout - WDTCount)))
+		{
+			Step = WDTTimeout - WDTCount;
+		}
+		MS -= Step;
+		Board_NowMS += Step;
+		RTCPhase += Step;
+		WDTCount += Step;
+		if(FlashPoweredDown == 1)
+		{
+			Board_Counters.FlashPowerDownMS += Step;
+		}
+		if((ADCMode[0] & 0xE0) == AD7794_MRH_MODE_POWERDOWN)
+		{
+			Board_Counters.ADCPowerDownMS += Step;
+		}
+		if(TimersStopped == 0)
+		{
+			Board_Timer1(Step * 1000);
+			if(Interrupts == 1)
+			{
+				//Timer 0 takes the CDC input every 8ms
+				if(((ElapsedMS + Step) / 8) != (ElapsedMS / 8))
+				{
+					Shell_Receive();
+				}
+				ElapsedMS = (ElapsedMS + Step) % 60000;
+			}
+		}
+		if((Interrupts == 1) && ((TIFR1 & (1<<TOV1)) != 0) && ((TIMSK1 & (1<<TOIE1)) != 0))
+		{
+			TIFR1 &= ~(1<<TOV1);
+			TIMER1_OVF_vect();
+		}
+
+		if(RTCPhase >= BOARD_RTC_TICK_MS)
+		{
+			RTCPhase = 0;
+			if(Interrupts == 1)
+			{
+				INT3_vect();
+			}
+		}
+
+		//When the relay went off for good after the hang
+		if(Board_HangMS != 0)
+		{
+			if((PORTD & (1<<6)) != 0)
+			{
+				Board_RelayOffMS = 0;
+			}
+			else if(Board_RelayOffMS == 0)
+			{
+				Board_RelayOffMS = Board_NowMS;
+			}
+		}
+
+		//The first time out in interrupt and reset mode runs the interrupt (if it can) and clears WDIE. The next one
+		//resets the processor.
+		if((WDTEnabled == 1) && (WDTCount >= WDTTimeout))
+		{
+			WDTCount = 0;
+			if((WDTCSR & (1<<WDIE)) != 0)
+			{
+				WDTCSR &= ~(1<<WDIE);
+				if(Interrupts == 1)
+				{
+					WDT_vect();
+				}
+			}
+			else
+			{
+				Board_Counters.WatchdogResets++;
+				MCUSR |= (1<<WDRF);
+				Board_Stuck = BOARD_STUCK_NONE;
+				Board_WatchdogReset();
+			}
+		}
+	}
+	return;
+}
+
+//Timer 1 at Fcpu/1024, if it is running. An overflow sets TOV1, and Board_Elapse runs the interrupt.
+static void Board_Timer1(uint32_t US)
+{
+	uint32_t Count;
+
+	if((TCCR1B & ((1<<CS12)|(1<<CS11)|(1<<CS10))) == 0)
+	{
+		Timer1Running = 0;
+		return;
+	}
+	if((Timer1Running == 0) || (TCNT1 != Timer1Last))
+	{
+		//Started or set by the firmware since the last look. The firmware clears TOV1 as it starts the timer, by writing
+		//a 1 to it, which a plain variable can not model.
+		Timer1Running = 1;
+		Timer1US = 0;
+		TIFR1 &= ~(1<<TOV1);
+	}
+	Timer1US += US;
+	Count = (uint32_t)TCNT1 + (Timer1US / BOARD_TIMER1_TICK_US);
+	Timer1US %= BOARD_TIMER1_TICK_US;
+	if(Count > 0xFFFF)
+	{
+		TIFR1 |= (1<<TOV1);
+	}
+	TCNT1 = (uint16_t)Count;
+	Timer1Last = TCNT1;
+	return;
+}
+
+//A transfer on one of the buses. Only timer 1 sees it.
+static void Board_BusTime(uint32_t US)
+{
+	Board_Counters.BusUS += US;
+	Board_Timer1(US);
+	return;
+}
+
+//Watchdog. Only modeled while there is somewhere to go on a reset.
+
+void wdt_enable(uint8_t Timeout)
+{
+	WDTEnabled = (Board_WatchdogReset != NULL) ? 1 : 0;
+	WDTTimeout = WDTTimeouts[Timeout];
+	WDTCount = 0;
+	WDTCSR = (1<<WDE);
+	return;
+}
+
+void wdt_disable(void)
+{
+	WDTEnabled = 0;
+	WDTCSR = 0;
+	return;
+}
+
+void wdt_reset(void)
+{
+	WDTCount = 0;
+	return;
+}
+
+//One ms of waiting on a hung part
+static void Board_HangStep(uint8_t Interrupts)
+{
+	if(Board_HangMS == 0)
+	{
+		Board_HangMS = Board_NowMS;
+	}
+	if(Board_WatchdogReset == NULL)
+	{
+		fprintf(stderr, "The firmware hung with no watchdog model\n");
+		exit(1);
+	}
+	Board_Elapse(1, Interrupts);
+	return;
+}
+
+//Wait forever on a hung part, with the clock running
+static void Board_Hang(uint8_t Interrupts)
+{
+	for(;;)
+	{
+		Board_HangStep(Interrupts);
+	}
+}
+
+//SPI bus. Each transaction runs when it is submitted.
+
+void SPIBus_InitTransaction(SPIBus_Transaction *Transaction, uint8_t Device)
+{
+	memset(Transaction, 0, sizeof(SPIBus_Transaction));
+	Transaction->Device = Device;
+	return;
+}
+
+void SPIBus_Submit(SPIBus_Transaction *Transaction)
+{
+	Board_Counters.SPITransactions++;
+	Board_BusTime((Transaction->HeaderLength + Transaction->DataLength) * BOARD_SPI_BYTE_US);
+	if(Transaction->Device == SPIBUS_DEVICE_AD7794)
+	{
+		Board_AD7794(Transaction);
+	}
+	else if(Transaction->Device == SPIBUS_DEVICE_AT45DB321D)
+	{
+		Board_AT45DB321D(Transaction);
+	}
+
+	Transaction->Status = SPIBUS_STATUS_DONE;
+	if(Transaction->Callback != NULL)
+	{
+		Transaction->Callback(Transaction);
+	}
+	return;
+}
+
+void SPIBus_Wait(SPIBus_Transaction *Transaction)
+{
+	(void)Transaction;
+	return;
+}
+
+void SPIBus_Transfer(SPIBus_Transaction *Transaction)
+{
+	SPIBus_Submit(Transaction);
+	return;
+}
+
+uint8_t SPIBus_Idle(void)
+{
+	return 1;
+}
+
+//TWI bus. Each transaction runs when it is submitted.
+
+void TWIBus_Init(void)
+{
+	return;
+}
+
+void TWIBus_Submit(TWIBus_Transaction *Transaction)
+{
+	Board_Counters.TWITransactions++;
+	if((Board_Stuck == BOARD_STUCK_TWI) || (Board_Stuck == BOARD_STUCK_TWI_CLI))
+	{
+		//The transaction never finishes
+		Transaction->Status = TWIBUS_STATUS_ACTIVE;
+		return;
+	}
+	Board_BusTime((1 + Transaction->TxLength + ((Transaction->RxLength != 0) ? (1 + Transaction->RxLength) : 0)) * BOARD_TWI_BYTE_US);
+	if(Transaction->Address == DS3232M_SLA_ADDRESS)
+	{
+		Transaction->Result = Board_DS3232M(Transaction);
+	}
+	else if(Transaction->Address == MAX7315_SLA_7B)
+	{
+		Transaction->Result = Board_MAX7315(Transaction);
+	}
+	else
+	{
+		Transaction->Result = BOARD_TW_MT_SLA_NACK;
+	}
+
+	if(Transaction->Result != TWIBUS_RESULT_OK)
+	{
+		Board_Counters.TWIErrors++;
+	}
+	Transaction->Status = TWIBUS_STATUS_DONE;
+	if(Transaction->Callback != NULL)
+	{
+		Transaction->Callback(Transaction);
+	}
+	return;
+}
+
+uint8_t TWIBus_Wait(TWIBus_Transaction *Transaction)
+{
+	if((Board_Stuck == BOARD_STUCK_TWI) || (Board_Stuck == BOARD_STUCK_TWI_CLI))
+	{
+		Board_Hang((Board_Stuck == BOARD_STUCK_TWI_CLI) ? 0 : 1);
+	}
+	if(Transaction->Status != TWIBUS_STATUS_DONE)
+	{
+		//Submitted while the bus was stuck, before a watchdog reset. The real firmware starts over with its RAM cleared,
+		//the replay keeps it, so run the transaction now.
+		TWIBus_Submit(Transaction);
+	}
+	return Transaction->Result;
+}
+
+uint8_t TWIBus_ReadWrite(uint8_t Address, const uint8_t *SendData, uint8_t *ReceiveData, uint8_t BytesToSend, uint8_t BytesToReceive)
+{
+	TWIBus_Transaction Transaction;
+
+	memset(&Transaction, 0, sizeof(Transaction));
+	Transaction.Address = Address;
+	Transaction.TxData = SendData;
+	Transaction.TxLength = BytesToSend;
+	Transaction.RxData = ReceiveData;
+	Transaction.RxLength = BytesToReceive;
+	TWIBus_Submit(&Transaction);
+	return TWIBus_Wait(&Transaction);
+}
+
+uint8_t TWIBus_Idle(void)
+{
+	return 1;
+}
+
+//USB and command line. Nothing is ever received.
+
+void USB_Init(void)
+{
+	return;
+}
+
+void USB_USBTask(void)
+{
+	return;
+}
+
+int16_t CDC_Device_ReceiveByte(USB_ClassInfo_CDC_Device_t *CDCInterfaceInfo)
+{
+	int16_t Byte;
+
+	(void)CDCInterfaceInfo;
+	if((Board_Keys == NULL) || (Board_NowMS < Board_KeysMS))
+	{
+		return -1;
+	}
+	Byte = (uint8_t)*Board_Keys;
+	Board_Keys++;
+	if(*Board_Keys == 0)
+	{
+		Board_Keys = NULL;
+	}
+	return Byte;
+}
+
+void CDC_Device_USBTask(USB_ClassInfo_CDC_Device_t *CDCInterfaceInfo)
+{
+	(void)CDCInterfaceInfo;
+	return;
+}
+
+void CommandGetInputChar(uint8_t c)
+{
+	(void)c;
+	return;
+}
+
+//avr-libc float to string
+char *dtostrf(double Value, signed char Width, unsigned char Precision, char *Output)
+{
+	sprintf(Output, "%*.*f", Width, Precision, Value);
+	return Output;
+}
+
+//Start a conversion that takes 'TimeMS' with Board_ADCTiming set. It is done right away, with the input at the start and
+//what is left of the offset error.
+static void Board_ADCConvert(uint8_t Channel, uint16_t TimeMS)
+{
+	uint32_t Input;
+
+	Input = (Board_ADCSource != NULL) ? (Board_ADCSource(Channel, Board_NowMS) & 0xFFFFFF) : Board_ADCInput[Channel];
+	ADCData = (Input + Board_ADCError[Channel] - (ADCOffset[Channel] - BOARD_ADC_OFFSET)) & 0xFFFFFF;
+	if(Board_ADCNoise == 1)
+	{
+		ADCData = (ADCData + Board_Noise(ADCMode[1] & 0x0F)) & 0xFFFFFF;
+	}
+	if(Board_ADCConversion != NULL)
+	{
+		Board_ADCConversion(Channel, Input, ADCData, ADCMode[1] & 0x0F);
+	}
+	ADCReady = 1;
+	Board_Counters.ADCConversions++;
+	if(Board_ADCTiming == 1)
+	{
+		//Ready after the conversion time
+		ADCReady = 0;
+		ADCConverting = 1;
+		ADCBusyUntil = Board_NowMS + TimeMS;
+		Board_Counters.ADCBusyMS += TimeMS;
+		if((ADCMode[0] & 0xE0) == AD7794_MRH_MODE_CONTINUOUS)
+		{
+			Board_Counters.ADCBurstMS += TimeMS;
+		}
+	}
+	return;
+}
+
+//AD7794. Register writes are sent in the header, register reads in the data phase.
+static void Board_AD7794(SPIBus_Transaction *Transaction)
+{
+	uint8_t Register;
+	uint8_t Channel;
+	uint8_t ReadData[3];
+	uint32_t Value;
+	uint8_t i;
+
+	//32 ones resets the part
+	if((Transaction->HeaderLength >= 4) && (Transaction->Header[0] == 0xFF) && (Transaction->Header[1] == 0xFF) && (Transaction->Header[2] == 0xFF) && (Transaction->Header[3] == 0xFF))
+	{
+		ADCMode[0] = 0x00;
+		ADCMode[1] = 0x0A;
+		ADCConfig[0] = 0x07;
+		ADCConfig[1] = 0x10;
+		ADCIO = 0x00;
+		ADCData = 0;
+		ADCReady = 0;
+		ADCBusyUntil = 0;
+		ADCConverting = 0;
+		for(i=0; i<BOARD_ADC_INPUTS; i++)
+		{
+			ADCOffset[i] = BOARD_ADC_OFFSET;
+			ADCFullScale[i] = BOARD_ADC_FULL_SCALE;
+		}
+		return;
+	}
+	Channel = ADCConfig[1] & 0x0F;
+	if(Channel >= BOARD_ADC_INPUTS)
+	{
+		Channel = 0;
+	}
+
+	Register = (Transaction->Header[0] >> 3) & 0x07;
+	if((Transaction->Header[0] & AD7794_CR_READ) == AD7794_CR_READ)
+	{
+		memset(ReadData, 0, sizeof(ReadData));
+		switch(Register)
+		{
+			case AD7794_CR_REG_STATUS:
+				if(Board_NowMS < ADCBusyUntil)
+				{
+					//The firmware is waiting on the part. Polls right after each other on a calibration are one wait.
+					if(ADCConverting == 0)
+					{
+						ADCWaitMS = (ADCLastPollMS == Board_NowMS) ? (ADCWaitMS + 1) : 1;
+						if(ADCWaitMS > Board_Counters.ADCLongestWaitMS)
+						{
+							Board_Counters.ADCLongestWaitMS = ADCWaitMS;
+						}
+					}
+					Board_Elapse(1, 1);
+					ADCLastPollMS = Board_NowMS;
+				}
+				if((ADCBusyUntil != 0) && (Board_NowMS >= ADCBusyUntil))
+				{
+					//Done, and back to idle unless converting continuously
+					ADCBusyUntil = 0;
+					ADCConverting = 0;
+					ADCReady = 1;
+					if((ADCMode[0] & 0xE0) != AD7794_MRH_MODE_CONTINUOUS)
+					{
+						ADCMode[0] = (ADCMode[0] & 0x1F) | AD7794_MRH_MODE_IDLE;
+					}
+				}
+				ReadData[0] = (ADCReady ? 0x00 : 0x80) | 0x08 | (ADCConfig[1] & 0x07);
+				break;
+
+			case AD7794_CR_REG_MODE:
+				ReadData[0] = ADCMode[0];
+				ReadData[1] = ADCMode[1];
+				break;
+
+			case AD7794_CR_REG_CONFIG:
+				ReadData[0] = ADCConfig[0];
+				ReadData[1] = ADCConfig[1];
+				break;
+
+			case AD7794_CR_REG_DATA:
+				ReadData[0] = (uint8_t)(ADCData >> 16);
+				ReadData[1] = (uint8_t)(ADCData >> 8);
+				ReadData[2] = (uint8_t)ADCData;
+				ADCReady = 0;
+				if(((ADCMode[0] & 0xE0) == AD7794_MRH_MODE_CONTINUOUS) && (ADCBusyUntil == 0))
+				{
+					//The next conversion, one period
+					i = ADCMode[1] & 0x0F;
+					Board_ADCConvert(Channel, (ADCConversionMS[i] > 1) ? (ADCConversionMS[i] / 2) : 1);
+				}
+				break;
+
+			case AD7794_CR_REG_ID:
+				ReadData[0] = 0x0F;
+				break;
+
+			case AD7794_CR_REG_IO:
+				ReadData[0] = ADCIO;
+				break;
+
+			case AD7794_CR_REG_OFFSET:
+			case AD7794_CR_REG_FS:
+				Value = (Register == AD7794_CR_REG_OFFSET) ? ADCOffset[Channel] : ADCFullScale[Channel];
+				ReadData[0] = (uint8_t)(Value >> 16);
+				ReadData[1] = (uint8_t)(Value >> 8);
+				ReadData[2] = (uint8_t)Value;
+				break;
+		}
+		Board_PutBytes(Transaction, ReadData, 3);
+		return;
+	}
+
+	//Any write stops a calibration or conversion that is running
+	if(ADCBusyUntil != 0)
+	{
+		ADCBusyUntil = 0;
+		if(ADCConverting == 0)
+		{
+			Board_Counters.ADCCalibrationsCut++;
+		}
+		ADCConverting = 0;
+	}
+	switch(Register)
+	{
+		case AD7794_CR_REG_MODE:
+			ADCMode[0] = Transaction->Header[1];
+			ADCMode[1] = Transaction->Header[2];
+			i = ADCMode[0] & 0xE0;
+			if((i == AD7794_MRH_MODE_IZ_CAL) || (i == AD7794_MRH_MODE_IFS_CAL))
+			{
+				//The result goes in the register at the start, the firmware only reads it once the part is ready
+				ADCReady = 0;
+				ADCBusyUntil = Board_NowMS + BOARD_ADC_CAL_MS;
+				Board_Counters.ADCCalibrations++;
+				if(i == AD7794_MRH_MODE_IZ_CAL)
+				{
+					ADCOffset[Channel] = BOARD_ADC_OFFSET + Board_ADCError[Channel];
+				}
+				else
+				{
+					ADCFullScale[Channel] = BOARD_ADC_FULL_SCALE + Board_ADCError[Channel];
+				}
+			}
+			if(i == AD7794_MRH_MODE_CONTINUOUS)
+			{
+				Board_Counters.ADCBursts++;
+			}
+			if((i == AD7794_MRH_MODE_SINGLE) || (i == AD7794_MRH_MODE_CONTINUOUS))
+			{
+				Board_ADCConvert(Channel, ADCConversionMS[ADCMode[1] & 0x0F]);
+				if(i == AD7794_MRH_MODE_SINGLE)
+				{
+					ADCMode[0] = (ADCMode[0] & 0x1F) | AD7794_MRH_MODE_IDLE;
+				}
+			}
+			break;
+
+		case AD7794_CR_REG_CONFIG:
+			ADCConfig[0] = Transaction->Header[1];
+			ADCConfig[1] = Transaction->Header[2];
+			break;
+
+		case AD7794_CR_REG_IO:
+			ADCIO = Transaction->Header[1];
+			break;
+
+		case AD7794_CR_REG_OFFSET:
+		case AD7794_CR_REG_FS:
+			Value = ((uint32_t)Transaction->Header[1] << 16) | ((uint32_t)Transaction->Header[2] << 8) | Transaction->Header[3];
+			if(Register == AD7794_CR_REG_OFFSET)
+			{
+				ADCOffset[Channel] = Value;
+			}
+			else
+			{
+				ADCFullScale[Channel] = Value;
+			}
+			break;
+	}
+	return;
+}
+
+//AT45DB321D in 528 byte page mode. Programming and erasing finish right away, so the part is always ready.
+static void Board_AT45DB321D(SPIBus_Transaction *Transaction)
+{
+	uint8_t Command;
+	uint16_t Page;
+	uint16_t Address;
+	uint8_t Buffer;
+	uint8_t ReadData[4];
+	uint16_t i;
+
+	Command = Transaction->Header[0];
+	if(FlashPoweredDown == 1)
+	{
+		if(Command == AT45DB321D_CMD_POWERUP)
+		{
+			FlashPoweredDown = 0;
+		}
+		else
+		{
+			Board_Counters.FlashIgnoredCommands++;
+		}
+		return;
+	}
+
+	Page = (((uint16_t)Transaction->Header[1] << 6) | (Transaction->Header[2] >> 2)) % BOARD_FLASH_PAGES;
+	Address = (((uint16_t)(Transaction->Header[2] & 0x03) << 8) | Transaction->Header[3]) % BOARD_FLASH_PAGE_SIZE;
+	Buffer = 0;
+
+	switch(Command)
+	{
+		case AT45DB321D_CMD_READ_DEVICE_ID:
+			ReadData[0] = 0x1F;
+			ReadData[1] = 0x27;
+			ReadData[2] = 0x01;
+			ReadData[3] = 0x00;
+			Board_PutBytes(Transaction, ReadData, 4);
+			break;
+
+		case AT45DB321D_CMD_READ_STATUS:
+			ReadData[0] = 0xB4;			//Ready, 32Mbit, 528 byte pages
+			if(Board_Stuck == BOARD_STUCK_FLASH)
+			{
+				//Busy, and each poll takes some time
+				ReadData[0] = 0x34;
+				Board_HangStep(1);
+			}
+			Board_PutBytes(Transaction, ReadData, 1);
+			break;
+
+		case AT45DB321D_CMD_POWERDOWN:
+			FlashPoweredDown = 1;
+			break;
+
+		case AT45DB321D_CMD_BUFFER2_WRITE:
+			Buffer = 1;
+			//Fall through
+		case AT45DB321D_CMD_BUFFER1_WRITE:
+			for(i=0; i<Transaction->DataLength; i++)
+			{
+				Board_GetBytes(Transaction, i, &FlashBuffer[Buffer][(Address + i) % BOARD_FLASH_PAGE_SIZE], 1);
+			}
+			break;
+
+		case AT45DB321D_CMD_BUFFER2_READ_HS:
+		case AT45DB321D_CMD_BUFFER2_READ_LS:
+			Buffer = 1;
+			//Fall through
+		case AT45DB321D_CMD_BUFFER1_READ_HS:
+		case AT45DB321D_CMD_BUFFER1_READ_LS:
+			if(Transaction->RxData != NULL)
+			{
+				for(i=0; i<Transaction->DataLength; i++)
+				{
+					Transaction->RxData[i] = FlashBuffer[Buffer][(Address + i) % BOARD_FLASH_PAGE_SIZE];
+				}
+			}
+			break;
+
+		case AT45DB321D_CMD_PAGE_READ:
+			Board_Counters.FlashArrayBytes += Transaction->DataLength;
+			if(Transaction->RxData != NULL)
+			{
+				for(i=0; i<Transaction->DataLength; i++)
+				{
+					Transaction->RxData[i] = Board_Flash[Page][(Address + i) % BOARD_FLASH_PAGE_SIZE];
+				}
+			}
+			break;
+
+		case AT45DB321D_CMD_TRANSFER_PAGE_TO_BUFFER2:
+			Buffer = 1;
+			//Fall through
+		case AT45DB321D_CMD_TRANSFER_PAGE_TO_BUFFER1:
+			memcpy(FlashBuffer[Buffer], Board_Flash[Page], BOARD_FLASH_PAGE_SIZE);
+			Board_Counters.FlashArrayBytes += BOARD_FLASH_PAGE_SIZE;
+			break;
+
+		case AT45DB321D_CMD_BUFFER2_TO_PAGE_ERASE:
+			Buffer = 1;
+			//Fall through
+		case AT45DB321D_CMD_BUFFER1_TO_PAGE_ERASE:
+			memcpy(Board_Flash[Page], FlashBuffer[Buffer], BOARD_FLASH_PAGE_SIZE);
+			Board_FlashErases[Page]++;
+			Board_Counters.FlashPageErases++;
+			Board_Counters.FlashPagePrograms++;
+			break;
+
+		case AT45DB321D_CMD_BUFFER2_TO_PAGE_NOERASE:
+			Buffer = 1;
+			//Fall through
+		case AT45DB321D_CMD_BUFFER1_TO_PAGE_NOERASE:
+			//Programming can only clear bits
+			for(i=0; i<BOARD_FLASH_PAGE_SIZE; i++)
+			{
+				Board_Flash[Page][i] &= FlashBuffer[Buffer][i];
+			}
+			Board_Counters.FlashPagePrograms++;
+			break;
+
+		case AT45DB321D_CMD_PAGE_ERASE:
+			memset(Board_Flash[Page], 0xFF, BOARD_FLASH_PAGE_SIZE);
+			Board_FlashErases[Page]++;
+			Board_Counters.FlashPageErases++;
+			break;
+
+		case AT45DB321D_CMD_BLOCK_ERASE:
+			Page = Page & ~0x0007;
+			memset(Board_Flash[Page], 0xFF, 8*BOARD_FLASH_PAGE_SIZE);
+			for(i=0; i<8; i++)
+			{
+				Board_FlashErases[Page + i]++;
+			}
+			Board_Counters.FlashPageErases += 8;
+			break;
+
+		case AT45DB321D_CMD_CHIP_ERASE1:
+			if((Transaction->HeaderLength == 4) && (Transaction->Header[1] == AT45DB321D_CMD_CHIP_ERASE2) && (Transaction->Header[2] == AT45DB321D_CMD_CHIP_ERASE3) && (Transaction->Header[3] == AT45DB321D_CMD_CHIP_ERASE4))
+			{
+				memset(Board_Flash, 0xFF, sizeof(Board_Flash));
+				for(i=0; i<BOARD_FLASH_PAGES; i++)
+				{
+					Board_FlashErases[i]++;
+				}
+				Board_Counters.FlashPageErases += BOARD_FLASH_PAGES;
+			}
+			break;
+	}
+	return;
+}
+
+//DS3232M. The time registers are made from the virtual clock when they are read.
+static uint8_t Board_DS3232M(TWIBus_Transaction *Transaction)
+{
+	struct tm Time;
+	uint8_t TimeWritten = 0;
+	uint8_t i;
+
+	gmtime_r(&RTCTime, &Time);
+	RTCRegisters[DS3232M_REG_SEC] = Board_ToBCD(Time.tm_sec);
+	RTCRegisters[DS3232M_REG_MIN] = Board_ToBCD(Time.tm_min);
+	RTCRegisters[DS3232M_REG_HOUR] = Board_ToBCD(Time.tm_hour);
+	RTCRegisters[DS3232M_REG_DAY] = Time.tm_wday + 1;
+	RTCRegisters[DS3232M_REG_DAY+1] = Board_ToBCD(Time.tm_mday);
+	RTCRegisters[DS3232M_REG_MONTH] = Board_ToBCD(Time.tm_mon + 1);
+	RTCRegisters[DS3232M_REG_YEAR] = Board_ToBCD(Time.tm_year % 100);
+	RTCRegisters[DS3232M_REG_TEMP_HI] = 25;
+
+	//The first byte written sets the register pointer
+	if(Transaction->TxLength > 0)
+	{
+		RTCPointer = Transaction->TxData[0];
+		for(i=1; i<Transaction->TxLength; i++)
+		{
+			if(RTCPointer <= DS3232M_REG_YEAR)
+			{
+				TimeWritten = 1;
+			}
+			RTCRegisters[RTCPointer++] = Transaction->TxData[i];
+		}
+	}
+
+	if(TimeWritten == 1)
+	{
+		memset(&Time, 0, sizeof(Time));
+		Time.tm_sec = Board_FromBCD(RTCRegisters[DS3232M_REG_SEC]);
+		Time.tm_min = Board_FromBCD(RTCRegisters[DS3232M_REG_MIN]);
+		Time.tm_hour = Board_FromBCD(RTCRegisters[DS3232M_REG_HOUR] & 0x3F);
+		Time.tm_mday = Board_FromBCD(RTCRegisters[DS3232M_REG_DAY+1]);
+		Time.tm_mon = Board_FromBCD(RTCRegisters[DS3232M_REG_MONTH] & 0x1F) - 1;
+		Time.tm_year = 100 + Board_FromBCD(RTCRegisters[DS3232M_REG_YEAR]);
+		RTCTime = timegm(&Time);
+	}
+
+	for(i=0; i<Transaction->RxLength; i++)
+	{
+		if(Transaction->RxData != NULL)
+		{
+			Transaction->RxData[i] = RTCRegisters[RTCPointer];
+		}
+		RTCPointer++;
+	}
+	return TWIBUS_RESULT_OK;
+}
+
+//MAX7315. The input register reads the button inputs, everything else reads back what was written.
+static uint8_t Board_MAX7315(TWIBus_Transaction *Transaction)
+{
+	uint8_t i;
+
+	IORegisters[MAX7315_REG_INPUTS] = IOInputs;
+	if(Transaction->TxLength > 0)
+	{
+		IOPointer = Transaction->TxData[0];
+		for(i=1; i<Transaction->TxLength; i++)
+		{
+			IORegisters[IOPointer++] = Transaction->TxData[i];
+		}
+	}
+
+	for(i=0; i<Transaction->RxLength; i++)
+	{
+		if(Transaction->RxData != NULL)
+		{
+			Transaction->RxData[i] = IORegisters[IOPointer];
+		}
+		IOPointer++;
+	}
+	return TWIBUS_RESULT_OK;
+}
+
+//Copy 'Length' bytes that the master sent, starting 'Offset' bytes into the data phase
+static void Board_GetBytes(SPIBus_Transaction *Transaction, uint16_t Offset, uint8_t Data[], uint16_t Length)
+{
+	uint16_t i;
+
+	for(i=0; i<Length; i++)
+	{
+		if(Transaction->TxData != NULL)
+		{
+			Data[i] = Transaction->TxData[Offset + i];
+		}
+		else
+		{
+			Data[i] = 0x00;
+		}
+	}
+	return;
+}
+
+//Return data to the master in the data phase. Bytes past the end of 'Data' read as 0xFF.
+static void Board_PutBytes(SPIBus_Transaction *Transaction, const uint8_t Data[], uint16_t Length)
+{
+	uint16_t i;
+
+	if(Transaction->RxData == NULL)
+	{
+		return;
+	}
+	for(i=0; i<Transaction->DataLength; i++)
+	{
+		if(i < Length)
+		{
+			Transaction->RxData[i] = Data[i];
+		}
+		else
+		{
+			Transaction->RxData[i] = 0xFF;
+		}
+	}
+	return;
+}
+
+static uint8_t Board_ToBCD(uint8_t Value)
+{
+	return (uint8_t)(((Value / 10) << 4) | (Value % 10));
+}
+
+static uint8_t Board_FromBCD(uint8_t Value)
+{
+	return (uint8_t)(((Value >> 4) * 10) + (Value & 0x0F));
+}
+
+//Gaussian noise for a conversion at 'Rate', from xorshift32 and the Box-Muller transform
+static int32_t Board_Noise(uint8_t Rate)
+{
+	double Uniform[2];
+	uint8_t i;
+
+	for(i=0; i<2; i++)
+	{
+		ADCRandom ^= ADCRandom << 13;
+		ADCRandom ^= ADCRandom >> 17;
+		ADCRandom ^= ADCRandom << 5;
+		Uniform[i] = ((double)ADCRandom + 1.0) / 4294967297.0;
+	}
+	return (int32_t)lround(ADCNoiseCounts[Rate & 0x0F] * sqrt(-2.0 * log(Uniform[0])) * cos(2.0 * M_PI * Uniform[1]));
+}
+
+/** @} */
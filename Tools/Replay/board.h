@@ -0,0 +1,175 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Board model for the replay tool.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	board.c replaces spibus.c and twibus.c. Every transaction runs as soon as it is submitted, against models of the
+*	AD7794, AT45DB321D, DS3232M and MAX7315, so the firmware drivers are used without changes. Parts are modeled at the
+*	command level. Conversions and flash programming finish right away and the virtual clock only moves when the replay
+*	tool moves it with Board_Elapse, which also runs the RTC interrupt and the watchdog.
+*
+*	AD7794 internal calibrations are the exception: each takes BOARD_ADC_CAL_MS, and each status poll while one runs moves
+*	the clock by 1ms (with interrupts), as a wait on the real part would. The part has an offset error on each input
+*	(Board_ADCError). A zero scale calibration puts it in the OFFSET register of the selected channel, and conversions
+*	read the input plus the error not taken out by that register. The full scale register is kept and read back, but
+*	conversions do not use it.
+*
+*	With Board_ADCTiming set, single conversions take their time too: two periods of the update rate in the mode
+*	register, as on the real part with chop on. Status polls while one runs move the clock the same way, and the time is
+*	added up in Board_Counters.ADCBusyMS. ElapsedMS follows the virtual clock while interrupts run. In continuous mode
+*	the first conversion is the same, and reading the data starts the next, which takes one period (to the ms below).
+*	The time in continuous mode, a burst, is also added up in Board_Counters.ADCBurstMS.
+*
+*	With Board_ADCNoise set, each conversion gets gaussian noise with the RMS noise of its update rate, roughly the one
+*	in the datasheet table for the internal reference. The noise is made by a fixed generator, so runs repeat.
+*	Board_ADCConversion, if set, is called with every conversion. Board_ADCSource, if set, gives the input at the time
+*	of each conversion instead of Board_ADCInput, for a waveform.
+*
+*	Bus transfers do not move the virtual clock either, but their time on the wire is added up in Board_Counters.BusUS
+*	(SPI at Fcpu/2 and TWI at 100kHz). Timer 1 counts the virtual clock plus that time, at Fcpu/1024 only, so
+*	the boot times from boot.c come out as the sum of the bus transfers. Its overflow interrupt runs from Board_Elapse.
+*
+*	With Board_SleepTiming set, sleep_cpu moves the virtual clock on to the next interrupt that wakes the processor: the
+*	next timer 0 interrupt (1ms) in idle sleep, or the next RTC tick in power save. Timer 0 and timer 1 stop in power
+*	save, so ElapsedMS and TCNT1 do not move while the processor is in it. The time asleep is added up for each sleep
+*	mode in Board_Counters, with the time the dataflash is in deep power down and the AD7794 in power down mode. With
+*	Board_SleepTiming clear (the default), sleep_cpu returns right away.
+*
+*	Board_Keys, if set, is typed on the CDC interface once the virtual clock reaches Board_KeysMS. Timer 0 hands it to
+*	the shell every 8ms, as on the board.
+*
+*	For the watchdog test, the TWI bus or the dataflash can be made to hang (Board_Stuck). A hung wait moves the virtual
+*	clock itself, so the interrupts keep running, until the watchdog resets the processor. The watchdog is only modeled
+*	while Board_WatchdogReset is set, since a reset has to leave the firmware with a longjmp.
+*
+*	@{
+*/
+
+#ifndef _REPLAY_BOARD_H_
+#define _REPLAY_BOARD_H_
+
+#include <stdint.h>
+#include <time.h>
+
+//AD7794 inputs, indexed by the channel select bits of the configuration register (AD7794_CRL_CHANNEL_*)
+#define BOARD_ADC_INPUTS			9
+#define BOARD_ADC_OFFSET			0x800000	//OFFSET register after a reset
+#define BOARD_ADC_FULL_SCALE		0x500000	//FS register after a reset (factory calibrated on the real part)
+#define BOARD_ADC_CAL_MS			200			//Two conversions at 10Hz
+
+#define BOARD_FLASH_PAGES			8192
+#define BOARD_FLASH_PAGE_SIZE		528
+
+#define BOARD_RTC_TICK_MS			500			//INT3 triggers on both edges of the 1Hz square wave
+
+//Ways for the board to hang
+#define BOARD_STUCK_NONE			0
+#define BOARD_STUCK_TWI				1			//TWI transactions never finish. Interrupts keep running.
+#define BOARD_STUCK_TWI_CLI			2			//TWI transactions never finish, and the wait has interrupts off
+#define BOARD_STUCK_FLASH			3			//The dataflash never reports ready
+
+typedef struct
+{
+	uint32_t ADCConversions;
+	uint32_t ADCCalibrations;
+	uint32_t ADCCalibrationsCut;				//Calibrations cut short by a register write
+	uint32_t ADCLongestWaitMS;					//Longest run of status polls on a calibration
+	uint32_t ADCBusyMS;							//Time converting, with Board_ADCTiming
+	uint32_t ADCBursts;							//Starts of continuous mode
+	uint32_t ADCBurstMS;						//Part of ADCBusyMS in continuous mode
+	uint32_t FlashPagePrograms;
+	uint32_t FlashPageErases;
+	uint32_t FlashIgnoredCommands;				//Commands sent while the dataflash was in deep power down
+	uint32_t FlashArrayBytes;					//Read from the array by page reads and page to buffer transfers
+	uint32_t SPITransactions;
+	uint32_t TWITransactions;
+	uint32_t TWIErrors;
+	uint32_t BusUS;								//Time on the SPI and TWI buses
+	uint32_t WatchdogResets;
+	uint32_t SleepIdleMS;						//Time in idle sleep, with Board_SleepTiming
+	uint32_t SleepSaveMS;						//Time in power save, with Board_SleepTiming
+	uint32_t FlashPowerDownMS;					//Time the dataflash was in deep power down
+	uint32_t ADCPowerDownMS;					//Time the AD7794 was in power down mode
+} Board_Stats;
+
+/** The counts returned for each AD7794 input. The replay tool updates these as the trace is played. */
+extern uint32_t Board_ADCInput[BOARD_ADC_INPUTS];
+
+/** The AD7794 offset error on each input, in counts. 0 unless the replay tool sets it. */
+extern int32_t Board_ADCError[BOARD_ADC_INPUTS];
+
+/** The dataflash array. */
+extern uint8_t Board_Flash[BOARD_FLASH_PAGES][BOARD_FLASH_PAGE_SIZE];
+
+/** Erases of each dataflash page since Board_Reset, with or without a program. */
+extern uint32_t Board_FlashErases[BOARD_FLASH_PAGES];
+
+extern Board_Stats Board_Counters;
+
+/** 1 to give single conversions their time. 0 (the default) finishes them right away. */
+extern uint8_t Board_ADCTiming;
+
+/** 1 to add noise to the conversions. 0 (the default) returns the input as it is. */
+extern uint8_t Board_ADCNoise;
+
+/** Called with each conversion: the AD7794 input, the input counts without noise or offset error, the counts read and
+*	the update rate. */
+extern void (*Board_ADCConversion)(uint8_t Input, uint32_t Counts, uint32_t Read, uint8_t Rate);
+
+/** Gives the input counts for a conversion that starts at 'NowMS'. */
+extern uint32_t (*Board_ADCSource)(uint8_t Input, uint32_t NowMS);
+
+/** 1 to move the virtual clock while the processor sleeps. 0 (the default) returns from sleep_cpu right away. */
+extern uint8_t Board_SleepTiming;
+
+/** Typed on the CDC interface from Board_KeysMS on. Moved on as it is read, NULL once it has all been read. */
+extern const char *Board_Keys;
+extern uint32_t Board_KeysMS;
+
+/** BOARD_STUCK_* */
+extern uint8_t Board_Stuck;
+
+/** Called when the watchdog resets the processor. Must not return. The watchdog is not modeled while this is NULL. */
+extern void (*Board_WatchdogReset)(void);
+
+/** Virtual time in ms, when the firmware first hung on Board_Stuck (0 if it has not), and when the relay went off and
+*	stayed off after that (0 if it is on). */
+extern uint32_t Board_NowMS;
+extern uint32_t Board_HangMS;
+extern uint32_t Board_RelayOffMS;
+
+/** Power on state: erased flash, reset parts, RTC at 'Time' (UTC seconds). */
+void Board_Reset(time_t Time);
+
+/** The RTC time. The DS3232M model reads this when its time registers are read. */
+time_t Board_GetTime(void);
+void Board_SetTime(time_t Time);
+
+/** Move the virtual clock. The RTC interrupt runs every BOARD_RTC_TICK_MS if 'Interrupts' is 1. */
+void Board_Elapse(uint32_t MS, uint8_t Interrupts);
+
+/** Sleep in the mode set with set_sleep_mode until the next interrupt. This is sleep_cpu. */
+void Board_Sleep(void);
+
+/** Set the MAX7315 inputs. Buttons are active low on bits 4 and 5. */
+void Board_SetInputs(uint8_t Inputs);
+
+#endif
+/** @} */
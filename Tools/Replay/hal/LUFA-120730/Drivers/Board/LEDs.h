@@ -0,0 +1,12 @@
+//Host replacement for the LUFA board LED driver used by the replay tool.
+#ifndef _REPLAY_LUFA_LEDS_H_
+#define _REPLAY_LUFA_LEDS_H_
+
+#define LEDS_LED1					0x01
+#define LEDS_LED2					0x02
+#define LEDS_LED3					0x04
+#define LEDS_LED4					0x08
+
+#define LEDs_SetAllLEDs(Mask)
+
+#endif
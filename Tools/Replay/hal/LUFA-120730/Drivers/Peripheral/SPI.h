@@ -0,0 +1,13 @@
+//Host replacement for the LUFA SPI driver used by the replay tool. The SPI bus is modeled in board.c.
+#ifndef _REPLAY_LUFA_SPI_H_
+#define _REPLAY_LUFA_SPI_H_
+
+#define SPI_SPEED_FCPU_DIV_2		0
+#define SPI_ORDER_MSB_FIRST			0
+#define SPI_SCK_LEAD_FALLING		0
+#define SPI_SAMPLE_TRAILING			0
+#define SPI_MODE_MASTER				0
+
+#define SPI_Init(Options)
+
+#endif
@@ -0,0 +1,61 @@
+//Host replacement for the LUFA USB driver used by the replay tool. USB is never attached during a replay.
+#ifndef _REPLAY_LUFA_USB_H_
+#define _REPLAY_LUFA_USB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define ENDPOINT_DIR_IN				0x80
+#define ENDPOINT_DIR_OUT			0x00
+
+#define DEVICE_STATE_Unattached		0
+#define DEVICE_STATE_Configured		4
+#define ENDPOINT_RWSTREAM_NoError	0
+
+#define ATTR_WARN_UNUSED_RESULT
+#define ATTR_NON_NULL_PTR_ARG(...)
+#define ATTR_ALWAYS_INLINE
+#define ATTR_CONST
+#define ATTR_PACKED					__attribute__ ((packed))
+
+typedef int USB_Descriptor_Configuration_Header_t;
+typedef int USB_Descriptor_Interface_t;
+typedef int USB_CDC_Descriptor_FunctionalHeader_t;
+typedef int USB_CDC_Descriptor_FunctionalACM_t;
+typedef int USB_CDC_Descriptor_FunctionalUnion_t;
+typedef int USB_Descriptor_Endpoint_t;
+
+typedef struct
+{
+	struct
+	{
+		int Address;
+		int Size;
+		int Banks;
+	} DataINEndpoint, DataOUTEndpoint, NotificationEndpoint;
+	int ControlInterfaceNumber;
+} USB_ClassInfo_CDC_Device_Config_t;
+
+typedef struct
+{
+	USB_ClassInfo_CDC_Device_Config_t Config;
+} USB_ClassInfo_CDC_Device_t;
+
+extern volatile uint8_t USB_DeviceState;
+
+void USB_Init(void);
+void USB_USBTask(void);
+int16_t CDC_Device_ReceiveByte(USB_ClassInfo_CDC_Device_t *CDCInterfaceInfo);
+void CDC_Device_USBTask(USB_ClassInfo_CDC_Device_t *CDCInterfaceInfo);
+
+//USB is never configured, so this is never reached
+static inline uint8_t CDC_Device_SendData(USB_ClassInfo_CDC_Device_t *CDCInterfaceInfo, const char *Buffer, uint16_t Length)
+{
+	(void)CDCInterfaceInfo;
+	(void)Buffer;
+	(void)Length;
+	return ENDPOINT_RWSTREAM_NoError;
+}
+
+#endif
@@ -0,0 +1,27 @@
+//Host replacement for <avr/eeprom.h> used by the replay tool.
+//EEMEM variables are normal variables on the host, so the EEPROM functions read and write them directly.
+#ifndef _REPLAY_AVR_EEPROM_H_
+#define _REPLAY_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+
+static inline uint8_t eeprom_read_byte(const uint8_t *Address)				{ return *Address; }
+static inline uint16_t eeprom_read_word(const uint16_t *Address)			{ return *Address; }
+static inline uint32_t eeprom_read_dword(const uint32_t *Address)			{ return *Address; }
+static inline float eeprom_read_float(const float *Address)					{ return *Address; }
+static inline void eeprom_read_block(void *Data, const void *Address, size_t Length)	{ memcpy(Data, Address, Length); }
+static inline void eeprom_update_byte(uint8_t *Address, uint8_t Value)		{ *Address = Value; }
+static inline void eeprom_update_word(uint16_t *Address, uint16_t Value)	{ *Address = Value; }
+static inline void eeprom_update_dword(uint32_t *Address, uint32_t Value)	{ *Address = Value; }
+static inline void eeprom_update_float(float *Address, float Value)			{ *Address = Value; }
+static inline void eeprom_update_block(const void *Data, void *Address, size_t Length)	{ memcpy(Address, Data, Length); }
+#define eeprom_write_byte		eeprom_update_byte
+#define eeprom_write_word		eeprom_update_word
+#define eeprom_write_dword		eeprom_update_dword
+#define eeprom_write_float		eeprom_update_float
+#define eeprom_write_block		eeprom_update_block
+
+#endif
@@ -0,0 +1,10 @@
+//Host replacement for <avr/interrupt.h> used by the replay tool.
+//Each ISR becomes a normal function with the vector name (ex: INT3_vect()) so the replay tool can call it.
+#ifndef _REPLAY_AVR_INTERRUPT_H_
+#define _REPLAY_AVR_INTERRUPT_H_
+
+#define ISR(Vector, ...)	void Vector(void); void Vector(void)
+#define sei()
+#define cli()
+
+#endif
@@ -0,0 +1,40 @@
+//Host replacement for <avr/io.h> used by the replay tool.
+//The registers are plain variables defined in board.c. Only the registers and bits used by the firmware are here.
+#ifndef _REPLAY_AVR_IO_H_
+#define _REPLAY_AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t SREG, MCUSR, MCUCR, WDTCSR;
+extern volatile uint8_t DDRB, DDRC, DDRD, DDRF, PORTB, PORTC, PORTD, PORTF;
+extern volatile uint8_t EICRA, EIFR, EIMSK;
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0, TIFR0;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1;
+extern volatile uint8_t TCCR3A, TCCR3B, TCNT3H, TCNT3L, OCR3AH, OCR3AL, TIMSK3;
+extern volatile uint8_t SPCR, SPSR, SPDR;
+extern volatile uint8_t TWBR, TWSR, TWDR, TWCR;
+
+#define SREG_I		7
+#define PORF		0
+#define EXTRF		1
+#define BORF		2
+#define WDRF		3
+#define WDE			3
+#define WDIE		6
+#define OCF0A		1
+#define TOV1		0
+#define TOIE1		0
+#define CS10		0
+#define CS11		1
+#define CS12		2
+#define SPIE		7
+#define SPIF		7
+#define TWINT		7
+#define TWEA		6
+#define TWSTA		5
+#define TWSTO		4
+#define TWEN		2
+#define TWIE		0
+
+#endif
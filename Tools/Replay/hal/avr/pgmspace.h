@@ -0,0 +1,19 @@
+//Host replacement for <avr/pgmspace.h> used by the replay tool. Flash and RAM are the same on the host.
+#ifndef _REPLAY_AVR_PGMSPACE_H_
+#define _REPLAY_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)				(s)
+#define printf_P			printf
+#define sprintf_P			sprintf
+#define strcmp_P			strcmp
+#define memcpy_P			memcpy
+#define pgm_read_byte(a)	(*(const uint8_t *)(a))
+#define pgm_read_word(a)	(*(const uint16_t *)(a))
+#define pgm_read_dword(a)	(*(const uint32_t *)(a))
+
+#endif
@@ -0,0 +1,8 @@
+//Host replacement for <avr/power.h> used by the replay tool.
+#ifndef _REPLAY_AVR_POWER_H_
+#define _REPLAY_AVR_POWER_H_
+
+#define clock_div_1					0
+#define clock_prescale_set(Div)
+
+#endif
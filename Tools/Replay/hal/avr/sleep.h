@@ -0,0 +1,20 @@
+//Host replacement for <avr/sleep.h> used by the replay tool. Sleeping runs Board_Sleep in board.c, which returns right
+//away unless Board_SleepTiming is set.
+#ifndef _REPLAY_AVR_SLEEP_H_
+#define _REPLAY_AVR_SLEEP_H_
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE			0
+#define SLEEP_MODE_PWR_DOWN		1
+#define SLEEP_MODE_PWR_SAVE		2
+
+extern uint8_t Board_SleepMode;
+void Board_Sleep(void);
+
+#define set_sleep_mode(Mode)	(Board_SleepMode = (Mode))
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()				Board_Sleep()
+
+#endif
@@ -0,0 +1,19 @@
+//Host replacement for command.h from AVR-Common used by the replay tool. There is no command line during a replay.
+#ifndef _REPLAY_COMMAND_H_
+#define _REPLAY_COMMAND_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+	const char *CommandString;
+	uint8_t MinArgs;
+	uint8_t MaxArgs;
+	int (*Function)(void);
+	const char *Description;
+	const char *HelpText;
+} CommandListItem;
+
+void CommandGetInputChar(uint8_t c);
+
+#endif
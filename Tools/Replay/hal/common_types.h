@@ -0,0 +1,19 @@
+//Host replacement for common_types.h from AVR-Common used by the replay tool.
+#ifndef _REPLAY_COMMON_TYPES_H_
+#define _REPLAY_COMMON_TYPES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+	uint8_t sec;
+	uint8_t min;
+	uint8_t hour;
+	uint8_t dow;
+	uint8_t day;
+	uint8_t month;
+	uint8_t year;
+} TimeAndDate;
+
+#endif
@@ -0,0 +1,5 @@
+//Host replacement for dfu_jump.h from AVR-Common used by the replay tool.
+#ifndef _REPLAY_DFU_JUMP_H_
+#define _REPLAY_DFU_JUMP_H_
+
+#endif
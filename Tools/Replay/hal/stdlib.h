@@ -0,0 +1,9 @@
+//Host replacement for the avr-libc additions to <stdlib.h> used by the replay tool.
+#ifndef _REPLAY_STDLIB_H_
+#define _REPLAY_STDLIB_H_
+
+#include_next <stdlib.h>
+
+char *dtostrf(double Value, signed char Width, unsigned char Precision, char *Output);
+
+#endif
@@ -0,0 +1,12 @@
+//Host replacement for twi.h from AVR-Common used by the replay tool. The TWI bus is modeled in board.c.
+#ifndef _REPLAY_TWI_H_
+#define _REPLAY_TWI_H_
+
+#include <stdint.h>
+
+#define TWI_CHECKSTAT(stat)		if((stat) != 0) { return (stat); }
+
+#define InitTWI()
+#define DeinitTWI()
+
+#endif
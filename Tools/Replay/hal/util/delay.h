@@ -0,0 +1,8 @@
+//Host replacement for <util/delay.h> used by the replay tool. Delays do not advance the virtual clock.
+#ifndef _REPLAY_UTIL_DELAY_H_
+#define _REPLAY_UTIL_DELAY_H_
+
+#define _delay_us(US)
+#define _delay_ms(MS)
+
+#endif
@@ -0,0 +1,2481 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Host tool to replay sensor traces through the firmware faster than real time.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	The firmware sources are built for the host without changes. The AVR, LUFA and AVR-Common headers are replaced by
+*	the ones in hal/, and the SPI and TWI buses are replaced by the board model in board.c. The replay runs HardwareInit,
+*	starts the temperature controller and the datalogger, then runs the main loop work (TemperatureControllerTask,
+*	AD7794CalibrateTask, Datalogger_Process and Power_Sleep) on every edge of the RTC square wave on a virtual clock.
+*
+*	The trace is a CSV file. The first line names the columns: 'time' (seconds from the start of the replay) and any of
+*	ain1-ain6, temp, avdd and gnd (raw AD7794 counts for that input). Each row holds until the next one. Without a trace,
+*	a made up trace is used: daily temperature swings on the thermistors, a 12V supply and a heater current that follows
+*	the relay.
+*
+*	With -s, the over temperature cutoff is tested instead. The controller is run flat out with a set point well above
+*	the made up temperatures, then the red thermistor is stepped over its limit at every point in the sample period,
+*	once with the main loop running and once with the main loop stopped at the same time (as if it was stuck in a
+*	blocking command). The time until the relay turns off is given for each, against the bound from safety.h. A/D
+*	conversions take no time in the replay, so the conversion time is not included. The watchdog supervisor would cut
+*	the relay first when the main loop is stuck, so it is suspended to measure the safety cutoff on its own.
+*
+*	With -w, the watchdog supervisor is tested. First the log is filled with REPLAY_DUMP_RECORDS data sets and dumped as
+*	the 'log 1' command dumps it, with the output going out at the speed of the CDC task (REPLAY_USB_PACKET bytes every
+*	REPLAY_USB_PACKET_MS), the interrupts running and the controller on. The dump takes much longer than the main loop
+*	deadline, and must not reset the processor or let the safety cutoff find the controller samples stale. Then a
+*	command asks for a key with the controller on, as 'tempcal' does, and the key is typed REPLAY_PROMPT_MS later. The
+*	wait must not reset the processor or let the safety cutoff find the samples stale. Then the controller is run flat
+*	out, then the board model hangs the TWI bus (with interrupts running, then with them off) or the dataflash (never
+*	ready) while the main loop keeps running. A hung wait keeps the virtual clock and the interrupts running until the
+*	watchdog resets the processor, which is modeled with a longjmp back to the boot code. For each, the time from the
+*	hang to the relay turning off and to the reset is given, then the fault record that the firmware reports at the next
+*	boot.
+*
+*	With -c, the A/D calibration is tested. The board model gives the AD7794 an offset error on each input and the
+*	firmware boots with no saved calibration, so it calibrates in the background with the controller running. The time
+*	it takes, the controller samples taken meanwhile and the longest time the firmware waited on the part are given,
+*	then the error left on each channel. Then the board is rebooted, and the calibration must come back from EEPROM with
+*	no calibration run and no error left.
+*
+*	With -b, the boot is timed. The board is powered on with no saved A/D calibration, the controller is started at the end
+*	of HardwareInit and the main loop is run from then on, then the board is rebooted with the calibration saved. The
+*	time of each stage from boot.c is given for both, as the 'boot' command shows them. Only bus transfers and waits on
+*	the AD7794 calibration take time in the board model, and USB is not modeled, so the USB configured stage is not
+*	reached. The EEPROM starts with stream deadbands saved by the firmware before HEATER_RMS, with REPLAY_OLD_FIELDS
+*	fields, and they must be back to the defaults after the first boot. A deadband set then must still be there after
+*	the reboot.
+*
+*	With -a, the acquisition schedule is tested. The board model gives the AD7794 conversions their time, and the
+*	controller is run for REPLAY_ACQUIRE_MINUTES from a fresh boot, so the background calibration runs at the start. The
+*	main loop runs on each RTC tick, and right away again if a tick came while it was busy. For each channel in the table
+*	in acquire.c the period is given against the mean interval achieved, with the conversions, the worst lateness and the
+*	deadlines missed. The interval must be within REPLAY_ACQUIRE_RATE_ERROR of the period, with no deadline missed or
+*	late by a tick. The A/D busy time per sample period and the time to finish each sample are given against GetData
+*	converting every channel at 10Hz. Then the controller is stopped, and GetData (as the 'temp' command calls it) must
+*	follow the red thermistor input as it is changed, not give the counts kept from the schedule.
+*
+*	With -n, the A/D rate policies from acquire.c are benchmarked. The board model gives the conversions their time and
+*	the noise of their update rate, and the controller is run with each policy in turn on the same inputs. The inputs
+*	are the trace if one is given, or else the thermal model from Tools/Sweep regulating at REPLAY_BENCH_SETPOINT. The
+*	model has the supply stepping by 1V every 10 minutes and the red probe pulled 2 deg C low at 30 minutes, as if it
+*	was moved, so there is something to follow. The run is REPLAY_BENCH_MINUTES, or the -l length, or the whole trace.
+*	For each policy the A/D busy time per sample period is given, split into the schedule and the heater current bursts
+*	from ripple.c, with the number of bursts and the time of each, then for each channel the share of conversions at the
+*	fast rate and the RMS noise read on the conversions where the input was steady and where it had moved by more than
+*	the Step of the channel between conversions in the last REPLAY_BENCH_SETTLE conversions. The adaptive policy must
+*	not take more A/D time than the steady one, and its noise in steady state must be within REPLAY_BENCH_NOISE_MARGIN
+*	of it.
+*
+*	With -r, the heater current burst in ripple.c is checked. Synthetic waveforms (DC, a sine on DC, a full wave
+*	rectified sine, a PWM square, a triangle, and currents at full scale both ways) and REPLAY_RIPPLE_RANDOM random ones
+*	are sampled as a burst would sample them, and the integer results are compared with the same results worked out in
+*	double precision from the same samples. Then the zero of the current sensor is calibrated REPLAY_RIPPLE_ZEROS times
+*	with the controller running flat out and the conversions taking their time, and must come out as the input with the
+*	relay off each time, although the RTC interrupt drives the relay meanwhile. Then a burst is run by the firmware on
+*	the board model, with a sine on DC at AIN1, and compared the same way against the conversions the firmware read.
+*	Every result must be within REPLAY_RIPPLE_LIMIT of the double precision one.
+*
+*	With -e, the wear of the dataflash is tested. The datalogger writes REPLAY_WEAR_YEARS of data sets, one every
+*	REPLAY_WEAR_SAVE_MIN as Datalogger_Process saves them, and is mounted again with Datalogger_Init every
+*	REPLAY_WEAR_RESTART_HOURS, as it is at each boot. This is done with the circular log the firmware uses, then with
+*	DATALOGGER_INIT_OVERWRITE, which starts over at page 0 on each mount. For each, the erases of the pages are given (the
+*	least, the mean, the most and page 0), with the page headers read and the bus time of the slowest mount. The circular
+*	log must not erase any page more than once over the others, and must mount in at most REPLAY_WEAR_MOUNT_READS reads.
+*
+*	With -q, range queries are benchmarked on a full dataflash. The log is filled past its end with a data set every
+*	REPLAY_RANGE_SAVE_MIN, so it wraps. The last REPLAY_RANGE_NEW_YEAR_DAYS days of it are in a new year, so the week and
+*	30 day queries cross the new year. Then the last hour, day, week and 30 days are read back with
+*	Datalogger_ReadBackRange, as the 'log 2' command does. For each, the bytes read from the flash array and the bus time
+*	are given, against reading the whole array as a scan from the oldest page does. Each query must give every data set in its window, and read at most REPLAY_RANGE_SEARCH_BYTES
+*	more than the pages that hold them.
+*
+*	With -t, torn writes are injected. Enough data sets to fill REPLAY_TORN_PAGES pages are written, and the program of
+*	the last page is cut short at each byte of the page in turn, REPLAY_TORN_TRIALS times, as on a power cut: the bytes
+*	before the cut are programmed, the byte at the cut has only some of its bits programmed and the rest of the page is
+*	left erased. Then the log is mounted again, REPLAY_TORN_NEW more data sets are written and the whole log is read
+*	back. Every data set that was programmed in full and every new one must come back once and unchanged, in order. The
+*	torn data set gives a CRC error or nothing, or passes its CRC-16 anyway and is read back in its place. The last is
+*	allowed, since no CRC can catch all of them, and the share of torn data sets that pass is given. A cut that leaves its
+*	data set whole, with the bits not programmed already 1, is not counted as torn.
+*
+*	With -p, the data sets that the firmware logs are written to a file to be checked against Tools/LogDecode. The AD7794
+*	inputs are set to random counts (all zero or all full scale for some data sets) before each of the
+*	REPLAY_PACK_SAMPLES samples of a data set, which are taken and averaged by Datalogger_AddDataSetToAverage through
+*	GetData and saved by Datalogger_AddDataSet as Datalogger_Process does, for REPLAY_PACK_DATASETS data sets. The time
+*	and the channel values of each data set as it was saved are written to the file in the format of 'logdecode -f raw',
+*	and the flash image is written with -o. The two must be the same byte for byte:
+*		replay -p values.csv -o flash.bin
+*		logdecode -f raw -o decoded.csv flash.bin
+*		cmp values.csv decoded.csv
+*
+*	With -d, the power manager in power.c is checked. The board model moves the virtual clock while the processor sleeps:
+*	to the next timer 0 interrupt in idle sleep, or to the next RTC tick in power save, with timer 0 stopped. The
+*	controller is run for REPLAY_POWER_MINUTES with the conversions taking their time, first with USB not attached, then
+*	attached. For each, the time that power.c counts awake, in idle sleep and in power save is given against the board
+*	model, with the time the dataflash spent in deep power down and the AD7794 in power down, and the latency from the
+*	RTC tick that makes a sample due to the start and the end of the sample. Each time must be within
+*	REPLAY_POWER_ERROR_MS of the model and every sample must be taken. Power save must only be used with USB not
+*	attached, with the dataflash in deep power down all through it and no command sent to it meanwhile. Code takes no
+*	time in the model, so the latency only holds the conversions, and the oscillator start up is not modeled.
+*
+*	The replay starts at 1/1/2013 00:00:00 with an erased dataflash unless an image is given with -f. The resulting
+*	flash image can be written with -o and read back with Tools/LogDecode.
+*
+*	Build (Linux/OS X), from this directory:
+*		gcc -std=gnu99 -O2 -DF_CPU=8000000UL -Ihal -I../../Board -I../.. -o replay replay.c board.c
+*			../../Board/Hardware.c ../../Board/heater.c ../../Board/Datalogger.c ../../Board/ad7794.c ../../Board/at45db321d.c
+*			../../Board/ds3232m.c ../../Board/max7315.c ../../Board/status.c ../../Board/thermistor.c
+*			../../Board/power.c ../../Board/controller.c ../../Board/fusion.c ../../Board/energy.c ../../Board/safety.c
+*			../../Board/supervisor.c ../../Board/shell.c ../../Board/stream.c ../../Board/boot.c ../../Board/acquire.c
+*			../../Board/ripple.c -lm
+*
+*	Usage:
+*		replay [-i trace.csv] [-l hours] [-f flash_in.bin] [-o flash_out.bin] [-v]
+*		replay -s
+*		replay -w
+*		replay -c
+*		replay -b
+*		replay -a
+*		replay -n [-i trace.csv] [-l hours]
+*		replay -r
+*		replay -e
+*		replay -q
+*		replay -t
+*		replay -d
+*		replay -p values.csv [-o flash_out.bin]
+*
+*	@{
+*/
+
+#define _GNU_SOURCE							//fopencookie
+#include "main.h"
+#include "board.h"
+#include "../Sweep/plant.h"
+#include <errno.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define REPLAY_START_TIME			1356998400		//1/1/2013 00:00:00 UTC
+#define REPLAY_DEFAULT_HOURS		168				//One week
+#define REPLAY_EDGES_PER_SECOND		2				//INT3 triggers on both edges of the 1Hz square wave
+#define REPLAY_MAX_LINE				256
+#define REPLAY_SAFETY_SETPOINT		30				//deg C, well above the made up temperatures
+#define REPLAY_SAFETY_LIMIT			45				//deg C
+#define REPLAY_SAFETY_WARMUP		120				//RTC ticks before each step
+#define REPLAY_SAFETY_TIMEOUT		200				//RTC ticks to wait for the relay to turn off
+#define REPLAY_WATCHDOG_WARMUP		300				//RTC ticks before the part hangs
+#define REPLAY_DUMP_RECORDS			1000			//Data sets in the log for the dump
+#define REPLAY_USB_PACKET			64				//Bytes sent by the CDC task...
+#define REPLAY_USB_PACKET_MS		8				//...every 8ms
+#define REPLAY_PROMPT_MS			60000			//Time the user takes to answer a prompt
+#define REPLAY_CAL_WINDOW			120				//RTC ticks for the A/D calibration to finish in
+#define REPLAY_BOOT_TICKS			30				//RTC ticks to run the main loop after each boot
+#define REPLAY_OLD_FIELDS			7				//Stream fields before HEATER_RMS
+#define REPLAY_DEADBAND_FIELD		1
+#define REPLAY_DEADBAND				1234
+#define REPLAY_HEARTBEAT			7
+#define REPLAY_ACQUIRE_MINUTES		30
+#define REPLAY_ACQUIRE_RATE_ERROR	0.01			//Largest error allowed on the interval of each channel
+#define REPLAY_GETDATA_MS			1000			//GetData converting every A/D channel at 10Hz
+#define REPLAY_BENCH_MINUTES		120
+#define REPLAY_BENCH_SETPOINT		20				//deg C, the thermal model starts there
+#define REPLAY_BENCH_PROBE_S		1800			//The red probe is moved
+#define REPLAY_BENCH_PROBE_STEP		-20000			//0.0001 deg C
+#define REPLAY_BENCH_PROBE_LAG		60.0			//s for it to come back
+#define REPLAY_BENCH_VOLT_COUNTS	495833.0		//Heater voltage counts per V, 5950000 at 12V
+#define REPLAY_BENCH_AMP_COUNTS		157286.0		//Heater current counts per A over the zero at 0x800000
+#define REPLAY_BENCH_NOISE_MARGIN	1.2
+#define REPLAY_BENCH_SETTLE			16				//Conversions after a move before the input counts as steady
+#define REPLAY_POLICIES				3
+#define REPLAY_RIPPLE_RANDOM		10000
+#define REPLAY_RIPPLE_LIMIT			1				//0.1mA, or 0.01 for the crest factor
+#define REPLAY_RIPPLE_HZ			470.0			//Conversions per second in a burst
+#define REPLAY_COUNTS_PER_AMP		(16777216.0 * 10000.0 / RIPPLE_SCALE)
+#define REPLAY_RIPPLE_RESULTS		5
+#define REPLAY_RIPPLE_ZEROS			10				//Current sensor zero calibrations with the controller on
+#define REPLAY_WEAR_YEARS			20
+#define REPLAY_WEAR_SAVE_MIN		30				//DATALOGGER_DATA_SAVE_RATE
+#define REPLAY_WEAR_RESTART_HOURS	24
+#define REPLAY_WEAR_MOUNT_READS		64				//Two binary searches over the pages and a scan of the newest one
+#define REPLAY_RANGE_SAVE_MIN		3
+#define REPLAY_RANGE_DAYS			360				//Of data sets, more than the dataflash holds...
+#define REPLAY_RANGE_NEW_YEAR_DAYS	5				//...the last of them in a new year
+#define REPLAY_RANGE_QUERIES		4
+#define REPLAY_RANGE_SEARCH_BYTES	4096			//Read to find the first page, over the pages of the window
+#define REPLAY_TORN_PAGES			3
+#define REPLAY_TORN_TRIALS			8				//Cuts at each byte, with other bits programmed in the byte at the cut
+#define REPLAY_TORN_NEW				5				//Data sets written after the mount
+#define REPLAY_TORN_FIRST_NEW		1000			//Number of the first of them
+#define REPLAY_PACK_DATASETS		200				//Over 11 pages
+#define REPLAY_PACK_SAMPLES			6				//DATALOGGER_DATA_SAVE_RATE / DATALOGGER_MIN_TO_SKIP
+#define REPLAY_PACK_SAVE_MIN		30
+#define REPLAY_POWER_MINUTES		30
+#define REPLAY_POWER_ERROR_MS		1000			//Error allowed on the time the firmware counts in each state
+#define REPLAY_DATASETS_PER_PAGE	((DATALOGGER_PAGE_SIZE - DATALOGGER_PAGE_HEADER_SIZE) / DATALOGGER_RECORD_SIZE)
+
+//Firmware state that the replay drives directly
+extern uint8_t NV_SET_TEMPERATURE;
+extern Stream_Deadbands NV_STREAM_DEADBANDS;
+extern uint8_t DataToSave[DATALOGGER_DATASET_SIZE];
+extern uint8_t DataSetNumber;
+
+typedef struct
+{
+	FILE *File;
+	int Column[BOARD_ADC_INPUTS + 1];		//The AD7794 input for each CSV column, or -1. Column 0 is the time.
+	int Columns;
+	long NextTime;							//Time of the row in NextValues, -1 at the end of the file
+	uint32_t NextValues[BOARD_ADC_INPUTS];
+	uint8_t NextHas[BOARD_ADC_INPUTS];
+} ReplayTrace;
+
+static const char * const InputNames[BOARD_ADC_INPUTS] = {"ain1", "ain2", "ain3", "ain4", "ain5", "ain6", "temp", "avdd", "gnd"};
+
+static void Usage(void)
+{
+	fprintf(stderr, "Usage: replay [-i trace.csv] [-l hours] [-f flash_in.bin] [-o flash_out.bin] [-v]\n"
+	                "       replay -s\n"
+	                "       replay -w\n"
+	                "       replay -c\n"
+	                "       replay -b\n"
+	                "       replay -a\n"
+	                "       replay -n [-i trace.csv] [-l hours]\n"
+	                "       replay -r\n"
+	                "       replay -e\n"
+	                "       replay -q\n"
+	                "       replay -t\n"
+	                "       replay -d\n"
+	                "       replay -p values.csv [-o flash_out.bin]\n");
+}
+
+static double WallSeconds(void)
+{
+	struct timeval Now;
+
+	gettimeofday(&Now, NULL);
+	return (double)Now.tv_sec + ((double)Now.tv_usec / 1000000.0);
+}
+
+//Read the next row of the trace into NextValues. Returns 0 at the end of the file.
+static int TraceReadRow(ReplayTrace *Trace)
+{
+	char Line[REPLAY_MAX_LINE];
+	char *Field;
+	char *Save;
+	int i;
+
+	while(fgets(Line, sizeof(Line), Trace->File) != NULL)
+	{
+		if((Line[0] == '\n') || (Line[0] == '#'))
+		{
+			continue;
+		}
+		memset(Trace->NextHas, 0, sizeof(Trace->NextHas));
+		Field = strtok_r(Line, ",\r\n", &Save);
+		for(i=0; (Field != NULL) && (i < Trace->Columns); i++)
+		{
+			if(i == 0)
+			{
+				Trace->NextTime = strtol(Field, NULL, 10);
+			}
+			else if(Trace->Column[i] >= 0)
+			{
+				Trace->NextValues[Trace->Column[i]] = (uint32_t)strtoul(Field, NULL, 0);
+				Trace->NextHas[Trace->Column[i]] = 1;
+			}
+			Field = strtok_r(NULL, ",\r\n", &Save);
+		}
+		return 1;
+	}
+	Trace->NextTime = -1;
+	return 0;
+}
+
+static int TraceOpen(ReplayTrace *Trace, const char *Name)
+{
+	char Line[REPLAY_MAX_LINE];
+	char *Field;
+	char *Save;
+	int i;
+
+	Trace->File = fopen(Name, "r");
+	if(Trace->File == NULL)
+	{
+		fprintf(stderr, "Cannot open %s: %s\n", Name, strerror(errno));
+		return 0;
+	}
+	if(fgets(Line, sizeof(Line), Trace->File) == NULL)
+	{
+		fprintf(stderr, "%s is empty\n", Name);
+		return 0;
+	}
+
+	Trace->Columns = 0;
+	Field = strtok_r(Line, ",\r\n", &Save);
+	while((Field != NULL) && (Trace->Columns <= BOARD_ADC_INPUTS))
+	{
+		Trace->Column[Trace->Columns] = -1;
+		for(i=0; i<BOARD_ADC_INPUTS; i++)
+		{
+			if(strcmp(Field, InputNames[i]) == 0)
+			{
+				Trace->Column[Trace->Columns] = i;
+			}
+		}
+		if((Trace->Columns == 0) && (strcmp(Field, "time") != 0))
+		{
+			fprintf(stderr, "The first column of %s must be 'time'\n", Name);
+			return 0;
+		}
+		if((Trace->Columns > 0) && (Trace->Column[Trace->Columns] < 0))
+		{
+			fprintf(stderr, "Warning: column '%s' is not an AD7794 input and is ignored\n", Field);
+		}
+		Trace->Columns++;
+		Field = strtok_r(NULL, ",\r\n", &Save);
+	}
+	TraceReadRow(Trace);
+	return 1;
+}
+
+//Apply every row at or before 'Time'
+static void TraceUpdate(ReplayTrace *Trace, long Time)
+{
+	int i;
+
+	while((Trace->NextTime >= 0) && (Trace->NextTime <= Time))
+	{
+		for(i=0; i<BOARD_ADC_INPUTS; i++)
+		{
+			if(Trace->NextHas[i] == 1)
+			{
+				Board_ADCInput[i] = Trace->NextValues[i];
+			}
+		}
+		TraceReadRow(Trace);
+	}
+	return;
+}
+
+//Made up inputs for 'Time' seconds into the replay
+static void SynthUpdate(long Time)
+{
+	double Day = sin((2.0 * M_PI * (double)Time) / 86400.0);
+
+	Board_ADCInput[1] = (uint32_t)(7170000.0 + (700000.0 * Day));					//Red thermistor, about 20C +/- 3C
+	Board_ADCInput[2] = (uint32_t)(7170000.0 + (250000.0 * Day));					//Black thermistor lags behind in the wort
+	Board_ADCInput[5] = 5950000;													//12V supply
+	Board_ADCInput[6] = (uint32_t)(116150.0 + (15000.0 * Day));						//AD7794 internal temperature
+	if((PORTD & (1<<6)) != 0)
+	{
+		Board_ADCInput[0] = 0x800000 + 0x060000;									//Relay on, about 2.5A
+	}
+	else
+	{
+		Board_ADCInput[0] = 0x800000;
+	}
+	return;
+}
+
+//One RTC tick on the made up trace, with the red thermistor held at 'Red' counts if it is not zero
+//The time at the start of a data set, as Datalogger_Process puts it in
+static void LogTime(time_t Time, uint8_t DataSet[DATALOGGER_TIME_SIZE])
+{
+	struct tm Date;
+
+	gmtime_r(&Time, &Date);
+	DataSet[0] = (uint8_t)(Date.tm_year - 100);
+	DataSet[1] = (uint8_t)(Date.tm_mon + 1);
+	DataSet[2] = (uint8_t)Date.tm_mday;
+	DataSet[3] = (uint8_t)Date.tm_hour;
+	DataSet[4] = (uint8_t)Date.tm_min;
+	return;
+}
+
+static void SafetyEdge(long Edge, uint32_t Red, int MainLoop)
+{
+	if((Edge % REPLAY_EDGES_PER_SECOND) == 0)
+	{
+		SynthUpdate(Edge / REPLAY_EDGES_PER_SECOND);
+		Board_SetTime(REPLAY_START_TIME + (Edge / REPLAY_EDGES_PER_SECOND));
+	}
+	if(Red != 0)
+	{
+		Board_ADCInput[1] = Red;
+	}
+
+	Board_Elapse(BOARD_RTC_TICK_MS, 1);
+	if(MainLoop == 1)
+	{
+		Supervisor_CheckIn(SUPERVISOR_TASK_LOOP);
+		TemperatureControllerTask();
+		AD7794CalibrateTask();
+		Datalogger_Process();
+		Power_Sleep();
+	}
+	return;
+}
+
+//Step the red thermistor over its limit at each point in the sample period and time the relay cutoff
+static int SafetyTest(FILE *Report)
+{
+	static const char * const Names[2] = {"Main loop running", "Main loop stuck"};
+	static const int Bounds[2] = {CONTROLLER_SAMPLE_TICKS, SAFETY_MAX_AGE + 1};
+	uint32_t Hot;
+	long Edge = 0;
+	int Stuck;
+	int Phase;
+	int Ticks;
+	int Worst[2] = {0, 0};
+	int Best[2] = {REPLAY_SAFETY_TIMEOUT, REPLAY_SAFETY_TIMEOUT};
+	int Trials[2] = {0, 0};
+	int Skipped = 0;
+	int Failed = 0;
+	int i;
+
+	SynthUpdate(0);
+	HardwareInit();
+	NV_SET_TEMPERATURE = REPLAY_SAFETY_SETPOINT;
+	SetSafetyLimit(SAFETY_RED, REPLAY_SAFETY_LIMIT);
+	Hot = ThermistorTempToCounts((REPLAY_SAFETY_LIMIT + 5) * 10000L);
+
+	for(Phase = 0; Phase < (2*CONTROLLER_SAMPLE_TICKS); Phase++)
+	{
+		for(Stuck = 0; Stuck < 2; Stuck++)
+		{
+			//The controller takes its first sample right away, so take the last step off first
+			SynthUpdate(Edge / REPLAY_EDGES_PER_SECOND);
+			StartTemperatureController(0);
+			Supervisor_Suspend(SUPERVISOR_TASK_LOOP);
+			Supervisor_Suspend(SUPERVISOR_TASK_CONTROLLER);
+			for(i = 0; i < (REPLAY_SAFETY_WARMUP + Phase); i++)
+			{
+				SafetyEdge(Edge++, 0, 1);
+			}
+			if((PORTD & (1<<6)) == 0)
+			{
+				Skipped++;
+				StopTemperatureController(0);
+				continue;
+			}
+
+			for(Ticks = 1; Ticks <= REPLAY_SAFETY_TIMEOUT; Ticks++)
+			{
+				SafetyEdge(Edge++, Hot, (Stuck == 0) ? 1 : 0);
+				if((PORTD & (1<<6)) == 0)
+				{
+					break;
+				}
+			}
+			if(Ticks > REPLAY_SAFETY_TIMEOUT)
+			{
+				Failed++;
+			}
+			Trials[Stuck]++;
+			Worst[Stuck] = (Ticks > Worst[Stuck]) ? Ticks : Worst[Stuck];
+			Best[Stuck] = (Ticks < Best[Stuck]) ? Ticks : Best[Stuck];
+			StopTemperatureController(0);
+		}
+	}
+
+	fprintf(Report, "Red thermistor stepped to %d C with a %d C limit (%lu counts)\n", REPLAY_SAFETY_LIMIT + 5,
+	        REPLAY_SAFETY_LIMIT, (unsigned long)Safety_GetThreshold(SAFETY_RED));
+	fprintf(Report, "                   Trials  Best (s)  Worst (s)  Bound (s)\n");
+	for(Stuck = 0; Stuck < 2; Stuck++)
+	{
+		fprintf(Report, "%-17s  %6d  %8.1f  %9.1f  %9.1f\n", Names[Stuck], Trials[Stuck],
+		        (double)Best[Stuck] / REPLAY_EDGES_PER_SECOND, (double)Worst[Stuck] / REPLAY_EDGES_PER_SECOND,
+		        (double)Bounds[Stuck] / REPLAY_EDGES_PER_SECOND);
+		if(Worst[Stuck] > Bounds[Stuck])
+		{
+			Failed++;
+		}
+	}
+	if(Skipped != 0)
+	{
+		fprintf(Report, "%d trials skipped with the relay off at the step\n", Skipped);
+	}
+	fprintf(Report, "%s\n", (Failed == 0) ? "Relay always off within the bound" : "Relay NOT off within the bound");
+	fflush(Report);
+	return (Failed == 0) ? 0 : 1;
+}
+
+static jmp_buf WatchdogJump;
+
+static void WatchdogReset(void)
+{
+	longjmp(WatchdogJump, 1);
+}
+
+static uint32_t DumpBytes;
+
+//The firmware output during the dump. It goes out at the speed of the CDC task, with the interrupts running.
+static ssize_t DumpWrite(void *Cookie, const char *Data, size_t Size)
+{
+	size_t i;
+
+	(void)Cookie;
+	(void)Data;
+	for(i = 0; i < Size; i++)
+	{
+		DumpBytes++;
+		if((DumpBytes % REPLAY_USB_PACKET) == 0)
+		{
+			Board_Elapse(REPLAY_USB_PACKET_MS, 1);
+		}
+	}
+	return (ssize_t)Size;
+}
+
+//Fill the log, then dump all of it with the main loop busy in the 'log' command the whole time
+static int DumpTest(FILE *Report, volatile long *Edge)
+{
+	static const cookie_io_functions_t Functions = {NULL, DumpWrite, NULL, NULL};
+	FILE * volatile Saved;
+	FILE *Dump;
+	volatile uint32_t Start;
+	volatile uint32_t Resets;
+	volatile uint16_t StaleCuts;
+	volatile int Failed = 0;
+	uint8_t DataSet[DATALOGGER_DATASET_SIZE];
+	long i;
+
+	//The controller starts the datalogger, and it stays on for the dump
+	StartTemperatureController(0);
+	SafetyEdge((*Edge)++, 0, 1);
+	for(i = 0; i < REPLAY_DUMP_RECORDS; i++)
+	{
+		memset(DataSet, (int)(i & 0xFF), sizeof(DataSet));
+		LogTime(REPLAY_START_TIME + (i * 60), DataSet);
+		Datalogger_AddDataSet(DataSet);
+	}
+
+	Dump = fopencookie(NULL, "w", Functions);
+	if(Dump == NULL)
+	{
+		fprintf(Report, "Cannot make the dump stream\n");
+		return 1;
+	}
+	setvbuf(Dump, NULL, _IONBF, 0);
+	Saved = stdout;
+	Resets = Board_Counters.WatchdogResets;
+	StaleCuts = Safety_GetStaleCuts();
+	Start = Board_NowMS;
+	DumpBytes = 0;
+	if(setjmp(WatchdogJump) == 0)
+	{
+		stdout = Dump;
+		Datalogger_ReadBackData(0xFFFF);
+	}
+	stdout = Saved;
+	fclose(Dump);
+	*Edge += (Board_NowMS - Start) / BOARD_RTC_TICK_MS;
+
+	fprintf(Report, "Long log dump: %lu bytes in %.1fs, ", (unsigned long)DumpBytes, (double)(Board_NowMS - Start) / 1000.0);
+	if(Board_Counters.WatchdogResets != Resets)
+	{
+		fprintf(Report, "reset\n");
+		Failed = 1;
+
+		//Boot
+		PORTD = 0;
+		SynthUpdate(*Edge / REPLAY_EDGES_PER_SECOND);
+		HardwareInit();
+		Supervisor_ClearFaults();
+	}
+	else
+	{
+		fprintf(Report, "no reset, %u stale cutoffs\n", (unsigned)(Safety_GetStaleCuts() - StaleCuts));
+		if(Safety_GetStaleCuts() != StaleCuts)
+		{
+			Failed = 1;
+		}
+	}
+	StopTemperatureController(0);
+
+	//A dump shorter than the deadline would pass anyway
+	if((Board_NowMS - Start) <= (SUPERVISOR_DEADLINE_LOOP * BOARD_RTC_TICK_MS))
+	{
+		fprintf(Report, "The dump is shorter than the main loop deadline\n");
+		Failed = 1;
+	}
+	fflush(Report);
+	return Failed;
+}
+
+//Ask for a key with the controller on and answer it long after the controller deadline
+static int PromptTest(FILE *Report, volatile long *Edge)
+{
+	volatile uint32_t Start;
+	volatile uint32_t Resets;
+	volatile uint16_t StaleCuts;
+	volatile char Key = 0;
+	volatile int Failed = 0;
+	long i;
+
+	StartTemperatureController(0);
+	for(i = 0; i < REPLAY_WATCHDOG_WARMUP; i++)
+	{
+		SafetyEdge((*Edge)++, 0, 1);
+	}
+
+	USB_DeviceState = DEVICE_STATE_Configured;
+	Board_SleepTiming = 1;
+	Board_Keys = "y";
+	Board_KeysMS = Board_NowMS + REPLAY_PROMPT_MS;
+	Resets = Board_Counters.WatchdogResets;
+	StaleCuts = Safety_GetStaleCuts();
+	Start = Board_NowMS;
+	if(setjmp(WatchdogJump) == 0)
+	{
+		Supervisor_Suspend(SUPERVISOR_TASK_LOOP);
+		Key = Shell_GetKey();
+		Supervisor_Resume(SUPERVISOR_TASK_LOOP);
+	}
+	Board_SleepTiming = 0;
+	USB_DeviceState = DEVICE_STATE_Unattached;
+	*Edge += (Board_NowMS - Start) / BOARD_RTC_TICK_MS;
+
+	fprintf(Report, "Prompt answered after %.1fs with the controller on: ", (double)(Board_NowMS - Start) / 1000.0);
+	if(Board_Counters.WatchdogResets != Resets)
+	{
+		fprintf(Report, "reset\n");
+		Failed = 1;
+
+		//Boot
+		PORTD = 0;
+		SynthUpdate(*Edge / REPLAY_EDGES_PER_SECOND);
+		HardwareInit();
+		Supervisor_ClearFaults();
+	}
+	else if(Key != 'y')
+	{
+		fprintf(Report, "wrong key\n");
+		Failed = 1;
+	}
+	else
+	{
+		fprintf(Report, "no reset, %u stale cutoffs\n", (unsigned)(Safety_GetStaleCuts() - StaleCuts));
+		if(Safety_GetStaleCuts() != StaleCuts)
+		{
+			Failed = 1;
+		}
+	}
+	StopTemperatureController(0);
+	fflush(Report);
+	return Failed;
+}
+
+//Hang each part in turn and check that the supervisor resets the processor and reports the fault at the next boot
+static int WatchdogTest(FILE *Report)
+{
+	static const char * const Names[3] = {"TWI bus stuck", "TWI bus stuck, interrupts off", "Dataflash never ready"};
+	static const uint8_t Modes[3] = {BOARD_STUCK_TWI, BOARD_STUCK_TWI_CLI, BOARD_STUCK_FLASH};
+	static const char * const Tasks[SUPERVISOR_TASKS] = {"main loop", "controller"};
+	Supervisor_Fault Fault;
+	volatile long Edge = 0;
+	volatile int Scenario;
+	volatile int Failed = 0;
+	uint16_t Count;
+	int i;
+
+	Board_WatchdogReset = WatchdogReset;
+	SynthUpdate(0);
+	MCUSR = (1<<PORF);
+	HardwareInit();
+	Supervisor_ClearFaults();
+	NV_SET_TEMPERATURE = REPLAY_SAFETY_SETPOINT;
+
+	Failed = DumpTest(Report, &Edge);
+	Failed |= PromptTest(Report, &Edge);
+
+	fprintf(Report, "Scenario                        Relay off (s)  Reset (s)  Boot report\n");
+	for(Scenario = 0; Scenario < 3; Scenario++)
+	{
+		StartTemperatureController(0);
+		for(i = 0; i < REPLAY_WATCHDOG_WARMUP; i++)
+		{
+			SafetyEdge(Edge++, 0, 1);
+		}
+
+		Board_HangMS = 0;
+		Board_RelayOffMS = 0;
+		Board_Stuck = Modes[Scenario];
+		if(setjmp(WatchdogJump) == 0)
+		{
+			//Run the main loop until it hangs on the part and the watchdog gets it out
+			for(;;)
+			{
+				if((Board_Stuck == BOARD_STUCK_FLASH) && (Board_HangMS == 0))
+				{
+					AT45DB321D_WaitForReady();
+				}
+				SafetyEdge(Edge++, 0, 1);
+			}
+		}
+
+		//The processor was reset with the relay as it was at the reset
+		fprintf(Report, "%-30s  ", Names[Scenario]);
+		if(Board_RelayOffMS == 0)
+		{
+			fprintf(Report, "%13s", "at reset");
+		}
+		else
+		{
+			fprintf(Report, "%13.1f", (double)(Board_RelayOffMS - Board_HangMS) / 1000.0);
+		}
+		fprintf(Report, "  %9.1f  ", (double)(Board_NowMS - Board_HangMS) / 1000.0);
+
+		//Boot
+		PORTD = 0;
+		SynthUpdate(Edge / REPLAY_EDGES_PER_SECOND);
+		HardwareInit();
+		Count = Supervisor_GetFault(&Fault);
+		if((Count != (Scenario + 1)) || ((Supervisor_GetResetCause() & (1<<WDRF)) == 0))
+		{
+			fprintf(Report, "no fault saved\n");
+			Failed = 1;
+		}
+		else if(Fault.Task < SUPERVISOR_TASKS)
+		{
+			fprintf(Report, "%s late at %lu ticks, last check in at %lu ticks\n", Tasks[Fault.Task],
+			        (unsigned long)Fault.Uptime, (unsigned long)Fault.CheckIn);
+		}
+		else if(Fault.Task == SUPERVISOR_TASK_UNKNOWN)
+		{
+			fprintf(Report, "watchdog reset with no record\n");
+		}
+		else
+		{
+			fprintf(Report, "RTC stopped at %lu ticks\n", (unsigned long)Fault.Uptime);
+		}
+	}
+	fprintf(Report, "Watchdog resets:    %lu\n", (unsigned long)Board_Counters.WatchdogResets);
+	fflush(Report);
+	return Failed;
+}
+
+//The offset error left on each calibrated channel, read the way the firmware reads them
+static void CalibrationErrors(int32_t Errors[AD7794_CAL_CHANNELS])
+{
+	Errors[0] = (int32_t)GetHeaterCurrent() - (int32_t)Board_ADCInput[0];
+	Errors[1] = (int32_t)GetRedTemp() - (int32_t)Board_ADCInput[1];
+	Errors[2] = (int32_t)GetBlackTemp() - (int32_t)Board_ADCInput[2];
+	Errors[3] = (int32_t)GetHeaterVoltage() - (int32_t)Board_ADCInput[5];
+	return;
+}
+
+//Calibrate in the background with the controller running, then reboot and check the calibration is put back
+static int CalibrationTest(FILE *Report)
+{
+	static const char * const Names[AD7794_CAL_CHANNELS] = {"ain1", "ain2", "ain3", "ain6"};
+	static const int Inputs[AD7794_CAL_CHANNELS] = {0, 1, 2, 5};
+	static const int32_t Errors[AD7794_CAL_CHANNELS] = {1500, -800, 600, 400};
+	int32_t Before[AD7794_CAL_CHANNELS];
+	int32_t After[AD7794_CAL_CHANNELS];
+	int32_t Rebooted[AD7794_CAL_CHANNELS];
+	Power_Stats Stats;
+	uint16_t Samples;
+	uint32_t Calibrations;
+	uint32_t Waited;
+	uint8_t Step;
+	long Edge = 0;
+	int Ticks;
+	int Done;
+	int Failed = 0;
+	int i;
+
+	for(i = 0; i < AD7794_CAL_CHANNELS; i++)
+	{
+		Board_ADCError[Inputs[i]] = Errors[i];
+	}
+	SynthUpdate(0);
+	HardwareInit();
+	CalibrationErrors(Before);
+	NV_SET_TEMPERATURE = REPLAY_SAFETY_SETPOINT;
+	StartTemperatureController(0);
+	Power_GetStats(&Stats);
+	Samples = Stats.Samples;
+
+	//Boot calibration, from the main loop
+	Done = 0;
+	for(Ticks = 0; Ticks < REPLAY_CAL_WINDOW; Ticks++)
+	{
+		if((Done == 0) && (AD7794CalibrateStatus(&Step) != AD7794_CAL_RUNNING))
+		{
+			Done = Ticks;
+		}
+		SafetyEdge(Edge++, 0, 1);
+	}
+	Power_GetStats(&Stats);
+	fprintf(Report, "Boot calibration:   %s after %.1f s\n", (AD7794CalibrateStatus(&Step) == AD7794_CAL_DONE) ? "done" : "NOT done",
+	        (double)Done / REPLAY_EDGES_PER_SECOND);
+	fprintf(Report, "Controller samples: %u of %d in the first %d s\n", (unsigned)(Stats.Samples - Samples),
+	        REPLAY_CAL_WINDOW / CONTROLLER_SAMPLE_TICKS, REPLAY_CAL_WINDOW / REPLAY_EDGES_PER_SECOND);
+	if((Stats.Samples - Samples) < (REPLAY_CAL_WINDOW / CONTROLLER_SAMPLE_TICKS))
+	{
+		Failed = 1;
+	}
+	if(AD7794CalibrateStatus(&Step) != AD7794_CAL_DONE)
+	{
+		Failed = 1;
+	}
+	CalibrationErrors(After);
+
+	//A measurement that comes along during a step waits for that step only
+	AD7794CalibrateStart();
+	AD7794CalibrateTask();
+	Board_Counters.ADCLongestWaitMS = 0;
+	GetHeaterVoltage();
+	Waited = Board_Counters.ADCLongestWaitMS;
+	for(Ticks = 0; (Ticks < REPLAY_CAL_WINDOW) && (AD7794CalibrateStatus(&Step) == AD7794_CAL_RUNNING); Ticks++)
+	{
+		SafetyEdge(Edge++, 0, 1);
+	}
+	fprintf(Report, "Longest wait:       %lu ms for a measurement during a step (%d ms for the %d steps run back to back)\n",
+	        (unsigned long)Waited, AD7794_CAL_STEPS * BOARD_ADC_CAL_MS, AD7794_CAL_STEPS);
+	fprintf(Report, "Steps cut short:    %lu\n", (unsigned long)Board_Counters.ADCCalibrationsCut);
+	if((Board_Counters.ADCCalibrationsCut != 0) || (Waited > BOARD_ADC_CAL_MS))
+	{
+		Failed = 1;
+	}
+
+	//Reboot. The reset puts the part back to its factory registers.
+	StopTemperatureController(0);
+	Calibrations = Board_Counters.ADCCalibrations;
+	HardwareInit();
+	CalibrationErrors(Rebooted);
+	fprintf(Report, "After reboot:       %lu calibration steps run, %s\n", (unsigned long)(Board_Counters.ADCCalibrations - Calibrations),
+	        (AD7794CalibrateStatus(&Step) == AD7794_CAL_RUNNING) ? "calibrating" : "loaded from EEPROM");
+	if((Board_Counters.ADCCalibrations != Calibrations) || (AD7794CalibrateStatus(&Step) == AD7794_CAL_RUNNING))
+	{
+		Failed = 1;
+	}
+
+	fprintf(Report, "Channel  Error (counts)  Uncalibrated  Calibrated  Rebooted\n");
+	for(i = 0; i < AD7794_CAL_CHANNELS; i++)
+	{
+		fprintf(Report, "%-7s  %14ld  %12ld  %10ld  %8ld\n", Names[i], (long)Errors[i], (long)Before[i], (long)After[i],
+		        (long)Rebooted[i]);
+		if((After[i] != 0) || (Rebooted[i] != 0))
+		{
+			Failed = 1;
+		}
+	}
+	fprintf(Report, "%s\n", (Failed == 0) ? "Calibration made in the background and put back at boot" : "Calibration FAILED");
+	fflush(Report);
+	return Failed;
+}
+
+//The main loop work
+static void MainLoopPass(void)
+{
+	Supervisor_CheckIn(SUPERVISOR_TASK_LOOP);
+	TemperatureControllerTask();
+	AD7794CalibrateTask();
+	Datalogger_Process();
+	Power_Sleep();
+	return;
+}
+
+//Boot, start the controller and run the main loop. Times holds the boot stages from the firmware.
+static void BootRun(long *Edge, uint32_t Times[BOOT_STAGES])
+{
+	int i;
+
+	SynthUpdate(*Edge / REPLAY_EDGES_PER_SECOND);
+	HardwareInit();
+	StartTemperatureController(0);
+
+	//The main loop starts right after the boot, then runs on each RTC tick
+	MainLoopPass();
+	for(i = 0; i < REPLAY_BOOT_TICKS; i++)
+	{
+		(*Edge)++;
+		if((*Edge % REPLAY_EDGES_PER_SECOND) == 0)
+		{
+			SynthUpdate(*Edge / REPLAY_EDGES_PER_SECOND);
+			Board_SetTime(REPLAY_START_TIME + (*Edge / REPLAY_EDGES_PER_SECOND));
+		}
+		Board_Elapse(BOARD_RTC_TICK_MS, 1);
+		MainLoopPass();
+	}
+	Boot_GetTimes(Times);
+	return;
+}
+
+//Time the boot stages with no saved calibration, then after a reboot with it saved
+static int BootTest(FILE *Report)
+{
+	static const char * const Names[BOOT_STAGES] = {"Buses", "AD7794", "Safety", "USB attached", "DS3232M", "MAX7315",
+	                                                "AT45DB321D", "Ready", "USB configured", "Datalogger", "First sample",
+	                                                "First decision"};
+	uint32_t Times[2][BOOT_STAGES];
+	uint32_t BusUS[2];
+	uint32_t Wait;
+	uint8_t Old[REPLAY_OLD_FIELDS * 5];
+	Stream_Deadbands Deadbands;
+	int DeadbandsReset = 1;
+	int DeadbandKept;
+	long Edge = 0;
+	int Failed = 0;
+	int Run;
+	int i;
+
+	//Deadbands as the older firmware saved them, with no layout tag and every field set
+	for(i = 0; i < REPLAY_OLD_FIELDS; i++)
+	{
+		memset(&Old[i * 4], i + 1, 4);
+		Old[(REPLAY_OLD_FIELDS * 4) + i] = REPLAY_HEARTBEAT;
+	}
+	memset(&NV_STREAM_DEADBANDS, 0xFF, sizeof(NV_STREAM_DEADBANDS));
+	memcpy(&NV_STREAM_DEADBANDS, Old, sizeof(Old));
+
+	for(Run = 0; Run < 2; Run++)
+	{
+		BusUS[Run] = Board_Counters.BusUS;
+		BootRun(&Edge, Times[Run]);
+		BusUS[Run] = Board_Counters.BusUS - BusUS[Run];
+		StopTemperatureController(0);
+		if(Run == 0)
+		{
+			Stream_GetDeadbands(&Deadbands);
+			for(i = 0; i < STREAM_FIELDS; i++)
+			{
+				if((Deadbands.Deadband[i] != STREAM_DEFAULT_DEADBAND) || (Deadbands.Heartbeat[i] != STREAM_DEFAULT_HEARTBEAT))
+				{
+					DeadbandsReset = 0;
+				}
+			}
+			Stream_SetDeadband(REPLAY_DEADBAND_FIELD, REPLAY_DEADBAND, REPLAY_HEARTBEAT);
+		}
+	}
+	Stream_GetDeadbands(&Deadbands);
+	DeadbandKept = ((Deadbands.Deadband[REPLAY_DEADBAND_FIELD] == REPLAY_DEADBAND) &&
+	                (Deadbands.Heartbeat[REPLAY_DEADBAND_FIELD] == REPLAY_HEARTBEAT)) ? 1 : 0;
+
+	fprintf(Report, "Stage             No calibration (ms)  Calibrated (ms)\n");
+	for(i = 0; i < BOOT_STAGES; i++)
+	{
+		fprintf(Report, "%-16s", Names[i]);
+		for(Run = 0; Run < 2; Run++)
+		{
+			if(Times[Run][i] == BOOT_NOT_REACHED)
+			{
+				fprintf(Report, "  %*s", (Run == 0) ? 19 : 15, "-");
+			}
+			else
+			{
+				fprintf(Report, "  %*.1f", (Run == 0) ? 19 : 15, (double)Times[Run][i] / 1000.0);
+			}
+		}
+		fprintf(Report, "\n");
+	}
+	fprintf(Report, "Bus time:         %.1f ms and %.1f ms over the first %d s\n", (double)BusUS[0] / 1000.0,
+	        (double)BusUS[1] / 1000.0, REPLAY_BOOT_TICKS / REPLAY_EDGES_PER_SECOND);
+
+	//The controller is started at the end of the boot. The RTC count alone would have it wait up to a full sample period.
+	for(Run = 0; Run < 2; Run++)
+	{
+		if((Times[Run][BOOT_STAGE_SAMPLE] == BOOT_NOT_REACHED) || (Times[Run][BOOT_STAGE_DECISION] == BOOT_NOT_REACHED))
+		{
+			Failed = 1;
+			continue;
+		}
+		Wait = Times[Run][BOOT_STAGE_SAMPLE] - Times[Run][BOOT_STAGE_READY];
+		if(Wait >= (CONTROLLER_SAMPLE_TICKS * BOARD_RTC_TICK_MS * 1000UL))
+		{
+			Failed = 1;
+		}
+	}
+	fprintf(Report, "%s\n", (Failed == 0) ? "First sample taken without waiting for the RTC count" :
+	        "First sample NOT taken within a sample period");
+	fprintf(Report, "Stream deadbands saved with %d fields: %s, one set after it: %s\n", REPLAY_OLD_FIELDS,
+	        (DeadbandsReset != 0) ? "back to the defaults" : "NOT reset", (DeadbandKept != 0) ? "kept" : "NOT kept");
+	if((DeadbandsReset == 0) || (DeadbandKept == 0))
+	{
+		Failed = 1;
+	}
+	fflush(Report);
+	return Failed;
+}
+
+//Run the controller with timed conversions and check the rate each channel gets
+#define REPLAY_CHANNEL_NAME(Name, Bytes, Read, Convert)		#Name,
+static int AcquireTest(FILE *Report)
+{
+	static const char * const Names[CHANNEL_COUNT] = { CHANNEL_LIST(REPLAY_CHANNEL_NAME) };
+	Acquire_Channel Channel;
+	Acquire_Stats Stats;
+	Power_Stats Power;
+	uint8_t Dataset[CHANNEL_DATA_SIZE];
+	uint32_t Red[2];
+	uint32_t EndMS;
+	uint32_t Tick;
+	uint32_t PeriodMS;
+	uint32_t Expected;
+	double Interval;
+	double Error;
+	int Failed = 0;
+	uint8_t i;
+
+	Board_ADCTiming = 1;
+	SynthUpdate(0);
+	HardwareInit();
+	StartTemperatureController(0);
+	Power_ResetStats();
+
+	//The main loop runs again right away if a tick came while it was busy, as the wake up flag would have it
+	EndMS = Board_NowMS + (REPLAY_ACQUIRE_MINUTES * 60000UL);
+	Tick = Board_NowMS / BOARD_RTC_TICK_MS;
+	MainLoopPass();
+	while(Board_NowMS < EndMS)
+	{
+		if((Board_NowMS / BOARD_RTC_TICK_MS) == Tick)
+		{
+			Board_Elapse(BOARD_RTC_TICK_MS - (Board_NowMS % BOARD_RTC_TICK_MS), 1);
+		}
+		Tick = Board_NowMS / BOARD_RTC_TICK_MS;
+		SynthUpdate(Board_NowMS / 1000);
+		Board_SetTime(REPLAY_START_TIME + (Board_NowMS / 1000));
+		MainLoopPass();
+	}
+	Power_GetStats(&Power);
+
+	fprintf(Report, "Channel         Conversion (ms)  Period (ms)  Interval (ms)  Error (%%)  Conversions  Expected  Late max (ms)  Missed\n");
+	for(i = 0; Acquire_GetChannel(i, &Channel, &Stats) == 0; i++)
+	{
+		PeriodMS = (uint32_t)Channel.Period * ACQUIRE_TICK_MS;
+		Expected = (REPLAY_ACQUIRE_MINUTES * 60000UL) / PeriodMS;
+		Interval = 0;
+		if(Stats.Samples > 1)
+		{
+			Interval = (double)(Stats.LastMS - Stats.FirstMS) / (double)(Stats.Samples - 1);
+		}
+		Error = (Interval - (double)PeriodMS) / (double)PeriodMS;
+		fprintf(Report, "%-14s  %15u  %11lu  %13.1f  %9.3f  %11lu  %8lu  %13u  %6u\n", Names[Channel.Channel],
+		        AD7794ConversionMS(Channel.Rate), (unsigned long)PeriodMS, Interval, Error * 100.0,
+		        (unsigned long)Stats.Samples, (unsigned long)Expected, Stats.MaxLateMS, Stats.Missed);
+		if((fabs(Error) > REPLAY_ACQUIRE_RATE_ERROR) || (Stats.Missed != 0) || (Stats.MaxLateMS >= ACQUIRE_TICK_MS) ||
+		   ((Stats.Samples + 1) < Expected) || (Stats.Samples > (Expected + 1)))
+		{
+			Failed = 1;
+		}
+	}
+	fprintf(Report, "A/D busy:           %.0f ms per %d s sample period (%d ms for GetData alone before)\n",
+	        (double)Board_Counters.ADCBusyMS * (CONTROLLER_SAMPLE_TICKS * BOARD_RTC_TICK_MS) / (REPLAY_ACQUIRE_MINUTES * 60000.0),
+	        (CONTROLLER_SAMPLE_TICKS * BOARD_RTC_TICK_MS) / 1000, REPLAY_GETDATA_MS);
+	fprintf(Report, "Sample done:        %.1f ms after the RTC tick, %.1f ms at most, over %u samples\n",
+	        (double)Power.SampleLatencyUS / 1000.0, (double)Power.SampleLatencyMaxUS / 1000.0, Power.Samples);
+	fprintf(Report, "Calibration:        %lu steps, %lu cut short\n", (unsigned long)Board_Counters.ADCCalibrations,
+	        (unsigned long)Board_Counters.ADCCalibrationsCut);
+
+	//With the controller stopped, GetData converts again each time
+	StopTemperatureController(0);
+	MainLoopPass();
+	for(i = 0; i < 2; i++)
+	{
+		Board_ADCInput[1] = (i == 0) ? 0x400000 : 0x200000;
+		GetData(Dataset);
+		Red[i] = Channels_Get(Dataset, RED_TEMP);
+	}
+	fprintf(Report, "Controller off:     red read 0x%06lX then 0x%06lX, set to 0x400000 then 0x200000\n",
+	        (unsigned long)Red[0], (unsigned long)Red[1]);
+	if((Red[0] != 0x400000) || (Red[1] != 0x200000))
+	{
+		Failed = 1;
+	}
+	fprintf(Report, "%s\n", (Failed == 0) ? "Every channel on its period" : "A channel is NOT on its period, or GetData is stale");
+	fflush(Report);
+	return Failed;
+}
+
+//Noise on the conversions of each input, split by whether the input moved by more than the Step of its channel in the
+//last REPLAY_BENCH_SETTLE conversions
+typedef struct
+{
+	uint32_t Step[BOARD_ADC_INPUTS];
+	uint32_t Last[BOARD_ADC_INPUTS];
+	uint8_t Has[BOARD_ADC_INPUTS];
+	uint8_t Since[BOARD_ADC_INPUTS];		//Conversions since it moved
+	double Square[2][BOARD_ADC_INPUTS];		//[0] steady, [1] moving
+	uint32_t Count[2][BOARD_ADC_INPUTS];
+} ReplayNoise;
+
+static ReplayNoise BenchNoise;
+
+static void BenchConversion(uint8_t Input, uint32_t Counts, uint32_t Read, uint8_t Rate)
+{
+	int32_t Error;
+	uint32_t Change;
+	int Moving;
+
+	(void)Rate;
+
+	Change = (Counts > BenchNoise.Last[Input]) ? (Counts - BenchNoise.Last[Input]) : (BenchNoise.Last[Input] - Counts);
+	if((BenchNoise.Has[Input] == 1) && (Change > BenchNoise.Step[Input]))
+	{
+		BenchNoise.Since[Input] = 0;
+	}
+	else if(BenchNoise.Since[Input] < REPLAY_BENCH_SETTLE)
+	{
+		BenchNoise.Since[Input]++;
+	}
+	Moving = (BenchNoise.Since[Input] < REPLAY_BENCH_SETTLE) ? 1 : 0;
+
+	//The difference of 24 bit values, sign extended
+	Error = (int32_t)((Read - Counts) & 0xFFFFFF);
+	if((Error & 0x800000) != 0)
+	{
+		Error -= 0x1000000;
+	}
+	BenchNoise.Square[Moving][Input] += (double)Error * (double)Error;
+	BenchNoise.Count[Moving][Input]++;
+	BenchNoise.Last[Input] = Counts;
+	BenchNoise.Has[Input] = 1;
+	return;
+}
+
+//The thermal model inputs, for the plant as it is now
+static void BenchInputs(const Plant_State *Plant, const Plant_Params *Params)
+{
+	double Supply = Plant_Supply(Params, Plant->Time);
+	double Probe = 0.0;
+
+	if(Plant->Time >= REPLAY_BENCH_PROBE_S)
+	{
+		Probe = REPLAY_BENCH_PROBE_STEP * exp(-(Plant->Time - REPLAY_BENCH_PROBE_S) / REPLAY_BENCH_PROBE_LAG);
+	}
+	Board_ADCInput[1] = ThermistorTempToCounts((int32_t)lround(Plant->Sensor * 10000.0 + Probe));
+	Board_ADCInput[2] = ThermistorTempToCounts((int32_t)lround(Plant->Wort * 10000.0));
+	Board_ADCInput[5] = (uint32_t)lround(Supply * REPLAY_BENCH_VOLT_COUNTS);
+	Board_ADCInput[6] = (uint32_t)lround(116150.0 + (5000.0 * (Plant_Room(Params, Plant->Time) - Params->Room)));
+	Board_ADCInput[0] = 0x800000;
+	if((PORTD & (1<<6)) != 0)
+	{
+		Board_ADCInput[0] += (uint32_t)lround((Supply / Params->HeaterResistance) * REPLAY_BENCH_AMP_COUNTS);
+	}
+	return;
+}
+
+//Run the controller with each A/D rate policy on the same inputs, and give the A/D time and noise of each
+static int BenchTest(FILE *Report, ReplayTrace *Trace, const char *TraceName, long Seconds)
+{
+	static const char * const Names[CHANNEL_COUNT] = { CHANNEL_LIST(REPLAY_CHANNEL_NAME) };
+	static const char * const Policies[REPLAY_POLICIES] = {"steady", "adaptive", "fast"};
+	Acquire_Channel Channel;
+	Acquire_Stats Now;
+	Acquire_Stats Stats[REPLAY_POLICIES][ACQUIRE_CHANNELS];
+	double Noise[REPLAY_POLICIES][2][ACQUIRE_CHANNELS];
+	uint32_t Count[REPLAY_POLICIES][2][ACQUIRE_CHANNELS];
+	double Busy[REPLAY_POLICIES];
+	double Burst[REPLAY_POLICIES];
+	uint32_t Bursts[REPLAY_POLICIES];
+	uint32_t BurstMS[REPLAY_POLICIES];
+	Plant_Params Params;
+	Plant_State Plant;
+	uint32_t EndMS;
+	uint32_t Tick;
+	uint8_t Policy;
+	uint8_t Input;
+	int Moving;
+	int Failed = 0;
+	uint8_t i;
+
+	Plant_DefaultParams(&Params);
+	Params.Noise = 0;
+	Params.SupplyStep = 1.0;
+	Params.SupplyStepPeriod = 600.0;
+
+	for(Policy = 0; Policy < REPLAY_POLICIES; Policy++)
+	{
+		Board_Reset(REPLAY_START_TIME);
+		Board_ADCTiming = 1;
+		Board_ADCNoise = 1;
+		Board_ADCConversion = BenchConversion;
+		memset(&BenchNoise, 0, sizeof(BenchNoise));
+		memset(BenchNoise.Since, REPLAY_BENCH_SETTLE, sizeof(BenchNoise.Since));
+		for(i = 0; Acquire_GetChannel(i, &Channel, &Now) == 0; i++)
+		{
+			//A channel that never goes fast is always steady
+			BenchNoise.Step[Channel.ConfigL & 0x0F] = (Channel.Step == 0) ? 0xFFFFFFFF : Channel.Step;
+		}
+
+		Plant_Init(&Plant, REPLAY_BENCH_SETPOINT, 1);
+		if(TraceName != NULL)
+		{
+			fclose(Trace->File);
+			TraceOpen(Trace, TraceName);
+			TraceUpdate(Trace, 0);
+		}
+		else
+		{
+			BenchInputs(&Plant, &Params);
+		}
+		NV_SET_TEMPERATURE = REPLAY_BENCH_SETPOINT;
+		HardwareInit();
+		Acquire_SetPolicy(Policy);
+		StartTemperatureController(0);
+
+		//The main loop runs on each tick, and again right away if a tick came while it was busy
+		EndMS = Board_NowMS + (uint32_t)Seconds * 1000UL;
+		Tick = Board_NowMS / BOARD_RTC_TICK_MS;
+		MainLoopPass();
+		while(Board_NowMS < EndMS)
+		{
+			if((Board_NowMS / BOARD_RTC_TICK_MS) == Tick)
+			{
+				Board_Elapse(BOARD_RTC_TICK_MS - (Board_NowMS % BOARD_RTC_TICK_MS), 1);
+			}
+			while(Tick < (Board_NowMS / BOARD_RTC_TICK_MS))
+			{
+				Plant_Step(&Plant, &Params, ((PORTD & (1<<6)) != 0) ? 1 : 0);
+				Tick++;
+			}
+			if(TraceName != NULL)
+			{
+				TraceUpdate(Trace, Board_NowMS / 1000);
+			}
+			else
+			{
+				BenchInputs(&Plant, &Params);
+			}
+			Board_SetTime(REPLAY_START_TIME + (Board_NowMS / 1000));
+			MainLoopPass();
+		}
+		StopTemperatureController(0);
+
+		Busy[Policy] = (double)Board_Counters.ADCBusyMS * (CONTROLLER_SAMPLE_TICKS * BOARD_RTC_TICK_MS) / ((double)Seconds * 1000.0);
+		Burst[Policy] = (double)Board_Counters.ADCBurstMS * (CONTROLLER_SAMPLE_TICKS * BOARD_RTC_TICK_MS) / ((double)Seconds * 1000.0);
+		Bursts[Policy] = Board_Counters.ADCBursts;
+		BurstMS[Policy] = Board_Counters.ADCBurstMS;
+		for(i = 0; Acquire_GetChannel(i, &Channel, &Stats[Policy][i]) == 0; i++)
+		{
+			Input = Channel.ConfigL & 0x0F;
+			for(Moving = 0; Moving < 2; Moving++)
+			{
+				Count[Policy][Moving][i] = BenchNoise.Count[Moving][Input];
+				Noise[Policy][Moving][i] = 0;
+				if(BenchNoise.Count[Moving][Input] != 0)
+				{
+					Noise[Policy][Moving][i] = sqrt(BenchNoise.Square[Moving][Input] / BenchNoise.Count[Moving][Input]);
+				}
+			}
+		}
+	}
+	Board_ADCConversion = NULL;
+	Board_ADCNoise = 0;
+	Board_ADCTiming = 0;
+
+	fprintf(Report, "%s, %.1f hours\n", (TraceName != NULL) ? TraceName : "Thermal model", (double)Seconds / 3600.0);
+	fprintf(Report, "Policy    A/D busy (ms per %d s)  Schedule  Bursts  Burst count  ms per burst\n",
+	        (CONTROLLER_SAMPLE_TICKS * BOARD_RTC_TICK_MS) / 1000);
+	for(Policy = 0; Policy < REPLAY_POLICIES; Policy++)
+	{
+		fprintf(Report, "%-8s  %22.0f  %8.0f  %6.0f  %11lu  %12.1f\n", Policies[Policy], Busy[Policy], Busy[Policy] - Burst[Policy],
+		        Burst[Policy], (unsigned long)Bursts[Policy], (Bursts[Policy] == 0) ? 0.0 : ((double)BurstMS[Policy] / Bursts[Policy]));
+	}
+	fprintf(Report, "The heater RMS burst blocks the main loop for its whole length on every sample with the relay on\n");
+	fprintf(Report, "Channel         Policy    Fast (%%)  Steady noise (counts)  Moving noise (counts)  Steady  Moving\n");
+	for(i = 0; Acquire_GetChannel(i, &Channel, &Now) == 0; i++)
+	{
+		for(Policy = 0; Policy < REPLAY_POLICIES; Policy++)
+		{
+			fprintf(Report, "%-14s  %-8s  %8.1f  %21.1f  %21.1f  %6lu  %6lu\n", Names[Channel.Channel], Policies[Policy],
+			        (Stats[Policy][i].Samples == 0) ? 0.0 : (100.0 * Stats[Policy][i].FastSamples / Stats[Policy][i].Samples),
+			        Noise[Policy][0][i], Noise[Policy][1][i], (unsigned long)Count[Policy][0][i], (unsigned long)Count[Policy][1][i]);
+		}
+		if(Noise[ACQUIRE_POLICY_ADAPTIVE][0][i] > (REPLAY_BENCH_NOISE_MARGIN * Noise[ACQUIRE_POLICY_FIXED][0][i]))
+		{
+			Failed = 1;
+		}
+	}
+	if(Busy[ACQUIRE_POLICY_ADAPTIVE] > Busy[ACQUIRE_POLICY_FIXED])
+	{
+		Failed = 1;
+	}
+	fprintf(Report, "%s\n", (Failed == 0) ? "Adaptive policy as quiet as steady in steady state, for no more A/D time" :
+	        "Adaptive policy NOT as quiet as steady in steady state, or takes more A/D time");
+	fflush(Report);
+	return Failed;
+}
+
+//Synthetic heater current waveforms
+enum
+{
+	REPLAY_WAVE_SINE,
+	REPLAY_WAVE_RECTIFIED,
+	REPLAY_WAVE_SQUARE,				//25% duty
+	REPLAY_WAVE_TRIANGLE,
+	REPLAY_WAVE_SHAPES
+};
+
+typedef struct
+{
+	const char *Name;
+	int Shape;
+	double Mean;					//A
+	double Amplitude;				//A
+	double Hz;
+	double Noise;					//A RMS
+} ReplayWave;
+
+//The firmware burst on the board model
+static ReplayWave RippleWave;
+static int32_t RippleRead[RIPPLE_SAMPLES];
+static int RippleReads;
+
+//0 to 1
+static double RippleUniform(void)
+{
+	return ((double)rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+static double RippleCurrent(const ReplayWave *Wave, double Time)
+{
+	double Phase = fmod(Time * Wave->Hz, 1.0);
+	double Current = Wave->Mean;
+
+	switch(Wave->Shape)
+	{
+		case REPLAY_WAVE_SINE:
+			Current += Wave->Amplitude * sin(2.0 * M_PI * Phase);
+			break;
+		case REPLAY_WAVE_RECTIFIED:
+			Current += Wave->Amplitude * fabs(sin(M_PI * Phase));
+			break;
+		case REPLAY_WAVE_SQUARE:
+			Current += (Phase < 0.25) ? Wave->Amplitude : 0.0;
+			break;
+		case REPLAY_WAVE_TRIANGLE:
+			Current += Wave->Amplitude * (1.0 - fabs((2.0 * Phase) - 1.0));
+			break;
+	}
+	if(Wave->Noise > 0)
+	{
+		Current += Wave->Noise * sqrt(-2.0 * log(RippleUniform())) * cos(2.0 * M_PI * RippleUniform());
+	}
+	return Current;
+}
+
+//Counts from the zero for a current, in the range of the bipolar input
+static int32_t RippleCounts(double Current)
+{
+	double Counts = round(Current * REPLAY_COUNTS_PER_AMP);
+
+	if(Counts > 8388607.0)
+	{
+		Counts = 8388607.0;
+	}
+	if(Counts < -8388608.0)
+	{
+		Counts = -8388608.0;
+	}
+	return (int32_t)Counts;
+}
+
+//The mean, RMS, ripple and peak in 0.1mA and the crest factor in 0.01, in double precision
+static void RippleDouble(const int32_t Counts[], int Samples, double Results[REPLAY_RIPPLE_RESULTS])
+{
+	double Scale = RIPPLE_SCALE / 16777216.0;
+	double Sum = 0;
+	double Squares = 0;
+	double Spread = 0;
+	double Peak = 0;
+	double Mean;
+	double RMS;
+	int i;
+
+	for(i = 0; i < Samples; i++)
+	{
+		Sum += Counts[i];
+		Squares += (double)Counts[i] * Counts[i];
+		if(fabs((double)Counts[i]) > Peak)
+		{
+			Peak = fabs((double)Counts[i]);
+		}
+	}
+	Mean = Sum / Samples;
+	RMS = sqrt(Squares / Samples);
+	for(i = 0; i < Samples; i++)
+	{
+		Spread += (Counts[i] - Mean) * (Counts[i] - Mean);
+	}
+	Results[0] = Mean * Scale;
+	Results[1] = RMS * Scale;
+	Results[2] = sqrt(Spread / Samples) * Scale;
+	Results[3] = Peak * Scale;
+	Results[4] = (RMS > 0) ? (100.0 * Peak / RMS) : 0.0;
+	return;
+}
+
+//The largest error of the integer results against the double precision ones
+static double RippleError(const Ripple_Result *Result, const double Results[REPLAY_RIPPLE_RESULTS], double Errors[REPLAY_RIPPLE_RESULTS])
+{
+	double Largest = 0;
+	int i;
+
+	Errors[0] = fabs(Result->Mean - Results[0]);
+	Errors[1] = fabs(Result->RMS - Results[1]);
+	Errors[2] = fabs(Result->Ripple - Results[2]);
+	Errors[3] = fabs(Result->Peak - Results[3]);
+	Errors[4] = fabs(Result->Crest - Results[4]);
+	for(i = 0; i < REPLAY_RIPPLE_RESULTS; i++)
+	{
+		if(Errors[i] > Largest)
+		{
+			Largest = Errors[i];
+		}
+	}
+	return Largest;
+}
+
+//Sample a waveform as a burst would, and get both results
+static double RippleCheck(const ReplayWave *Wave, Ripple_Result *Result, double Results[REPLAY_RIPPLE_RESULTS], double Errors[REPLAY_RIPPLE_RESULTS])
+{
+	int32_t Counts[RIPPLE_SAMPLES];
+	Ripple_Sums Sums;
+	int i;
+
+	Ripple_Init(&Sums);
+	for(i = 0; i < RIPPLE_SAMPLES; i++)
+	{
+		Counts[i] = RippleCounts(RippleCurrent(Wave, i / REPLAY_RIPPLE_HZ));
+		Ripple_Add(&Sums, Counts[i]);
+	}
+	Ripple_Finish(&Sums, Result);
+	RippleDouble(Counts, RIPPLE_SAMPLES, Results);
+	return RippleError(Result, Results, Errors);
+}
+
+//The waveform on AIN1 while the relay is on, no current while it is off
+static uint32_t RippleSource(uint8_t Input, uint32_t NowMS)
+{
+	if(Input != 0)
+	{
+		return Board_ADCInput[Input];
+	}
+	if((PORTD & (1<<6)) == 0)
+	{
+		return 0x800000;
+	}
+	return (uint32_t)(0x800000 + RippleCounts(RippleCurrent(&RippleWave, NowMS / 1000.0)));
+}
+
+static void RippleConversion(uint8_t Input, uint32_t Counts, uint32_t Read, uint8_t Rate)
+{
+	(void)Counts;
+	(void)Rate;
+	if((Input == 0) && (RippleReads < RIPPLE_SAMPLES))
+	{
+		RippleRead[RippleReads] = (int32_t)Read - (int32_t)GetHeaterCurrentZero();
+		RippleReads++;
+	}
+	return;
+}
+
+//Check the integer burst results against double precision on synthetic waveforms, then run a burst on the board model
+static int RippleTest(FILE *Report)
+{
+	static const ReplayWave Waves[] =
+	{
+		{"DC 2A",						REPLAY_WAVE_SINE,		2.0,	0.0,	0.0,	0.0},
+		{"Zero with A/D noise",			REPLAY_WAVE_SINE,		0.0,	0.0,	0.0,	0.00006},
+		{"DC -1.5A",					REPLAY_WAVE_SINE,		-1.5,	0.0,	0.0,	0.0},
+		{"2A, 0.2A sine at 100Hz",		REPLAY_WAVE_SINE,		2.0,	0.2,	100.0,	0.0},
+		{"Rectified 2.5A at 100Hz",		REPLAY_WAVE_RECTIFIED,	0.0,	2.5,	100.0,	0.0},
+		{"PWM 25% 2.5A at 50Hz",		REPLAY_WAVE_SQUARE,		0.0,	2.5,	50.0,	0.0},
+		{"Triangle 0-2.5A at 60Hz",		REPLAY_WAVE_TRIANGLE,	0.0,	2.5,	60.0,	0.0},
+		{"Full scale both ways",		REPLAY_WAVE_SQUARE,		-3.0,	6.0,	117.5,	0.0},
+		{"1A, 0.5A sine with noise",	REPLAY_WAVE_SINE,		1.0,	0.5,	100.0,	0.01},
+	};
+	static const char * const Names[REPLAY_RIPPLE_RESULTS] = {"Mean", "RMS", "Ripple", "Peak", "Crest"};
+	Ripple_Result Result;
+	ReplayWave Wave;
+	double Results[REPLAY_RIPPLE_RESULTS];
+	double Errors[REPLAY_RIPPLE_RESULTS];
+	double Largest[REPLAY_RIPPLE_RESULTS];
+	uint32_t BusyMS;
+	uint32_t StartMS;
+	uint32_t RMS;
+	int Zero;
+	int Failed = 0;
+	unsigned i;
+	int j;
+
+	srand(1);
+	fprintf(Report, "Waveform                   Mean (A)  RMS (A)  Ripple (A)  Peak (A)  Crest  Error\n");
+	for(i = 0; i < (sizeof(Waves) / sizeof(Waves[0])); i++)
+	{
+		if(RippleCheck(&Waves[i], &Result, Results, Errors) > REPLAY_RIPPLE_LIMIT)
+		{
+			Failed = 1;
+		}
+		fprintf(Report, "%-25s  %8.4f  %7.4f  %10.4f  %8.4f  %5.2f  %5.2f\n", Waves[i].Name, Result.Mean / 10000.0,
+		        Result.RMS / 10000.0, Result.Ripple / 10000.0, Result.Peak / 10000.0, Result.Crest / 100.0,
+		        RippleError(&Result, Results, Errors));
+	}
+
+	//Random waveforms, over the whole range
+	memset(Largest, 0, sizeof(Largest));
+	for(i = 0; i < REPLAY_RIPPLE_RANDOM; i++)
+	{
+		Wave.Name = NULL;
+		Wave.Shape = rand() % REPLAY_WAVE_SHAPES;
+		Wave.Mean = (RippleUniform() * 6.0) - 3.0;
+		Wave.Amplitude = (RippleUniform() * 6.0) - 3.0;
+		Wave.Hz = RippleUniform() * (REPLAY_RIPPLE_HZ / 2.0);
+		Wave.Noise = ((rand() % 2) == 0) ? 0.0 : (RippleUniform() * 0.1);
+		RippleCheck(&Wave, &Result, Results, Errors);
+		for(j = 0; j < REPLAY_RIPPLE_RESULTS; j++)
+		{
+			if(Errors[j] > Largest[j])
+			{
+				Largest[j] = Errors[j];
+			}
+		}
+	}
+	fprintf(Report, "Largest error over %d random waveforms:", REPLAY_RIPPLE_RANDOM);
+	for(j = 0; j < REPLAY_RIPPLE_RESULTS; j++)
+	{
+		fprintf(Report, " %s %.2f", Names[j], Largest[j]);
+		if(Largest[j] > REPLAY_RIPPLE_LIMIT)
+		{
+			Failed = 1;
+		}
+	}
+	fprintf(Report, " (0.1mA, 0.01 for the crest)\n");
+
+	//A burst by the firmware, with the relay on so it is the one logged. The zero of the sensor is calibrated first, with
+	//the controller running flat out so the RTC interrupt would turn the relay back on during the calibration.
+	Board_Reset(REPLAY_START_TIME);
+	Board_ADCTiming = 1;
+	SynthUpdate(0);
+	HardwareInit();
+	RippleWave = Waves[3];
+	Board_ADCSource = RippleSource;
+	NV_SET_TEMPERATURE = REPLAY_SAFETY_SETPOINT;
+	StartTemperatureController(0);
+	for(i = 0; i < REPLAY_WATCHDOG_WARMUP; i++)
+	{
+		SafetyEdge(i, 0, 1);
+	}
+	Zero = 0;
+	for(i = 0; i < REPLAY_RIPPLE_ZEROS; i++)
+	{
+		CalibrateHeaterCurrent();
+		if(GetHeaterCurrentZero() != 0x800000)
+		{
+			Zero++;
+		}
+	}
+	StopTemperatureController(0);
+	fprintf(Report, "Current zero calibrated %d times with the controller on, %d wrong\n", REPLAY_RIPPLE_ZEROS, Zero);
+	if(Zero != 0)
+	{
+		Failed = 1;
+	}
+	Board_ADCNoise = 1;
+	CalibrateHeaterCurrent();
+	RippleReads = 0;
+	Board_ADCConversion = RippleConversion;
+	Relay(1);
+	BusyMS = Board_Counters.ADCBusyMS;
+	StartMS = Board_NowMS;
+	RMS = Ripple_Get();
+	Ripple_GetLatest(&Result);
+	BusyMS = Board_Counters.ADCBusyMS - BusyMS;
+	StartMS = Board_NowMS - StartMS;
+	Relay(0);
+	Board_ADCSource = NULL;
+	Board_ADCConversion = NULL;
+	Board_ADCNoise = 0;
+	Board_ADCTiming = 0;
+
+	RippleDouble(RippleRead, RippleReads, Results);
+	fprintf(Report, "Burst on the board model, %s: %d conversions in %lu ms (%lu ms of A/D time)\n", RippleWave.Name,
+	        RippleReads, (unsigned long)StartMS, (unsigned long)BusyMS);
+	fprintf(Report, "Integer:  mean %.4f A, RMS %.4f A, ripple %.4f A, peak %.4f A, crest %.2f\n", Result.Mean / 10000.0,
+	        Result.RMS / 10000.0, Result.Ripple / 10000.0, Result.Peak / 10000.0, Result.Crest / 100.0);
+	fprintf(Report, "Double:   mean %.4f A, RMS %.4f A, ripple %.4f A, peak %.4f A, crest %.2f\n", Results[0] / 10000.0,
+	        Results[1] / 10000.0, Results[2] / 10000.0, Results[3] / 10000.0, Results[4] / 100.0);
+	if((RippleReads != RIPPLE_SAMPLES) || (Result.Samples != RIPPLE_SAMPLES) || (RMS != Result.RMS) ||
+	   (RippleError(&Result, Results, Errors) > REPLAY_RIPPLE_LIMIT))
+	{
+		Failed = 1;
+	}
+
+	fprintf(Report, "%s\n", (Failed == 0) ? "Integer results within the limit of double precision" :
+	        "Integer results NOT within the limit of double precision");
+	fflush(Report);
+	return Failed;
+}
+
+//Log REPLAY_WEAR_YEARS of data sets, mounting the log with 'SetupByte' every REPLAY_WEAR_RESTART_HOURS
+static void WearRun(uint8_t SetupByte, uint32_t *MountReads, uint32_t *MountUS)
+{
+	uint8_t DataSet[DATALOGGER_DATASET_SIZE];
+	time_t Time;
+	uint32_t Reads;
+	uint32_t BusUS;
+	long Record;
+	long Records;
+
+	Board_Reset(REPLAY_START_TIME);
+	SynthUpdate(0);
+	HardwareInit();
+	Datalogger_Init(SetupByte);
+	*MountReads = 0;
+	*MountUS = 0;
+
+	Records = REPLAY_WEAR_YEARS * 365L * 24L * (60 / REPLAY_WEAR_SAVE_MIN);
+	Time = REPLAY_START_TIME;
+	for(Record = 0; Record < Records; Record++)
+	{
+		memset(DataSet, (int)(Record & 0xFF), sizeof(DataSet));
+		LogTime(Time, DataSet);
+		Datalogger_AddDataSet(DataSet);
+		Time += REPLAY_WEAR_SAVE_MIN * 60;
+
+		//A boot. The data set being filled in the dataflash buffer is lost, as on a power cut.
+		if(((Time - REPLAY_START_TIME) % (REPLAY_WEAR_RESTART_HOURS * 3600L)) == 0)
+		{
+			Reads = Board_Counters.SPITransactions;
+			BusUS = Board_Counters.BusUS;
+			Datalogger_Init(SetupByte);
+			Reads = Board_Counters.SPITransactions - Reads;
+			BusUS = Board_Counters.BusUS - BusUS;
+			if(Reads > *MountReads)
+			{
+				*MountReads = Reads;
+			}
+			if(BusUS > *MountUS)
+			{
+				*MountUS = BusUS;
+			}
+		}
+	}
+	return;
+}
+
+//Years of logging with a mount every day, with the circular log and with the log started over at page 0
+static int WearTest(FILE *Report)
+{
+	static const char * const Names[2] = {"Circular", "Page 0 restart"};
+	static const uint8_t SetupBytes[2] = {(DATALOGGER_INIT_APPEND | DATALOGGER_INIT_RESTART_IF_FULL),
+	                                      DATALOGGER_INIT_OVERWRITE};
+	uint32_t MountReads;
+	uint32_t MountUS;
+	uint32_t Least;
+	uint32_t Most;
+	double Total;
+	int Failed = 0;
+	int Run;
+	int i;
+
+	fprintf(Report, "%d years, a data set every %d min, a mount every %d h\n", REPLAY_WEAR_YEARS, REPLAY_WEAR_SAVE_MIN,
+	        REPLAY_WEAR_RESTART_HOURS);
+	fprintf(Report, "Log               Least erases   Mean erases   Most erases   Page 0   Mount reads   Mount bus (ms)\n");
+	for(Run = 0; Run < 2; Run++)
+	{
+		WearRun(SetupBytes[Run], &MountReads, &MountUS);
+		Least = Board_FlashErases[0];
+		Most = Board_FlashErases[0];
+		Total = 0;
+		for(i = 0; i < BOARD_FLASH_PAGES; i++)
+		{
+			if(Board_FlashErases[i] < Least)
+			{
+				Least = Board_FlashErases[i];
+			}
+			if(Board_FlashErases[i] > Most)
+			{
+				Most = Board_FlashErases[i];
+			}
+			Total += Board_FlashErases[i];
+		}
+		fprintf(Report, "%-16s  %12lu  %12.2f  %12lu  %7lu  %12lu  %15.1f\n", Names[Run], (unsigned long)Least,
+		        Total / BOARD_FLASH_PAGES, (unsigned long)Most, (unsigned long)Board_FlashErases[0],
+		        (unsigned long)MountReads, (double)MountUS / 1000.0);
+		if((Run == 0) && (((Most - Least) > 1) || (MountReads > REPLAY_WEAR_MOUNT_READS)))
+		{
+			Failed = 1;
+		}
+	}
+	fprintf(Report, "%s\n", (Failed == 0) ? "Circular log wears the pages evenly and mounts in a few reads" :
+	        "Circular log does NOT wear evenly or mount in a few reads");
+	fflush(Report);
+	return Failed;
+}
+
+static uint32_t RangeLines;
+
+static ssize_t RangeWrite(void *Cookie, const char *Data, size_t Size)
+{
+	size_t i;
+
+	(void)Cookie;
+	for(i = 0; i < Size; i++)
+	{
+		if(Data[i] == '\n')
+		{
+			RangeLines++;
+		}
+	}
+	return (ssize_t)Size;
+}
+
+//Fill the dataflash past its end, then read back recent windows with the time index
+static int RangeTest(FILE *Report)
+{
+	static const cookie_io_functions_t Functions = {NULL, RangeWrite, NULL, NULL};
+	static const char * const Names[REPLAY_RANGE_QUERIES] = {"Last hour", "Last day", "Last week", "Last 30 days"};
+	static const long Windows[REPLAY_RANGE_QUERIES] = {3600L, 86400L, 7 * 86400L, 30 * 86400L};
+	uint8_t DataSet[DATALOGGER_DATASET_SIZE];
+	uint8_t From[DATALOGGER_TIME_SIZE];
+	uint8_t To[DATALOGGER_TIME_SIZE];
+	time_t Time;
+	time_t Last;
+	FILE *Saved;
+	FILE *Lines;
+	uint32_t Bytes;
+	uint32_t BusUS;
+	uint32_t Expected;
+	uint32_t Pages;
+	long Record;
+	long Records;
+	int Failed = 0;
+	int i;
+
+	SynthUpdate(0);
+	HardwareInit();
+	Datalogger_Init(DATALOGGER_INIT_APPEND | DATALOGGER_INIT_RESTART_IF_FULL);
+	Records = REPLAY_RANGE_DAYS * 24L * (60 / REPLAY_RANGE_SAVE_MIN);
+	Time = REPLAY_START_TIME + (REPLAY_RANGE_NEW_YEAR_DAYS - REPLAY_RANGE_DAYS) * 86400L;
+	for(Record = 0; Record < Records; Record++)
+	{
+		memset(DataSet, (int)(Record & 0xFF), sizeof(DataSet));
+		LogTime(Time, DataSet);
+		Datalogger_AddDataSet(DataSet);
+		Time += REPLAY_RANGE_SAVE_MIN * 60;
+	}
+	Datalogger_SaveDataToFlash();
+	Last = Time - (REPLAY_RANGE_SAVE_MIN * 60);
+
+	Lines = fopencookie(NULL, "w", Functions);
+	if(Lines == NULL)
+	{
+		fprintf(Report, "Cannot make the readback stream\n");
+		return 1;
+	}
+	fprintf(Report, "%ld data sets, one every %d min. A scan reads %lu bytes.\n", Records, REPLAY_RANGE_SAVE_MIN,
+	        (unsigned long)BOARD_FLASH_PAGES * BOARD_FLASH_PAGE_SIZE);
+	fprintf(Report, "Query          Data sets   Bytes read   Of a scan   Bus time (ms)\n");
+	for(i = 0; i < REPLAY_RANGE_QUERIES; i++)
+	{
+		Bytes = Board_Counters.FlashArrayBytes;
+		BusUS = Board_Counters.BusUS;
+		RangeLines = 0;
+		Saved = stdout;
+		stdout = Lines;
+		LogTime(Last - Windows[i], From);
+		LogTime(Last, To);
+		Datalogger_ReadBackRange(From, To);
+		fflush(Lines);
+		stdout = Saved;
+		Bytes = Board_Counters.FlashArrayBytes - Bytes;
+		BusUS = Board_Counters.BusUS - BusUS;
+
+		Expected = (uint32_t)(Windows[i] / (REPLAY_RANGE_SAVE_MIN * 60)) + 1;
+		Pages = (Expected + ((DATALOGGER_PAGE_SIZE - DATALOGGER_PAGE_HEADER_SIZE) / DATALOGGER_RECORD_SIZE) - 1) /
+		        ((DATALOGGER_PAGE_SIZE - DATALOGGER_PAGE_HEADER_SIZE) / DATALOGGER_RECORD_SIZE) + 1;
+		fprintf(Report, "%-13s  %10lu  %11lu  %9.2f%%  %14.1f\n", Names[i], (unsigned long)RangeLines,
+		        (unsigned long)Bytes, 100.0 * Bytes / ((double)BOARD_FLASH_PAGES * BOARD_FLASH_PAGE_SIZE),
+		        (double)BusUS / 1000.0);
+		if((RangeLines != Expected) || (Bytes > ((Pages * BOARD_FLASH_PAGE_SIZE) + REPLAY_RANGE_SEARCH_BYTES)))
+		{
+			Failed = 1;
+		}
+	}
+	fclose(Lines);
+
+	fprintf(Report, "%s\n", (Failed == 0) ? "Every query gave its window and read little more than its pages" :
+	        "A query did NOT give its window, or read too much");
+	fflush(Report);
+	return Failed;
+}
+
+//A data set that holds its number 'Index', in its time and in every byte of the channels
+static void TornDataSet(long Index, uint8_t DataSet[DATALOGGER_DATASET_SIZE])
+{
+	memset(DataSet, (int)(Index & 0xFF), DATALOGGER_DATASET_SIZE);
+	LogTime(REPLAY_START_TIME + (Index * 60), DataSet);
+	return;
+}
+
+//Check a readback: the data sets must be the 'Count' in 'Expected', in order and unchanged. One data set that is not
+//the next one is allowed after the first 'Torn' of them, for a torn data set that passed its CRC. Returns 1 if they are.
+static int TornCheck(char *Text, const long Expected[], int Count, int Torn, int *CRCErrors, int *Missed)
+{
+	uint8_t Read[DATALOGGER_DATASET_SIZE];
+	uint8_t Want[DATALOGGER_DATASET_SIZE];
+	unsigned int Value;
+	char *Line;
+	char *Next;
+	int Found = 0;
+	int Used;
+	int i;
+
+	*CRCErrors = 0;
+	*Missed = 0;
+	for(Line = Text; (Line != NULL) && (*Line != 0); Line = Next)
+	{
+		Next = strchr(Line, '\n');
+		if(Next != NULL)
+		{
+			*Next++ = 0;
+		}
+		if(strncmp(Line, "CRC error", 9) == 0)
+		{
+			(*CRCErrors)++;
+			continue;
+		}
+		if(strncmp(Line, "0x", 2) != 0)
+		{
+			continue;
+		}
+		for(i = 0; i < DATALOGGER_DATASET_SIZE; i++)
+		{
+			if(sscanf(Line, "0x%2X, %n", &Value, &Used) != 1)
+			{
+				return 0;
+			}
+			Read[i] = (uint8_t)Value;
+			Line += Used;
+		}
+		if(Found < Count)
+		{
+			TornDataSet(Expected[Found], Want);
+		}
+		if((Found >= Count) || (memcmp(Read, Want, sizeof(Want)) != 0))
+		{
+			if((Found != Torn) || (*Missed != 0))
+			{
+				return 0;
+			}
+			(*Missed)++;
+			continue;
+		}
+		Found++;
+	}
+	return (Found == Count) ? 1 : 0;
+}
+
+//Cut the program of the last page short at each byte, then mount, add to the log and read it back
+static int TornTest(FILE *Report)
+{
+	uint8_t DataSet[DATALOGGER_DATASET_SIZE];
+	uint8_t Programmed[DATALOGGER_PAGE_SIZE];
+	long Expected[REPLAY_TORN_PAGES * REPLAY_DATASETS_PER_PAGE + REPLAY_TORN_NEW];
+	uint16_t Page = REPLAY_TORN_PAGES - 1;
+	uint32_t Random = 1;
+	FILE *Saved;
+	FILE *Text;
+	char *Output;
+	size_t Size;
+	long Index;
+	int Count;
+	int Kept;
+	int CRCErrors;
+	int Missed;
+	int TornRecords = 0;
+	int Whole = 0;
+	int Detected = 0;
+	int Misses = 0;
+	int Bad = 0;
+	int Cut;
+	int Trial;
+	int Intact;
+	int i;
+
+	for(Cut = 0; Cut < DATALOGGER_PAGE_SIZE; Cut++)
+	{
+		for(Trial = 0; Trial < REPLAY_TORN_TRIALS; Trial++)
+		{
+			Board_Reset(REPLAY_START_TIME);
+			SynthUpdate(0);
+			HardwareInit();
+			Datalogger_Init(DATALOGGER_INIT_APPEND | DATALOGGER_INIT_RESTART_IF_FULL);
+			for(Index = 0; Index < (REPLAY_TORN_PAGES * REPLAY_DATASETS_PER_PAGE); Index++)
+			{
+				TornDataSet(Index, DataSet);
+				Datalogger_AddDataSet(DataSet);
+			}
+
+			//The power goes while the last page is programmed
+			memcpy(Programmed, Board_Flash[Page], DATALOGGER_PAGE_SIZE);
+			Random = Random * 1103515245UL + 12345UL;
+			Board_Flash[Page][Cut] |= (uint8_t)(Random >> 16) | 0x01;
+			memset(&Board_Flash[Page][Cut + 1], 0xFF, DATALOGGER_PAGE_SIZE - Cut - 1);
+
+			//Boot, and add to the log
+			Datalogger_Init(DATALOGGER_INIT_APPEND | DATALOGGER_INIT_RESTART_IF_FULL);
+			for(Index = REPLAY_TORN_FIRST_NEW; Index < (REPLAY_TORN_FIRST_NEW + REPLAY_TORN_NEW); Index++)
+			{
+				TornDataSet(Index, DataSet);
+				Datalogger_AddDataSet(DataSet);
+			}
+			Datalogger_SaveDataToFlash();
+
+			//Every data set that was programmed in full, then the new ones
+			Count = 0;
+			for(Index = 0; Index < (REPLAY_TORN_PAGES * REPLAY_DATASETS_PER_PAGE); Index++)
+			{
+				i = DATALOGGER_PAGE_HEADER_SIZE + (Index % REPLAY_DATASETS_PER_PAGE) * DATALOGGER_RECORD_SIZE;
+				if(((Index / REPLAY_DATASETS_PER_PAGE) < Page) || ((Cut >= DATALOGGER_PAGE_HEADER_SIZE) &&
+				   ((i + DATALOGGER_RECORD_SIZE) <= Cut)))
+				{
+					Expected[Count++] = Index;
+				}
+			}
+			Kept = Count;
+			for(Index = REPLAY_TORN_FIRST_NEW; Index < (REPLAY_TORN_FIRST_NEW + REPLAY_TORN_NEW); Index++)
+			{
+				Expected[Count++] = Index;
+			}
+
+			//The cut is in a data set unless it is in the page header or after the last data set. The data set is left
+			//whole if the bits not programmed at the cut and the bytes after it were already 1, and then it must pass.
+			i = Cut - DATALOGGER_PAGE_HEADER_SIZE;
+			Intact = 0;
+			if((i >= 0) && (i < (REPLAY_DATASETS_PER_PAGE * DATALOGGER_RECORD_SIZE)))
+			{
+				i = DATALOGGER_PAGE_HEADER_SIZE + (i / DATALOGGER_RECORD_SIZE) * DATALOGGER_RECORD_SIZE;
+				if(memcmp(&Programmed[i], &Board_Flash[Page][i], DATALOGGER_RECORD_SIZE) == 0)
+				{
+					Intact = 1;
+					Whole++;
+				}
+				else
+				{
+					TornRecords++;
+				}
+			}
+
+			Output = NULL;
+			Text = open_memstream(&Output, &Size);
+			if(Text == NULL)
+			{
+				fprintf(Report, "Cannot make the readback stream\n");
+				return 1;
+			}
+			Saved = stdout;
+			stdout = Text;
+			Datalogger_ReadBackData(0xFFFF);
+			stdout = Saved;
+			fclose(Text);
+			if((TornCheck(Output, Expected, Count, Kept, &CRCErrors, &Missed) == 0) || ((CRCErrors + Missed) > 1))
+			{
+				if(Bad == 0)
+				{
+					fprintf(Report, "First failure with the cut at byte %d\n", Cut);
+				}
+				Bad++;
+			}
+			Detected += CRCErrors;
+			if(Intact == 0)
+			{
+				Misses += Missed;
+			}
+			free(Output);
+		}
+	}
+
+	fprintf(Report, "Cuts:                       %d, %d at each byte of page %u\n", DATALOGGER_PAGE_SIZE * REPLAY_TORN_TRIALS,
+	        REPLAY_TORN_TRIALS, Page);
+	fprintf(Report, "Torn data sets:             %d (and %d left whole by the cut)\n", TornRecords, Whole);
+	fprintf(Report, "Found by their CRC:         %d\n", Detected);
+	fprintf(Report, "Passed their CRC anyway:    %d (%.2f in 256)\n", Misses, 256.0 * Misses / TornRecords);
+	fprintf(Report, "Other data lost or changed: %d readbacks\n", Bad);
+	fprintf(Report, "%s\n", (Bad == 0) ? "No data lost to a torn write but the torn data set" :
+	        "Data lost to a torn write");
+	fflush(Report);
+	return (Bad == 0) ? 0 : 1;
+}
+
+static int WriteFlash(const char *Name)
+{
+	FILE *File;
+
+	File = fopen(Name, "wb");
+	if((File == NULL) || (fwrite(Board_Flash, 1, sizeof(Board_Flash), File) != sizeof(Board_Flash)))
+	{
+		fprintf(stderr, "Cannot write %s: %s\n", Name, strerror(errno));
+		return 0;
+	}
+	fclose(File);
+	return 1;
+}
+
+//Log data sets from random inputs and write what was saved in the format of 'logdecode -f raw'
+static int PackTest(FILE *Report, const char *ValuesName, const char *FlashOutName)
+{
+	static const char * const Names[CHANNEL_COUNT] = { CHANNEL_LIST(REPLAY_CHANNEL_NAME) };
+	uint32_t Values[CHANNEL_COUNT];
+	uint32_t Random = 1;
+	time_t Time;
+	FILE *File;
+	int DataSet;
+	int Sample;
+	int i;
+
+	File = fopen(ValuesName, "w");
+	if(File == NULL)
+	{
+		fprintf(stderr, "Cannot open %s: %s\n", ValuesName, strerror(errno));
+		return 1;
+	}
+	fprintf(File, "year,month,day,hour,min");
+	for(i = 0; i < CHANNEL_COUNT; i++)
+	{
+		fprintf(File, ",%s", Names[i]);
+	}
+	fprintf(File, "\n");
+
+	SynthUpdate(0);
+	HardwareInit();
+	Datalogger_Init(DATALOGGER_INIT_APPEND | DATALOGGER_INIT_RESTART_IF_FULL);
+	for(DataSet = 0; DataSet < REPLAY_PACK_DATASETS; DataSet++)
+	{
+		DataSetNumber = 0;
+		memset(DataToSave, 0, sizeof(DataToSave));
+		for(Sample = 0; Sample < REPLAY_PACK_SAMPLES; Sample++)
+		{
+			for(i = 0; i < BOARD_ADC_INPUTS; i++)
+			{
+				Random = Random * 1103515245UL + 12345UL;
+				Board_ADCInput[i] = (Random >> 8) & 0xFFFFFF;
+				if((DataSet % 8) == 0)
+				{
+					Board_ADCInput[i] = 0;
+				}
+				else if((DataSet % 8) == 1)
+				{
+					Board_ADCInput[i] = 0xFFFFFF;
+				}
+			}
+			Datalogger_AddDataSetToAverage();
+		}
+
+		Time = REPLAY_START_TIME + ((time_t)DataSet * REPLAY_PACK_SAVE_MIN * 60);
+		LogTime(Time, DataToSave);
+		Datalogger_AddDataSet(DataToSave);
+
+		Channels_Unpack(&DataToSave[DATALOGGER_TIME_SIZE], Values);
+		fprintf(File, "%u,%u,%u,%u,%u", DataToSave[0], DataToSave[1], DataToSave[2], DataToSave[3], DataToSave[4]);
+		for(i = 0; i < CHANNEL_COUNT; i++)
+		{
+			fprintf(File, ",%lu", (unsigned long)Values[i]);
+		}
+		fprintf(File, "\n");
+	}
+	Datalogger_SaveDataToFlash();
+	fclose(File);
+
+	if((FlashOutName != NULL) && (WriteFlash(FlashOutName) == 0))
+	{
+		return 1;
+	}
+	fprintf(Report, "%d data sets of %d samples logged, values in %s\n", REPLAY_PACK_DATASETS, REPLAY_PACK_SAMPLES, ValuesName);
+	if(FlashOutName != NULL)
+	{
+		fprintf(Report, "Flash image in %s, check it with 'logdecode -f raw' and cmp\n", FlashOutName);
+	}
+	fflush(Report);
+	return 0;
+}
+
+//Run the main loop with the processor sleeping between passes, with USB not attached and attached, and check the time
+//that power.c counts in each state against the board model
+static int PowerTest(FILE *Report)
+{
+	static const char * const Runs[2] = {"USB not attached", "USB attached"};
+	static const char * const States[POWER_NUMBER_OF_STATES] = {"Run", "Idle", "Power save"};
+	Power_Stats Power;
+	Board_Stats Start;
+	uint32_t Model[POWER_NUMBER_OF_STATES];
+	uint32_t RunMS;
+	uint32_t EndMS;
+	uint32_t TotalMS;
+	uint32_t Expected;
+	uint32_t Passes;
+	uint32_t FlashMS;
+	uint32_t ADCMS;
+	int Failed = 0;
+	int Run;
+	int i;
+
+	Board_ADCTiming = 1;
+	Board_SleepTiming = 1;
+	Power_SetMode(POWER_MODE_AUTO);
+	RunMS = REPLAY_POWER_MINUTES * 60000UL;
+	Expected = RunMS / (CONTROLLER_SAMPLE_TICKS * BOARD_RTC_TICK_MS);
+	for(Run = 0; Run < 2; Run++)
+	{
+		USB_DeviceState = (Run == 0) ? DEVICE_STATE_Unattached : DEVICE_STATE_Configured;
+		SynthUpdate(Board_NowMS / 1000);
+		HardwareInit();
+		StartTemperatureController(0);
+		Power_ResetStats();
+		Start = Board_Counters;
+
+		//Each pass sleeps, so the clock moves. A pass that never sleeps would run on forever.
+		EndMS = Board_NowMS + RunMS;
+		Passes = 0;
+		while((Board_NowMS < EndMS) && (Passes < (4 * RunMS)))
+		{
+			SynthUpdate(Board_NowMS / 1000);
+			Board_SetTime(REPLAY_START_TIME + (Board_NowMS / 1000));
+			MainLoopPass();
+			Passes++;
+		}
+		Power_GetStats(&Power);
+		StopTemperatureController(0);
+
+		RunMS = Board_NowMS - (EndMS - RunMS);
+		Model[POWER_STATE_IDLE] = Board_Counters.SleepIdleMS - Start.SleepIdleMS;
+		Model[POWER_STATE_SAVE] = Board_Counters.SleepSaveMS - Start.SleepSaveMS;
+		Model[POWER_STATE_RUN] = RunMS - Model[POWER_STATE_IDLE] - Model[POWER_STATE_SAVE];
+		FlashMS = Board_Counters.FlashPowerDownMS - Start.FlashPowerDownMS;
+		ADCMS = Board_Counters.ADCPowerDownMS - Start.ADCPowerDownMS;
+
+		fprintf(Report, "%s, %lu main loop passes in %.1f min:\n", Runs[Run], (unsigned long)Passes, RunMS / 60000.0);
+		fprintf(Report, "State       Firmware (ms)  Board model (ms)  Share  Sleeps\n");
+		TotalMS = 0;
+		for(i = 0; i < POWER_NUMBER_OF_STATES; i++)
+		{
+			fprintf(Report, "%-10s  %13lu  %16lu  %4.1f%%  %6lu\n", States[i], (unsigned long)Power.TimeMS[i], (unsigned long)Model[i],
+			        100.0 * Model[i] / RunMS, (unsigned long)Power.Sleeps[i]);
+			TotalMS += Power.TimeMS[i];
+			if(labs((long)Power.TimeMS[i] - (long)Model[i]) > REPLAY_POWER_ERROR_MS)
+			{
+				Failed = 1;
+			}
+		}
+		fprintf(Report, "Dataflash:          %lu ms in deep power down, %lu commands ignored\n", (unsigned long)FlashMS,
+		        (unsigned long)(Board_Counters.FlashIgnoredCommands - Start.FlashIgnoredCommands));
+		fprintf(Report, "AD7794:             %lu ms in power down (%.1f%%)\n", (unsigned long)ADCMS, 100.0 * ADCMS / RunMS);
+		fprintf(Report, "Samples:            %u of %lu\n", Power.Samples, (unsigned long)Expected);
+		fprintf(Report, "Wake to sample:     start %.3f ms (%.3f at most), done %.1f ms (%.1f at most)\n\n",
+		        Power.StartLatencyUS / 1000.0, Power.StartLatencyMaxUS / 1000.0, Power.SampleLatencyUS / 1000.0,
+		        Power.SampleLatencyMaxUS / 1000.0);
+
+		//Power save only with USB not attached, with the dataflash down all the time
+		if((Board_NowMS < EndMS) || (labs((long)TotalMS - (long)RunMS) > REPLAY_POWER_ERROR_MS) || (((uint32_t)Power.Samples + 1) < Expected) ||
+		   (Power.Samples > (Expected + 1)) || (ADCMS == 0) || (Board_Counters.FlashIgnoredCommands != Start.FlashIgnoredCommands) ||
+		   (Board_Counters.WatchdogResets != Start.WatchdogResets))
+		{
+			Failed = 1;
+		}
+		if((Run == 0) && ((Power.Sleeps[POWER_STATE_SAVE] == 0) || (FlashMS < Model[POWER_STATE_SAVE])))
+		{
+			Failed = 1;
+		}
+		if((Run == 1) && ((Power.Sleeps[POWER_STATE_SAVE] != 0) || (Model[POWER_STATE_SAVE] != 0) || (FlashMS != 0)))
+		{
+			Failed = 1;
+		}
+		RunMS = REPLAY_POWER_MINUTES * 60000UL;
+	}
+	USB_DeviceState = DEVICE_STATE_Unattached;
+	Board_SleepTiming = 0;
+	Board_ADCTiming = 0;
+	fprintf(Report, "%s\n", (Failed == 0) ? "Time in each state counted right, power save only without USB" : "Power check FAILED");
+	fflush(Report);
+	return Failed;
+}
+
+int main(int argc, char *argv[])
+{
+	ReplayTrace Trace;
+	const char *TraceName = NULL;
+	const char *FlashInName = NULL;
+	const char *FlashOutName = NULL;
+	const char *ValuesName = NULL;
+	double Hours = -1;
+	int Verbose = 0;
+	int Safety = 0;
+	int Watchdog = 0;
+	int Calibration = 0;
+	int Boot = 0;
+	int Acquire = 0;
+	int Bench = 0;
+	int Ripple = 0;
+	int Wear = 0;
+	int Range = 0;
+	int Torn = 0;
+	int Sleep = 0;
+	int LengthGiven;
+	int Option;
+	long Seconds;
+	long Time;
+	int Edge;
+	double WallStart;
+	double WallTime;
+	FILE *File;
+	FILE *Quiet = NULL;
+	FILE *Report = stdout;
+
+	while((Option = getopt(argc, argv, "i:l:f:o:p:vswcbanreqtdh")) != -1)
+	{
+		switch(Option)
+		{
+			case 'i':
+				TraceName = optarg;
+				break;
+			case 'l':
+				Hours = atof(optarg);
+				break;
+			case 'f':
+				FlashInName = optarg;
+				break;
+			case 'o':
+				FlashOutName = optarg;
+				break;
+			case 'p':
+				ValuesName = optarg;
+				break;
+			case 'v':
+				Verbose = 1;
+				break;
+			case 's':
+				Safety = 1;
+				break;
+			case 'w':
+				Watchdog = 1;
+				break;
+			case 'c':
+				Calibration = 1;
+				break;
+			case 'b':
+				Boot = 1;
+				break;
+			case 'a':
+				Acquire = 1;
+				break;
+			case 'n':
+				Bench = 1;
+				break;
+			case 'r':
+				Ripple = 1;
+				break;
+			case 'e':
+				Wear = 1;
+				break;
+			case 'q':
+				Range = 1;
+				break;
+			case 't':
+				Torn = 1;
+				break;
+			case 'd':
+				Sleep = 1;
+				break;
+			default:
+				Usage();
+				return 1;
+		}
+	}
+	if(optind != argc)
+	{
+		Usage();
+		return 1;
+	}
+
+	Board_Reset(REPLAY_START_TIME);
+	if(FlashInName != NULL)
+	{
+		File = fopen(FlashInName, "rb");
+		if(File == NULL)
+		{
+			fprintf(stderr, "Cannot open %s: %s\n", FlashInName, strerror(errno));
+			return 1;
+		}
+		if(fread(Board_Flash, 1, sizeof(Board_Flash), File) != sizeof(Board_Flash))
+		{
+			fprintf(stderr, "Warning: %s is smaller than the dataflash, the rest is left erased\n", FlashInName);
+		}
+		fclose(File);
+	}
+
+	memset(&Trace, 0, sizeof(Trace));
+	Trace.NextTime = -1;
+	if((TraceName != NULL) && (TraceOpen(&Trace, TraceName) == 0))
+	{
+		return 1;
+	}
+
+	//Run to the end of the trace unless a length is given
+	LengthGiven = ((Hours >= 0) || (TraceName != NULL)) ? 1 : 0;
+	if(Hours < 0)
+	{
+		Hours = REPLAY_DEFAULT_HOURS;
+		if(TraceName != NULL)
+		{
+			Hours = 0;
+			while(Trace.NextTime >= 0)
+			{
+				Hours = (double)Trace.NextTime / 3600.0;
+				TraceReadRow(&Trace);
+			}
+			fclose(Trace.File);
+			TraceOpen(&Trace, TraceName);
+		}
+	}
+	Seconds = (long)(Hours * 3600.0);
+
+	//The firmware prints to stdout. Throw that away unless asked for it.
+	if(Verbose == 0)
+	{
+		Quiet = fopen("/dev/null", "w");
+		if(Quiet != NULL)
+		{
+			Report = fdopen(dup(fileno(stdout)), "w");
+			stdout = Quiet;
+		}
+	}
+
+	if(Safety == 1)
+	{
+		return SafetyTest(Report);
+	}
+	if(Watchdog == 1)
+	{
+		return WatchdogTest(Report);
+	}
+	if(Calibration == 1)
+	{
+		return CalibrationTest(Report);
+	}
+	if(Boot == 1)
+	{
+		return BootTest(Report);
+	}
+	if(Acquire == 1)
+	{
+		return AcquireTest(Report);
+	}
+	if(Bench == 1)
+	{
+		return BenchTest(Report, &Trace, TraceName, (LengthGiven == 1) ? Seconds : (REPLAY_BENCH_MINUTES * 60L));
+	}
+	if(Ripple == 1)
+	{
+		return RippleTest(Report);
+	}
+	if(Wear == 1)
+	{
+		return WearTest(Report);
+	}
+	if(Range == 1)
+	{
+		return RangeTest(Report);
+	}
+	if(Torn == 1)
+	{
+		return TornTest(Report);
+	}
+	if(Sleep == 1)
+	{
+		return PowerTest(Report);
+	}
+	if(ValuesName != NULL)
+	{
+		return PackTest(Report, ValuesName, FlashOutName);
+	}
+
+	WallStart = WallSeconds();
+
+	if(TraceName != NULL)
+	{
+		TraceUpdate(&Trace, 0);
+	}
+	else
+	{
+		SynthUpdate(0);
+	}
+	HardwareInit();
+	StartTemperatureController(1);
+	Datalogger_Start();
+
+	for(Time = 0; Time < Seconds; Time++)
+	{
+		if(TraceName != NULL)
+		{
+			TraceUpdate(&Trace, Time);
+		}
+		else
+		{
+			SynthUpdate(Time);
+		}
+
+		for(Edge = 0; Edge < REPLAY_EDGES_PER_SECOND; Edge++)
+		{
+			Board_Elapse(BOARD_RTC_TICK_MS, 1);
+
+			//Main loop work
+			Supervisor_CheckIn(SUPERVISOR_TASK_LOOP);
+			TemperatureControllerTask();
+			AD7794CalibrateTask();
+			Datalogger_Process();
+			Power_Sleep();
+		}
+		Board_SetTime(Board_GetTime() + 1);
+	}
+
+	//Write out the page that is still in the dataflash buffer
+	Datalogger_SaveDataToFlash();
+	WallTime = WallSeconds() - WallStart;
+
+	if((FlashOutName != NULL) && (WriteFlash(FlashOutName) == 0))
+	{
+		return 1;
+	}
+
+	if(WallTime <= 0)
+	{
+		WallTime = 1e-6;
+	}
+	fprintf(Report, "Simulated:          %.2f hours\n", (double)Seconds / 3600.0);
+	fprintf(Report, "Wall time:          %.3f s\n", WallTime);
+	fprintf(Report, "Throughput:         %.0f simulated hours per second\n", ((double)Seconds / 3600.0) / WallTime);
+	fprintf(Report, "A/D conversions:    %lu\n", (unsigned long)Board_Counters.ADCConversions);
+	fprintf(Report, "Flash programs:     %lu\n", (unsigned long)Board_Counters.FlashPagePrograms);
+	fprintf(Report, "Flash erases:       %lu\n", (unsigned long)Board_Counters.FlashPageErases);
+	fprintf(Report, "Flash ignored:      %lu commands while in deep power down\n", (unsigned long)Board_Counters.FlashIgnoredCommands);
+	fprintf(Report, "SPI transactions:   %lu\n", (unsigned long)Board_Counters.SPITransactions);
+	fprintf(Report, "TWI transactions:   %lu (%lu failed)\n", (unsigned long)Board_Counters.TWITransactions, (unsigned long)Board_Counters.TWIErrors);
+	fflush(Report);
+	return 0;
+}
+
+/** @} */
@@ -0,0 +1,359 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Host tool to time a sequence of commands sent one at a time, batched with ';', and as macros.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	beer_heater_main
+*
+*	Opens the board's USB serial port and times a command sequence from sending the first byte until the prompt after
+*	the last command comes back:
+*		-One at a time: each command is sent after the prompt for the one before it.
+*		-Batched: all of the commands are sent on one line, separated by ';'.
+*		-Macros (-m): the commands are saved in as few macros as they fit in, then run with one line of "run" commands.
+*		 This overwrites those macros and deletes them when done.
+*
+*	A command is counted as done when the prompt is seen at the start of a line. The default sequence is 20 commands
+*	that only read from the board. Another sequence can be given with -c, one command per line.
+*
+*	Build (Linux/OS X):
+*		g++ -std=c++17 -O2 -Wall -o shellbench shellbench.cpp
+*
+*	Usage:
+*		shellbench [-c commands.txt] [-n repeats] [-t timeout_ms] [-m] /dev/ttyACM0
+*
+*	@{
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../../Board/shell.h"
+
+#define SHELLBENCH_PROMPT				'>'		//COMMAND_PROMPT in Board/commands.h
+#define SHELLBENCH_DEFAULT_REPEATS		10
+#define SHELLBENCH_DEFAULT_TIMEOUT_MS	5000
+
+typedef std::chrono::steady_clock Clock;
+
+static const char * const DefaultCommands[] =
+{
+	"gettime", "temp", "mem 3", "mem 4", "adread 0", "adread 1", "power", "energy", "safety", "fault",
+	"gettime", "temp", "mem 3", "adread 2", "adread 3", "power", "energy", "safety", "fault", "gettime",
+};
+
+static int Port = -1;
+static int TimeoutMS = SHELLBENCH_DEFAULT_TIMEOUT_MS;
+static bool AtLineStart = true;
+
+static void Usage(void)
+{
+	fprintf(stderr, "Usage: shellbench [-c commands.txt] [-n repeats] [-t timeout_ms] [-m] port\n");
+	fprintf(stderr, "  -c  Commands to send, one per line (default: 20 commands that only read from the board)\n");
+	fprintf(stderr, "  -n  Times to run each test (default %d)\n", SHELLBENCH_DEFAULT_REPEATS);
+	fprintf(stderr, "  -t  Time to wait for a prompt in ms (default %d)\n", SHELLBENCH_DEFAULT_TIMEOUT_MS);
+	fprintf(stderr, "  -m  Also time the commands saved as macros. Overwrites the macros used.\n");
+	return;
+}
+
+static bool OpenPort(const char *Name)
+{
+	struct termios Settings;
+
+	Port = open(Name, O_RDWR | O_NOCTTY);
+	if(Port < 0)
+	{
+		fprintf(stderr, "Cannot open %s: %s\n", Name, strerror(errno));
+		return false;
+	}
+	if(tcgetattr(Port, &Settings) != 0)
+	{
+		fprintf(stderr, "%s is not a serial port\n", Name);
+		return false;
+	}
+
+	//The baud rate means nothing to a CDC device, but raw mode matters
+	cfmakeraw(&Settings);
+	cfsetispeed(&Settings, B115200);
+	cfsetospeed(&Settings, B115200);
+	tcsetattr(Port, TCSANOW, &Settings);
+	tcflush(Port, TCIOFLUSH);
+	return true;
+}
+
+static bool Send(const std::string &Text)
+{
+	size_t Sent = 0;
+	ssize_t Result;
+
+	while(Sent < Text.size())
+	{
+		Result = write(Port, Text.data() + Sent, Text.size() - Sent);
+		if(Result < 0)
+		{
+			fprintf(stderr, "Write failed: %s\n", strerror(errno));
+			return false;
+		}
+		Sent += (size_t)Result;
+	}
+	return true;
+}
+
+//Read until 'Prompts' prompts have been seen. Returns false on a timeout.
+static bool WaitForPrompts(unsigned Prompts)
+{
+	struct pollfd Poll;
+	char Buffer[256];
+	ssize_t Length;
+
+	Poll.fd = Port;
+	Poll.events = POLLIN;
+	while(Prompts > 0)
+	{
+		if(poll(&Poll, 1, TimeoutMS) <= 0)
+		{
+			return false;
+		}
+		Length = read(Port, Buffer, sizeof(Buffer));
+		if(Length <= 0)
+		{
+			return false;
+		}
+		for(ssize_t i = 0; i < Length; i++)
+		{
+			if((Buffer[i] == SHELLBENCH_PROMPT) && AtLineStart && (Prompts > 0))
+			{
+				Prompts--;
+			}
+			AtLineStart = (Buffer[i] == '\r') || (Buffer[i] == '\n');
+		}
+	}
+	return true;
+}
+
+//Throw away anything left over, such as the echo after the last prompt
+static void Drain(void)
+{
+	struct pollfd Poll;
+	char Buffer[256];
+
+	Poll.fd = Port;
+	Poll.events = POLLIN;
+	while(poll(&Poll, 1, 100) > 0)
+	{
+		if(read(Port, Buffer, sizeof(Buffer)) <= 0)
+		{
+			break;
+		}
+	}
+	AtLineStart = true;
+	return;
+}
+
+//Send each line and wait for 'Prompts' prompts after each. Returns the time in ms, or a negative number on a timeout.
+static double Time(const std::vector<std::string> &Lines, unsigned Prompts)
+{
+	Clock::time_point Start;
+
+	Drain();
+	Start = Clock::now();
+	for(const std::string &Line : Lines)
+	{
+		if(!Send(Line + "\r") || !WaitForPrompts(Prompts))
+		{
+			return -1.0;
+		}
+	}
+	return std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+}
+
+static void Report(const char *Name, std::vector<double> &Times, size_t Commands)
+{
+	std::sort(Times.begin(), Times.end());
+	double Median = Times[Times.size() / 2];
+	printf("%-16s %9.1f %9.1f %9.1f %9.2f\n", Name, Times.front(), Median, Times.back(), Median / (double)Commands);
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> Commands;
+	const char *CommandsName = NULL;
+	int Repeats = SHELLBENCH_DEFAULT_REPEATS;
+	bool Macros = false;
+	int Option;
+
+	while((Option = getopt(argc, argv, "c:n:t:mh")) != -1)
+	{
+		switch(Option)
+		{
+			case 'c':
+				CommandsName = optarg;
+				break;
+			case 'n':
+				Repeats = atoi(optarg);
+				break;
+			case 't':
+				TimeoutMS = atoi(optarg);
+				break;
+			case 'm':
+				Macros = true;
+				break;
+			default:
+				Usage();
+				return 1;
+		}
+	}
+	if((optind != (argc - 1)) || (Repeats < 1))
+	{
+		Usage();
+		return 1;
+	}
+
+	if(CommandsName == NULL)
+	{
+		Commands.assign(std::begin(DefaultCommands), std::end(DefaultCommands));
+	}
+	else
+	{
+		FILE *File = fopen(CommandsName, "r");
+		char Line[256];
+
+		if(File == NULL)
+		{
+			fprintf(stderr, "Cannot open %s: %s\n", CommandsName, strerror(errno));
+			return 1;
+		}
+		while(fgets(Line, sizeof(Line), File) != NULL)
+		{
+			Line[strcspn(Line, "\r\n")] = 0;
+			if(Line[0] != 0)
+			{
+				Commands.push_back(Line);
+			}
+		}
+		fclose(File);
+		if(Commands.empty())
+		{
+			fprintf(stderr, "No commands in %s\n", CommandsName);
+			return 1;
+		}
+	}
+
+	if(!OpenPort(argv[optind]))
+	{
+		return 1;
+	}
+
+	//Get to a prompt
+	if(!Send("\r") || !WaitForPrompts(1))
+	{
+		fprintf(stderr, "No prompt from the board\n");
+		return 1;
+	}
+
+	//Each test is a list of lines and the prompts to wait for after each line
+	std::string Batch;
+	for(const std::string &Command : Commands)
+	{
+		Batch += (Batch.empty() ? "" : std::string(1, SHELL_SEPARATOR)) + Command;
+	}
+
+	std::vector<std::string> Runs;
+	std::string RunLine;
+	if(Macros)
+	{
+		std::string Macro;
+
+		for(const std::string &Command : Commands)
+		{
+			if(!Macro.empty() && ((Macro.size() + 1 + Command.size()) > (SHELL_MACRO_SIZE - 1)))
+			{
+				Runs.push_back(Macro);
+				Macro.clear();
+			}
+			Macro += (Macro.empty() ? "" : std::string(1, SHELL_SEPARATOR)) + Command;
+		}
+		Runs.push_back(Macro);
+		if((Runs.size() > SHELL_MACROS) || (Macro.size() > (SHELL_MACRO_SIZE - 1)))
+		{
+			fprintf(stderr, "The commands do not fit in %d macros of %d characters\n", SHELL_MACROS, SHELL_MACRO_SIZE - 1);
+			return 1;
+		}
+		for(size_t i = 0; i < Runs.size(); i++)
+		{
+			if(!Send("macro " + std::to_string(i) + " 1" + std::string(1, SHELL_SEPARATOR) + Runs[i] + "\r") || !WaitForPrompts(1))
+			{
+				fprintf(stderr, "Could not save macro %zu\n", i);
+				return 1;
+			}
+			RunLine += (RunLine.empty() ? "" : std::string(1, SHELL_SEPARATOR)) + "run " + std::to_string(i);
+		}
+	}
+
+	std::vector<double> Single;
+	std::vector<double> Batched;
+	std::vector<double> Macro;
+	for(int i = 0; i < Repeats; i++)
+	{
+		Single.push_back(Time(Commands, 1));
+		Batched.push_back(Time(std::vector<std::string>(1, Batch), (unsigned)Commands.size()));
+		if(Macros)
+		{
+			Macro.push_back(Time(std::vector<std::string>(1, RunLine), (unsigned)(Commands.size() + Runs.size())));
+		}
+		if((Single.back() < 0) || (Batched.back() < 0) || (Macros && (Macro.back() < 0)))
+		{
+			fprintf(stderr, "Timed out waiting for a prompt\n");
+			return 1;
+		}
+	}
+
+	if(Macros)
+	{
+		for(size_t i = 0; i < Runs.size(); i++)
+		{
+			Send("macro " + std::to_string(i) + " 0\r");
+			WaitForPrompts(1);
+		}
+	}
+
+	printf("%zu commands, %d runs\n", Commands.size(), Repeats);
+	printf("%-16s %9s %9s %9s %9s\n", "", "Min (ms)", "Med (ms)", "Max (ms)", "ms/cmd");
+	Report("One at a time", Single, Commands.size());
+	Report("Batched", Batched, Commands.size());
+	if(Macros)
+	{
+		Report("Macros", Macro, Commands.size());
+	}
+	close(Port);
+	return 0;
+}
+
+/** @} */
@@ -0,0 +1,623 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Host tool to receive the telemetry stream and report its rate, jitter and drops.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Opens the board's USB serial port, starts a stream with the "stream" command, and reads frames for the given time.
+*	Then the stream is stopped and the report is printed:
+*		-Frames received, frames the board dropped (gaps in the sequence numbers), and frames that failed their check.
+*		-The rate achieved, against the rate asked for.
+*		-The time between frames as they arrived: mean, standard deviation, and the largest difference from the period.
+*
+*		-The bytes received, per hour.
+*
+*	The frame layout comes from Board/stream.h. Fields left out by the board's deadbands are filled in with the last value
+*	received for them. Each frame can also be written out as CSV with the arrival time, which makes a recorded trace.
+*
+*	With -r, a recorded trace is read instead of the port. It is run through the deadbands given with -D (the same
+*	Stream_Filter the board uses) and the bytes per hour are reported for every field in every frame against only the
+*	fields that pass, for both formats. This is how the deadbands are picked before they are set with "deadband".
+*
+*	Build (Linux/OS X):
+*		g++ -std=c++17 -O2 -Wall -o streamstat streamstat.cpp
+*
+*	Usage:
+*		streamstat [-p period] [-f csv|bin] [-t seconds] [-o frames.csv] /dev/ttyACM0
+*		streamstat -r frames.csv [-D field:deadband:heartbeat,...]
+*
+*	@{
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../../Board/stream.h"
+
+#define STREAMSTAT_DEFAULT_PERIOD		1
+#define STREAMSTAT_DEFAULT_SECONDS		300
+
+typedef std::chrono::steady_clock Clock;
+
+/** A received frame */
+struct StreamFrame
+{
+	double Arrival;					//s from the start
+	uint16_t Sequence;
+	int32_t Temperature;			//0.0001 deg C
+	uint8_t Relay;
+	uint8_t Mask;					//The fields that were sent
+	uint32_t Value[CHANNEL_COUNT];
+};
+
+static int Port = -1;
+static std::vector<StreamFrame> Frames;
+static unsigned long BadFrames = 0;
+static unsigned long long FrameBytes = 0;
+static uint32_t LastValues[STREAM_FIELDS];		//For the fields a frame leaves out
+
+static void Usage(void)
+{
+	fprintf(stderr, "Usage: streamstat [-p period] [-f csv|bin] [-t seconds] [-o frames.csv] port\n");
+	fprintf(stderr, "       streamstat -r frames.csv [-D field:deadband:heartbeat,...]\n");
+	fprintf(stderr, "  -p  Samples per frame, %d seconds each (default %d)\n", STREAM_SAMPLE_PERIOD_S, STREAMSTAT_DEFAULT_PERIOD);
+	fprintf(stderr, "  -f  Frame format (default bin)\n");
+	fprintf(stderr, "  -t  Time to receive for (default %d)\n", STREAMSTAT_DEFAULT_SECONDS);
+	fprintf(stderr, "  -o  Write each frame as CSV\n");
+	fprintf(stderr, "  -r  Read a trace written with -o and report the bytes per hour with deadbands\n");
+	fprintf(stderr, "  -D  Deadbands for -r. Fields 0 to %d are the channels, %d is the temperature in 0.0001 C\n",
+	        CHANNEL_COUNT - 1, STREAM_FIELD_TEMPERATURE);
+	return;
+}
+
+static bool OpenPort(const char *Name)
+{
+	struct termios Settings;
+
+	Port = open(Name, O_RDWR | O_NOCTTY);
+	if(Port < 0)
+	{
+		fprintf(stderr, "Cannot open %s: %s\n", Name, strerror(errno));
+		return false;
+	}
+	if(tcgetattr(Port, &Settings) != 0)
+	{
+		fprintf(stderr, "%s is not a serial port\n", Name);
+		return false;
+	}
+	cfmakeraw(&Settings);
+	cfsetispeed(&Settings, B115200);
+	cfsetospeed(&Settings, B115200);
+	tcsetattr(Port, TCSANOW, &Settings);
+	tcflush(Port, TCIOFLUSH);
+	return true;
+}
+
+static void Send(const std::string &Text)
+{
+	if(write(Port, Text.data(), Text.size()) != (ssize_t)Text.size())
+	{
+		fprintf(stderr, "Write failed: %s\n", strerror(errno));
+	}
+	return;
+}
+
+//Fill in the fields a frame left out, and keep the ones it has for the next frame
+static void AddFrame(StreamFrame &Frame, uint32_t Values[])
+{
+	for(int i = 0; i < STREAM_FIELDS; i++)
+	{
+		if((Frame.Mask & (1 << i)) != 0)
+		{
+			LastValues[i] = Values[i];
+		}
+	}
+	for(int i = 0; i < CHANNEL_COUNT; i++)
+	{
+		Frame.Value[i] = LastValues[i];
+	}
+	Frame.Temperature = (int32_t)LastValues[STREAM_FIELD_TEMPERATURE];
+	Frames.push_back(Frame);
+	return;
+}
+
+//Take the CSV frames out of the received text. Anything that is not a frame (the command echo, the prompt) is skipped.
+static void ParseCSV(std::string &Received, double Arrival)
+{
+	size_t End;
+
+	while((End = Received.find('\n')) != std::string::npos)
+	{
+		std::string Line = Received.substr(0, End);
+		Received.erase(0, End + 1);
+
+		size_t Start = Line.find('@');
+		if(Start == std::string::npos)
+		{
+			continue;
+		}
+
+		//Sequence, temperature, relay, then the channels. The temperature and channels can be empty.
+		StreamFrame Frame;
+		long long Fields[3 + CHANNEL_COUNT];
+		bool Present[3 + CHANNEL_COUNT];
+		int Count = 0;
+		const char *Next = Line.c_str() + Start + 1;
+		char *After;
+
+		while(Count < (3 + CHANNEL_COUNT))
+		{
+			Fields[Count] = strtoll(Next, &After, 10);
+			Present[Count] = (After != Next);
+			Count++;
+			Next = After;
+			if(*Next != ',')
+			{
+				break;
+			}
+			Next++;
+		}
+		if((Count != (3 + CHANNEL_COUNT)) || ((*Next != '\r') && (*Next != 0)) || !Present[0] || !Present[2])
+		{
+			BadFrames++;
+			continue;
+		}
+
+		uint32_t Values[STREAM_FIELDS];
+		Frame.Arrival = Arrival;
+		Frame.Sequence = (uint16_t)Fields[0];
+		Frame.Relay = (uint8_t)Fields[2];
+		Frame.Mask = 0;
+		for(int i = 0; i < STREAM_FIELDS; i++)
+		{
+			int Column = (i == STREAM_FIELD_TEMPERATURE) ? 1 : (3 + i);
+
+			Values[i] = (uint32_t)Fields[Column];
+			if(Present[Column])
+			{
+				Frame.Mask |= (1 << i);
+			}
+		}
+		FrameBytes += Line.size() - Start + 1;
+		AddFrame(Frame, Values);
+	}
+	return;
+}
+
+//Take the binary frames out of the received bytes. A frame with a bad length or check is skipped a byte at a time.
+#define STREAMSTAT_GET_CHANNEL(Name, Bytes, Read, Convert)		if((Mask & (1 << CHANNEL_##Name)) != 0) { Values[CHANNEL_##Name] = Channels_GetValue(Data, Length, (Bytes)); Length += (Bytes); }
+static void ParseBinary(std::vector<uint8_t> &Received, double Arrival)
+{
+	size_t Position = 0;
+
+	while((Received.size() - Position) >= STREAM_BINARY_HEADER)
+	{
+		const uint8_t *Data = &Received[Position];
+		uint8_t Mask = Data[6];
+		uint8_t Size = Data[2] + 3;
+		uint8_t Check = 0;
+
+		if((Data[0] != STREAM_SYNC_1) || (Data[1] != STREAM_SYNC_2))
+		{
+			Position++;
+			continue;
+		}
+		if((Mask >= (1 << STREAM_FIELDS)) || (Size != Stream_BinarySize(Mask)))
+		{
+			BadFrames++;
+			Position++;
+			continue;
+		}
+		if((Received.size() - Position) < Size)
+		{
+			break;
+		}
+		for(int i = 2; i < Size; i++)
+		{
+			Check += Data[i];
+		}
+		if(Check != 0xFF)
+		{
+			BadFrames++;
+			Position++;
+			continue;
+		}
+
+		StreamFrame Frame;
+		uint32_t Values[STREAM_FIELDS];
+		uint8_t Length = STREAM_BINARY_HEADER;
+
+		Frame.Arrival = Arrival;
+		Frame.Sequence = (uint16_t)Channels_GetValue(Data, 3, 2);
+		Frame.Relay = Data[5];
+		Frame.Mask = Mask;
+		if((Mask & (1 << STREAM_FIELD_TEMPERATURE)) != 0)
+		{
+			Values[STREAM_FIELD_TEMPERATURE] = Channels_GetValue(Data, Length, 4);
+			Length += 4;
+		}
+		CHANNEL_LIST(STREAMSTAT_GET_CHANNEL)
+		FrameBytes += Size;
+		AddFrame(Frame, Values);
+		Position += Size;
+	}
+	Received.erase(Received.begin(), Received.begin() + Position);
+	return;
+}
+
+//The size of a CSV frame from the board with the fields in 'Mask'
+static size_t CSVSize(const StreamFrame &Frame, uint8_t Mask)
+{
+	size_t Size = snprintf(NULL, 0, "@%u,,%u", Frame.Sequence, Frame.Relay) + CHANNEL_COUNT + 2;
+
+	if((Mask & (1 << STREAM_FIELD_TEMPERATURE)) != 0)
+	{
+		Size += snprintf(NULL, 0, "%ld", (long)Frame.Temperature);
+	}
+	for(int i = 0; i < CHANNEL_COUNT; i++)
+	{
+		if((Mask & (1 << i)) != 0)
+		{
+			Size += snprintf(NULL, 0, "%lu", (unsigned long)Frame.Value[i]);
+		}
+	}
+	return Size;
+}
+
+//Read a trace written with -o
+static bool ReadTrace(const char *Name)
+{
+	FILE *Input = fopen(Name, "r");
+	char Line[512];
+
+	if(Input == NULL)
+	{
+		fprintf(stderr, "Cannot open %s: %s\n", Name, strerror(errno));
+		return false;
+	}
+	while(fgets(Line, sizeof(Line), Input) != NULL)
+	{
+		StreamFrame Frame;
+		double Temperature;
+		unsigned Sequence;
+		unsigned Relay;
+		int Used;
+
+		if(sscanf(Line, "%lf,%u,%lf,%u%n", &Frame.Arrival, &Sequence, &Temperature, &Relay, &Used) != 4)
+		{
+			continue;			//The heading
+		}
+		Frame.Sequence = (uint16_t)Sequence;
+		Frame.Temperature = (int32_t)std::lround(Temperature * 10000.0);
+		Frame.Relay = (uint8_t)Relay;
+		Frame.Mask = (1 << STREAM_FIELDS) - 1;
+		const char *Next = Line + Used;
+		for(int i = 0; i < CHANNEL_COUNT; i++)
+		{
+			char *After;
+
+			Frame.Value[i] = (*Next == ',') ? (uint32_t)strtoul(Next + 1, &After, 10) : 0;
+			Next = (*Next == ',') ? After : Next;
+		}
+		Frames.push_back(Frame);
+	}
+	fclose(Input);
+	if(Frames.size() < 2)
+	{
+		fprintf(stderr, "Not enough frames in %s\n", Name);
+		return false;
+	}
+	return true;
+}
+
+//"field:deadband:heartbeat,..." with the heartbeat optional
+static bool ParseDeadbands(const char *Text, Stream_Deadbands &Deadbands)
+{
+	const char *Next = Text;
+
+	while(*Next != 0)
+	{
+		char *After;
+		long Field = strtol(Next, &After, 10);
+		long Deadband;
+		long Heartbeat = STREAM_DEFAULT_HEARTBEAT;
+
+		if((After == Next) || (*After != ':') || (Field < 0) || (Field >= STREAM_FIELDS))
+		{
+			return false;
+		}
+		Next = After + 1;
+		Deadband = strtol(Next, &After, 10);
+		if((After == Next) || (Deadband < 0))
+		{
+			return false;
+		}
+		Next = After;
+		if(*Next == ':')
+		{
+			Heartbeat = strtol(Next + 1, &After, 10);
+			if((After == (Next + 1)) || (Heartbeat < 0) || (Heartbeat >= STREAM_HEARTBEAT_ERASED))
+			{
+				return false;
+			}
+			Next = After;
+		}
+		Deadbands.Deadband[Field] = (uint32_t)Deadband;
+		Deadbands.Heartbeat[Field] = (uint8_t)Heartbeat;
+		if(*Next == ',')
+		{
+			Next++;
+		}
+		else if(*Next != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//Run the trace through the deadbands and report what it would have cost
+static void ReportTrace(const Stream_Deadbands &Deadbands)
+{
+	const uint8_t All = (1 << STREAM_FIELDS) - 1;
+	Stream_FilterState State;
+	unsigned long Sent[STREAM_FIELDS] = {0};
+	unsigned long long FullCSV = 0;
+	unsigned long long FullBinary = 0;
+	unsigned long long FilteredCSV = 0;
+	unsigned long long FilteredBinary = 0;
+	double Hours = (Frames.back().Arrival - Frames.front().Arrival) * Frames.size() / (Frames.size() - 1) / 3600.0;
+
+	memset(&State, 0, sizeof(State));
+	for(const StreamFrame &Frame : Frames)
+	{
+		uint32_t Values[STREAM_FIELDS];
+		uint8_t Mask;
+
+		for(int i = 0; i < CHANNEL_COUNT; i++)
+		{
+			Values[i] = Frame.Value[i];
+		}
+		Values[STREAM_FIELD_TEMPERATURE] = (uint32_t)Frame.Temperature;
+		Mask = Stream_Filter(&Deadbands, &State, Values);
+		for(int i = 0; i < STREAM_FIELDS; i++)
+		{
+			Sent[i] += ((Mask & (1 << i)) != 0) ? 1 : 0;
+		}
+		FullCSV += CSVSize(Frame, All);
+		FullBinary += Stream_BinarySize(All);
+		FilteredCSV += CSVSize(Frame, Mask);
+		FilteredBinary += Stream_BinarySize(Mask);
+	}
+
+	printf("Trace:      %zu frames over %.2f hours\n", Frames.size(), Hours);
+	printf("%-8s %10s %10s %10s\n", "Field", "Deadband", "Heartbeat", "Sent (%)");
+	for(int i = 0; i < STREAM_FIELDS; i++)
+	{
+		printf("%-8d %10lu %10u %10.1f%s\n", i, (unsigned long)Deadbands.Deadband[i], Deadbands.Heartbeat[i],
+		       100.0 * Sent[i] / Frames.size(), (i == STREAM_FIELD_TEMPERATURE) ? "  temperature" : "");
+	}
+	printf("%-8s %14s %14s %10s\n", "Format", "All (B/h)", "Deadband (B/h)", "Saved (%)");
+	printf("%-8s %14.0f %14.0f %10.1f\n", "CSV", FullCSV / Hours, FilteredCSV / Hours, 100.0 - 100.0 * FilteredCSV / FullCSV);
+	printf("%-8s %14.0f %14.0f %10.1f\n", "Binary", FullBinary / Hours, FilteredBinary / Hours,
+	       100.0 - 100.0 * FilteredBinary / FullBinary);
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	int Period = STREAMSTAT_DEFAULT_PERIOD;
+	int Format = STREAM_FORMAT_BINARY;
+	double Seconds = STREAMSTAT_DEFAULT_SECONDS;
+	const char *OutputName = NULL;
+	const char *TraceName = NULL;
+	Stream_Deadbands Deadbands;
+	int Option;
+
+	Deadbands.Layout = STREAM_DEADBANDS_LAYOUT;
+	for(int i = 0; i < STREAM_FIELDS; i++)
+	{
+		Deadbands.Deadband[i] = STREAM_DEFAULT_DEADBAND;
+		Deadbands.Heartbeat[i] = STREAM_DEFAULT_HEARTBEAT;
+	}
+	while((Option = getopt(argc, argv, "p:f:t:o:r:D:h")) != -1)
+	{
+		switch(Option)
+		{
+			case 'p':
+				Period = atoi(optarg);
+				break;
+			case 'f':
+				if(strcmp(optarg, "csv") == 0)
+				{
+					Format = STREAM_FORMAT_CSV;
+				}
+				else if(strcmp(optarg, "bin") == 0)
+				{
+					Format = STREAM_FORMAT_BINARY;
+				}
+				else
+				{
+					Usage();
+					return 1;
+				}
+				break;
+			case 't':
+				Seconds = atof(optarg);
+				break;
+			case 'o':
+				OutputName = optarg;
+				break;
+			case 'r':
+				TraceName = optarg;
+				break;
+			case 'D':
+				if(!ParseDeadbands(optarg, Deadbands))
+				{
+					fprintf(stderr, "Bad deadbands: %s\n", optarg);
+					return 1;
+				}
+				break;
+			default:
+				Usage();
+				return 1;
+		}
+	}
+	if(TraceName != NULL)
+	{
+		if(!ReadTrace(TraceName))
+		{
+			return 1;
+		}
+		ReportTrace(Deadbands);
+		return 0;
+	}
+	if((optind != (argc - 1)) || (Period < 1) || (Period > 255) || (Seconds <= 0))
+	{
+		Usage();
+		return 1;
+	}
+	if(!OpenPort(argv[optind]))
+	{
+		return 1;
+	}
+
+	//Receive
+	std::string ReceivedText;
+	std::vector<uint8_t> ReceivedBytes;
+	struct pollfd Poll;
+	uint8_t Buffer[256];
+	Clock::time_point Start = Clock::now();
+	double Now = 0.0;
+
+	Send("stream " + std::to_string(Period) + " " + std::to_string(Format) + "\r");
+	Poll.fd = Port;
+	Poll.events = POLLIN;
+	while(Now < Seconds)
+	{
+		if(poll(&Poll, 1, 100) > 0)
+		{
+			ssize_t Length = read(Port, Buffer, sizeof(Buffer));
+			if(Length <= 0)
+			{
+				fprintf(stderr, "Read failed\n");
+				break;
+			}
+			Now = std::chrono::duration<double>(Clock::now() - Start).count();
+			if(Format == STREAM_FORMAT_CSV)
+			{
+				ReceivedText.append((const char *)Buffer, (size_t)Length);
+				ParseCSV(ReceivedText, Now);
+			}
+			else
+			{
+				ReceivedBytes.insert(ReceivedBytes.end(), Buffer, Buffer + Length);
+				ParseBinary(ReceivedBytes, Now);
+			}
+		}
+		Now = std::chrono::duration<double>(Clock::now() - Start).count();
+	}
+	Send("stream 0\r");
+
+	if(OutputName != NULL)
+	{
+		FILE *Output = fopen(OutputName, "w");
+		if(Output == NULL)
+		{
+			fprintf(stderr, "Cannot open %s: %s\n", OutputName, strerror(errno));
+			return 1;
+		}
+		fprintf(Output, "Arrival (s),Sequence,Temperature (C),Relay");
+		for(int i = 0; i < CHANNEL_COUNT; i++)
+		{
+			fprintf(Output, ",Channel %d", i);
+		}
+		fprintf(Output, "\n");
+		for(const StreamFrame &Frame : Frames)
+		{
+			fprintf(Output, "%.3f,%u,%.4f,%u", Frame.Arrival, Frame.Sequence, Frame.Temperature / 10000.0, Frame.Relay);
+			for(int i = 0; i < CHANNEL_COUNT; i++)
+			{
+				fprintf(Output, ",%lu", (unsigned long)Frame.Value[i]);
+			}
+			fprintf(Output, "\n");
+		}
+		fclose(Output);
+	}
+
+	//Report
+	double Expected = (double)Period * STREAM_SAMPLE_PERIOD_S;
+	unsigned long Dropped = 0;
+	double Sum = 0.0;
+	double SumSquares = 0.0;
+	double Worst = 0.0;
+	unsigned long Gaps = 0;
+
+	printf("Frames:     %zu received, %lu failed the check\n", Frames.size(), BadFrames);
+	if(Frames.size() < 2)
+	{
+		printf("Not enough frames for the rate\n");
+		return 1;
+	}
+	for(size_t i = 1; i < Frames.size(); i++)
+	{
+		uint16_t Step = (uint16_t)(Frames[i].Sequence - Frames[i-1].Sequence);
+		double Between = Frames[i].Arrival - Frames[i-1].Arrival;
+
+		Dropped += Step - 1;
+
+		//Only back to back frames count toward the jitter
+		if(Step == 1)
+		{
+			Sum += Between;
+			SumSquares += Between * Between;
+			Worst = std::max(Worst, std::fabs(Between - Expected));
+			Gaps++;
+		}
+	}
+	printf("Dropped:    %lu (%.2f%%)\n", Dropped, 100.0 * Dropped / (double)(Frames.size() + Dropped));
+	printf("Rate:       %.4f frames/s, asked for %.4f\n",
+	       (double)(Frames.size() - 1) / (Frames.back().Arrival - Frames.front().Arrival), 1.0 / Expected);
+	printf("Bytes:      %llu in frames, %.0f per hour\n", FrameBytes,
+	       FrameBytes * 3600.0 / (Frames.back().Arrival - Frames.front().Arrival) * (Frames.size() - 1) / Frames.size());
+	if(Gaps > 0)
+	{
+		double Mean = Sum / Gaps;
+		double Deviation = std::sqrt(std::max(0.0, SumSquares / Gaps - Mean * Mean));
+		printf("Interval:   %.3f s mean, %.1f ms standard deviation, %.1f ms worst from %.0f s\n", Mean,
+		       Deviation * 1000.0, Worst * 1000.0, Expected);
+	}
+	close(Port);
+	return 0;
+}
+
+/** @} */
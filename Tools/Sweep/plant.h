@@ -0,0 +1,178 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Lumped thermal model of the heater, the wort and the room.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Three nodes:
+*		-The heater pad, heated by the relay and losing heat to the wort.
+*		-The wort, heated by the pad and losing heat to the room.
+*		-The thermistor, which follows the wort with a first order lag.
+*
+*	The room temperature swings once a day around its average. The supply voltage can be stepped up by SupplyStep for
+*	every other SupplyStepPeriod to check how the controller handles a changing supply. The model is stepped with the
+*	RTC tick, which is much shorter than any of its time constants, so a forward Euler step is accurate enough. The
+*	state is all in Plant_State, so any number of models can run at once. This header is usable from C and C++.
+*
+*	@{
+*/
+
+#ifndef _PLANT_H_
+#define _PLANT_H_
+
+#include <math.h>
+#include <stdint.h>
+
+#define PLANT_STEP_S				0.5			//One RTC tick
+#define PLANT_DAY_S					86400.0
+
+typedef struct
+{
+	double SupplyVoltage;		//V
+	double SupplyStep;			//V added to the supply for every other SupplyStepPeriod
+	double SupplyStepPeriod;	//s
+	double HeaterResistance;	//Ohms
+	double HeaterCapacity;		//J/K
+	double WortCapacity;		//J/K
+	double HeaterToWort;		//W/K
+	double WortToRoom;			//W/K
+	double SensorLag;			//Time constant of the thermistor in s
+	double Room;				//Average room temperature in deg C
+	double RoomSwing;			//Amplitude of the daily room temperature swing in deg C
+	int32_t Noise;				//Peak noise on the thermistor reading in 0.0001 deg C
+} Plant_Params;
+
+typedef struct
+{
+	double Heater;				//deg C
+	double Wort;
+	double Sensor;
+	double Time;				//s
+	double Energy;				//Heater energy in J
+	uint32_t Random;			//Noise generator state
+} Plant_State;
+
+/** A 20 liter fermenter with a 60W heat wrap in a 15 deg C room. */
+static inline void Plant_DefaultParams(Plant_Params *Params)
+{
+	Params->SupplyVoltage = 12.0;
+	Params->SupplyStep = 0.0;
+	Params->SupplyStepPeriod = 7200.0;
+	Params->HeaterResistance = 2.4;
+	Params->HeaterCapacity = 400.0;
+	Params->WortCapacity = 20.0*4186.0;
+	Params->HeaterToWort = 4.0;
+	Params->WortToRoom = 2.5;
+	Params->SensorLag = 120.0;
+	Params->Room = 15.0;
+	Params->RoomSwing = 3.0;
+	Params->Noise = 50;
+	return;
+}
+
+/** Start with everything at 'Temperature'. Seed must not be zero. */
+static inline void Plant_Init(Plant_State *State, double Temperature, uint32_t Seed)
+{
+	State->Heater = Temperature;
+	State->Wort = Temperature;
+	State->Sensor = Temperature;
+	State->Time = 0.0;
+	State->Energy = 0.0;
+	State->Random = Seed;
+	return;
+}
+
+static inline double Plant_Room(const Plant_Params *Params, double Time)
+{
+	return Params->Room + Params->RoomSwing*sin((2.0*M_PI/PLANT_DAY_S)*Time);
+}
+
+static inline double Plant_Supply(const Plant_Params *Params, double Time)
+{
+	if((((uint32_t)(Time/Params->SupplyStepPeriod)) & 1) != 0)
+	{
+		return Params->SupplyVoltage + Params->SupplyStep;
+	}
+	return Params->SupplyVoltage;
+}
+
+/** The heater voltage in mV and current in mA, as the firmware measures them. */
+static inline void Plant_Measure(const Plant_State *State, const Plant_Params *Params, uint8_t RelayOn, uint16_t *Voltage,
+                                 int16_t *Current)
+{
+	double Supply;
+
+	Supply = Plant_Supply(Params, State->Time);
+	*Voltage = (uint16_t)lround(Supply*1000.0);
+	*Current = 0;
+	if(RelayOn == 1)
+	{
+		*Current = (int16_t)lround(Supply*1000.0/Params->HeaterResistance);
+	}
+	return;
+}
+
+/** Advance the model by one RTC tick. */
+static inline void Plant_Step(Plant_State *State, const Plant_Params *Params, uint8_t RelayOn)
+{
+	double Power;
+	double Supply;
+	double ToWort;
+	double ToRoom;
+
+	Power = 0.0;
+	if(RelayOn == 1)
+	{
+		Supply = Plant_Supply(Params, State->Time);
+		Power = (Supply*Supply)/Params->HeaterResistance;
+	}
+	ToWort = Params->HeaterToWort*(State->Heater - State->Wort);
+	ToRoom = Params->WortToRoom*(State->Wort - Plant_Room(Params, State->Time));
+
+	State->Heater += (PLANT_STEP_S/Params->HeaterCapacity)*(Power - ToWort);
+	State->Wort += (PLANT_STEP_S/Params->WortCapacity)*(ToWort - ToRoom);
+	State->Sensor += (PLANT_STEP_S/Params->SensorLag)*(State->Wort - State->Sensor);
+	State->Energy += Power*PLANT_STEP_S;
+	State->Time += PLANT_STEP_S;
+	return;
+}
+
+/** The thermistor reading in 0.0001 deg C, with triangular noise of up to +/-Params->Noise. */
+static inline int32_t Plant_Read(Plant_State *State, const Plant_Params *Params)
+{
+	int32_t Noise;
+	uint32_t x;
+
+	//xorshift32, twice
+	x = State->Random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	Noise = (int32_t)(x & 0xFFFF);
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	Noise -= (int32_t)(x & 0xFFFF);
+	State->Random = x;
+
+	return (int32_t)lround(State->Sensor*10000.0) + (int32_t)(((int64_t)Noise*Params->Noise) >> 16);
+}
+
+#endif
+/** @} */
@@ -0,0 +1,714 @@
+/*   This program is free software: you can redistribute it and/or modify
+*    it under the terms of the GNU General Public License as published by
+*    the Free Software Foundation, either version 3 of the License, or
+*    (at your option) any later version.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU General Public License for more details.
+*
+*    You should have received a copy of the GNU General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** \file
+*	\brief		Host tool to sweep the heater controller settings against a thermal model.
+*	\author		Pat Satyshur
+*	\version	1.0
+*	\date		10/19/2026
+*	\copyright	Copyright 2013, Pat Satyshur
+*	\ingroup 	hardware
+*
+*	Runs the firmware controller (Board/controller.c) against the thermal model in plant.h for every combination of Kp,
+*	Ki, relay window and deadband in the given ranges. Each run starts with the wort at room temperature and the set
+*	point above it, and is scored on:
+*		-Overshoot:		The highest wort temperature above the set point after it is first reached.
+*		-Settling time:	The time after which the wort stays within the band around the set point.
+*		-Relay cycles:	Times the relay was turned on, per day.
+*	The score is a weighted sum of the three (lower is better). A run that never settles gets SWEEP_UNSETTLED_PENALTY
+*	added, so it scores worse than every run that does, in the ranking and in the -o file. A run that never reaches the
+*	set point has not settled either: without the integral term the wort holds below the set point, inside the band but
+*	with no overshoot to count against it.
+*
+*	The runs are split evenly between the threads. A thread that runs out of work takes the upper half of the runs left
+*	to another thread, so slow runs on one thread do not hold up the sweep. Each run is seeded from its index, so the
+*	results are the same for any number of threads.
+*
+*	With -t, the autotune test in the controller is run against the model instead of a sweep. The gains it finds are
+*	then run and scored the same way, with the window and deadband given by -W and -d.
+*
+*	With -f, the controller is run with the default gains on the combined temperature from Board/fusion.c instead. Each
+*	thermistor gets its own noise (peak given by -N, in deg C) and both get the excitation drift from a board that runs
+*	5 deg C above the room. The RMS error of each thermistor, of their average and of the combined temperature is given
+*	against the temperature at the thermistors, after the first hour. 'Avg-drift' is the average with the drift taken out
+*	exactly, which shows how much of the improvement comes from the filter itself.
+*
+*	With -e, the controller holds the set point with the default gains while the supply steps up by -V volts for every
+*	other two hours, once without and once with the power feed forward. The RMS and largest error of the wort
+*	temperature are given for each.
+*
+*	With -m, the controller holds the set point for a week (or -l hours) with the supply stepping by -V volts, and the
+*	heater energy is metered with Energy_Accumulate from Board/energy.h the same way the firmware does it. The metered
+*	total is given against the energy put into the model, integrated in double precision every tick, and against the
+*	same meter in double precision, which shows how much of the error comes from the fixed point math.
+*
+*	Every mode measures the heater voltage and current from the model each sample like the firmware does, and uses the
+*	feed forward with the rated power given by -P (default CONTROLLER_DEFAULT_POWER).
+*
+*	Ranges are given as min:max:step or as a single value. The window is in seconds and the deadband and band are in deg C.
+*	Kp and Ki are in 0.1% duty per deg C (Ki per sample). Ki is rounded to the 1/16 steps the controller holds it in.
+*
+*	Build (Linux/OS X), from this directory:
+*		g++ -std=c++17 -O2 -pthread -o sweep sweep.cpp ../../Board/controller.c ../../Board/fusion.c
+*
+*	Usage:
+*		sweep [-p kp] [-i ki] [-W window] [-d deadband] [-s setpoint] [-l hours] [-b band] [-w over,settle,cycles]
+*			[-n top] [-o results.csv] [-j threads]
+*		sweep -t [-W window] [-d deadband] [-s setpoint] [-l hours] [-b band] [-w over,settle,cycles]
+*		sweep -f [-N noise] [-s setpoint] [-l hours]
+*		sweep -e [-V step] [-s setpoint] [-l hours]
+*		sweep -m [-V step] [-s setpoint] [-l hours]
+*		All modes also take [-P rated_power]
+*
+*	@{
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../../Board/controller.h"
+#include "../../Board/fusion.h"
+#include "../../Board/energy.h"
+#include "plant.h"
+
+//Runs taken from a thread's own queue at a time
+#define SWEEP_RUNS_PER_TAKE			4
+
+//Added to the score of a run that never settles. Larger than any score a run that settles can get.
+#define SWEEP_UNSETTLED_PENALTY		1.0e6
+
+/** One axis of the sweep */
+struct SweepAxis
+{
+	double Min;
+	double Max;
+	double Step;
+
+	size_t Count() const
+	{
+		if(Step <= 0.0 || Max < Min)
+		{
+			return 1;
+		}
+		return (size_t)floor((Max - Min)/Step + 1e-9) + 1;
+	}
+
+	double Value(size_t i) const
+	{
+		return Min + Step*(double)i;
+	}
+};
+
+/** The settings and results of one run */
+struct SweepRun
+{
+	Controller_Params Params;
+	double Overshoot;		//deg C
+	double SettleHours;		//Hours, or the run length if the wort never settled
+	bool Settled;
+	double CyclesPerDay;
+	double Score;
+};
+
+/** Runs left for one thread. Each queue is on its own cache line. */
+struct alignas(64) SweepQueue
+{
+	std::mutex Lock;
+	size_t Begin = 0;
+	size_t End = 0;
+};
+
+static Plant_Params Plant;
+static double RunHours = 48.0;
+static double Band = 0.2;
+static double WeightOvershoot = 10.0;
+static double WeightSettle = 1.0;
+static double WeightCycles = 0.05;
+static uint16_t RatedPower = CONTROLLER_DEFAULT_POWER;
+
+static bool ParseAxis(const char *Text, SweepAxis &Axis)
+{
+	int Fields = sscanf(Text, "%lf:%lf:%lf", &Axis.Min, &Axis.Max, &Axis.Step);
+	if(Fields == 1)
+	{
+		Axis.Max = Axis.Min;
+		Axis.Step = 0.0;
+		return true;
+	}
+	return (Fields == 3) && (Axis.Step > 0.0) && (Axis.Max >= Axis.Min);
+}
+
+//One controller sample: measure the heater, then update with the temperature
+static void ControlSample(Controller_State &Controller, Controller_Params &Params, const Plant_State &State, int32_t Temperature)
+{
+	uint16_t Voltage;
+	int16_t Current;
+
+	Plant_Measure(&State, &Plant, Controller.RelayOn, &Voltage, &Current);
+	Controller_Measure(&Controller, Voltage, Current, Controller.RelayOn);
+	Controller_Update(&Controller, &Params, Temperature);
+}
+
+//Run the controller against the plant and score it
+static void Simulate(SweepRun &Run, uint32_t Seed)
+{
+	Controller_State Controller;
+	Plant_State State;
+	uint32_t Ticks = (uint32_t)(RunHours*3600.0/PLANT_STEP_S);
+	double SetPoint = (double)Run.Params.SetPoint/10000.0;
+	double LastOutside = 0.0;
+	double Overshoot = 0.0;
+	bool Reached = false;
+
+	Controller_Init(&Controller);
+	Plant_Init(&State, Plant.Room, Seed);
+
+	for(uint32_t Tick = 0; Tick < Ticks; Tick++)
+	{
+		if((Tick % CONTROLLER_SAMPLE_TICKS) == 0)
+		{
+			ControlSample(Controller, Run.Params, State, Plant_Read(&State, &Plant));
+		}
+		Plant_Step(&State, &Plant, Controller_Tick(&Controller, &Run.Params));
+
+		double Error = State.Wort - SetPoint;
+		if(Error >= 0.0)
+		{
+			Reached = true;
+		}
+		if(Reached && Error > Overshoot)
+		{
+			Overshoot = Error;
+		}
+		if(fabs(Error) > Band)
+		{
+			LastOutside = State.Time;
+		}
+	}
+
+	Run.Overshoot = Overshoot;
+	Run.Settled = Reached && (LastOutside < State.Time - 3600.0);		//Must hold for at least the last hour
+	Run.SettleHours = Run.Settled ? (LastOutside/3600.0) : RunHours;
+	Run.CyclesPerDay = (double)Controller.RelayCycles*24.0/RunHours;
+	Run.Score = WeightOvershoot*Run.Overshoot + WeightSettle*Run.SettleHours + WeightCycles*Run.CyclesPerDay;
+	if(!Run.Settled)
+	{
+		Run.Score += SWEEP_UNSETTLED_PENALTY;
+	}
+	return;
+}
+
+//Take runs from this thread's queue, or steal half of the runs left to another thread
+static bool TakeRuns(std::vector<SweepQueue> &Queues, unsigned Self, size_t &Begin, size_t &End, bool &Stolen)
+{
+	Stolen = false;
+	{
+		std::lock_guard<std::mutex> Guard(Queues[Self].Lock);
+		if(Queues[Self].Begin < Queues[Self].End)
+		{
+			Begin = Queues[Self].Begin;
+			End = std::min(Begin + SWEEP_RUNS_PER_TAKE, Queues[Self].End);
+			Queues[Self].Begin = End;
+			return true;
+		}
+	}
+
+	for(unsigned i = 1; i < Queues.size(); i++)
+	{
+		unsigned Victim = (Self + i) % Queues.size();
+		size_t StolenBegin;
+		size_t StolenEnd;
+		{
+			std::lock_guard<std::mutex> Guard(Queues[Victim].Lock);
+			size_t Left = Queues[Victim].End - Queues[Victim].Begin;
+			if(Left == 0)
+			{
+				continue;
+			}
+			StolenBegin = Queues[Victim].End - (Left + 1)/2;
+			StolenEnd = Queues[Victim].End;
+			Queues[Victim].End = StolenBegin;
+		}
+
+		//Run the first few now and leave the rest where other threads can steal them
+		Begin = StolenBegin;
+		End = std::min(Begin + SWEEP_RUNS_PER_TAKE, StolenEnd);
+		std::lock_guard<std::mutex> Guard(Queues[Self].Lock);
+		Queues[Self].Begin = End;
+		Queues[Self].End = StolenEnd;
+		Stolen = true;
+		return true;
+	}
+
+	//Runs are never added, so once every queue is empty the sweep is done
+	return false;
+}
+
+static void PrintRun(size_t Rank, const SweepRun &Run)
+{
+	printf("%4zu  %6u  %6.2f  %9.1f  %11.3f  %12.3f  %8.2f%c  %10.1f  %8.3f\n", Rank, Run.Params.Kp,
+	       (double)Run.Params.Ki/(1 << CONTROLLER_KI_SHIFT), Run.Params.Window*PLANT_STEP_S, Run.Params.Deadband/10000.0,
+	       Run.Overshoot, Run.SettleHours, Run.Settled ? ' ' : '*', Run.CyclesPerDay, Run.Score);
+}
+
+//Run the autotune test against the plant, then score the gains it found
+static int Autotune(SweepRun &Run)
+{
+	Controller_State Controller;
+	Plant_State State;
+	uint32_t Tick = 0;
+
+	Controller_Init(&Controller);
+	Plant_Init(&State, Plant.Room, 1);
+	Controller_TuneStart(&Controller, CONTROLLER_TUNE_HYSTERESIS);
+	while(Controller.Tune.Status == CONTROLLER_TUNE_RUNNING)
+	{
+		if((Tick % CONTROLLER_SAMPLE_TICKS) == 0)
+		{
+			ControlSample(Controller, Run.Params, State, Plant_Read(&State, &Plant));
+		}
+		Plant_Step(&State, &Plant, Controller_Tick(&Controller, &Run.Params));
+		Tick++;
+	}
+	if(Controller.Tune.Status != CONTROLLER_TUNE_DONE)
+	{
+		printf("Autotune failed after %.2f hours\n", State.Time/3600.0);
+		return 1;
+	}
+
+	double Amplitude = Controller.Tune.Amplitude/10000.0;
+	double Period = Controller.Tune.Period*CONTROLLER_SAMPLE_TICKS*PLANT_STEP_S;
+	printf("Autotune finished in %.2f hours (%u relay cycles)\n", State.Time/3600.0, Controller.Tune.Rises);
+	printf("Amplitude %.4f C, period %.1f min: Ku %.0f, Tu %.1f min\n", Amplitude, Period/60.0,
+	       4.0*(CONTROLLER_DUTY_MAX/2)/(M_PI*Amplitude), Period/60.0);
+
+	Simulate(Run, 1);
+	printf("\nRank      Kp      Ki  Window(s)  Deadband(C)  Overshoot(C)  Settle(h)  Cycles/day     Score\n");
+	PrintRun(1, Run);
+	printf("* did not reach the set point and then stay within +/-%.2f C\n", Band);
+	return 0;
+}
+
+//Run the controller on the combined thermistor temperature and compare the errors
+static int FusionCheck(double SetPoint, double Noise)
+{
+	Controller_Params Params = {(int32_t)lround(SetPoint*10000.0), CONTROLLER_DEFAULT_KP, CONTROLLER_DEFAULT_KI,
+	                            CONTROLLER_DEFAULT_WINDOW, CONTROLLER_DEFAULT_DEADBAND, RatedPower};
+	Fusion_Params Filter = {FUSION_DEFAULT_PROCESS, 0, 0, FUSION_DEFAULT_DRIFT};
+	Controller_State Controller;
+	Fusion_State Fused;
+	Plant_State State;
+	uint32_t Ticks = (uint32_t)(RunHours*3600.0/PLANT_STEP_S);
+	double Squares[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+	double VarianceSum = 0.0;
+	uint32_t Samples = 0;
+	uint32_t Rejected = 0;
+
+	//Triangular noise with a peak of N has a variance of N^2/6
+	Plant.Noise = (int32_t)lround(Noise*10000.0);
+	Filter.RedNoise = (uint32_t)((double)Plant.Noise*Plant.Noise/6.0) + 1;
+	Filter.BlackNoise = Filter.RedNoise;
+
+	Controller_Init(&Controller);
+	Fusion_Init(&Fused);
+	Plant_Init(&State, Plant.Room, 1);
+	for(uint32_t Tick = 0; Tick < Ticks; Tick++)
+	{
+		if((Tick % CONTROLLER_SAMPLE_TICKS) == 0)
+		{
+			double Board = Plant_Room(&Plant, State.Time) + 5.0;
+			int32_t Drift = (int32_t)lround(-FUSION_DEFAULT_DRIFT*(Board - FUSION_DRIFT_REFERENCE/10000.0));
+			int32_t Red = Plant_Read(&State, &Plant) + Drift;
+			int32_t Black = Plant_Read(&State, &Plant) + Drift;
+			int32_t Estimate = Fusion_Update(&Fused, &Filter, Red, Black, (int32_t)lround(Board*10000.0));
+			ControlSample(Controller, Params, State, Estimate);
+
+			if(State.Time >= 3600.0)
+			{
+				double Truth = State.Sensor*10000.0;
+				double Errors[5] = {Red - Truth, Black - Truth, (Red + Black)/2.0 - Truth, (Red + Black)/2.0 - Drift - Truth,
+				                    Estimate - Truth};
+				for(int i = 0; i < 5; i++)
+				{
+					Squares[i] += Errors[i]*Errors[i];
+				}
+				VarianceSum += Fused.Variance;
+				Samples++;
+				if(Fused.Used != (FUSION_USED_RED|FUSION_USED_BLACK))
+				{
+					Rejected++;
+				}
+			}
+		}
+		Plant_Step(&State, &Plant, Controller_Tick(&Controller, &Params));
+	}
+
+	const char *Names[5] = {"Red", "Black", "Average", "Avg-drift", "Combined"};
+	printf("%u samples, thermistor noise +/-%.4f C peak\n", Samples, Noise);
+	printf("              RMS error (C)\n");
+	for(int i = 0; i < 5; i++)
+	{
+		printf("%-10s    %.5f\n", Names[i], sqrt(Squares[i]/Samples)/10000.0);
+	}
+	printf("Combined standard deviation reported by the filter: %.5f C\n", sqrt(VarianceSum/Samples)/10000.0);
+	printf("Error variance of Avg-drift over Combined: %.1f\n", Squares[3]/Squares[4]);
+	printf("Samples with a reading thrown out: %u\n", Rejected);
+	return 0;
+}
+
+//Hold the set point while the supply voltage steps, with and without the power feed forward
+static int SupplyCheck(double SetPoint, double Step)
+{
+	Plant.SupplyStep = Step;
+	printf("Supply %.1f V stepping to %.1f V every %.1f hours, %.0f hours from the set point\n", Plant.SupplyVoltage,
+	       Plant.SupplyVoltage + Step, Plant.SupplyStepPeriod/3600.0, RunHours);
+	printf("Feed forward  RMS error (C)  Max error (C)  Cycles/day\n");
+	for(int FeedForward = 0; FeedForward < 2; FeedForward++)
+	{
+		Controller_Params Params = {(int32_t)lround(SetPoint*10000.0), CONTROLLER_DEFAULT_KP, CONTROLLER_DEFAULT_KI,
+		                            CONTROLLER_DEFAULT_WINDOW, CONTROLLER_DEFAULT_DEADBAND, (uint16_t)(FeedForward ? RatedPower : 0)};
+		Controller_State Controller;
+		Plant_State State;
+		uint32_t Ticks = (uint32_t)(RunHours*3600.0/PLANT_STEP_S);
+		double Squares = 0.0;
+		double MaxError = 0.0;
+		uint32_t Samples = 0;
+
+		Controller_Init(&Controller);
+		Plant_Init(&State, SetPoint, 1);
+		for(uint32_t Tick = 0; Tick < Ticks; Tick++)
+		{
+			if((Tick % CONTROLLER_SAMPLE_TICKS) == 0)
+			{
+				ControlSample(Controller, Params, State, Plant_Read(&State, &Plant));
+			}
+			Plant_Step(&State, &Plant, Controller_Tick(&Controller, &Params));
+
+			//Let the integral settle before the first step
+			if(State.Time >= Plant.SupplyStepPeriod)
+			{
+				double Error = State.Wort - SetPoint;
+				Squares += Error*Error;
+				MaxError = std::max(MaxError, fabs(Error));
+				Samples++;
+			}
+		}
+		printf("%-12s  %13.4f  %13.4f  %10.1f\n", FeedForward ? "on" : "off", sqrt(Squares/Samples), MaxError,
+		       (double)Controller.RelayCycles*24.0/RunHours);
+	}
+	return 0;
+}
+
+//Meter the heater energy like the firmware and check it against the model
+static int EnergyCheck(double SetPoint, double Step)
+{
+	Controller_Params Params = {(int32_t)lround(SetPoint*10000.0), CONTROLLER_DEFAULT_KP, CONTROLLER_DEFAULT_KI,
+	                            CONTROLLER_DEFAULT_WINDOW, CONTROLLER_DEFAULT_DEADBAND, RatedPower};
+	Controller_State Controller;
+	Plant_State State;
+	Energy_Counter Meter = {0, 0};
+	uint32_t Ticks = (uint32_t)(RunHours*3600.0/PLANT_STEP_S);
+	uint16_t OnTicks = 0;
+	double Exact = 0.0;
+
+	Plant.SupplyStep = Step;
+	Controller_Init(&Controller);
+	Plant_Init(&State, SetPoint, 1);
+	for(uint32_t Tick = 0; Tick < Ticks; Tick++)
+	{
+		if((Tick % CONTROLLER_SAMPLE_TICKS) == 0)
+		{
+			ControlSample(Controller, Params, State, Plant_Read(&State, &Plant));
+			Energy_Accumulate(&Meter, Controller.HeaterPower, OnTicks);
+			Exact += (double)Controller.HeaterPower*OnTicks*PLANT_STEP_S/3600.0;
+			OnTicks = 0;
+		}
+		uint8_t RelayOn = Controller_Tick(&Controller, &Params);
+		if(RelayOn == 1)
+		{
+			OnTicks++;
+		}
+		Plant_Step(&State, &Plant, RelayOn);
+	}
+	Energy_Accumulate(&Meter, Controller.HeaterPower, OnTicks);
+	Exact += (double)Controller.HeaterPower*OnTicks*PLANT_STEP_S/3600.0;
+
+	double Model = State.Energy/3.6;
+	double Metered = (double)Meter.MilliWattHours + (double)Meter.Remainder/ENERGY_UNITS_PER_MWH;
+	printf("Supply %.1f V stepping to %.1f V every %.1f hours, %.0f hours at the set point\n", Plant.SupplyVoltage,
+	       Plant.SupplyVoltage + Step, Plant.SupplyStepPeriod/3600.0, RunHours);
+	printf("Model energy:        %14.3f Wh\n", Model/1000.0);
+	printf("Metered (double):    %14.3f Wh  %+.4f%%\n", Exact/1000.0, (Exact - Model)*100.0/Model);
+	printf("Metered (firmware):  %14.3f Wh  %+.4f%%\n", Metered/1000.0, (Metered - Model)*100.0/Model);
+	printf("Fixed point error:   %14.6f mWh\n", Metered - Exact);
+	return 0;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr, "Usage: sweep [-p kp] [-i ki] [-W window] [-d deadband] [-s setpoint] [-l hours] [-b band] [-w over,settle,cycles]\n"
+	                "             [-n top] [-o results.csv] [-j threads]\n"
+	                "       sweep -t [-W window] [-d deadband] [-s setpoint] [-l hours] [-b band] [-w over,settle,cycles]\n"
+	                "       sweep -f [-N noise] [-s setpoint] [-l hours]\n"
+	                "       sweep -e [-V step] [-s setpoint] [-l hours]\n"
+	                "       sweep -m [-V step] [-s setpoint] [-l hours]\n"
+	                "All modes also take [-P rated_power] (0 turns off the feed forward)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	SweepAxis Kp = {100.0, 2000.0, 100.0};
+	SweepAxis Ki = {0.0, 20.0, 2.0};
+	SweepAxis Window = {30.0, 300.0, 30.0};
+	SweepAxis Deadband = {0.0, 0.25, 0.05};
+	double SetPoint = 20.0;
+	size_t Top = 20;
+	const char *OutputName = NULL;
+	unsigned Threads = std::thread::hardware_concurrency();
+	bool Tune = false;
+	bool Fusion = false;
+	bool Supply = false;
+	bool Meter = false;
+	bool LengthGiven = false;
+	double Noise = 0.02;
+	double Step = 3.0;
+	int Option;
+
+	Plant_DefaultParams(&Plant);
+
+	while((Option = getopt(argc, argv, "p:i:W:d:s:l:b:w:n:o:j:tfN:emV:P:h")) != -1)
+	{
+		bool Good = true;
+		switch(Option)
+		{
+			case 'p':
+				Good = ParseAxis(optarg, Kp);
+				break;
+			case 'i':
+				Good = ParseAxis(optarg, Ki);
+				break;
+			case 'W':
+				Good = ParseAxis(optarg, Window);
+				break;
+			case 'd':
+				Good = ParseAxis(optarg, Deadband);
+				break;
+			case 's':
+				SetPoint = atof(optarg);
+				break;
+			case 'l':
+				RunHours = atof(optarg);
+				LengthGiven = true;
+				Good = (RunHours > 1.0);
+				break;
+			case 'b':
+				Band = atof(optarg);
+				break;
+			case 'w':
+				Good = (sscanf(optarg, "%lf,%lf,%lf", &WeightOvershoot, &WeightSettle, &WeightCycles) == 3);
+				break;
+			case 'n':
+				Top = (size_t)atoi(optarg);
+				break;
+			case 'o':
+				OutputName = optarg;
+				break;
+			case 'j':
+				Threads = (unsigned)atoi(optarg);
+				break;
+			case 't':
+				Tune = true;
+				break;
+			case 'f':
+				Fusion = true;
+				break;
+			case 'N':
+				Noise = atof(optarg);
+				Good = (Noise > 0.0);
+				break;
+			case 'e':
+				Supply = true;
+				break;
+			case 'm':
+				Meter = true;
+				break;
+			case 'V':
+				Step = atof(optarg);
+				break;
+			case 'P':
+				RatedPower = (uint16_t)atoi(optarg);
+				break;
+			default:
+				Good = false;
+				break;
+		}
+		if(!Good)
+		{
+			Usage();
+			return 1;
+		}
+	}
+	if(optind != argc)
+	{
+		Usage();
+		return 1;
+	}
+	if(Threads == 0)
+	{
+		Threads = 1;
+	}
+
+	if(Fusion)
+	{
+		return FusionCheck(SetPoint, Noise);
+	}
+	if(Supply)
+	{
+		return SupplyCheck(SetPoint, Step);
+	}
+	if(Meter)
+	{
+		if(!LengthGiven)
+		{
+			RunHours = 168.0;
+		}
+		return EnergyCheck(SetPoint, Step);
+	}
+	if(Tune)
+	{
+		SweepRun Run = {};
+		Run.Params.SetPoint = (int32_t)lround(SetPoint*10000.0);
+		Run.Params.Window = (uint16_t)std::max(1L, lround(Window.Value(0)/PLANT_STEP_S));
+		Run.Params.Deadband = (uint16_t)lround(Deadband.Value(0)*10000.0);
+		Run.Params.RatedPower = RatedPower;
+		return Autotune(Run);
+	}
+
+	//Lay out every combination
+	std::vector<SweepRun> Runs;
+	Runs.reserve(Kp.Count()*Ki.Count()*Window.Count()*Deadband.Count());
+	for(size_t a = 0; a < Kp.Count(); a++)
+	{
+		for(size_t b = 0; b < Ki.Count(); b++)
+		{
+			for(size_t c = 0; c < Window.Count(); c++)
+			{
+				for(size_t d = 0; d < Deadband.Count(); d++)
+				{
+					SweepRun Run = {};
+					Run.Params.SetPoint = (int32_t)lround(SetPoint*10000.0);
+					Run.Params.Kp = (uint16_t)lround(Kp.Value(a));
+					Run.Params.Ki = (uint16_t)lround(Ki.Value(b)*(1 << CONTROLLER_KI_SHIFT));
+					Run.Params.Window = (uint16_t)std::max(1L, lround(Window.Value(c)/PLANT_STEP_S));
+					Run.Params.Deadband = (uint16_t)lround(Deadband.Value(d)*10000.0);
+					Run.Params.RatedPower = RatedPower;
+					Runs.push_back(Run);
+				}
+			}
+		}
+	}
+	if(Threads > Runs.size())
+	{
+		Threads = (unsigned)Runs.size();
+	}
+
+	std::vector<SweepQueue> Queues(Threads);
+	for(unsigned i = 0; i < Threads; i++)
+	{
+		Queues[i].Begin = Runs.size()*i/Threads;
+		Queues[i].End = Runs.size()*(i + 1)/Threads;
+	}
+	std::atomic<uint32_t> Steals(0);
+
+	auto Worker = [&](unsigned Self)
+	{
+		size_t Begin;
+		size_t End;
+		bool Stolen;
+		while(TakeRuns(Queues, Self, Begin, End, Stolen))
+		{
+			if(Stolen)
+			{
+				Steals++;
+			}
+			for(size_t i = Begin; i < End; i++)
+			{
+				Simulate(Runs[i], (uint32_t)(i*2654435761u) | 1u);
+			}
+		}
+	};
+
+	auto Start = std::chrono::steady_clock::now();
+	std::vector<std::thread> Pool;
+	for(unsigned i = 0; i < Threads; i++)
+	{
+		Pool.emplace_back(Worker, i);
+	}
+	for(std::thread &T : Pool)
+	{
+		T.join();
+	}
+	double Wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+	if(OutputName != NULL)
+	{
+		FILE *Output = fopen(OutputName, "w");
+		if(Output == NULL)
+		{
+			fprintf(stderr, "Cannot open %s: %s\n", OutputName, strerror(errno));
+			return 1;
+		}
+		fprintf(Output, "kp,ki,window_s,deadband_c,overshoot_c,settle_h,settled,cycles_per_day,score\n");
+		for(const SweepRun &Run : Runs)
+		{
+			fprintf(Output, "%u,%.4f,%.1f,%.4f,%.4f,%.3f,%d,%.1f,%.4f\n", Run.Params.Kp, (double)Run.Params.Ki/(1 << CONTROLLER_KI_SHIFT), Run.Params.Window*PLANT_STEP_S,
+			        Run.Params.Deadband/10000.0, Run.Overshoot, Run.SettleHours, Run.Settled ? 1 : 0, Run.CyclesPerDay, Run.Score);
+		}
+		fclose(Output);
+	}
+
+	std::vector<size_t> Order(Runs.size());
+	for(size_t i = 0; i < Order.size(); i++)
+	{
+		Order[i] = i;
+	}
+	std::stable_sort(Order.begin(), Order.end(), [&](size_t a, size_t b)
+	{
+		return Runs[a].Score < Runs[b].Score;
+	});
+
+	printf("Rank      Kp      Ki  Window(s)  Deadband(C)  Overshoot(C)  Settle(h)  Cycles/day     Score\n");
+	for(size_t i = 0; i < std::min(Top, Order.size()); i++)
+	{
+		PrintRun(i + 1, Runs[Order[i]]);
+	}
+	printf("\n%zu runs of %.1f hours on %u threads in %.2f s (%.0f runs per minute, %u steals)\n", Runs.size(), RunHours,
+	       Threads, Wall, (double)Runs.size()*60.0/Wall, Steals.load());
+	printf("* did not reach the set point and then stay within +/-%.2f C\n", Band);
+	return 0;
+}
+
+/** @} */
@@ -90,9 +90,14 @@ int main(void)
 	//OldButtonState = GetButtonState();
 	for (;;)
 	{
+		Supervisor_CheckIn(SUPERVISOR_TASK_LOOP);
+		Shell_Task();
 		RunCommand();
+		Stream_Flush();
 		HandleButtonPress();
 		TemperatureControllerTask();
+		AD7794CalibrateTask();
+		Power_Sleep();
 	}
 }
 
@@ -114,6 +119,7 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 	bool ConfigSuccess = true;
 
 	ConfigSuccess &= CDC_Device_ConfigureEndpoints(&VirtualSerial_CDC_Interface);
+	Boot_Mark(BOOT_STAGE_USB_CONFIGURED);
 
 	LEDs_SetAllLEDs(ConfigSuccess ? LEDMASK_USB_READY : LEDMASK_USB_ERROR);
 }
@@ -56,16 +56,31 @@
 		#include "twi.h"
 		#include "common_types.h"
 		
+		#include "controller.h"
+		#include "fusion.h"
+		#include "energy.h"
+		#include "safety.h"
+		#include "supervisor.h"
+		#include "shell.h"
+		#include "stream.h"
 		#include "Board/Hardware.h"
+		#include "heater.h"
 		#include "commands.h"
 		#include "dfu_jump.h"
+		#include "spibus.h"
 		#include "ad7794.h"
+		#include "twibus.h"
 		#include "max7315.h"
 		#include "at45db321d.h"
+		#include "channels.h"
 		#include "datalogger.h"
 		#include "ds3232m.h"
 		#include "thermistor.h"
 		#include "status.h"
+		#include "power.h"
+		#include "boot.h"
+		#include "acquire.h"
+		#include "ripple.h"
 		
 	/* Macros: */
 		/** LED mask for the library LED driver, to indicate that the USB interface is not ready. */